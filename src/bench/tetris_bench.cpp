@@ -0,0 +1,750 @@
+// Headless benchmarks of the engine, no SDL involved
+//   tetris_bench engine [instances] [ticks]
+//   tetris_bench movegen [boards]
+//   tetris_bench features [boards]
+//   tetris_bench bot [pieces] [budget ms]
+//   tetris_bench pc [openings]
+//   tetris_bench mcts [seeds] [playouts] [pieces]
+//   tetris_bench nn <network> [boards] [seeds]
+//   tetris_bench external "<bot command>" [pieces]
+//   tetris_bench book <book> [seeds]
+//   tetris_bench hint [pieces]
+//   tetris_bench env [games] [steps] [threads]
+//   tetris_bench stream <replay>...
+//
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include "../engine/tetris_engine.h"
+#include "../process/bag_generator.h"
+#include "../bot/move_generator.h"
+#include "../bot/bot_controller.h"
+#include "../bot/hint_controller.h"
+#include "../bot/external_bot.h"
+#include "../bot/pc_solver.h"
+#include "../bot/opening_book.h"
+#include "../engine/attack_rules.h"
+#include "../sim/sim_bot.h"
+#include "../env/tetris_env.h"
+#include "../engine/zobrist.h"
+#include "../engine/replay.h"
+#include "../engine/board_stream.h"
+
+namespace {
+    // one simulated player: an engine and the generator it draws from
+    struct BenchInstance {
+        SevenBagGenerator generator;
+        TetrisEngine engine;
+        uint64_t rng;
+
+        BenchInstance(TetrisConfig *config, const int64_t seed) : generator(seed), engine(config, &generator), rng(seed * 2654435761ULL + 1) {
+            // keep the instance alive forever, a top out just wipes the matrix
+            TetrisEngine *target = &engine;
+            engine.runOnGameOver([target]() { target->resetPlayfield(); });
+            engine.start(false);
+        }
+
+        // xorshift64, cheap enough to not show up in the measurements
+        uint64_t nextRandom() {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            return rng;
+        }
+
+        void step() {
+            switch (nextRandom() % 16) {
+                case 0: engine.moveLeft(); break;
+                case 1: engine.moveRight(); break;
+                case 2: engine.rotateCW(); break;
+                case 3: engine.rotateCCW(); break;
+                case 4: engine.hardDrop(); break;
+                default: break;
+            }
+            engine.tick();
+        }
+    };
+
+    // resident set size in kB (Linux only, 0 elsewhere)
+    long residentSetKb() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmRSS:", 0) == 0) return std::stol(line.substr(6));
+        }
+        return 0;
+    }
+
+    double secondsSince(const std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    int benchEngine(const int instances, const int ticks) {
+        TetrisConfig *config = TetrisConfig::builder();
+
+        std::cout << "sizeof(TetrisEngineState) = " << sizeof(TetrisEngineState) << "\n"
+                  << "sizeof(TetrisEngineCold)  = " << sizeof(TetrisEngineCold) << "\n"
+                  << "sizeof(TetrisEngine)      = " << sizeof(TetrisEngine) << "\n";
+
+        const long rssBefore = residentSetKb();
+        std::vector<std::unique_ptr<BenchInstance>> pool;
+        pool.reserve(instances);
+        for (int i = 0; i < instances; ++i) {
+            pool.push_back(std::make_unique<BenchInstance>(config, 1000 + i));
+        }
+        const long rssAfter = residentSetKb();
+        if (rssBefore > 0) {
+            std::cout << instances << " instances: " << (rssAfter - rssBefore) / 1024.0 << " MB RSS ("
+                      << (rssAfter - rssBefore) * 1024.0 / instances << " bytes each)\n";
+        }
+
+        // single thread
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < ticks; ++t) {
+            for (auto &instance : pool) instance->step();
+        }
+        double elapsed = secondsSince(start);
+        const double total = static_cast<double>(instances) * ticks;
+        std::cout << "1 thread:  " << total / elapsed / 1e6 << " M ticks/s\n";
+
+        // every core, one slice of the pool each
+        const int threads = std::max(1u, std::thread::hardware_concurrency());
+        start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int w = 0; w < threads; ++w) {
+            workers.emplace_back([&pool, w, threads, ticks, instances]() {
+                const int from = static_cast<int>(static_cast<long long>(instances) * w / threads);
+                const int to = static_cast<int>(static_cast<long long>(instances) * (w + 1) / threads);
+                for (int t = 0; t < ticks; ++t) {
+                    for (int i = from; i < to; ++i) pool[i]->step();
+                }
+            });
+        }
+        for (auto &worker : workers) worker.join();
+        elapsed = secondsSince(start);
+        std::cout << threads << " threads: " << total / elapsed / 1e6 << " M ticks/s ("
+                  << total / elapsed / threads / 1e6 << " M per core)\n";
+
+        pool.clear();
+        delete config;
+        return 0;
+    }
+
+    // random messy stacks, 0 to 11 rows high, never a full row
+    std::vector<std::vector<uint16_t>> randomStacks(const int boards) {
+        uint64_t rng = 88172645463325252ULL;
+        const auto nextRandom = [&rng]() {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            return rng;
+        };
+        std::vector<std::vector<uint16_t>> playfields(boards, std::vector<uint16_t>(Bitboard::HEIGHT, 0));
+        for (auto &rows : playfields) {
+            const int height = static_cast<int>(nextRandom() % 12);
+            for (int y = Bitboard::HEIGHT - 1; y >= Bitboard::HEIGHT - height; --y) {
+                rows[y] = static_cast<uint16_t>((nextRandom() | nextRandom()) & Bitboard::FULL_ROW);
+                if (rows[y] == Bitboard::FULL_ROW) rows[y] ^= 1 << (nextRandom() % Bitboard::WIDTH);
+            }
+        }
+        return playfields;
+    }
+
+    int benchMoveGenerator(const int boards) {
+        const std::vector<std::vector<uint16_t>> playfields = randomStacks(boards);
+
+        const MoveGenerator generator;
+        std::vector<Placement> placements;
+        long long found = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto &rows : playfields) {
+            for (int type = 0; type < MinoType::valuesLength; ++type) {
+                generator.generate(rows.data(), type, placements);
+                found += static_cast<long long>(placements.size());
+            }
+        }
+        const double elapsed = secondsSince(start);
+        const double pieces = static_cast<double>(boards) * MinoType::valuesLength;
+        std::cout << pieces << " pieces: " << elapsed * 1e6 / pieces << " us per piece, "
+                  << found / pieces << " placements per piece\n";
+        return 0;
+    }
+
+    int benchFeatures(const int boards) {
+        const std::vector<std::vector<uint16_t>> playfields = randomStacks(boards);
+        std::vector<const uint16_t *> pointers;
+        for (const auto &rows : playfields) pointers.push_back(rows.data());
+
+        // the scalar version is the reference
+        std::vector<BoardFeatures> reference(boards);
+        for (int i = 0; i < boards; ++i) reference[i] = BoardEval::extractFeatures(pointers[i]);
+
+        const BoardEval::SimdLevel supported = BoardEval::detectSimdLevel();
+        const char *names[] = {"scalar", "sse2", "avx2"};
+        int failures = 0;
+        for (int level = BoardEval::SIMD_SCALAR; level <= supported; ++level) {
+            std::vector<BoardFeatures> features(boards);
+            const auto start = std::chrono::steady_clock::now();
+            BoardEval::extractFeaturesBatch(pointers.data(), boards, features.data(),
+                                            static_cast<BoardEval::SimdLevel>(level));
+            const double elapsed = secondsSince(start);
+
+            int mismatches = 0;
+            for (int i = 0; i < boards; ++i) {
+                const BoardFeatures &a = features[i], &b = reference[i];
+                if (a.aggregateHeight != b.aggregateHeight || a.maxHeight != b.maxHeight || a.holes != b.holes ||
+                    a.coveredHoles != b.coveredHoles || a.bumpiness != b.bumpiness ||
+                    a.rowTransitions != b.rowTransitions || a.wellDepth != b.wellDepth || a.tSlots != b.tSlots) {
+                    ++mismatches;
+                }
+            }
+            failures += mismatches;
+            std::cout << names[level] << ": " << elapsed * 1e9 / boards << " ns per board, "
+                      << mismatches << " mismatches\n";
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    int benchBot(const int pieces, const double budgetMs) {
+        TetrisConfig *config = TetrisConfig::builder();
+        SevenBagGenerator generator(1234);
+        TetrisEngine engine(config, &generator);
+
+        int placed = 0, lines = 0, topOuts = 0;
+        engine.runOnMinoLocked([&placed, &lines](const int cleared) {
+            ++placed;
+            lines += cleared;
+        });
+        engine.runOnGameOver([&engine, &topOuts]() {
+            ++topOuts;
+            engine.resetPlayfield();
+        });
+
+        BeamSearchBot::Settings settings;
+        settings.timeBudgetMs = budgetMs;
+        settings.useSRS = config->srsEnabled;
+        long long nodes = 0, transpositions = 0;
+        double searchMs = 0;
+        {
+            BotController bot(&engine, settings);
+            engine.runOnTickEnd([&bot]() { bot.update(); });
+            engine.start(false);
+
+            // real time ticks, the bot has to keep up with gravity like a player would
+            const auto start = std::chrono::steady_clock::now();
+            auto nextTick = start;
+            int lastPlaced = 0;
+            while (placed < pieces) {
+                engine.tick();
+                if (placed != lastPlaced) {
+                    lastPlaced = placed;
+                    const BotStats stats = bot.getLastStats();
+                    nodes += stats.nodes;
+                    transpositions += stats.transpositions;
+                    searchMs += stats.elapsedMs;
+                }
+                nextTick += std::chrono::microseconds(static_cast<long long>(EngineTimer::TICK_INTERVAL_MS * 1000));
+                std::this_thread::sleep_until(nextTick);
+            }
+            engine.runOnTickEnd(nullptr);
+            std::cout << placed << " pieces in " << secondsSince(start) << " s: " << lines << " lines, "
+                      << topOuts << " top outs\n";
+        }
+        std::cout << "search: " << (searchMs > 0 ? nodes * 1000.0 / searchMs / 1e6 : 0) << " M nodes/s, "
+                  << searchMs / std::max(1, placed) << " ms per piece, "
+                  << transpositions * 100.0 / std::max(1LL, nodes + transpositions) << "% transpositions\n";
+        delete config;
+        return 0;
+    }
+
+    int benchExternal(const std::string &command, const int pieces) {
+        TetrisConfig *config = TetrisConfig::builder();
+        SevenBagGenerator generator(1234);
+        TetrisEngine engine(config, &generator);
+
+        int placed = 0, lines = 0, topOuts = 0;
+        engine.runOnMinoLocked([&placed, &lines](const int cleared) {
+            ++placed;
+            lines += cleared;
+        });
+        engine.runOnGameOver([&engine, &topOuts]() {
+            ++topOuts;
+            engine.resetPlayfield();
+        });
+
+        ExternalBotStats stats;
+        std::string name, lastError;
+        {
+            ExternalBotController bot(&engine, command, config->srsEnabled);
+            engine.runOnTickEnd([&bot]() { bot.update(); });
+            engine.start(false);
+
+            // real time ticks, same as the bot benchmark: the round trips overlap with the fall
+            const auto start = std::chrono::steady_clock::now();
+            auto nextTick = start;
+            while (placed < pieces && bot.isAlive()) {
+                engine.tick();
+                nextTick += std::chrono::microseconds(static_cast<long long>(EngineTimer::TICK_INTERVAL_MS * 1000));
+                std::this_thread::sleep_until(nextTick);
+            }
+            engine.runOnTickEnd(nullptr);
+            stats = bot.getStats();
+            name = bot.getName();
+            lastError = bot.getLastError();
+            std::cout << placed << " pieces in " << secondsSince(start) << " s: " << lines << " lines, "
+                      << topOuts << " top outs" << (placed < pieces ? " (the bot exited)" : "") << "\n";
+        }
+        std::cout << (name.empty() ? command : name) << ": " << stats.suggestions << " suggestions, round trip "
+                  << stats.meanMs() << " ms mean, " << stats.maxMs << " ms max, " << stats.invalid << " invalid, "
+                  << stats.stale << " stale, " << stats.resyncs << " resyncs, " << stats.errors << " errors"
+                  << (lastError.empty() ? "" : " (last: " + lastError + ")") << "\n";
+        delete config;
+        return placed < pieces ? 1 : 0;
+    }
+
+    // the practice hints under a bot that plays at real speed: what the tick pays, how soon a hint shows up
+    int benchHint(const int pieces) {
+        TetrisConfig *config = TetrisConfig::builder();
+        SevenBagGenerator generator(1234);
+        TetrisEngine engine(config, &generator);
+
+        int placed = 0;
+        engine.runOnGameOver([&engine]() { engine.resetPlayfield(); });
+
+        BeamSearchBot::Settings player;
+        player.timeBudgetMs = 150;
+        player.threads = 2;
+        player.useSRS = config->srsEnabled;
+        BeamSearchBot::Settings hinting;
+        hinting.beamWidth = 128;
+        hinting.timeBudgetMs = 400;
+        hinting.threads = 2;
+        hinting.useSRS = config->srsEnabled;
+
+        double worstUpdateUs = 0, totalUpdateUs = 0, firstHintMs = 0;
+        long long updates = 0;
+        int hinted = 0, depths = 0;
+        {
+            HintController hints(&engine, hinting);
+            BotController bot(&engine, player);
+            bool shown = false;
+            std::chrono::steady_clock::time_point spawnedAt;
+            Hint hint;
+            engine.runOnMinoLocked([&](int) {
+                ++placed;
+                hints.cancel();
+                if (shown) depths += hint.depth;
+                shown = false;
+                spawnedAt = std::chrono::steady_clock::now();
+            });
+            engine.runOnTickEnd([&]() {
+                const auto start = std::chrono::steady_clock::now();
+                hints.update();
+                const bool got = hints.getHint(hint);
+                const double us = secondsSince(start) * 1e6;
+                worstUpdateUs = std::max(worstUpdateUs, us);
+                totalUpdateUs += us;
+                ++updates;
+                if (got && !shown) {
+                    shown = true;
+                    ++hinted;
+                    firstHintMs += std::chrono::duration<double, std::milli>(start - spawnedAt).count();
+                }
+                bot.update();
+            });
+            engine.start(false);
+            spawnedAt = std::chrono::steady_clock::now();
+
+            const auto start = std::chrono::steady_clock::now();
+            auto nextTick = start;
+            while (placed < pieces) {
+                engine.tick();
+                nextTick += std::chrono::microseconds(static_cast<long long>(EngineTimer::TICK_INTERVAL_MS * 1000));
+                std::this_thread::sleep_until(nextTick);
+            }
+            engine.runOnTickEnd(nullptr);
+            engine.runOnMinoLocked(nullptr);
+            std::cout << placed << " pieces in " << secondsSince(start) << " s, " << hinted << " hinted\n";
+        }
+        std::cout << "tick side: " << totalUpdateUs / std::max(1LL, updates) << " us mean, " << worstUpdateUs
+                  << " us worst; first hint " << firstHintMs / std::max(1, hinted) << " ms after the spawn, depth "
+                  << static_cast<double>(depths) / std::max(1, hinted) << " when the piece locked\n";
+        delete config;
+        return 0;
+    }
+
+    // the board stream of recorded games (see tetris_replay --record): bytes per minute of play, and the
+    // encoder/decoder speed in MB/s of frames (a BoardFrame a tick), the entropy coder in MB/s of stream
+    int benchStream(const std::vector<std::string> &files) {
+        int failures = 0;
+        for (const std::string &file: files) {
+            ReplayPlayer replay;
+            try {
+                replay = ReplayPlayer::load(file);
+            } catch (const std::invalid_argument &e) {
+                std::cerr << e.what() << std::endl;
+                ++failures;
+                continue;
+            }
+            // the frames of every tick, what a spectator would be sent
+            std::vector<BoardFrame> frames;
+            {
+                TetrisConfig config = replay.getConfig();
+                SevenBagGenerator generator(replay.getSeed());
+                TetrisEngine engine(&config, &generator);
+                const std::vector<uint8_t> &bytes = replay.getBytes();
+                ReplayDriver driver(&engine, &config, ReplayEventReader(bytes.data(), bytes.size(), ReplayRecorder::HEADER_SIZE, 0));
+                frames.reserve(static_cast<size_t>(replay.getEndTick()) + 1);
+                for (int64_t tick = 0; driver.runTo(tick); ++tick) frames.push_back(BoardFrame::of(engine.getState()));
+            }
+            const double frameMb = static_cast<double>(frames.size() * sizeof(BoardFrame)) / 1e6;
+            const int rounds = 5;
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<uint8_t> stream;
+            size_t changed = 0;
+            for (int i = 0; i < rounds; ++i) {
+                BoardStreamEncoder encoder;
+                for (const BoardFrame &frame: frames) encoder.encode(frame);
+                stream = encoder.getBytes();
+                changed = encoder.getFrameCount();
+            }
+            const double encodeSeconds = secondsSince(start) / rounds;
+
+            start = std::chrono::steady_clock::now();
+            bool matched = true;
+            for (int i = 0; i < rounds; ++i) {
+                BoardStreamDecoder decoder(stream.data(), stream.size());
+                while (decoder.next()) {
+                    const BoardFrame &frame = decoder.getFrame();
+                    matched &= frame.tick < static_cast<int64_t>(frames.size()) && frame == frames[frame.tick];
+                }
+                // the ticks after the last frame changed nothing
+                BoardFrame last = decoder.getFrame();
+                last.tick = frames.back().tick;
+                matched &= last == frames.back();
+            }
+            const double decodeSeconds = secondsSince(start) / rounds;
+
+            start = std::chrono::steady_clock::now();
+            std::vector<uint8_t> compressed;
+            for (int i = 0; i < rounds; ++i) compressed = BoardStreamCompression::compress(stream);
+            const double compressSeconds = secondsSince(start) / rounds;
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < rounds; ++i) matched &= BoardStreamCompression::decompress(compressed.data(), compressed.size()) == stream;
+            const double decompressSeconds = secondsSince(start) / rounds;
+
+            const double minutes = static_cast<double>(frames.size()) / EngineTimer::TARGETTED_TICK_RATE / 60;
+            const double streamMb = static_cast<double>(stream.size()) / 1e6;
+            std::cout << file << ": " << frames.size() << " ticks, " << changed << " frames, " << stream.size() << " bytes ("
+                      << static_cast<long long>(static_cast<double>(stream.size()) / minutes) << " B/min), compressed "
+                      << compressed.size() << " bytes (" << static_cast<long long>(static_cast<double>(compressed.size()) / minutes)
+                      << " B/min)\n  encode " << frameMb / encodeSeconds << " MB/s, decode " << frameMb / decodeSeconds
+                      << " MB/s, compress " << streamMb / compressSeconds << " MB/s, decompress " << streamMb / decompressSeconds
+                      << " MB/s, " << (matched ? "round trip ok" : "ROUND TRIP MISMATCH") << "\n";
+            failures += !matched;
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    // the training environment through its C ABI, random legal actions (what an agent would cost on top)
+    int benchEnv(const int games, const int steps, const int threads) {
+        TetrisEnvConfig config = tetris_env_default_config();
+        config.count = games;
+        config.threads = threads;
+        config.max_pieces = 500;
+        TetrisEnv *env = tetris_env_create(&config);
+        if (env == nullptr) {
+            std::cerr << "bad environment config" << std::endl;
+            return 1;
+        }
+        std::vector<uint8_t> observations(static_cast<size_t>(games) * TETRIS_ENV_OBS_SIZE);
+        std::vector<uint16_t> actions(games);
+        std::vector<float> rewards(games);
+        std::vector<uint8_t> dones(games);
+        tetris_env_reset(env, observations.data());
+
+        uint64_t rng = 1234;
+        long long ended = 0;
+        double attack = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < steps; ++step) {
+            for (int game = 0; game < games; ++game) {
+                const uint8_t *mask = &observations[static_cast<size_t>(game) * TETRIS_ENV_OBS_SIZE + TETRIS_ENV_OBS_MASK];
+                int legal[TETRIS_ENV_ACTIONS], count = 0;
+                for (int action = 0; action < TETRIS_ENV_ACTIONS; ++action) {
+                    if (mask[action]) legal[count++] = action;
+                }
+                rng = Zobrist::mix(rng);
+                actions[game] = static_cast<uint16_t>(count > 0 ? legal[rng % count] : 0);
+            }
+            tetris_env_step(env, actions.data(), observations.data(), rewards.data(), dones.data());
+            for (int game = 0; game < games; ++game) {
+                attack += rewards[game];
+                ended += dones[game];
+            }
+        }
+        const double seconds = secondsSince(start);
+        std::cout << games << " games x " << steps << " steps on " << (threads == 0 ? "every core" : std::to_string(threads) + " threads")
+                  << ": " << static_cast<double>(games) * steps / seconds / 1e6 << " M steps/s, " << ended
+                  << " games ended, " << attack / (static_cast<double>(games) * steps) << " attack per piece\n";
+        tetris_env_destroy(env);
+        return 0;
+    }
+
+    int benchPerfectClear(const int openings) {
+        TetrisConfig *config = TetrisConfig::builder();
+        PcSolver::Settings settings;
+        settings.useSRS = config->srsEnabled;
+        PcSolver solver(settings);
+
+        // the first bag of every seed, on an empty board
+        int found = 0, incomplete = 0;
+        long long nodes = 0;
+        double totalMs = 0, worstMs = 0;
+        for (int seed = 1; seed <= openings; ++seed) {
+            SevenBagGenerator generator(seed);
+            TetrisEngine engine(config, &generator);
+            engine.start(false);
+            engine.tick();
+            const PcResult result = solver.solve(PcInput::fromState(engine.saveState(), config->holdEnabled));
+            found += result.found;
+            incomplete += !result.complete;
+            nodes += result.nodes;
+            totalMs += result.elapsedMs;
+            worstMs = std::max(worstMs, result.elapsedMs);
+        }
+        std::cout << found << "/" << openings << " openings can perfect clear, " << totalMs / openings
+                  << " ms per solve (worst " << worstMs << " ms, " << incomplete << " out of time at "
+                  << settings.timeBudgetMs << " ms), " << nodes / std::max(1, openings) << " nodes\n";
+        delete config;
+        return 0;
+    }
+
+    // the same seeds for every bot, no gravity pressure: one piece per call
+    void playCorpus(const char *name, const SimBotSettings &settings, const int seeds, const int pieces) {
+        TetrisConfig *config = TetrisConfig::builder();
+        SimBot bot(settings, *config);
+        long long lines = 0, attack = 0, playouts = 0, nodes = 0;
+        int placed = 0, topOuts = 0;
+        double searchMs = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int seed = 1; seed <= seeds; ++seed) {
+            SevenBagGenerator generator(seed);
+            TetrisEngine engine(config, &generator);
+            int gamePieces = 0, backToBack = 0;
+            bool toppedOut = false;
+            engine.runOnMinoLocked([&](const int cleared) {
+                ++gamePieces;
+                lines += cleared;
+            });
+            engine.onPlayfieldEvent([&](const PlayfieldEvent &event) {
+                const int cleared = static_cast<int>(event.getLinesCleared().size());
+                backToBack = AttackRules::nextBackToBack(backToBack, cleared, event.isSpin(), event.isMiniSpin());
+                attack += AttackRules::attack(cleared, event.isSpin(), event.isPerfectClear(), backToBack, engine.getComboCount());
+            });
+            engine.runOnGameOver([&toppedOut]() { toppedOut = true; });
+            engine.start(false);
+
+            bot.newGame(seed);
+            while (!toppedOut && gamePieces < pieces && engine.tick()) {
+                if (!bot.update(engine)) continue;
+                playouts += bot.getLastStats().playouts;
+                nodes += bot.getLastStats().nodes;
+                searchMs += bot.getLastStats().elapsedMs;
+            }
+            placed += gamePieces;
+            topOuts += toppedOut;
+        }
+        std::cout << name << ": " << lines << " lines, " << attack << " attack, " << topOuts << "/" << seeds
+                  << " top outs over " << placed << " pieces in " << secondsSince(start) << " s, "
+                  << searchMs / std::max(1, placed) << " ms per piece";
+        if (playouts > 0) std::cout << ", " << playouts * 1000.0 / std::max(1e-9, searchMs) << " playouts/s";
+        std::cout << ", " << nodes * 1000.0 / std::max(1e-9, searchMs) / 1e6 << " M nodes/s\n";
+        delete config;
+    }
+
+    // boards/s of the network (scalar and AVX2, same scores) against the handcrafted evaluation,
+    // then the beam search with one and the other on the same seeds
+    int benchNetwork(const std::string &path, const int boards, const int seeds) {
+        std::shared_ptr<const NnEval> network;
+        try {
+            network = NnEval::load(path);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        const std::vector<std::vector<uint16_t>> playfields = randomStacks(boards);
+        const int8_t queue[] = {0, 3, 5, 1, 6};
+        std::vector<const uint16_t *> pointers;
+        std::vector<NnEval::Input> inputs;
+        for (int i = 0; i < boards; ++i) {
+            pointers.push_back(playfields[i].data());
+            inputs.push_back({playfields[i].data(), static_cast<int8_t>(i % 8 - 1), queue, 5});
+        }
+
+        // in batches of 256, about what a beam search expansion hands over
+        constexpr int BATCH = 256;
+        std::vector<BoardFeatures> features(BATCH);
+        float sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int first = 0; first < boards; first += BATCH) {
+            const int count = std::min(BATCH, boards - first);
+            BoardEval::extractFeaturesBatch(pointers.data() + first, count, features.data());
+            for (int i = 0; i < count; ++i) sink += BoardEval::evaluate(features[i], BotWeights());
+        }
+        std::cout << "handcrafted: " << boards / secondsSince(start) / 1e6 << " M boards/s\n";
+
+        std::vector<float> reference(boards), scores(boards);
+        const char *names[] = {"scalar", "sse2", "avx2"};
+        int mismatches = 0;
+        for (const BoardEval::SimdLevel level: {BoardEval::SIMD_SCALAR, BoardEval::SIMD_AVX2}) {
+            if (level > BoardEval::detectSimdLevel()) continue;
+            std::vector<float> &out = level == BoardEval::SIMD_SCALAR ? reference : scores;
+            start = std::chrono::steady_clock::now();
+            for (int first = 0; first < boards; first += BATCH) {
+                network->evaluateBatch(inputs.data() + first, std::min(BATCH, boards - first), out.data() + first, level);
+            }
+            std::cout << "network " << names[level] << ": " << boards / secondsSince(start) / 1e6 << " M boards/s\n";
+            if (level != BoardEval::SIMD_SCALAR) {
+                for (int i = 0; i < boards; ++i) mismatches += scores[i] != reference[i];
+                std::cout << mismatches << " mismatches\n";
+            }
+        }
+        if (sink == 0) std::cout << '\n'; // keeps the handcrafted loop from being optimized away
+
+        SimBotSettings handcrafted;
+        handcrafted.beamWidth = 32;
+        handcrafted.depth = 3;
+        playCorpus("beam, handcrafted", handcrafted, seeds, 200);
+        SimBotSettings learned = handcrafted;
+        learned.network = network;
+        playCorpus("beam, network", learned, seeds, 200);
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    int benchMcts(const int seeds, const int playouts, const int pieces) {
+        SimBotSettings beam;
+        beam.beamWidth = 32;
+        beam.depth = 3;
+        playCorpus("beam", beam, seeds, pieces);
+
+        SimBotSettings mcts;
+        mcts.bot = "mcts";
+        mcts.playouts = playouts;
+        playCorpus("mcts", mcts, seeds, pieces);
+        return 0;
+    }
+
+    // how many first pieces the book answers and how fast, then the beam search with and without it
+    int benchBook(const std::string &path, const int seeds) {
+        std::shared_ptr<const OpeningBook> book;
+        try {
+            book = OpeningBook::open(path);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        TetrisConfig *config = TetrisConfig::builder();
+        MoveGenerator moveGenerator(config->srsEnabled);
+        int answered = 0;
+        long long lookups = 0;
+        double lookupMs = 0;
+        for (int seed = 1; seed <= seeds; ++seed) {
+            SevenBagGenerator generator(seed);
+            TetrisEngine engine(config, &generator);
+            engine.start(false);
+            engine.tick();
+            const BotInput input = BotInput::fromState(engine.getState(), config->holdEnabled);
+            BotDecision decision;
+            const auto start = std::chrono::steady_clock::now();
+            bool found = false;
+            for (int i = 0; i < 1000; ++i) found = book->decide(input, moveGenerator, decision);
+            lookupMs += secondsSince(start) * 1000;
+            lookups += 1000;
+            answered += found;
+        }
+        std::cout << book->size() << " positions, " << answered << "/" << seeds << " openings in the book, "
+                  << lookupMs * 1000 / std::max(1LL, lookups) << " us per book move (path included)\n";
+        delete config;
+
+        SimBotSettings beam;
+        beam.beamWidth = 32;
+        beam.depth = 3;
+        playCorpus("beam", beam, seeds, 100);
+        beam.book = book;
+        playCorpus("beam, book", beam, seeds, 100);
+        return 0;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " engine [instances] [ticks] | movegen [boards] | features [boards] | bot [pieces] [budget ms] | pc [openings] | mcts [seeds] [playouts] [pieces] | nn <network> [boards] [seeds] | external \"<bot command>\" [pieces] | book <book> [seeds] | hint [pieces] | env [games] [steps] [threads] | stream <replay>..." << std::endl;
+        return 1;
+    }
+
+    if (std::strcmp(argv[1], "engine") == 0) {
+        const int instances = argc > 2 ? std::stoi(argv[2]) : 100000;
+        const int ticks = argc > 3 ? std::stoi(argv[3]) : 600;
+        return benchEngine(instances, ticks);
+    }
+
+    if (std::strcmp(argv[1], "movegen") == 0) {
+        return benchMoveGenerator(argc > 2 ? std::stoi(argv[2]) : 20000);
+    }
+
+    if (std::strcmp(argv[1], "features") == 0) {
+        return benchFeatures(argc > 2 ? std::stoi(argv[2]) : 200000);
+    }
+
+    if (std::strcmp(argv[1], "bot") == 0) {
+        const int pieces = argc > 2 ? std::stoi(argv[2]) : 200;
+        return benchBot(pieces, argc > 3 ? std::stod(argv[3]) : 50);
+    }
+
+    if (std::strcmp(argv[1], "pc") == 0) {
+        return benchPerfectClear(argc > 2 ? std::stoi(argv[2]) : 100);
+    }
+
+    if (std::strcmp(argv[1], "mcts") == 0) {
+        const int seeds = argc > 2 ? std::stoi(argv[2]) : 10;
+        const int playouts = argc > 3 ? std::stoi(argv[3]) : 400;
+        return benchMcts(seeds, playouts, argc > 4 ? std::stoi(argv[4]) : 200);
+    }
+
+    if (std::strcmp(argv[1], "nn") == 0 && argc > 2) {
+        const int boards = argc > 3 ? std::stoi(argv[3]) : 200000;
+        return benchNetwork(argv[2], boards, argc > 4 ? std::stoi(argv[4]) : 10);
+    }
+
+    if (std::strcmp(argv[1], "external") == 0 && argc > 2) {
+        return benchExternal(argv[2], argc > 3 ? std::stoi(argv[3]) : 200);
+    }
+
+    if (std::strcmp(argv[1], "book") == 0 && argc > 2) {
+        return benchBook(argv[2], argc > 3 ? std::stoi(argv[3]) : 20);
+    }
+
+    if (std::strcmp(argv[1], "hint") == 0) {
+        return benchHint(argc > 2 ? std::stoi(argv[2]) : 100);
+    }
+
+    if (std::strcmp(argv[1], "env") == 0) {
+        const int games = argc > 2 ? std::stoi(argv[2]) : 1024;
+        const int steps = argc > 3 ? std::stoi(argv[3]) : 200;
+        return benchEnv(games, steps, argc > 4 ? std::stoi(argv[4]) : 0);
+    }
+
+    if (std::strcmp(argv[1], "stream") == 0 && argc > 2) {
+        return benchStream(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
+    std::cerr << "unknown benchmark: " << argv[1] << std::endl;
+    return 1;
+}
@@ -0,0 +1,254 @@
+#include "beam_search_bot.h"
+#include "opening_book.h"
+#include "../engine/zobrist.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+struct BeamSearchBot::Node {
+    uint16_t rows[Bitboard::HEIGHT];
+    int8_t hold;
+    int8_t next; // the index (in the piece sequence) of the piece to place
+    int16_t combo;
+    bool backToBack;
+    float reward; // the lock rewards collected on the way
+    float score; // reward + the evaluation of the board
+    // the first move of the line this board comes from
+    bool rootHold;
+    Placement rootPlacement;
+};
+
+BotInput BotInput::fromState(const TetrisEngineState &state, const bool holdEnabled) {
+    BotInput input;
+    std::memcpy(input.rows, state.rows, sizeof(input.rows));
+    input.fallingType = state.fallingType;
+    input.fallingX = state.fallingX;
+    input.fallingY = state.fallingY;
+    input.fallingRotation = state.fallingRotation;
+    input.holdType = state.holdType;
+    input.canHold = holdEnabled && state.canHold;
+    std::memcpy(input.nextQueue, state.nextQueue, sizeof(input.nextQueue));
+    input.nextQueueSize = state.nextQueueSize;
+    input.comboCount = state.comboCount;
+    input.backToBack = state.backToBack;
+    return input;
+}
+
+BeamSearchBot::BeamSearchBot(const Settings &settings)
+        : settings(settings), generator(settings.useSRS), pool(std::make_unique<ThreadPool>(settings.threads)) {
+    if (settings.transpositionBits > 0) table = std::make_unique<TranspositionTable>(settings.transpositionBits);
+}
+
+void BeamSearchBot::expand(const Node &parent, const std::vector<int8_t> &sequence, const bool rootHoldAllowed,
+                           const BotInput &input, std::vector<Node> &children, Scratch &scratch) const {
+    const int sequenceSize = static_cast<int>(sequence.size());
+    // nothing left to place (HOLD swallowed the last piece), the board carries over as it is
+    if (parent.next >= sequenceSize) {
+        children.push_back(parent);
+        return;
+    }
+    const bool isRoot = parent.next == 0;
+    const int current = sequence[parent.next];
+    std::vector<Placement> &placements = scratch.placements;
+    scratch.pending.clear();
+
+    for (int option = 0; option < 2; ++option) {
+        const bool useHold = option == 1;
+        int piece = current, hold = parent.hold, next = parent.next + 1;
+        if (useHold) {
+            if (isRoot && !rootHoldAllowed) break;
+            if (parent.hold == -1) {
+                // empty HOLD: the current piece goes in, the next one comes out
+                if (parent.next + 1 >= sequenceSize) break;
+                piece = sequence[parent.next + 1];
+                next = parent.next + 2;
+            } else {
+                piece = parent.hold;
+            }
+            hold = current;
+            if (piece == current && !isRoot) break; // same piece, same placements
+        }
+
+        // the root piece is already falling somewhere, everything else spawns
+        if (isRoot && !useHold) {
+            generator.generate(parent.rows, piece, input.fallingX, input.fallingY, input.fallingRotation, placements);
+        } else {
+            generator.generate(parent.rows, piece, placements);
+        }
+
+        const int following = next < sequenceSize ? sequence[next] : -1;
+        for (const Placement &placement: placements) {
+            Node child;
+            std::memcpy(child.rows, parent.rows, sizeof(child.rows));
+            Bitboard::place(child.rows, piece, placement.rotation, placement.x, placement.y);
+            const uint64_t cleared = Bitboard::fullRows(child.rows);
+            const int lines = __builtin_popcountll(cleared);
+            if (lines > 0) Bitboard::clearRows(child.rows, cleared);
+
+            const bool perfectClear = lines > 0 && child.rows[Bitboard::HEIGHT - 1] == 0;
+            const bool difficult = SRS::isDifficultClear(lines, placement.spin);
+            child.combo = static_cast<int16_t>(lines > 0 ? parent.combo + 1 : -1);
+            child.backToBack = lines > 0 ? difficult : parent.backToBack;
+            child.hold = static_cast<int8_t>(hold);
+            child.next = static_cast<int8_t>(next);
+            child.reward = parent.reward + BoardEval::lockReward(lines, placement.spin, piece == Bitboard::PIECE_T,
+                                                                 perfectClear, std::max<int>(0, child.combo),
+                                                                 lines > 0 && difficult && parent.backToBack,
+                                                                 settings.weights);
+            child.rootHold = isRoot ? useHold : parent.rootHold;
+            child.rootPlacement = isRoot ? placement : parent.rootPlacement;
+
+            // the next piece must be able to spawn
+            const bool dead = following >= 0
+                              ? !Bitboard::fits(child.rows, following, 0, Bitboard::spawnX(following), Bitboard::SPAWN_Y)
+                              : (child.rows[Bitboard::SPAWN_Y + 1] & 0b0001111000) != 0;
+            // the same board can be reached through different orders (A then B, B then A...),
+            // only the line that earned the most on the way is worth expanding
+            if (!dead && table != nullptr) {
+                const uint64_t hash = Zobrist::boardHash(child.rows)
+                                      ^ Zobrist::stateKey(-1, hold, true, child.backToBack, child.combo);
+                if (!table->insert(hash, next, child.reward)) {
+                    ++scratch.transpositions;
+                    continue;
+                }
+            }
+
+            child.score = dead ? BoardEval::DEAD : child.reward;
+            if (!dead) scratch.pending.push_back(static_cast<int>(children.size()));
+            children.push_back(child);
+        }
+    }
+
+    // the boards are evaluated all at once, the feature extraction (or the network) is vectorized
+    const int pending = static_cast<int>(scratch.pending.size());
+    if (settings.network != nullptr) {
+        scratch.networkInputs.resize(pending);
+        scratch.networkScores.resize(pending);
+        for (int i = 0; i < pending; ++i) {
+            const Node &child = children[scratch.pending[i]];
+            const int next = std::min<int>(child.next, sequenceSize);
+            scratch.networkInputs[i] = {child.rows, child.hold, sequence.data() + next, sequenceSize - next};
+        }
+        settings.network->evaluateBatch(scratch.networkInputs.data(), pending, scratch.networkScores.data());
+        for (int i = 0; i < pending; ++i) children[scratch.pending[i]].score += scratch.networkScores[i];
+        return;
+    }
+    scratch.boards.resize(pending);
+    scratch.features.resize(pending);
+    for (int i = 0; i < pending; ++i) scratch.boards[i] = children[scratch.pending[i]].rows;
+    BoardEval::extractFeaturesBatch(scratch.boards.data(), pending, scratch.features.data());
+    for (int i = 0; i < pending; ++i) {
+        children[scratch.pending[i]].score += BoardEval::evaluate(scratch.features[i], settings.weights);
+    }
+}
+
+BotDecision BeamSearchBot::search(const BotInput &input) {
+    return search(input, nullptr, nullptr);
+}
+
+BotDecision BeamSearchBot::search(const BotInput &input, const std::atomic<bool> *cancel,
+                                  const std::function<void(const BotDecision &)> &onDepth) {
+    using Clock = std::chrono::steady_clock;
+    const auto startedAt = Clock::now();
+    const auto deadline = startedAt + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::milli>(settings.timeBudgetMs));
+
+    BotDecision decision;
+    if (input.fallingType < 0) return decision;
+    // a known opening, nothing to think about
+    if (settings.book != nullptr && settings.book->decide(input, generator, decision)) {
+        decision.stats.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - startedAt).count();
+        return decision;
+    }
+
+    // the pieces in the order they come: the falling one, then the NEXT queue
+    std::vector<int8_t> sequence;
+    sequence.push_back(input.fallingType);
+    for (int i = 0; i < input.nextQueueSize; ++i) sequence.push_back(input.nextQueue[i]);
+    const int depthLimit = std::min<int>(settings.maxDepth, static_cast<int>(sequence.size()));
+
+    Node root{};
+    std::memcpy(root.rows, input.rows, sizeof(root.rows));
+    root.hold = input.holdType;
+    root.next = 0;
+    root.combo = static_cast<int16_t>(input.comboCount);
+    root.backToBack = input.backToBack;
+    root.reward = 0;
+    root.score = 0;
+    root.rootHold = false;
+
+    const int workers = pool->size();
+    std::vector<std::vector<Node>> buffers(workers);
+    std::vector<Scratch> scratches(workers);
+    std::vector<Node> beam{root};
+    std::vector<Node> candidates;
+    std::atomic<bool> expired{false};
+    const auto cancelled = [cancel] { return cancel != nullptr && cancel->load(std::memory_order_relaxed); };
+    const auto better = [](const Node &a, const Node &b) { return a.score > b.score; };
+    if (table != nullptr) table->newSearch();
+
+    for (int depth = 0; depth < depthLimit; ++depth) {
+        // the first depth always completes (there has to be a move), unless nobody wants it anymore
+        if ((depth > 0 && Clock::now() >= deadline) || cancelled()) break;
+        for (auto &buffer: buffers) buffer.clear();
+
+        pool->parallelFor(static_cast<int>(beam.size()), [&](const int item, const int worker) {
+            if (expired.load(std::memory_order_relaxed) || cancelled() || (depth > 0 && Clock::now() >= deadline)) {
+                expired.store(true, std::memory_order_relaxed);
+                return;
+            }
+            expand(beam[item], sequence, input.canHold, input, buffers[worker], scratches[worker]);
+        });
+        for (auto &buffer: buffers) decision.stats.nodes += static_cast<long long>(buffer.size());
+        if (expired.load()) break; // half a depth is worse than none, keep the previous one
+
+        candidates.clear();
+        for (auto &buffer: buffers) candidates.insert(candidates.end(), buffer.begin(), buffer.end());
+        if (candidates.empty()) break;
+
+        // keep the best beamWidth boards
+        if (static_cast<int>(candidates.size()) > settings.beamWidth) {
+            std::nth_element(candidates.begin(), candidates.begin() + settings.beamWidth, candidates.end(), better);
+            candidates.resize(settings.beamWidth);
+        }
+        beam.swap(candidates);
+        decision.stats.depth = depth + 1;
+
+        if (onDepth) {
+            const Node &best = *std::min_element(beam.begin(), beam.end(), better);
+            BotDecision sofar;
+            sofar.found = best.score > BoardEval::DEAD;
+            sofar.useHold = best.rootHold;
+            sofar.placement = best.rootPlacement;
+            sofar.score = best.score;
+            sofar.stats = decision.stats;
+            sofar.stats.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - startedAt).count();
+            onDepth(sofar);
+        }
+    }
+
+    if (decision.stats.depth > 0) {
+        const Node &best = *std::max_element(beam.begin(), beam.end(), [](const Node &a, const Node &b) {
+            return a.score < b.score;
+        });
+        decision.found = best.score > BoardEval::DEAD;
+        decision.useHold = best.rootHold;
+        decision.placement = best.rootPlacement;
+        decision.score = best.score;
+
+        if (decision.found) {
+            if (decision.useHold) {
+                // the piece that comes out of HOLD spawns fresh
+                const int piece = input.holdType != -1 ? input.holdType : input.nextQueue[0];
+                decision.found = generator.findPath(input.rows, piece, decision.placement, decision.path);
+            } else {
+                decision.found = findPath(input, decision.placement, decision.path);
+            }
+        }
+    }
+
+    for (const Scratch &scratch: scratches) decision.stats.transpositions += scratch.transpositions;
+    decision.stats.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - startedAt).count();
+    return decision;
+}
@@ -0,0 +1,153 @@
+#ifndef TETISENGINE_BEAM_SEARCH_BOT_H
+#define TETISENGINE_BEAM_SEARCH_BOT_H
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <memory>
+#include "../engine/bitboard.h"
+#include "../engine/tetris_engine_state.h"
+#include "move_generator.h"
+#include "board_eval.h"
+#include "nn_eval.h"
+#include "thread_pool.h"
+#include "transposition_table.h"
+
+class OpeningBook;
+
+/**
+ * What the bot knows when it thinks: everything the player can see
+ */
+struct BotInput {
+    uint16_t rows[Bitboard::HEIGHT] = {};
+    int8_t fallingType = -1; // the piece to place
+    int8_t fallingX = 0, fallingY = 0, fallingRotation = 0; // where it is right now
+    int8_t holdType = -1;
+    bool canHold = true; // false if HOLD was already used on this piece (or is disabled)
+    int8_t nextQueue[STATE_MAX_NEXT_QUEUE] = {};
+    int8_t nextQueueSize = 0;
+    int comboCount = -1; // the engine's combo counter (-1 = no combo)
+    bool backToBack = false; // the last clear was a difficult one
+
+    /**
+     * Reads the visible part of an engine state
+     * @param holdEnabled false if the engine has HOLD disabled
+     */
+    static BotInput fromState(const TetrisEngineState &state, bool holdEnabled = true);
+
+    /**
+     * Same board, same pieces (wherever the falling one is): a decision made for one is valid for the other
+     */
+    bool sameSituation(const BotInput &other) const {
+        return fallingType == other.fallingType && holdType == other.holdType && canHold == other.canHold &&
+               nextQueueSize == other.nextQueueSize &&
+               std::memcmp(nextQueue, other.nextQueue, nextQueueSize) == 0 &&
+               std::memcmp(rows, other.rows, sizeof(rows)) == 0;
+    }
+};
+
+/**
+ * Search statistics of one decision
+ */
+struct BotStats {
+    long long nodes = 0; // placements evaluated
+    double elapsedMs = 0;
+    int depth = 0; // pieces looked ahead (1 = the current piece only)
+    long long transpositions = 0; // boards dropped because another line of play already reached them
+    long long playouts = 0; // MctsBot only
+
+    double nodesPerSecond() const {
+        return elapsedMs > 0 ? static_cast<double>(nodes) * 1000.0 / elapsedMs : 0;
+    }
+};
+
+/**
+ * The result of a search: where to put the current piece, and how to get there
+ */
+struct BotDecision {
+    bool found = false; // false if every placement tops out (or there is no piece)
+    bool useHold = false; // press HOLD first, the path is for the piece that comes out
+    Placement placement;
+    std::vector<MoveStep> path; // then hard drop
+    float score = 0;
+    int bookSetup = -1; // the move came from the opening book, building this setup (-1 = searched)
+    BotStats stats;
+};
+
+/**
+ * A beam search over the visible pieces (current, NEXT queue and HOLD): every depth places one
+ * more piece, only the best beamWidth boards survive to the next depth.
+ * The boards of a depth are expanded in parallel on a thread pool.
+ */
+class BeamSearchBot {
+public:
+    struct Settings {
+        int beamWidth = 256;
+        int maxDepth = 6; // pieces, capped by what the queue shows
+        double timeBudgetMs = 100; // per decision, the first depth always completes
+        unsigned threads = 0; // 0 = every core
+        bool useSRS = true; // same as TetrisConfig::srsEnabled
+        int transpositionBits = 16; // log2 of the buckets of the transposition table (64 bytes each), 0 = none
+        BotWeights weights;
+        std::shared_ptr<const NnEval> network; // evaluates the boards in place of the weights, null = BoardEval::evaluate()
+        std::shared_ptr<const OpeningBook> book; // asked before searching, null = always search
+    };
+
+    explicit BeamSearchBot(const Settings &settings);
+
+    /**
+     * Picks a move for the falling piece (blocking, call it off the tick thread)
+     */
+    BotDecision search(const BotInput &input);
+
+    /**
+     * search(), anytime: every time a depth completes, the best move so far goes to onDepth
+     * (no path yet, stats.depth = the depth), and setting cancel stops the search where it is
+     *
+     * @param cancel  checked as the boards are expanded, null = never cancelled
+     * @param onDepth called on the searching thread, null = nobody listens
+     * @return the final decision, found = false if it was cancelled before the first depth
+     */
+    BotDecision search(const BotInput &input, const std::atomic<bool> *cancel,
+                       const std::function<void(const BotDecision &)> &onDepth);
+
+    /**
+     * Finds a path to a placement for the piece that is falling right now,
+     * to replay a decision when the piece moved in the meantime (gravity)
+     */
+    bool findPath(const BotInput &input, const Placement &target, std::vector<MoveStep> &out) const {
+        return generator.findPath(input.rows, input.fallingType, input.fallingX, input.fallingY,
+                                  input.fallingRotation, target, out);
+    }
+
+    const Settings &getSettings() const {
+        return settings;
+    }
+
+private:
+    struct Node;
+
+    // what a worker reuses from one expansion to the next
+    struct Scratch {
+        std::vector<Placement> placements;
+        std::vector<int> pending; // the children that still need their board evaluated
+        std::vector<const uint16_t *> boards;
+        std::vector<BoardFeatures> features;
+        std::vector<NnEval::Input> networkInputs;
+        std::vector<float> networkScores;
+        long long transpositions = 0;
+    };
+
+    Settings settings;
+    MoveGenerator generator;
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<TranspositionTable> table; // shared by the workers, null if disabled
+
+    // expands one board by one piece, into the worker's own buffer
+    void expand(const Node &parent, const std::vector<int8_t> &sequence, bool rootHoldAllowed,
+                const BotInput &input, std::vector<Node> &children, Scratch &scratch) const;
+};
+
+#endif //TETISENGINE_BEAM_SEARCH_BOT_H
@@ -0,0 +1,103 @@
+#include "board_eval.h"
+#include <algorithm>
+#include <cstdlib>
+#include "board_eval_simd.h"
+
+BoardFeatures BoardEval::extractFeatures(const uint16_t *rows) {
+    BoardFeatures features;
+    int heights[Bitboard::WIDTH] = {};
+    int filledAbove[Bitboard::WIDTH] = {}; // per column, the minos seen so far (top -> down)
+    uint16_t covered = 0; // columns that have a mino above the current row
+    uint16_t holeSeen = 0; // columns that already had a hole above the current row
+
+    for (int y = 0; y < Bitboard::HEIGHT; ++y) {
+        const uint16_t row = rows[y];
+        if (row == 0 && covered == 0) continue; // still above the stack
+
+        // the first mino of a column sets its height
+        for (uint32_t fresh = row & ~covered; fresh != 0; fresh &= fresh - 1) {
+            heights[__builtin_ctz(fresh)] = Bitboard::HEIGHT - y;
+        }
+
+        // holes: empty cells under a mino, the first hole of a column counts what covers it
+        const uint16_t holes = covered & static_cast<uint16_t>(~row) & Bitboard::FULL_ROW;
+        features.holes += __builtin_popcount(holes);
+        for (uint32_t fresh = holes & ~holeSeen; fresh != 0; fresh &= fresh - 1) {
+            features.coveredHoles += filledAbove[__builtin_ctz(fresh)];
+        }
+        holeSeen |= holes;
+        for (uint32_t minos = row; minos != 0; minos &= minos - 1) ++filledAbove[__builtin_ctz(minos)];
+        covered |= row;
+
+        // the walls are filled, an empty row in the stack has 2 transitions
+        const uint32_t walled = BoardEvalSimd::walled(row);
+        features.rowTransitions += __builtin_popcount((walled ^ (walled >> 1)) & ((1u << (Bitboard::WIDTH + 1)) - 1));
+
+        // T-spin double slots with this row as the stem
+        const uint32_t top = BoardEvalSimd::walled(y >= 2 ? rows[y - 2] : 0);
+        const uint32_t mid = BoardEvalSimd::walled(y >= 1 ? rows[y - 1] : 0);
+        const uint32_t floor = y + 1 < Bitboard::HEIGHT ? BoardEvalSimd::walled(rows[y + 1]) : ~0u;
+        features.tSlots += __builtin_popcount(BoardEvalSimd::tSlots(top, mid, walled, floor, BoardEvalSimd::CELLS));
+    }
+
+    for (int x = 0; x < Bitboard::WIDTH; ++x) {
+        features.aggregateHeight += heights[x];
+        features.maxHeight = std::max(features.maxHeight, heights[x]);
+        if (x + 1 < Bitboard::WIDTH) features.bumpiness += std::abs(heights[x] - heights[x + 1]);
+
+        // the walls are as high as the board
+        const int left = x > 0 ? heights[x - 1] : Bitboard::HEIGHT;
+        const int right = x + 1 < Bitboard::WIDTH ? heights[x + 1] : Bitboard::HEIGHT;
+        features.wellDepth = std::max(features.wellDepth, std::min(left, right) - heights[x]);
+    }
+    return features;
+}
+
+float BoardEval::evaluate(const BoardFeatures &features, const BotWeights &weights) {
+    return weights.aggregateHeight * static_cast<float>(features.aggregateHeight)
+           + weights.dangerHeight * static_cast<float>(std::max(0, features.maxHeight - BotWeights::DANGER_ROWS))
+           + weights.holes * static_cast<float>(features.holes)
+           + weights.coveredHoles * static_cast<float>(features.coveredHoles)
+           + weights.bumpiness * static_cast<float>(features.bumpiness)
+           + weights.rowTransitions * static_cast<float>(features.rowTransitions)
+           + weights.wellDepth * static_cast<float>(std::min(features.wellDepth, 4))
+           + weights.tSlot * static_cast<float>(std::min(features.tSlots, 2));
+}
+
+BoardEval::SimdLevel BoardEval::detectSimdLevel() {
+#if TETRIS_SIMD_X86
+    static const SimdLevel level = __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+    return level;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+void BoardEval::extractFeaturesBatch(const uint16_t *const *boards, const int count, BoardFeatures *out,
+                                     const SimdLevel level) {
+    switch (std::min(level, detectSimdLevel())) {
+#if TETRIS_SIMD_X86
+        case SIMD_AVX2:
+            BoardEvalSimd::extractAvx2(boards, count, out);
+            return;
+        case SIMD_SSE2:
+            BoardEvalSimd::extractSse2(boards, count, out);
+            return;
+#endif
+        default:
+            for (int i = 0; i < count; ++i) out[i] = extractFeatures(boards[i]);
+    }
+}
+
+float BoardEval::lockReward(const int lines, const SRS::SpinType spin, const bool isT, const bool perfectClear,
+                            const int combo, const bool backToBack, const BotWeights &weights) {
+    float reward;
+    if (isT && spin == SRS::SPIN_FULL) reward = weights.tSpin[std::min(lines, 3)];
+    else if (spin != SRS::SPIN_NONE) reward = weights.miniSpin * static_cast<float>(lines + 1);
+    else reward = weights.clears[std::min(lines, 4)];
+
+    if (perfectClear) reward += weights.perfectClear;
+    if (lines > 0) reward += weights.combo * static_cast<float>(combo);
+    if (backToBack) reward += weights.backToBack;
+    return reward;
+}
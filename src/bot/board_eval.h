@@ -0,0 +1,101 @@
+#ifndef TETISENGINE_BOARD_EVAL_H
+#define TETISENGINE_BOARD_EVAL_H
+#pragma once
+#include <cstdint>
+#include "../engine/bitboard.h"
+#include "../engine/srs.h"
+
+/**
+ * What a bot looks at on a board
+ */
+struct BoardFeatures {
+    int aggregateHeight = 0; // sum of the column heights
+    int maxHeight = 0; // the highest column
+    int holes = 0; // empty cells with something above them
+    int coveredHoles = 0; // the amount of minos sitting over holes (how hard they are to dig out)
+    int bumpiness = 0; // sum of the height differences between neighbor columns
+    int rowTransitions = 0; // filled <-> empty changes along the rows (walls count as filled)
+    int wellDepth = 0; // how deep the deepest single-column well is
+    int tSlots = 0; // T-spin double slots: an empty T shape under an overhang, on a solid floor
+};
+
+/**
+ * The weights of a bot, positive = good. Board weights are applied to BoardFeatures, lock
+ * rewards are earned when a piece locks (lines, spins, combos...)
+ */
+struct BotWeights {
+    // board shape
+    float aggregateHeight = -0.20F;
+    float dangerHeight = -1.50F; // per row of the highest column above DANGER_ROWS
+    float holes = -4.00F;
+    float coveredHoles = -0.50F;
+    float bumpiness = -0.25F;
+    float rowTransitions = -0.35F;
+    float wellDepth = 0.30F; // up to 4, a well is what makes a Tetris possible
+    float tSlot = 1.00F; // up to 2, the setup of a T-spin double
+
+    // lock rewards
+    float clears[5] = {0.0F, -1.5F, -1.0F, -0.5F, 4.0F}; // 0 to 4 lines, no spin
+    float tSpin[4] = {0.5F, 3.0F, 6.5F, 9.0F}; // T-spin with 0 to 3 lines
+    float miniSpin = 0.25F; // per line + 1
+    float perfectClear = 15.0F;
+    float combo = 0.5F; // per combo step
+    float backToBack = 1.5F; // a difficult clear right after another one
+
+    static constexpr int DANGER_ROWS = 10;
+};
+
+namespace BoardEval {
+    // score of a board that tops out, nothing beats staying alive
+    static constexpr float DEAD = -1.0e9F;
+
+    /**
+     * The vector units extractFeaturesBatch() can use
+     */
+    enum SimdLevel {
+        SIMD_SCALAR, // one board at a time, the reference
+        SIMD_SSE2, // 8 boards at a time
+        SIMD_AVX2 // 16 boards at a time
+    };
+
+    /**
+     * @return the best SimdLevel this CPU supports (checked once)
+     */
+    SimdLevel detectSimdLevel();
+
+    /**
+     * @param rows the playfield, Bitboard::HEIGHT row masks
+     * @return the features of the board
+     */
+    BoardFeatures extractFeatures(const uint16_t *rows);
+
+    /**
+     * extractFeatures() over many boards at once, same results
+     *
+     * @param boards pointers to count playfields (Bitboard::HEIGHT row masks each)
+     * @param out    count features, one per board
+     * @param level  the instruction set to use, capped by what the CPU supports
+     */
+    void extractFeaturesBatch(const uint16_t *const *boards, int count, BoardFeatures *out,
+                              SimdLevel level = SIMD_AVX2);
+
+    /**
+     * @return the weighted score of the features
+     */
+    float evaluate(const BoardFeatures &features, const BotWeights &weights);
+
+    /**
+     * The reward of a single lock
+     *
+     * @param lines        the amount of lines it cleared (0-4)
+     * @param spin         the spin it was locked with
+     * @param isT          true if the piece was a T
+     * @param perfectClear true if the board is empty afterwards
+     * @param combo        the combo count after the lock (0 = first clear)
+     * @param backToBack   true if this clear continues a back-to-back chain
+     */
+    float lockReward(int lines, SRS::SpinType spin, bool isT, bool perfectClear, int combo, bool backToBack,
+                     const BotWeights &weights);
+}
+
+#endif //TETISENGINE_BOARD_EVAL_H
@@ -0,0 +1,16 @@
+// BoardEval::extractFeaturesBatch() for AVX2, 16 boards at a time
+//
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#pragma GCC target("avx2")
+#endif
+#include "board_eval_simd.h"
+
+#if TETRIS_SIMD_X86
+namespace {
+    typedef int16_t VectorAVX2 __attribute__((vector_size(32)));
+}
+
+void BoardEvalSimd::extractAvx2(const uint16_t *const *boards, const int count, BoardFeatures *out) {
+    extract<VectorAVX2, 16>(boards, count, out);
+}
+#endif
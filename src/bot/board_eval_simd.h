@@ -0,0 +1,161 @@
+// The vectorized BoardEval::extractFeaturesBatch(): one board per 16-bit lane, the boards are
+// transposed so every instruction works on the same row of 8 (SSE2) or 16 (AVX2) boards.
+// Only board_eval*.cpp should include this.
+//
+
+#ifndef TETISENGINE_BOARD_EVAL_SIMD_H
+#define TETISENGINE_BOARD_EVAL_SIMD_H
+#pragma once
+#include <cstdint>
+#include "board_eval.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TETRIS_SIMD_X86 1
+#else
+#define TETRIS_SIMD_X86 0
+#endif
+
+namespace BoardEvalSimd {
+    // a row with its walls: bit 0 and bit WIDTH + 1 are filled, the cells are bits 1..WIDTH
+    constexpr uint32_t WALLS = 1u | (1u << (Bitboard::WIDTH + 1));
+    constexpr uint32_t CELLS = static_cast<uint32_t>(Bitboard::FULL_ROW) << 1;
+
+    constexpr uint32_t walled(const uint16_t row) {
+        return (static_cast<uint32_t>(row) << 1) | WALLS;
+    }
+
+    /**
+     * T-spin double slots, the T pointing down into the stem row:
+     * <pre>
+     *     top    #..    (an overhang on either side, nothing right above the T)
+     *     mid    ...    (the arms)
+     *     stem   #.#    (the stem, between two minos)
+     *     floor  .#.    (something to rest on)
+     * </pre>
+     * Works on scalars and on GCC vectors alike, every row is walled()
+     * @return the cells (walled bits) where a slot's stem is
+     */
+    template<class T>
+    inline T tSlots(const T top, const T mid, const T stem, const T floor, const T cells) {
+        return ~stem & (stem << 1) & (stem >> 1)
+               & ~(mid | (mid << 1) | (mid >> 1))
+               & ~top & ((top << 1) | (top >> 1))
+               & floor & cells;
+    }
+
+#if TETRIS_SIMD_X86
+    void extractSse2(const uint16_t *const *boards, int count, BoardFeatures *out);
+
+    void extractAvx2(const uint16_t *const *boards, int count, BoardFeatures *out);
+
+    // per 16-bit lane, the values are positive
+    template<class V>
+    inline V popcount(V x) {
+        x = x - ((x >> 1) & 0x5555);
+        x = (x & 0x3333) + ((x >> 2) & 0x3333);
+        x = (x + (x >> 4)) & 0x0F0F;
+        return (x + (x >> 8)) & 0x001F;
+    }
+
+    /**
+     * The kernel, V is a GCC vector of int16_t (compiled once per instruction set).
+     * Every value stays below 1 << 12 except the floor (which is never shifted), so the
+     * arithmetic shifts of int16_t work as logical ones.
+     *
+     * @warning no std:: templates in here: their instantiations would be shared with the
+     * scalar code and might come out of the AVX2 translation unit
+     */
+    template<class V, int LANES>
+    inline void extract(const uint16_t *const *boards, const int count, BoardFeatures *out) {
+        constexpr int HEIGHT = Bitboard::HEIGHT;
+        constexpr int WIDTH = Bitboard::WIDTH;
+        // one more row below the board: the floor
+        alignas(32) int16_t soa[HEIGHT + 1][LANES];
+        for (int lane = 0; lane < LANES; ++lane) soa[HEIGHT][lane] = static_cast<int16_t>(~0);
+
+        for (int base = 0; base < count; base += LANES) {
+            const int lanes = count - base < LANES ? count - base : LANES;
+
+            // transpose, and find the highest mino of the batch: everything above it is empty
+            int top = HEIGHT;
+            for (int y = 0; y < HEIGHT; ++y) {
+                int16_t any = 0;
+                for (int lane = 0; lane < LANES; ++lane) {
+                    const int16_t row = lane < lanes ? static_cast<int16_t>(boards[base + lane][y]) : 0;
+                    soa[y][lane] = row;
+                    any |= row;
+                }
+                if (any != 0 && top == HEIGHT) top = y;
+            }
+
+            const V zero = {}, one = zero + 1, walls = zero + static_cast<int16_t>(WALLS);
+            const V cells = zero + static_cast<int16_t>(CELLS);
+            const V transitionBits = zero + static_cast<int16_t>((1u << (WIDTH + 1)) - 1);
+
+            V covered = zero, holeSeen = zero;
+            V holes = zero, coveredHoles = zero, transitions = zero, slots = zero;
+            V heights[WIDTH], filledAbove[WIDTH];
+            for (int x = 0; x < WIDTH; ++x) heights[x] = filledAbove[x] = zero;
+            V topRow = walls, midRow = walls; // walled rows y - 2 and y - 1
+
+            for (int y = top; y < HEIGHT; ++y) {
+                V row;
+                __builtin_memcpy(&row, soa[y], sizeof(V));
+                const V after = covered | row;
+
+                // a column counts every row from its first mino down
+                for (int x = 0; x < WIDTH; ++x) heights[x] += (after >> x) & one;
+
+                // holes: the first hole of a column counts what covers it
+                const V hole = covered & ~row;
+                holes += popcount(hole);
+                const V fresh = hole & ~holeSeen;
+                for (int x = 0; x < WIDTH; ++x) coveredHoles += filledAbove[x] & -((fresh >> x) & one);
+                holeSeen |= hole;
+                for (int x = 0; x < WIDTH; ++x) filledAbove[x] += (row >> x) & one;
+                covered = after;
+
+                const V stem = (row << 1) | walls;
+                transitions += popcount((stem ^ (stem >> 1)) & transitionBits) & (after != 0);
+
+                V floor;
+                __builtin_memcpy(&floor, soa[y + 1], sizeof(V));
+                floor = y + 1 < HEIGHT ? (floor << 1) | walls : floor;
+                slots += popcount(tSlots(topRow, midRow, stem, floor, cells));
+                topRow = midRow;
+                midRow = stem;
+            }
+
+            // the walls are as high as the board
+            const V wall = zero + static_cast<int16_t>(HEIGHT);
+            V aggregate = zero, maxHeight = zero, bumpiness = zero, wellDepth = zero;
+            for (int x = 0; x < WIDTH; ++x) {
+                aggregate += heights[x];
+                maxHeight = maxHeight > heights[x] ? maxHeight : heights[x];
+                if (x + 1 < WIDTH) {
+                    const V diff = heights[x] - heights[x + 1];
+                    bumpiness += diff < 0 ? -diff : diff;
+                }
+                const V left = x > 0 ? heights[x - 1] : wall;
+                const V right = x + 1 < WIDTH ? heights[x + 1] : wall;
+                const V well = (left < right ? left : right) - heights[x];
+                wellDepth = wellDepth > well ? wellDepth : well;
+            }
+
+            for (int lane = 0; lane < lanes; ++lane) {
+                BoardFeatures &features = out[base + lane];
+                features.aggregateHeight = aggregate[lane];
+                features.maxHeight = maxHeight[lane];
+                features.holes = holes[lane];
+                features.coveredHoles = coveredHoles[lane];
+                features.bumpiness = bumpiness[lane];
+                features.rowTransitions = transitions[lane];
+                features.wellDepth = wellDepth[lane];
+                features.tSlots = slots[lane];
+            }
+        }
+    }
+#endif
+}
+
+#endif //TETISENGINE_BOARD_EVAL_SIMD_H
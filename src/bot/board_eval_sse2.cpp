@@ -0,0 +1,16 @@
+// BoardEval::extractFeaturesBatch() for SSE2, 8 boards at a time
+//
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#pragma GCC target("sse2")
+#endif
+#include "board_eval_simd.h"
+
+#if TETRIS_SIMD_X86
+namespace {
+    typedef int16_t VectorSSE2 __attribute__((vector_size(16)));
+}
+
+void BoardEvalSimd::extractSse2(const uint16_t *const *boards, const int count, BoardFeatures *out) {
+    extract<VectorSSE2, 8>(boards, count, out);
+}
+#endif
@@ -0,0 +1,151 @@
+#include "bot_controller.h"
+#include <algorithm>
+
+BotController::BotController(TetrisEngine *engine, const BeamSearchBot::Settings &settings)
+        : engine(engine), bot(settings) {
+    worker = std::thread([this] { workerLoop(); });
+}
+
+BotController::~BotController() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    worker.join();
+}
+
+BotStats BotController::getLastStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastStats;
+}
+
+void BotController::setPiecesPerSecond(const double pps) {
+    ticksPerPiece = pps > 0 ? EngineTimer::TARGETTED_TICK_RATE / pps : 0;
+}
+
+void BotController::post(const JobKind kind, const BotInput &input, const Placement &target) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = kind;
+        jobInput = input;
+        jobTarget = target;
+        resultReady = false;
+    }
+    waiting = true;
+    wakeUp.notify_one();
+}
+
+void BotController::workerLoop() {
+    for (;;) {
+        JobKind kind;
+        BotInput input;
+        Placement target;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return stopping || job != JOB_NONE; });
+            if (stopping) return;
+            kind = job;
+            input = jobInput;
+            target = jobTarget;
+            job = JOB_NONE;
+        }
+
+        BotDecision decision;
+        if (kind == JOB_SEARCH) {
+            decision = bot.search(input);
+        } else {
+            decision.placement = target;
+            decision.found = bot.findPath(input, target, decision.path);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (job != JOB_NONE) continue; // a newer job came in, this one is stale
+        if (kind == JOB_SEARCH) lastStats = decision.stats;
+        result = std::move(decision);
+        resultInput = input;
+        resultReady = true;
+    }
+}
+
+void BotController::update() {
+    if (engine->isStopped()) return;
+    const TetrisEngineState &state = engine->getState();
+    if (state.fallingType < 0) return; // spawn delay / line clear, nothing to play
+    if (holdPending) {
+        holdPending = false;
+        finishMove(pendingPath);
+        return; // the next piece is searched for on the next tick
+    }
+    const BotInput current = BotInput::fromState(state, engine->holdAllowed());
+
+    if (!waiting) {
+        post(JOB_SEARCH, current);
+        return;
+    }
+    // too early to play it, the result stays where it is (the checks below run once it's time)
+    if (static_cast<double>(engine->getTicksPassed()) < nextPieceTick) return;
+
+    BotDecision decision;
+    BotInput madeFor;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!resultReady) return; // still thinking, the piece keeps falling meanwhile
+        resultReady = false;
+        decision = std::move(result);
+        madeFor = resultInput;
+    }
+    waiting = false;
+
+    // the board changed under the bot (garbage...), think again
+    if (!current.sameSituation(madeFor)) {
+        post(JOB_SEARCH, current);
+        return;
+    }
+
+    // gravity moved the piece while the bot was thinking, the path starts somewhere else now
+    // (a HOLD brings a piece in at the spawn, its path starts there whatever gravity did)
+    if (decision.found && !decision.useHold &&
+        (current.fallingX != madeFor.fallingX || current.fallingY != madeFor.fallingY ||
+         current.fallingRotation != madeFor.fallingRotation)) {
+        post(JOB_PATH, current, decision.placement);
+        return;
+    }
+
+    if (!decision.found) {
+        // every placement loses (or the piece can't reach its spot anymore), let it go
+        engine->hardDrop();
+        return;
+    }
+    play(decision);
+}
+
+void BotController::play(const BotDecision &decision) {
+    if (ticksPerPiece > 0) {
+        // keeps the fraction of a tick when on time, a late piece does not bank time for the next ones
+        nextPieceTick = std::max(nextPieceTick, static_cast<double>(engine->getTicksPassed()) - 1) + ticksPerPiece;
+    }
+    if (decision.useHold) {
+        engine->hold();
+        if (engine->getState().fallingType < 0) {
+            // the hold was empty, the piece to play comes from the queue on the next tick
+            holdPending = true;
+            pendingPath = decision.path;
+            return;
+        }
+    }
+    finishMove(decision.path);
+}
+
+void BotController::finishMove(const std::vector<MoveStep> &path) {
+    for (const MoveStep step: path) {
+        switch (step) {
+            case STEP_LEFT: engine->moveLeft(); break;
+            case STEP_RIGHT: engine->moveRight(); break;
+            case STEP_CW: engine->rotateCW(); break;
+            case STEP_CCW: engine->rotateCCW(); break;
+            case STEP_DROP: engine->softDropToGround(); break;
+        }
+    }
+    engine->hardDrop();
+}
@@ -0,0 +1,94 @@
+#ifndef TETISENGINE_BOT_CONTROLLER_H
+#define TETISENGINE_BOT_CONTROLLER_H
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "../engine/tetris_engine.h"
+#include "beam_search_bot.h"
+
+/**
+ * Plays a TetrisEngine with a BeamSearchBot, through the same methods a player uses
+ * (hold, moveLeft, rotateCW, hardDrop...).
+ *
+ * The search runs on the controller's own thread: update() only copies the state out and
+ * replays finished decisions, so the tick thread never waits for the bot.
+ *
+ * Usage:
+ * <pre>
+ *     BotController bot(engine, settings);
+ *     engine->runOnTickEnd([&bot] { bot.update(); });
+ * </pre>
+ */
+class BotController {
+public:
+    /**
+     * @param engine   the engine to play, must outlive the controller
+     * @param settings the search settings
+     */
+    BotController(TetrisEngine *engine, const BeamSearchBot::Settings &settings);
+
+    ~BotController();
+
+    BotController(const BotController &) = delete;
+    BotController &operator=(const BotController &) = delete;
+
+    /**
+     * Call it once per tick, on the tick thread (e.g. from runOnTickEnd()):
+     * hands the new piece to the bot, and plays its move as soon as it is ready
+     */
+    void update();
+
+    /**
+     * @return the statistics of the last search
+     */
+    BotStats getLastStats() const;
+
+    /**
+     * Caps how fast the bot plays: a move is held back until 1 / pps seconds (of ticks) after the
+     * last one. The bot still thinks as soon as the piece spawns, only the playing waits
+     * @param pps pieces per second, 0 = as fast as it can think
+     */
+    void setPiecesPerSecond(double pps);
+
+private:
+    enum JobKind {
+        JOB_NONE,
+        JOB_SEARCH, // pick a move
+        JOB_PATH // the move is known, the piece moved: find a new path to it
+    };
+
+    TetrisEngine *engine;
+    BeamSearchBot bot;
+    std::thread worker;
+
+    // shared with the worker, guarded by the mutex
+    mutable std::mutex mutex;
+    std::condition_variable wakeUp;
+    JobKind job = JOB_NONE;
+    BotInput jobInput; // the situation the job was posted for
+    Placement jobTarget; // JOB_PATH only
+    bool resultReady = false;
+    BotDecision result;
+    BotInput resultInput;
+    BotStats lastStats;
+    bool stopping = false;
+
+    // tick thread only
+    bool waiting = false; // a job is posted, its result was not played yet
+    double ticksPerPiece = 0; // the PPS cap, 0 = none
+    double nextPieceTick = 0; // no move before this tick
+    bool holdPending = false; // HOLD into an empty slot, the piece to play spawns on the next tick
+    std::vector<MoveStep> pendingPath;
+
+    void workerLoop();
+
+    void post(JobKind kind, const BotInput &input, const Placement &target = Placement());
+
+    void play(const BotDecision &decision);
+
+    // steps, then hard drop
+    void finishMove(const std::vector<MoveStep> &path);
+};
+
+#endif //TETISENGINE_BOT_CONTROLLER_H
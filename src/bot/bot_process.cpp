@@ -0,0 +1,191 @@
+#include "bot_process.h"
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+// only in here, windows.h does not get anywhere near the rest of the code
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <vector>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+BotProcess::~BotProcess() {
+    stop(0);
+    closeOutput();
+}
+
+#ifdef _WIN32
+void BotProcess::start(const std::string &command) {
+    if (running) throw std::runtime_error("The bot is already running");
+    closeOutput();
+    buffer.clear();
+    SECURITY_ATTRIBUTES inherit{sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+    HANDLE childIn = nullptr, parentIn = nullptr, parentOut = nullptr, childOut = nullptr;
+    if (!CreatePipe(&childIn, &parentIn, &inherit, 0) || !CreatePipe(&parentOut, &childOut, &inherit, 0)) {
+        throw std::runtime_error("Cannot create the pipes of " + command);
+    }
+    // the child only gets its own ends
+    SetHandleInformation(parentIn, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(parentOut, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA startup{};
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = childIn;
+    startup.hStdOutput = childOut;
+    startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    PROCESS_INFORMATION info{};
+    std::vector<char> line(command.begin(), command.end());
+    line.push_back('\0');
+    const BOOL created = CreateProcessA(nullptr, line.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW,
+                                        nullptr, nullptr, &startup, &info);
+    CloseHandle(childIn);
+    CloseHandle(childOut);
+    if (!created) {
+        CloseHandle(parentIn);
+        CloseHandle(parentOut);
+        throw std::runtime_error("Cannot start " + command);
+    }
+    CloseHandle(info.hThread);
+    process = info.hProcess;
+    input = parentIn;
+    output = parentOut;
+    running = true;
+}
+
+bool BotProcess::writeLine(const std::string &line) {
+    if (!running || input == nullptr) return false;
+    const std::string data = line + "\n";
+    DWORD written = 0;
+    for (size_t sent = 0; sent < data.size(); sent += written) {
+        if (!WriteFile(input, data.data() + sent, static_cast<DWORD>(data.size() - sent), &written, nullptr)) return false;
+    }
+    return true;
+}
+
+long BotProcess::readSome(char *to, const long size) {
+    DWORD read = 0;
+    if (output == nullptr || !ReadFile(output, to, static_cast<DWORD>(size), &read, nullptr)) return 0;
+    return static_cast<long>(read);
+}
+
+void BotProcess::stop(const int waitMs) {
+    if (!running) return;
+    running = false;
+    CloseHandle(input);
+    input = nullptr;
+    if (WaitForSingleObject(process, static_cast<DWORD>(waitMs)) != WAIT_OBJECT_0) TerminateProcess(process, 1);
+    WaitForSingleObject(process, INFINITE);
+    CloseHandle(process);
+    process = nullptr;
+    // the reader (if any) sees the end of the stream now that the child is gone, output stays open for it
+}
+
+void BotProcess::closeOutput() {
+    if (output != nullptr) CloseHandle(output);
+    output = nullptr;
+}
+#else
+void BotProcess::start(const std::string &command) {
+    if (running) throw std::runtime_error("The bot is already running");
+    closeOutput();
+    buffer.clear();
+    int toChild[2], fromChild[2];
+    if (pipe(toChild) != 0) throw std::runtime_error("Cannot create the pipes of " + command);
+    if (pipe(fromChild) != 0) {
+        close(toChild[0]);
+        close(toChild[1]);
+        throw std::runtime_error("Cannot create the pipes of " + command);
+    }
+    // no other child (another bot) keeps these open, dup2 drops the flag on the child's stdin/stdout
+    for (const int fd: {toChild[0], toChild[1], fromChild[0], fromChild[1]}) fcntl(fd, F_SETFD, FD_CLOEXEC);
+    // a bot that dies must not take the game with it (SIGPIPE on the next write)
+    signal(SIGPIPE, SIG_IGN);
+
+    pid = fork();
+    if (pid < 0) {
+        for (const int fd: {toChild[0], toChild[1], fromChild[0], fromChild[1]}) close(fd);
+        throw std::runtime_error("Cannot start " + command);
+    }
+    if (pid == 0) {
+        dup2(toChild[0], STDIN_FILENO);
+        dup2(fromChild[1], STDOUT_FILENO);
+        close(toChild[0]);
+        close(toChild[1]);
+        close(fromChild[0]);
+        close(fromChild[1]);
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    close(toChild[0]);
+    close(fromChild[1]);
+    input = toChild[1];
+    output = fromChild[0];
+    running = true;
+}
+
+bool BotProcess::writeLine(const std::string &line) {
+    if (!running || input < 0) return false;
+    const std::string data = line + "\n";
+    for (size_t sent = 0; sent < data.size();) {
+        const ssize_t written = write(input, data.data() + sent, data.size() - sent);
+        if (written <= 0) return false;
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+long BotProcess::readSome(char *to, const long size) {
+    if (output < 0) return 0;
+    const ssize_t got = read(output, to, static_cast<size_t>(size));
+    return got > 0 ? static_cast<long>(got) : 0;
+}
+
+void BotProcess::stop(const int waitMs) {
+    if (!running) return;
+    running = false;
+    close(input);
+    input = -1;
+
+    int status;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(waitMs);
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    pid = -1;
+    // the reader (if any) sees the end of the stream now that the child is gone, output stays open for it
+}
+
+void BotProcess::closeOutput() {
+    if (output >= 0) close(output);
+    output = -1;
+}
+#endif
+
+bool BotProcess::readLine(std::string &line) {
+    for (;;) {
+        const size_t end = buffer.find('\n');
+        if (end != std::string::npos) {
+            line = buffer.substr(0, end);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            buffer.erase(0, end + 1);
+            return true;
+        }
+        char chunk[512];
+        const long got = readSome(chunk, sizeof(chunk));
+        if (got <= 0) return false;
+        buffer.append(chunk, static_cast<size_t>(got));
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef TETISENGINE_BOT_PROCESS_H
+#define TETISENGINE_BOT_PROCESS_H
+#pragma once
+#include <string>
+
+/**
+ * A child process with its stdin and stdout on pipes, talked to one line at a time.
+ * The command is one string, arguments and all (run by sh -c, by CreateProcess on Windows)
+ */
+class BotProcess {
+public:
+    BotProcess() = default;
+    ~BotProcess();
+
+    BotProcess(const BotProcess &) = delete;
+    BotProcess &operator=(const BotProcess &) = delete;
+
+    /**
+     * @throws std::runtime_error if the process can't be started
+     */
+    void start(const std::string &command);
+
+    /**
+     * Sends a line ("\n" is added), from one thread at a time
+     * @return false if the process is gone
+     */
+    bool writeLine(const std::string &line);
+
+    /**
+     * Blocks until a whole line came in ("\r\n" works too), from one thread at a time
+     * @return false once the process closed its stdout
+     */
+    bool readLine(std::string &line);
+
+    /**
+     * Closes its stdin, gives it waitMs to exit on its own, then kills it.
+     * A readLine() blocked on another thread returns false afterwards (join that thread before
+     * destroying this)
+     */
+    void stop(int waitMs = 500);
+
+    bool isRunning() const {
+        return running;
+    }
+
+private:
+    bool running = false;
+    std::string buffer; // read, not returned yet
+#ifdef _WIN32
+    void *process = nullptr, *input = nullptr, *output = nullptr; // HANDLEs
+#else
+    int pid = -1, input = -1, output = -1;
+#endif
+
+    // what read() returns: bytes, 0 at the end of the stream
+    long readSome(char *to, long size);
+
+    void closeOutput();
+};
+
+#endif //TETISENGINE_BOT_PROCESS_H
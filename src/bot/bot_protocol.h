@@ -0,0 +1,135 @@
+// The line protocol between the game and an external bot (in the spirit of the Tetris Bot Protocol,
+// without the JSON). One message per line, space separated, the bot reads stdin and writes stdout.
+//
+//   bot  -> info <name> [anything]       first thing it says, optional
+//   game -> rules                        the standard rules (SRS, 7-bag, HOLD)
+//   bot  -> ready                        nothing is sent before this
+//   game -> start <hold> <queue> <combo> <b2b> <rows...>
+//           hold:  a piece letter or -
+//           queue: the piece letters, the falling piece first (e.g. TZSLJ)
+//           combo: the engine's counter (-1 = none), b2b: 0 or 1
+//           rows:  Bitboard::HEIGHT row masks in decimal, row 0 at the top, bit x = column x
+//   game -> new_piece <P>                one more piece at the end of the queue
+//   game -> suggest                      the bot answers with exactly one suggestion line
+//   bot  -> suggestion [<P> <rot> <x> <y> <spin>]...
+//           the moves it likes, best first (none at all = it gave up). P is the piece to place:
+//           not the first of the queue = HOLD first. rot, x, y as in the engine (the bounding
+//           box, rotation 0-3 clockwise from spawn), spin is none, mini or full
+//   game -> play <P> <rot> <x> <y> <spin>  what was played, the bot updates its state on its own
+//           (HOLD as in TBP: P not first of the queue = the first goes to HOLD)
+//   game -> stop                         forget the game, a start comes next
+//   game -> quit                         exit
+//   bot  -> error <message>              to stderr of the game, stands for the suggestion if one is due
+//
+// Piece letters are T Z S L J I O, the ordinals in that order
+//
+
+#ifndef TETISENGINE_BOT_PROTOCOL_H
+#define TETISENGINE_BOT_PROTOCOL_H
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include "../engine/bitboard.h"
+#include "../engine/srs.h"
+#include "move_generator.h"
+
+namespace BotProtocol {
+    inline constexpr const char *PIECE_LETTERS = "TZSLJIO";
+
+    inline char pieceLetter(const int type) {
+        return type >= 0 && type < 7 ? PIECE_LETTERS[type] : '-';
+    }
+
+    /**
+     * @return the ordinal, -1 for anything else
+     */
+    inline int pieceFromLetter(const char letter) {
+        const char *found = letter != '\0' ? std::strchr(PIECE_LETTERS, letter) : nullptr;
+        return found ? static_cast<int>(found - PIECE_LETTERS) : -1;
+    }
+
+    inline const char *spinName(const SRS::SpinType spin) {
+        return spin == SRS::SPIN_FULL ? "full" : spin == SRS::SPIN_MINI ? "mini" : "none";
+    }
+
+    /**
+     * @return false if it isn't a spin name
+     */
+    inline bool spinFromName(const std::string &name, SRS::SpinType &out) {
+        if (name == "none") out = SRS::SPIN_NONE;
+        else if (name == "mini") out = SRS::SPIN_MINI;
+        else if (name == "full") out = SRS::SPIN_FULL;
+        else return false;
+        return true;
+    }
+
+    /**
+     * A move of a suggestion / play line
+     */
+    struct Move {
+        int8_t type = -1;
+        Placement placement;
+    };
+
+    inline std::string formatMove(const Move &move) {
+        std::ostringstream line;
+        line << pieceLetter(move.type) << ' ' << static_cast<int>(move.placement.rotation) << ' '
+             << static_cast<int>(move.placement.x) << ' ' << static_cast<int>(move.placement.y) << ' '
+             << spinName(move.placement.spin);
+        return line.str();
+    }
+
+    /**
+     * Reads the next 5 tokens as a move
+     * @return false at the end of the line or on garbage
+     */
+    inline bool readMove(std::istringstream &in, Move &out) {
+        std::string piece, spin;
+        int rotation, x, y;
+        if (!(in >> piece >> rotation >> x >> y >> spin)) return false;
+        out.type = static_cast<int8_t>(piece.size() == 1 ? pieceFromLetter(piece[0]) : -1);
+        if (out.type < 0 || rotation < 0 || rotation > 3 || !spinFromName(spin, out.placement.spin)) return false;
+        if (x < -4 || x >= Bitboard::WIDTH + 4 || y < -4 || y >= Bitboard::HEIGHT + 4) return false;
+        out.placement.rotation = static_cast<int8_t>(rotation);
+        out.placement.x = static_cast<int8_t>(x);
+        out.placement.y = static_cast<int8_t>(y);
+        return true;
+    }
+
+    /**
+     * What a play does to the queue and HOLD, both sides keep theirs in sync with this
+     * @param queue the pieces to come, the falling one first
+     * @return false if the piece could not have been played
+     */
+    inline bool takePiece(std::string &queue, int8_t &hold, const int type) {
+        if (queue.empty()) return false;
+        const int first = pieceFromLetter(queue[0]);
+        if (type == first) {
+            queue.erase(0, 1);
+        } else if (hold < 0 && queue.size() > 1 && pieceFromLetter(queue[1]) == type) {
+            hold = static_cast<int8_t>(first);
+            queue.erase(0, 2);
+        } else if (hold == type) {
+            hold = static_cast<int8_t>(first);
+            queue.erase(0, 1);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Locks the piece and clears the full rows
+     * @return the lines cleared
+     */
+    inline int lockPiece(uint16_t *rows, const int type, const Placement &placement) {
+        Bitboard::place(rows, type, placement.rotation, placement.x, placement.y);
+        const uint64_t full = Bitboard::fullRows(rows);
+        Bitboard::clearRows(rows, full);
+        return __builtin_popcountll(full);
+    }
+}
+
+#endif //TETISENGINE_BOT_PROTOCOL_H
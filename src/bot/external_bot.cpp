@@ -0,0 +1,220 @@
+#include "external_bot.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+ExternalBotController::ExternalBotController(TetrisEngine *engine, const std::string &command, const bool useSRS)
+        : engine(engine), generator(useSRS) {
+    process.start(command);
+    reader = std::thread([this] { readerLoop(); });
+    // the bot reads it whenever it's done introducing itself
+    send("rules");
+}
+
+ExternalBotController::~ExternalBotController() {
+    send("quit");
+    process.stop();
+    reader.join();
+}
+
+ExternalBotStats ExternalBotController::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+std::string ExternalBotController::getName() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return name;
+}
+
+std::string ExternalBotController::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastError;
+}
+
+bool ExternalBotController::isAlive() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !closed;
+}
+
+void ExternalBotController::send(const std::string &line) {
+    // a dead bot is reported by the reader, the game goes on without it
+    process.writeLine(line);
+}
+
+void ExternalBotController::reportError(const std::string &line) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats.errors;
+    lastError = line;
+}
+
+void ExternalBotController::readerLoop() {
+    std::string line;
+    while (process.readLine(line)) {
+        const Clock::time_point received = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        lines.push_back({line, received});
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+}
+
+void ExternalBotController::update() {
+    if (engine->isStopped()) return; // the lines wait, ready included
+    std::deque<Line> incoming;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        incoming.swap(lines);
+    }
+    const TetrisEngineState &state = engine->getState();
+
+    for (const Line &line: incoming) {
+        std::istringstream in(line.text);
+        std::string command;
+        in >> command;
+        if (command == "info") {
+            std::string rest;
+            std::getline(in >> std::ws, rest);
+            std::lock_guard<std::mutex> lock(mutex);
+            name = rest;
+        } else if (command == "ready") {
+            ready = true;
+        } else if (command == "suggestion" || command == "error") {
+            if (command == "error") reportError(line.text);
+            if (!waiting) continue; // an error out of the blue, nothing was asked
+            waiting = false;
+            const double ms = std::chrono::duration<double, std::milli>(line.received - suggestedAt).count();
+            const BotInput current = BotInput::fromState(state, engine->holdAllowed());
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++stats.suggestions;
+                stats.lastMs = ms;
+                stats.totalMs += ms;
+                stats.maxMs = std::max(stats.maxMs, ms);
+                // the piece locked on its own, or the board changed (garbage...): it answers something else
+                if (state.fallingType < 0 || !current.sameSituation(suggestedFor)) {
+                    ++stats.stale;
+                    continue;
+                }
+            }
+            playSuggestion(in, current);
+        } else if (!command.empty()) {
+            reportError(line.text);
+        }
+    }
+
+    if (state.fallingType < 0) return;
+    if (holdPending) {
+        holdPending = false;
+        finishMove(pendingPath, pendingMove);
+        if (engine->getState().fallingType < 0) return;
+    }
+    // one suggest at a time: anything else would have to be matched with its answer
+    if (!ready || waiting) return;
+    requestSuggestion(BotInput::fromState(state, engine->holdAllowed()));
+}
+
+void ExternalBotController::requestSuggestion(const BotInput &current) {
+    std::string queue(1, BotProtocol::pieceLetter(current.fallingType));
+    for (int i = 0; i < current.nextQueueSize; ++i) queue += BotProtocol::pieceLetter(current.nextQueue[i]);
+
+    // what the bot worked out from the plays is still true: only the new pieces are news
+    const bool inSync = started && mirrorHold == current.holdType &&
+                        std::memcmp(mirrorRows, current.rows, sizeof(mirrorRows)) == 0 &&
+                        queue.compare(0, mirrorQueue.size(), mirrorQueue) == 0;
+    if (inSync) {
+        for (size_t i = mirrorQueue.size(); i < queue.size(); ++i) send(std::string("new_piece ") + queue[i]);
+    } else {
+        if (started) {
+            send("stop");
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.resyncs;
+        }
+        std::ostringstream start;
+        start << "start " << BotProtocol::pieceLetter(current.holdType) << ' ' << queue << ' '
+              << current.comboCount << ' ' << (current.backToBack ? 1 : 0);
+        for (const uint16_t row: current.rows) start << ' ' << row;
+        send(start.str());
+        std::memcpy(mirrorRows, current.rows, sizeof(mirrorRows));
+        mirrorHold = current.holdType;
+        started = true;
+    }
+    mirrorQueue = queue;
+
+    suggestedFor = current;
+    suggestedAt = Clock::now();
+    waiting = true;
+    send("suggest");
+}
+
+void ExternalBotController::playSuggestion(std::istringstream &moves, const BotInput &current) {
+    BotProtocol::Move move;
+    while (BotProtocol::readMove(moves, move)) {
+        if (tryMove(move, current)) return;
+    }
+    // nothing it said can be played, let the piece go (the bot gets a start with the real board next time)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.invalid;
+    }
+    engine->hardDrop();
+}
+
+bool ExternalBotController::tryMove(const BotProtocol::Move &move, const BotInput &current) {
+    const int type = move.type;
+    const bool useHold = type != current.fallingType;
+    if (useHold) {
+        const int comesOut = current.holdType >= 0 ? current.holdType
+                                                   : current.nextQueueSize > 0 ? current.nextQueue[0] : -1;
+        if (!current.canHold || type != comesOut) return false;
+    }
+
+    // the spin it named first, then the same cells any other way
+    Placement target = MoveGenerator::canonical(type, move.placement);
+    const SRS::SpinType named = target.spin;
+    const SRS::SpinType spins[3] = {named, named == SRS::SPIN_NONE ? SRS::SPIN_FULL : SRS::SPIN_NONE,
+                                    named == SRS::SPIN_MINI ? SRS::SPIN_FULL : SRS::SPIN_MINI};
+    std::vector<MoveStep> path;
+    bool found = false;
+    for (const SRS::SpinType spin: spins) {
+        target.spin = spin;
+        // a HOLD spawns the other piece, its path starts at the spawn
+        found = useHold ? generator.findPath(current.rows, type, target, path)
+                        : generator.findPath(current.rows, type, current.fallingX, current.fallingY,
+                                             current.fallingRotation, target, path);
+        if (found) break;
+    }
+    if (!found) return false;
+
+    const BotProtocol::Move played{static_cast<int8_t>(type), target};
+    if (useHold) {
+        engine->hold();
+        if (engine->getState().fallingType < 0) {
+            // the next piece spawns on the next tick
+            holdPending = true;
+            pendingPath = std::move(path);
+            pendingMove = played;
+            return true;
+        }
+    }
+    finishMove(path, played);
+    return true;
+}
+
+void ExternalBotController::finishMove(const std::vector<MoveStep> &path, const BotProtocol::Move &move) {
+    for (const MoveStep step: path) {
+        switch (step) {
+            case STEP_LEFT: engine->moveLeft(); break;
+            case STEP_RIGHT: engine->moveRight(); break;
+            case STEP_CW: engine->rotateCW(); break;
+            case STEP_CCW: engine->rotateCCW(); break;
+            case STEP_DROP: engine->softDropToGround(); break;
+        }
+    }
+    engine->hardDrop();
+
+    // what the bot will believe after the play line, checked against the engine on the next spawn
+    BotProtocol::takePiece(mirrorQueue, mirrorHold, move.type);
+    BotProtocol::lockPiece(mirrorRows, move.type, move.placement);
+    send("play " + BotProtocol::formatMove(move));
+}
@@ -0,0 +1,135 @@
+#ifndef TETISENGINE_EXTERNAL_BOT_H
+#define TETISENGINE_EXTERNAL_BOT_H
+#pragma once
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../engine/tetris_engine.h"
+#include "beam_search_bot.h"
+#include "bot_process.h"
+#include "bot_protocol.h"
+
+/**
+ * Round trips of the suggest requests (suggest sent -> suggestion read)
+ */
+struct ExternalBotStats {
+    long long suggestions = 0;
+    double lastMs = 0, totalMs = 0, maxMs = 0;
+    long long invalid = 0; // suggestions with nothing playable in them (the piece was hard dropped)
+    long long stale = 0; // came back after the piece was gone (too slow, or the board changed)
+    long long resyncs = 0; // stop + start, the bot's idea of the game was off
+    long long errors = 0; // error lines, and lines that aren't part of the protocol (see getLastError())
+
+    double meanMs() const {
+        return suggestions > 0 ? totalMs / static_cast<double>(suggestions) : 0;
+    }
+};
+
+/**
+ * Plays a TetrisEngine with a bot running as a child process, over the line protocol of
+ * bot_protocol.h (same idea as BotController, the bot is just somewhere else).
+ *
+ * The suggestion is requested the tick the piece spawns, so the bot thinks while the piece falls;
+ * a reader thread collects the bot's lines, update() never waits for them.
+ *
+ * Usage:
+ * <pre>
+ *     ExternalBotController bot(engine, "./tetris_tbp --depth 3");
+ *     engine->runOnTickEnd([&bot] { bot.update(); });
+ * </pre>
+ */
+class ExternalBotController {
+public:
+    /**
+     * @param engine  the engine to play, must outlive the controller
+     * @param command what starts the bot (through the shell)
+     * @param useSRS  same as TetrisConfig::srsEnabled
+     * @throws std::runtime_error if the bot can't be started
+     */
+    ExternalBotController(TetrisEngine *engine, const std::string &command, bool useSRS = true);
+
+    ~ExternalBotController();
+
+    ExternalBotController(const ExternalBotController &) = delete;
+    ExternalBotController &operator=(const ExternalBotController &) = delete;
+
+    /**
+     * Call it once per tick, on the tick thread (e.g. from runOnTickEnd()):
+     * asks for a suggestion when a piece spawns, plays it as soon as it is back
+     */
+    void update();
+
+    ExternalBotStats getStats() const;
+
+    /**
+     * @return what the bot said in its info line (empty until then)
+     */
+    std::string getName() const;
+
+    /**
+     * @return the last error line of the bot, or the last line it sent that isn't part of the
+     * protocol (empty if there was none)
+     */
+    std::string getLastError() const;
+
+    /**
+     * @return false once the bot exited (or closed its stdout)
+     */
+    bool isAlive() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Line {
+        std::string text;
+        Clock::time_point received;
+    };
+
+    TetrisEngine *engine;
+    BotProcess process;
+    MoveGenerator generator;
+    std::thread reader;
+
+    // shared with the reader, guarded by the mutex
+    mutable std::mutex mutex;
+    std::deque<Line> lines;
+    bool closed = false;
+    std::string name;
+    std::string lastError;
+    ExternalBotStats stats;
+
+    // tick thread only
+    bool ready = false; // the bot said ready
+    bool started = false; // it was sent a start, the mirror below is what it believes
+    bool waiting = false; // a suggest is out, its answer did not come yet
+    Clock::time_point suggestedAt;
+    BotInput suggestedFor; // the situation the suggest was sent for
+    uint16_t mirrorRows[Bitboard::HEIGHT] = {};
+    int8_t mirrorHold = -1;
+    std::string mirrorQueue; // piece letters, the falling one first
+    bool holdPending = false; // HOLD was pressed, the piece to play spawns on the next tick
+    std::vector<MoveStep> pendingPath;
+    BotProtocol::Move pendingMove;
+
+    void readerLoop();
+
+    // brings the bot up to date with the spawned piece (new_piece, or stop + start), then asks it
+    void requestSuggestion(const BotInput &current);
+
+    // plays the first move of the suggestion that can be reached, hard drops if none can
+    void playSuggestion(std::istringstream &moves, const BotInput &current);
+
+    bool tryMove(const BotProtocol::Move &move, const BotInput &current);
+
+    // steps, hard drop, tells the bot
+    void finishMove(const std::vector<MoveStep> &path, const BotProtocol::Move &move);
+
+    void send(const std::string &line);
+
+    // counted in the stats, kept for getLastError()
+    void reportError(const std::string &line);
+};
+
+#endif //TETISENGINE_EXTERNAL_BOT_H
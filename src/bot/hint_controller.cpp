@@ -0,0 +1,108 @@
+#include "hint_controller.h"
+#include <algorithm>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the hint slot has to be lock free");
+
+namespace {
+    constexpr uint64_t VALID_BIT = 1ULL << 31;
+}
+
+HintController::HintController(TetrisEngine *engine, const BeamSearchBot::Settings &settings)
+        : engine(engine), bot(settings) {
+    worker = std::thread([this] { workerLoop(); });
+}
+
+HintController::~HintController() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cancelled.store(true);
+    wakeUp.notify_all();
+    worker.join();
+}
+
+uint64_t HintController::pack(const uint32_t generation, const Hint &hint) {
+    return static_cast<uint64_t>(generation) << 32 | VALID_BIT |
+           static_cast<uint64_t>(hint.type & 7) << 24 |
+           static_cast<uint64_t>(hint.placement.rotation & 3) << 22 |
+           static_cast<uint64_t>((hint.placement.x + 8) & 31) << 17 |
+           static_cast<uint64_t>(hint.placement.y & 63) << 11 |
+           static_cast<uint64_t>(std::min(hint.depth, 15));
+}
+
+bool HintController::getHint(Hint &out) const {
+    const uint64_t packed = slot.load(std::memory_order_acquire);
+    // a search of a piece that's gone may still publish, its generation is old
+    if (!(packed & VALID_BIT) || static_cast<uint32_t>(packed >> 32) != generation) return false;
+    out.type = static_cast<int8_t>(packed >> 24 & 7);
+    out.placement.rotation = static_cast<int8_t>(packed >> 22 & 3);
+    out.placement.x = static_cast<int8_t>((packed >> 17 & 31) - 8);
+    out.placement.y = static_cast<int8_t>(packed >> 11 & 63);
+    out.depth = static_cast<int>(packed & 15);
+    return true;
+}
+
+void HintController::cancel() {
+    {
+        // a job the worker didn't pick up yet is withdrawn, not searched for a piece that's gone
+        std::lock_guard<std::mutex> lock(mutex);
+        jobPosted = false;
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+    searching = false;
+    ++generation;
+}
+
+void HintController::update() {
+    if (engine->isStopped()) return;
+    const TetrisEngineState &state = engine->getState();
+    if (state.fallingType < 0) {
+        if (searching) cancel();
+        return;
+    }
+    // moving the piece around doesn't change where it should go
+    const BotInput current = BotInput::fromState(state, engine->holdAllowed());
+    if (searching && current.sameSituation(searchedFor)) return;
+
+    ++generation;
+    searching = true;
+    searchedFor = current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobPosted = true;
+        jobInput = current;
+        jobGeneration = generation;
+        cancelled.store(true, std::memory_order_relaxed); // the one running (if any) is for something else
+    }
+    wakeUp.notify_one();
+}
+
+void HintController::workerLoop() {
+    for (;;) {
+        BotInput input;
+        uint32_t jobFor;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return stopping || jobPosted; });
+            if (stopping) return;
+            input = jobInput;
+            jobFor = jobGeneration;
+            jobPosted = false;
+            cancelled.store(false, std::memory_order_relaxed);
+        }
+
+        const auto publish = [this, jobFor, &input](const BotDecision &decision) {
+            if (!decision.found) return;
+            Hint hint;
+            hint.type = !decision.useHold ? input.fallingType
+                                          : input.holdType >= 0 ? input.holdType : input.nextQueue[0];
+            hint.placement = decision.placement;
+            hint.depth = decision.bookSetup >= 0 ? 0 : decision.stats.depth;
+            slot.store(pack(jobFor, hint), std::memory_order_release);
+        };
+        // every depth is better than the last, the final decision is the deepest (or the book's)
+        const BotDecision decision = bot.search(input, &cancelled, publish);
+        if (!cancelled.load(std::memory_order_relaxed)) publish(decision);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef TETISENGINE_HINT_CONTROLLER_H
+#define TETISENGINE_HINT_CONTROLLER_H
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "../engine/tetris_engine.h"
+#include "beam_search_bot.h"
+
+/**
+ * Where the bot would put the piece, for the player to look at
+ */
+struct Hint {
+    int8_t type = -1; // the piece to place: not the falling one = HOLD first
+    Placement placement;
+    int depth = 0; // pieces the search looked ahead, 0 = from the opening book
+};
+
+/**
+ * Searches the best placement of the falling piece while the player plays it (practice hints).
+ *
+ * The search runs on the controller's own thread and deepens one piece at a time: every depth
+ * that completes replaces the hint, so there is something to show after a few milliseconds and
+ * a better one until the time budget runs out. A new piece (or a changed board) cancels it.
+ *
+ * The hint is published through a single 64-bit atomic, update() and getHint() never take a lock
+ * the worker holds while it searches, the tick thread never waits for it.
+ *
+ * Usage:
+ * <pre>
+ *     HintController hints(engine, settings);
+ *     engine->runOnTickEnd([&hints] { hints.update(); });
+ *     engine->runOnMinoLocked([&hints](int) { hints.cancel(); });
+ *     if (hints.getHint(hint)) ... draw it
+ * </pre>
+ */
+class HintController {
+public:
+    /**
+     * @param engine   the engine the player plays, must outlive the controller
+     * @param settings the search settings, timeBudgetMs is how long a hint keeps improving
+     */
+    HintController(TetrisEngine *engine, const BeamSearchBot::Settings &settings);
+
+    ~HintController();
+
+    HintController(const HintController &) = delete;
+    HintController &operator=(const HintController &) = delete;
+
+    /**
+     * Call it once per tick, on the tick thread: starts a search whenever the situation changed
+     */
+    void update();
+
+    /**
+     * Drops the current search and its hint (the piece locked), on the tick thread
+     */
+    void cancel();
+
+    /**
+     * The best placement found so far for the falling piece, on the tick thread
+     * @return false if there is none yet
+     */
+    bool getHint(Hint &out) const;
+
+private:
+    TetrisEngine *engine;
+    BeamSearchBot bot;
+    std::thread worker;
+
+    // the job, guarded by the mutex (only held to hand it over)
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool jobPosted = false;
+    BotInput jobInput;
+    uint32_t jobGeneration = 0;
+    bool stopping = false;
+
+    std::atomic<bool> cancelled{false}; // the search in progress is stale
+    std::atomic<uint64_t> slot{0}; // the packed hint, see pack()
+
+    // tick thread only
+    bool searching = false;
+    BotInput searchedFor;
+    uint32_t generation = 0; // bumped every time the hint shown so far stops being true
+
+    void workerLoop();
+
+    // generation (32 bits) | valid | type | rotation | x + 8 | y | depth
+    static uint64_t pack(uint32_t generation, const Hint &hint);
+};
+
+#endif //TETISENGINE_HINT_CONTROLLER_H
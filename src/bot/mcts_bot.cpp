@@ -0,0 +1,463 @@
+#include "mcts_bot.h"
+#include "opening_book.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    constexpr int PIECES = 7;
+    constexpr uint8_t FULL_BAG = (1u << PIECES) - 1;
+    constexpr long long VALUE_ONE = 1LL << 20; // edge values are summed in fixed point
+
+    enum NodeState : int {
+        LEAF,
+        EXPANDING,
+        EXPANDED
+    };
+
+    // xorshift64, one per thread
+    struct Random {
+        uint64_t state;
+
+        int next(const int bound) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return static_cast<int>(state % static_cast<uint64_t>(bound));
+        }
+
+        // one of the pieces of a bag mask
+        int draw(const uint8_t bag) {
+            int pick = next(__builtin_popcount(bag));
+            for (int piece = 0; piece < PIECES; ++piece) {
+                if (!(bag & (1u << piece))) continue;
+                if (pick-- == 0) return piece;
+            }
+            return -1;
+        }
+    };
+
+    // the next piece can't spawn
+    bool blocksSpawn(const uint16_t *rows, const int piece) {
+        return piece >= 0 ? !Bitboard::fits(rows, piece, 0, Bitboard::spawnX(piece), Bitboard::SPAWN_Y)
+                          : (rows[Bitboard::SPAWN_Y + 1] & 0b0001111000) != 0;
+    }
+}
+
+/**
+ * A piece to place (a decision), the edges are the placements
+ */
+struct MctsBot::Node {
+    uint16_t rows[Bitboard::HEIGHT];
+    int8_t piece; // the piece to place, -1 = topped out
+    int8_t hold;
+    int8_t next; // the index (in the visible sequence) of the piece after this one
+    uint8_t bag; // what the bag still owes once the visible sequence ran out (0 = a new bag)
+    int16_t combo;
+    bool backToBack;
+    float reward; // the lock rewards from the root to here
+    std::atomic<int> state{LEAF};
+    std::unique_ptr<Edge[]> edges;
+    int edgeCount = 0;
+};
+
+/**
+ * A placement, and the chance node behind it: one child per piece that can come next
+ */
+struct MctsBot::Edge {
+    bool useHold = false;
+    bool dead = false; // tops out whatever comes next
+    int8_t piece = -1; // the piece it places (the held one, or the one HOLD brings out)
+    Placement placement;
+    float prior = 0; // P(edge) of PUCT
+    float heuristic = 0; // the value of the board it leaves, until a playout went through
+    std::atomic<int> visits{0}; // virtual losses included
+    std::atomic<long long> value{0}; // fixed point (VALUE_ONE)
+    std::atomic<Node *> outcomes[PIECES];
+
+    Edge() {
+        for (auto &outcome: outcomes) outcome.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~Edge() {
+        for (auto &outcome: outcomes) delete outcome.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * One search() call
+ */
+struct MctsBot::Search {
+    const MctsBot &bot;
+    const Settings &settings;
+    const BotInput &input;
+    std::vector<int8_t> sequence; // the visible pieces: the falling one, then the NEXT queue
+    float baseline = 0; // the evaluation of the root board, values are relative to it
+    std::atomic<long long> nodes{0};
+    std::atomic<int> maxDepth{0};
+    std::atomic<long long> playouts{0};
+
+    // what a thread reuses
+    struct Worker {
+        Random random{};
+        std::vector<Placement> placements;
+        std::vector<uint16_t> boards; // Bitboard::HEIGHT rows per placement
+        std::vector<const uint16_t *> boardPointers;
+        std::vector<BoardFeatures> features;
+        std::vector<float> rewards;
+        std::vector<Edge *> path;
+    };
+
+    Search(const MctsBot &bot, const BotInput &input) : bot(bot), settings(bot.settings), input(input) {
+        sequence.push_back(input.fallingType);
+        for (int i = 0; i < input.nextQueueSize; ++i) sequence.push_back(input.nextQueue[i]);
+    }
+
+    float toValue(const float score) const {
+        return 1.0F / (1.0F + std::exp(-(score - baseline) / settings.valueScale));
+    }
+
+    // places a piece on a copy of the board, returns the lines it cleared
+    static int lock(uint16_t *rows, const int piece, const Placement &placement) {
+        Bitboard::place(rows, piece, placement.rotation, placement.x, placement.y);
+        const uint64_t cleared = Bitboard::fullRows(rows);
+        const int lines = __builtin_popcountll(cleared);
+        if (lines > 0) Bitboard::clearRows(rows, cleared);
+        return lines;
+    }
+
+    float lockReward(const int lines, const Placement &placement, const int piece, const uint16_t *rows,
+                     const int combo, const bool backToBack) const {
+        const bool perfectClear = lines > 0 && rows[Bitboard::HEIGHT - 1] == 0;
+        const bool difficult = SRS::isDifficultClear(lines, placement.spin);
+        return BoardEval::lockReward(lines, placement.spin, piece == Bitboard::PIECE_T, perfectClear,
+                                     std::max(0, combo), lines > 0 && difficult && backToBack, settings.weights);
+    }
+
+    /**
+     * The piece after a placement: the next visible one, or a draw from the bag
+     * @param next in: the index of the next piece in the sequence, out: after the draw
+     * @param bag  in: what the bag owes, out: after the draw
+     */
+    int drawPiece(int &next, uint8_t &bag, Random &random) const {
+        if (next < static_cast<int>(sequence.size())) return sequence[next++];
+        const uint8_t owed = bag == 0 ? FULL_BAG : bag;
+        const int piece = random.draw(owed);
+        bag = static_cast<uint8_t>(owed & ~(1u << piece));
+        ++next;
+        return piece;
+    }
+
+    // the piece HOLD brings out, -1 if HOLD is not an option (or it is the next one, still hidden)
+    int heldPiece(const Node &node, const bool isRoot) const {
+        if (isRoot && !input.canHold) return -1;
+        const int piece = node.hold != -1 ? node.hold
+                                          : (node.next < static_cast<int>(sequence.size()) ? sequence[node.next] : -1);
+        if (piece == node.piece && !isRoot) return -1; // same piece, same placements
+        return piece;
+    }
+
+    // fills the edges of a node, one per placement (HOLD included)
+    void expand(Node &node, const bool isRoot, Worker &worker) {
+        struct Candidate {
+            bool useHold;
+            int piece;
+            Placement placement;
+            float score;
+            bool dead;
+        };
+        std::vector<Candidate> candidates;
+
+        for (int option = 0; option < 2; ++option) {
+            const bool useHold = option == 1;
+            const int piece = useHold ? heldPiece(node, isRoot) : node.piece;
+            if (piece < 0) continue;
+            // the root piece is already falling somewhere, everything else spawns
+            if (isRoot && !useHold) {
+                bot.generator.generate(node.rows, piece, input.fallingX, input.fallingY, input.fallingRotation, worker.placements);
+            } else {
+                bot.generator.generate(node.rows, piece, worker.placements);
+            }
+
+            const size_t first = candidates.size();
+            const int count = static_cast<int>(worker.placements.size());
+            worker.boards.resize((first + count) * Bitboard::HEIGHT);
+            for (int i = 0; i < count; ++i) {
+                const Placement &placement = worker.placements[i];
+                uint16_t *rows = &worker.boards[(first + i) * Bitboard::HEIGHT];
+                std::memcpy(rows, node.rows, sizeof(node.rows));
+                const int lines = lock(rows, piece, placement);
+                const int combo = lines > 0 ? node.combo + 1 : -1;
+                const float reward = lockReward(lines, placement, piece, rows, combo, node.backToBack);
+                // the piece after this one, if it is known
+                const int following = useHold && node.hold == -1 ? node.next + 1 : node.next;
+                const int nextPiece = following < static_cast<int>(sequence.size()) ? sequence[following] : -1;
+                candidates.push_back({useHold, piece, placement, node.reward + reward, blocksSpawn(rows, nextPiece)});
+            }
+        }
+
+        // the boards are evaluated all at once, the feature extraction is vectorized
+        const int count = static_cast<int>(candidates.size());
+        worker.boardPointers.resize(count);
+        worker.features.resize(count);
+        for (int i = 0; i < count; ++i) worker.boardPointers[i] = &worker.boards[i * Bitboard::HEIGHT];
+        BoardEval::extractFeaturesBatch(worker.boardPointers.data(), count, worker.features.data());
+
+        float best = BoardEval::DEAD;
+        for (int i = 0; i < count; ++i) {
+            if (candidates[i].dead) continue;
+            candidates[i].score += BoardEval::evaluate(worker.features[i], settings.weights);
+            best = std::max(best, candidates[i].score);
+        }
+
+        // priors: a softmax over the scores
+        auto edges = std::make_unique<Edge[]>(count);
+        float total = 0;
+        for (int i = 0; i < count; ++i) {
+            Edge &edge = edges[i];
+            const Candidate &candidate = candidates[i];
+            edge.useHold = candidate.useHold;
+            edge.piece = static_cast<int8_t>(candidate.piece);
+            edge.placement = candidate.placement;
+            edge.dead = candidate.dead;
+            edge.heuristic = candidate.dead ? 0 : toValue(candidate.score);
+            edge.prior = candidate.dead ? 0 : std::exp((candidate.score - best) / settings.priorTemperature);
+            total += edge.prior;
+        }
+        for (int i = 0; i < count && total > 0; ++i) edges[i].prior /= total;
+        node.edges = std::move(edges);
+        node.edgeCount = count;
+        nodes.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // PUCT, with the evaluation of the board for the edges no playout went through yet
+    Edge *select(Node &node) const {
+        int total = 0;
+        for (int i = 0; i < node.edgeCount; ++i) total += node.edges[i].visits.load(std::memory_order_relaxed);
+        const float explore = settings.exploration * std::sqrt(static_cast<float>(total + 1));
+
+        Edge *best = nullptr;
+        float bestScore = -1;
+        for (int i = 0; i < node.edgeCount; ++i) {
+            Edge &edge = node.edges[i];
+            if (edge.dead) continue;
+            const int visits = edge.visits.load(std::memory_order_relaxed);
+            const float q = visits > 0
+                            ? static_cast<float>(edge.value.load(std::memory_order_relaxed)) / (static_cast<float>(visits) * VALUE_ONE)
+                            : edge.heuristic;
+            const float score = q + explore * edge.prior / static_cast<float>(1 + visits);
+            if (score > bestScore) {
+                bestScore = score;
+                best = &edge;
+            }
+        }
+        return best;
+    }
+
+    // the node behind an edge once the next piece is drawn, created by the first thread that gets there
+    Node *child(Node &parent, Edge &edge, Random &random) {
+        int next = parent.next + (edge.useHold && parent.hold == -1 ? 1 : 0);
+        uint8_t bag = parent.bag;
+        const int drawn = drawPiece(next, bag, random);
+
+        std::atomic<Node *> &slot = edge.outcomes[drawn];
+        Node *existing = slot.load(std::memory_order_acquire);
+        if (existing != nullptr) return existing;
+
+        auto *node = new Node;
+        std::memcpy(node->rows, parent.rows, sizeof(node->rows));
+        const int lines = lock(node->rows, edge.piece, edge.placement);
+        node->combo = static_cast<int16_t>(lines > 0 ? parent.combo + 1 : -1);
+        node->backToBack = lines > 0 ? SRS::isDifficultClear(lines, edge.placement.spin) : parent.backToBack;
+        node->reward = parent.reward + lockReward(lines, edge.placement, edge.piece, node->rows, node->combo, parent.backToBack);
+        node->hold = static_cast<int8_t>(edge.useHold ? parent.piece : parent.hold);
+        node->piece = static_cast<int8_t>(blocksSpawn(node->rows, drawn) ? -1 : drawn);
+        node->next = static_cast<int8_t>(std::min(next, 127));
+        node->bag = bag;
+
+        if (slot.compare_exchange_strong(existing, node, std::memory_order_acq_rel)) return node;
+        delete node; // another thread was first
+        return existing;
+    }
+
+    // a few greedy pieces from a node (no HOLD), the value of where they end up
+    float rollout(const Node &node, Worker &worker) const {
+        uint16_t rows[Bitboard::HEIGHT];
+        std::memcpy(rows, node.rows, sizeof(rows));
+        int piece = node.piece, next = node.next, combo = node.combo;
+        uint8_t bag = node.bag;
+        bool backToBack = node.backToBack;
+        float reward = node.reward;
+
+        for (int depth = 0; depth < settings.rolloutDepth; ++depth) {
+            bot.generator.generate(rows, piece, worker.placements);
+            const int count = static_cast<int>(worker.placements.size());
+            if (count == 0) return 0;
+
+            worker.boards.resize(count * Bitboard::HEIGHT);
+            worker.boardPointers.resize(count);
+            worker.features.resize(count);
+            std::vector<float> &rewards = worker.rewards;
+            rewards.resize(count);
+            for (int i = 0; i < count; ++i) {
+                uint16_t *board = &worker.boards[i * Bitboard::HEIGHT];
+                std::memcpy(board, rows, sizeof(rows));
+                const int lines = lock(board, piece, worker.placements[i]);
+                rewards[i] = lockReward(lines, worker.placements[i], piece, board, lines > 0 ? combo + 1 : -1, backToBack);
+                worker.boardPointers[i] = board;
+            }
+            BoardEval::extractFeaturesBatch(worker.boardPointers.data(), count, worker.features.data());
+            int best = 0;
+            float bestScore = BoardEval::DEAD;
+            for (int i = 0; i < count; ++i) {
+                const float score = rewards[i] + BoardEval::evaluate(worker.features[i], settings.weights);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = i;
+                }
+            }
+
+            const Placement placement = worker.placements[best];
+            const int lines = lock(rows, piece, placement);
+            combo = lines > 0 ? combo + 1 : -1;
+            reward += rewards[best];
+            if (lines > 0) backToBack = SRS::isDifficultClear(lines, placement.spin);
+            piece = drawPiece(next, bag, worker.random);
+            if (blocksSpawn(rows, piece)) return 0;
+        }
+        return toValue(reward + BoardEval::evaluate(BoardEval::extractFeatures(rows), settings.weights));
+    }
+
+    // down the tree, expand, roll out, back up
+    void playout(Node &root, Worker &worker) {
+        const int virtualLoss = settings.virtualLoss;
+        worker.path.clear();
+        Node *node = &root;
+        float value;
+        for (;;) {
+            if (node->piece < 0) {
+                value = 0; // topped out
+                break;
+            }
+            int state = node->state.load(std::memory_order_acquire);
+            if (state == LEAF && node->state.compare_exchange_strong(state, EXPANDING, std::memory_order_acq_rel)) {
+                expand(*node, node == &root, worker);
+                node->state.store(EXPANDED, std::memory_order_release);
+                value = rollout(*node, worker);
+                break;
+            }
+            if (state != EXPANDED) {
+                // another thread is expanding it, no point in waiting
+                value = rollout(*node, worker);
+                break;
+            }
+
+            Edge *edge = select(*node);
+            if (edge == nullptr) {
+                value = 0; // every placement tops out
+                break;
+            }
+            edge->visits.fetch_add(virtualLoss, std::memory_order_relaxed);
+            worker.path.push_back(edge);
+            node = child(*node, *edge, worker.random);
+        }
+
+        const long long fixed = static_cast<long long>(value * VALUE_ONE);
+        for (Edge *edge: worker.path) {
+            edge->value.fetch_add(fixed, std::memory_order_relaxed);
+            edge->visits.fetch_add(1 - virtualLoss, std::memory_order_relaxed);
+        }
+        playouts.fetch_add(1, std::memory_order_relaxed);
+        const int depth = static_cast<int>(worker.path.size());
+        int seen = maxDepth.load(std::memory_order_relaxed);
+        while (depth > seen && !maxDepth.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {}
+    }
+};
+
+MctsBot::MctsBot(const Settings &settings)
+        : settings(settings), generator(settings.useSRS), pool(std::make_unique<ThreadPool>(settings.threads)) {}
+
+MctsBot::~MctsBot() = default;
+
+uint8_t MctsBot::bagRemaining(const TetrisEngineState &snapshot) {
+    uint8_t bag = 0;
+    for (int i = 0; i < snapshot.generator.bagSize; ++i) bag |= 1u << snapshot.generator.bag[i];
+    return bag;
+}
+
+BotDecision MctsBot::search(const BotInput &input, const uint8_t bagRemaining) {
+    using Clock = std::chrono::steady_clock;
+    const auto startedAt = Clock::now();
+    const auto deadline = startedAt + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::milli>(settings.timeBudgetMs));
+
+    BotDecision decision;
+    if (input.fallingType < 0) return decision;
+    // a known opening, nothing to think about
+    if (settings.book != nullptr && settings.book->decide(input, generator, decision)) {
+        decision.stats.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - startedAt).count();
+        return decision;
+    }
+
+    Search search(*this, input);
+    Node root;
+    std::memcpy(root.rows, input.rows, sizeof(root.rows));
+    root.piece = input.fallingType;
+    root.hold = input.holdType;
+    root.next = 1;
+    root.bag = bagRemaining;
+    root.combo = static_cast<int16_t>(input.comboCount);
+    root.backToBack = input.backToBack;
+    root.reward = 0;
+    search.baseline = BoardEval::evaluate(BoardEval::extractFeatures(input.rows), settings.weights);
+
+    const int workers = pool->size();
+    std::vector<Search::Worker> scratch(workers);
+    for (int i = 0; i < workers; ++i) scratch[i].random.state = (settings.seed + i) * 0x9E3779B97F4A7C15ULL | 1;
+
+    // the root is always expanded, there has to be a move
+    search.expand(root, true, scratch[0]);
+    root.state.store(EXPANDED);
+
+    std::atomic<int> started{0};
+    pool->parallelFor(workers, [&](int, const int worker) {
+        for (int i = 0; started.fetch_add(1, std::memory_order_relaxed) < settings.playouts; ++i) {
+            if ((i & 15) == 0 && Clock::now() >= deadline) break;
+            search.playout(root, scratch[worker]);
+        }
+    });
+
+    // the most visited move
+    const Edge *best = nullptr;
+    for (int i = 0; i < root.edgeCount; ++i) {
+        const Edge &edge = root.edges[i];
+        if (edge.dead) continue;
+        if (best == nullptr || edge.visits.load() > best->visits.load()
+            || (edge.visits.load() == best->visits.load() && edge.heuristic > best->heuristic)) {
+            best = &edge;
+        }
+    }
+
+    if (best != nullptr) {
+        decision.found = true;
+        decision.useHold = best->useHold;
+        decision.placement = best->placement;
+        const int visits = best->visits.load();
+        decision.score = visits > 0 ? static_cast<float>(best->value.load()) / (static_cast<float>(visits) * VALUE_ONE) : best->heuristic;
+        if (decision.useHold) {
+            // the piece that comes out of HOLD spawns fresh
+            decision.found = generator.findPath(input.rows, best->piece, decision.placement, decision.path);
+        } else {
+            decision.found = generator.findPath(input.rows, input.fallingType, input.fallingX, input.fallingY,
+                                                input.fallingRotation, decision.placement, decision.path);
+        }
+    }
+
+    decision.stats.nodes = search.nodes.load();
+    decision.stats.depth = search.maxDepth.load() + 1;
+    decision.stats.playouts = search.playouts.load();
+    decision.stats.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - startedAt).count();
+    return decision;
+}
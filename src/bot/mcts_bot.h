@@ -0,0 +1,66 @@
+#ifndef TETISENGINE_MCTS_BOT_H
+#define TETISENGINE_MCTS_BOT_H
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "beam_search_bot.h"
+
+/**
+ * A Monte-Carlo tree search over placements. Past the visible pieces (current, NEXT queue and
+ * HOLD) the tree goes on through chance nodes: the piece that comes next is drawn from what the
+ * 7-bag still owes, never from a piece the bag already dealt.
+ *
+ * Every playout goes down the tree (PUCT, the priors come from the board evaluation), expands
+ * the leaf it lands on, plays a few greedy pieces from there (the rollout, on bitboards like the
+ * other bots) and backs the result up.
+ * The threads share the tree: a thread on its way down adds virtual losses to the edges it took,
+ * so the others spread out instead of piling on the same line.
+ */
+class MctsBot {
+public:
+    struct Settings {
+        int playouts = 4000; // per decision, split between the threads
+        double timeBudgetMs = 100; // per decision, whichever runs out first (the root is always expanded)
+        unsigned threads = 0; // 0 = every core
+        bool useSRS = true; // same as TetrisConfig::srsEnabled
+        int rolloutDepth = 3; // pieces played greedily after a leaf
+        float exploration = 1.5F; // the PUCT constant
+        int virtualLoss = 3; // visits (worth nothing) a playout adds to its path until it is backed up
+        float priorTemperature = 2.0F; // of the softmax over the evaluations of the children
+        float valueScale = 8.0F; // evaluation units per unit of the logistic that maps them to [0, 1]
+        uint64_t seed = 1; // of the draws, a search on 1 thread with no time limit is reproducible
+        BotWeights weights;
+        std::shared_ptr<const OpeningBook> book; // asked before searching, null = always search
+    };
+
+    explicit MctsBot(const Settings &settings);
+    ~MctsBot();
+
+    /**
+     * Picks a move for the falling piece (blocking, call it off the tick thread)
+     * @param bagRemaining bit = ordinal, the pieces of the current bag that come after the NEXT
+     *                     queue (0 = a new bag), see bagRemaining()
+     */
+    BotDecision search(const BotInput &input, uint8_t bagRemaining);
+
+    /**
+     * @param snapshot a snapshot from TetrisEngine::saveState() (the live state has no generator)
+     * @return what the 7-bag still owes after the NEXT queue
+     */
+    static uint8_t bagRemaining(const TetrisEngineState &snapshot);
+
+    const Settings &getSettings() const {
+        return settings;
+    }
+
+private:
+    struct Node;
+    struct Edge;
+    struct Search;
+
+    Settings settings;
+    MoveGenerator generator;
+    std::unique_ptr<ThreadPool> pool;
+};
+
+#endif //TETISENGINE_MCTS_BOT_H
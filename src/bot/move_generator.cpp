@@ -0,0 +1,384 @@
+#include "move_generator.h"
+#include <algorithm>
+
+namespace {
+    constexpr int X_OFFSET = 3; // bit X + 3 of a position mask = x-position X (boxes can stick out on the left)
+    constexpr int Y_OFFSET = 3; // index Y + 3 = y-position Y (empty box rows can stick out on the top)
+    constexpr int ROWS = Bitboard::HEIGHT + Y_OFFSET;
+
+    // what the last successful action was, it is all the engine needs to classify a spin on lock
+    enum Tag {
+        TAG_SHIFTED, // moved (or spawned), never a spin
+        TAG_ROTATED, // rotated without a kick
+        TAG_KICKED, // rotated with a kick
+        TAG_KICKED_1_2, // rotated with the (1, 2) kick, upgrades T-spin minis
+        TAG_COUNT
+    };
+
+    // the tag a rotation leaves, see SRS::detectSpin
+    Tag rotationTag(const int kickUsed, const SRS::Kick &kick) {
+        if (kickUsed == 0) return TAG_ROTATED;
+        return kick.x == 1 && kick.y == 2 ? TAG_KICKED_1_2 : TAG_KICKED;
+    }
+
+    /**
+     * A board row as seen by the position masks: bit X + 3 = column X,
+     * the walls (and everything outside the board) are solid
+     */
+    uint32_t extendedRow(const uint16_t *rows, const int y) {
+        if (y < 0 || y >= Bitboard::HEIGHT) return ~0u;
+        return (static_cast<uint32_t>(rows[y]) << X_OFFSET) | ~(static_cast<uint32_t>(Bitboard::FULL_ROW) << X_OFFSET);
+    }
+
+    // moves every position of a mask dx columns to the right
+    uint16_t shiftX(const uint32_t mask, const int dx) {
+        return static_cast<uint16_t>(dx >= 0 ? mask << dx : mask >> -dx);
+    }
+
+    /**
+     * fits[rotation][Y + 3] = the x-positions the piece fits at on that row,
+     * the extra row at the end is the floor (fits nowhere)
+     */
+    struct FitTable {
+        uint16_t fits[4][ROWS + 1];
+    };
+
+    void buildFitTable(const uint16_t *rows, const int type, FitTable &table) {
+        uint32_t extended[Bitboard::HEIGHT];
+        for (int y = 0; y < Bitboard::HEIGHT; ++y) extended[y] = extendedRow(rows, y);
+
+        // the rows above the stack are empty, the piece fits there wherever the walls let it
+        int firstFilled = 0;
+        while (firstFilled < Bitboard::HEIGHT && rows[firstFilled] == 0) ++firstFilled;
+
+        for (int rotation = 0; rotation < 4; ++rotation) {
+            const Bitboard::PieceShape &shape = Bitboard::SHAPES.shapes[type][rotation];
+            uint16_t openRow = 0;
+            for (int index = 0; index < ROWS; ++index) {
+                const int y = index - Y_OFFSET;
+                if (openRow != 0 && y + shape.size <= firstFilled) {
+                    table.fits[rotation][index] = openRow;
+                    continue;
+                }
+                // a position is blocked if any mino of the piece lands on a solid cell:
+                // mino at box column B blocks the position X if the column X + B is solid
+                uint32_t blocked = 0;
+                for (int r = 0; r < shape.size && blocked != ~0u; ++r) {
+                    if (shape.rows[r] == 0) continue;
+                    const int boardY = y + r;
+                    if (boardY < 0 || boardY >= Bitboard::HEIGHT) {
+                        blocked = ~0u;
+                        break;
+                    }
+                    for (int b = 0; b < shape.size; ++b) {
+                        if ((shape.rows[r] >> b) & 1) blocked |= extended[boardY] >> b;
+                    }
+                }
+                table.fits[rotation][index] = static_cast<uint16_t>(~blocked);
+                if (y >= 0 && y + shape.size <= firstFilled) openRow = table.fits[rotation][index];
+            }
+            table.fits[rotation][ROWS] = 0;
+        }
+    }
+
+    /**
+     * Maps every rotation state to the lowest one that covers the same cells
+     * (S, Z and I have 2 distinct states, O has 1), with the box offset between them
+     */
+    struct Equivalence {
+        int8_t rotation = 0, dx = 0, dy = 0;
+    };
+
+    struct EquivalenceTable {
+        Equivalence of[7][4];
+    };
+
+    constexpr int lowestColumn(const Bitboard::PieceShape &shape) {
+        int column = shape.size;
+        for (int r = 0; r < shape.size; ++r) {
+            for (int b = 0; b < shape.size; ++b) {
+                if (((shape.rows[r] >> b) & 1) && b < column) column = b;
+            }
+        }
+        return column;
+    }
+
+    constexpr int lowestRow(const Bitboard::PieceShape &shape) {
+        for (int r = 0; r < shape.size; ++r) {
+            if (shape.rows[r] != 0) return r;
+        }
+        return shape.size;
+    }
+
+    constexpr bool sameCells(const Bitboard::PieceShape &a, const Bitboard::PieceShape &b) {
+        const int ax = lowestColumn(a), ay = lowestRow(a), bx = lowestColumn(b), by = lowestRow(b);
+        for (int r = 0; r < 4; ++r) {
+            const uint16_t rowA = ay + r < a.size ? static_cast<uint16_t>(a.rows[ay + r] >> ax) : 0;
+            const uint16_t rowB = by + r < b.size ? static_cast<uint16_t>(b.rows[by + r] >> bx) : 0;
+            if (rowA != rowB) return false;
+        }
+        return true;
+    }
+
+    constexpr EquivalenceTable buildEquivalences() {
+        EquivalenceTable table{};
+        for (int type = 0; type < 7; ++type) {
+            for (int rotation = 0; rotation < 4; ++rotation) {
+                const Bitboard::PieceShape &shape = Bitboard::SHAPES.shapes[type][rotation];
+                for (int lower = 0; lower <= rotation; ++lower) {
+                    const Bitboard::PieceShape &other = Bitboard::SHAPES.shapes[type][lower];
+                    if (!sameCells(shape, other)) continue;
+                    table.of[type][rotation] = {
+                            static_cast<int8_t>(lower),
+                            static_cast<int8_t>(lowestColumn(shape) - lowestColumn(other)),
+                            static_cast<int8_t>(lowestRow(shape) - lowestRow(other))
+                    };
+                    break;
+                }
+            }
+        }
+        return table;
+    }
+
+    constexpr EquivalenceTable EQUIVALENCES = buildEquivalences();
+
+    /**
+     * The spin masks of the grounded T positions of a row, same lookup as SRS::detectSpin
+     * (corners outside the board count as filled)
+     */
+    void classifyTSpins(const uint16_t *rows, const int rotation, const int y, const uint16_t grounded, const Tag tag,
+                        uint16_t &full, uint16_t &mini) {
+        const uint32_t top = extendedRow(rows, y), bottom = extendedRow(rows, y + 2);
+        const uint32_t c1 = top, c2 = top >> 2, c3 = bottom, c4 = bottom >> 2;
+        const uint32_t tMinoRelative[4][4] = {
+                {c1, c2, /*back*/ c3, c4},  // 0
+                {c2, c3, /*back*/ c1, c4},  // 1
+                {c3, c4, /*back*/ c1, c2},  // 2
+                {c4, c1, /*back*/ c2, c3}   // 3
+        };
+        const uint32_t *pair = tMinoRelative[rotation];
+        full = static_cast<uint16_t>(pair[0] & pair[1] & (pair[2] | pair[3]) & grounded);
+        mini = static_cast<uint16_t>(pair[2] & pair[3] & (pair[0] | pair[1]) & grounded & ~full);
+        if (tag == TAG_KICKED_1_2) {
+            full |= mini;
+            mini = 0;
+        }
+    }
+}
+
+Placement MoveGenerator::canonical(const int type, const Placement &placement) {
+    const Equivalence &equivalence = EQUIVALENCES.of[type][placement.rotation];
+    Placement result = placement;
+    result.rotation = equivalence.rotation;
+    result.x = static_cast<int8_t>(placement.x + equivalence.dx);
+    result.y = static_cast<int8_t>(placement.y + equivalence.dy);
+    return result;
+}
+
+void MoveGenerator::generate(const uint16_t *rows, const int type, const int x, const int y, const int rotation,
+                             std::vector<Placement> &out) const {
+    out.clear();
+    FitTable table;
+    buildFitTable(rows, type, table);
+    if (x + X_OFFSET < 0 || x + X_OFFSET >= 16 || y + Y_OFFSET < 0 || y + Y_OFFSET >= ROWS) return;
+    if (!((table.fits[rotation][y + Y_OFFSET] >> (x + X_OFFSET)) & 1)) return; // topped out
+
+    // reached[rotation][tag][Y + 3] = the x-positions reached with that last action
+    uint16_t reached[4][TAG_COUNT][ROWS] = {};
+    reached[rotation][TAG_SHIFTED][y + Y_OFFSET] = static_cast<uint16_t>(1 << (x + X_OFFSET));
+
+    // rotation states with positions that were not expanded yet, and the highest row reached
+    // (nothing above it can be reached but through an upward kick)
+    bool pending[4] = {};
+    pending[rotation] = true;
+    int top = y + Y_OFFSET;
+    const auto reach = [&pending](const int into, uint16_t &positions, const uint16_t added) {
+        if (added & ~positions) {
+            positions |= added;
+            pending[into] = true;
+        }
+    };
+
+    // flood until nothing new shows up
+    for (int from = 0; ; from = (from + 1) % 4) {
+        if (!pending[from]) {
+            if (!pending[0] && !pending[1] && !pending[2] && !pending[3]) break;
+            continue;
+        }
+        pending[from] = false;
+        const uint16_t *fits = table.fits[from];
+
+        // shifts: every position of the row connected to a reached one
+        uint16_t any[ROWS];
+        for (int index = top; index < ROWS; ++index) {
+            uint32_t positions = 0;
+            for (int tag = 0; tag < TAG_COUNT; ++tag) positions |= reached[from][tag][index];
+            if (positions != 0) {
+                uint32_t spread = ((positions << 1) | (positions >> 1)) & fits[index];
+                for (uint32_t next = spread; ; spread = next) {
+                    next = spread | (((spread << 1) | (spread >> 1)) & fits[index]);
+                    if (next == spread) break;
+                }
+                reach(from, reached[from][TAG_SHIFTED][index], static_cast<uint16_t>(spread));
+                positions |= spread;
+            }
+            any[index] = static_cast<uint16_t>(positions);
+        }
+
+        // drops: every column falls until the next row blocks it, the last action stays the same
+        for (int tag = 0; tag < TAG_COUNT; ++tag) {
+            uint16_t falling = 0;
+            for (int index = top; index < ROWS; ++index) {
+                falling |= reached[from][tag][index];
+                if (falling == 0) continue;
+                const uint16_t landed = falling & static_cast<uint16_t>(~fits[index + 1]);
+                reach(from, reached[from][tag][index], landed);
+                any[index] |= landed;
+                falling &= fits[index + 1];
+            }
+        }
+
+        // rotations: the first kick that fits wins, the later ones only see what is left
+        const int firstRow = top;
+        for (const int direction: {1, 3}) {
+            const int to = (from + direction) % 4;
+            const SRS::KickSequence sequence = SRS::kickSequence(type, from, to, useSRS);
+            for (int index = firstRow; index < ROWS; ++index) {
+                uint16_t remaining = any[index];
+                for (int k = 0; k < sequence.count && remaining != 0; ++k) {
+                    const SRS::Kick &kick = sequence.kicks[k];
+                    const int target = index - kick.y; // the board is upside down
+                    if (target < 0 || target >= ROWS) continue;
+                    const uint16_t kicked = shiftX(table.fits[to][target], -kick.x) & remaining;
+                    if (kicked == 0) continue;
+                    remaining &= static_cast<uint16_t>(~kicked);
+                    reach(to, reached[to][rotationTag(k, kick)][target], shiftX(kicked, kick.x));
+                    top = std::min(top, target);
+                }
+            }
+        }
+    }
+
+    // the grounded positions are the placements, bucketed by canonical rotation and spin
+    uint16_t placements[4][3][ROWS] = {};
+    for (int from = 0; from < 4; ++from) {
+        const uint16_t *fits = table.fits[from];
+        const Equivalence &equivalence = EQUIVALENCES.of[type][from];
+        for (int index = 0; index < ROWS; ++index) {
+            const int target = index + equivalence.dy;
+            if (target < 0 || target >= ROWS) continue;
+            for (int tag = 0; tag < TAG_COUNT; ++tag) {
+                const uint16_t grounded = reached[from][tag][index] & static_cast<uint16_t>(~fits[index + 1]);
+                if (grounded == 0) continue;
+
+                uint16_t full = 0, mini = 0;
+                if (tag != TAG_SHIFTED) {
+                    if (type == Bitboard::PIECE_T) {
+                        classifyTSpins(rows, from, index - Y_OFFSET, grounded, static_cast<Tag>(tag), full, mini);
+                    } else if (tag != TAG_ROTATED) {
+                        mini = grounded; // All-Spin: any kicked rotation
+                    }
+                }
+                const uint16_t none = grounded & static_cast<uint16_t>(~(full | mini));
+
+                uint16_t (&bucket)[3][ROWS] = placements[equivalence.rotation];
+                bucket[SRS::SPIN_NONE][target] |= shiftX(none, equivalence.dx);
+                bucket[SRS::SPIN_MINI][target] |= shiftX(mini, equivalence.dx);
+                bucket[SRS::SPIN_FULL][target] |= shiftX(full, equivalence.dx);
+            }
+        }
+    }
+
+    for (int rotationState = 0; rotationState < 4; ++rotationState) {
+        for (int spin = 0; spin < 3; ++spin) {
+            for (int index = 0; index < ROWS; ++index) {
+                for (uint32_t positions = placements[rotationState][spin][index]; positions != 0; positions &= positions - 1) {
+                    Placement placement;
+                    placement.x = static_cast<int8_t>(__builtin_ctz(positions) - X_OFFSET);
+                    placement.y = static_cast<int8_t>(index - Y_OFFSET);
+                    placement.rotation = static_cast<int8_t>(rotationState);
+                    placement.spin = static_cast<SRS::SpinType>(spin);
+                    out.push_back(placement);
+                }
+            }
+        }
+    }
+}
+
+bool MoveGenerator::findPath(const uint16_t *rows, const int type, const int x, const int y, const int rotation,
+                             const Placement &target, std::vector<MoveStep> &out) const {
+    out.clear();
+    FitTable table;
+    buildFitTable(rows, type, table);
+    const Placement goal = canonical(type, target);
+
+    // a state is (rotation, tag, Y + 3, X + 3), breadth first so the path is one of the shortest
+    constexpr int STATES = 4 * TAG_COUNT * ROWS * 16;
+    const auto encode = [](const int r, const int tag, const int index, const int position) {
+        return ((r * TAG_COUNT + tag) * ROWS + index) * 16 + position;
+    };
+    const auto fitsAt = [&table](const int r, const int index, const int position) {
+        return index >= 0 && index < ROWS && position >= 0 && position < 16 && ((table.fits[r][index] >> position) & 1);
+    };
+
+    if (!fitsAt(rotation, y + Y_OFFSET, x + X_OFFSET)) return false;
+    std::vector<int16_t> parent(STATES, -1);
+    std::vector<int8_t> stepTaken(STATES, -1);
+    std::vector<int16_t> queue;
+    queue.reserve(STATES);
+
+    const int start = encode(rotation, TAG_SHIFTED, y + Y_OFFSET, x + X_OFFSET);
+    parent[start] = static_cast<int16_t>(start);
+    queue.push_back(static_cast<int16_t>(start));
+
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const int current = queue[head];
+        const int position = current % 16;
+        const int index = (current / 16) % ROWS;
+        const int tag = (current / 16 / ROWS) % TAG_COUNT;
+        const int r = current / 16 / ROWS / TAG_COUNT;
+
+        // grounded: this is where a hard drop would lock it
+        if (!fitsAt(r, index + 1, position)) {
+            Placement reached;
+            reached.x = static_cast<int8_t>(position - X_OFFSET);
+            reached.y = static_cast<int8_t>(index - Y_OFFSET);
+            reached.rotation = static_cast<int8_t>(r);
+            const bool kickedOneTwo = tag == TAG_KICKED_1_2;
+            reached.spin = SRS::detectSpin(rows, type, r, reached.x, reached.y, tag != TAG_SHIFTED,
+                                           tag == TAG_ROTATED ? 0 : (kickedOneTwo ? 4 : 1),
+                                           kickedOneTwo ? 1 : 0, kickedOneTwo ? 2 : 0);
+            if (canonical(type, reached) == goal) {
+                for (int state = current; state != start; state = parent[state]) {
+                    out.push_back(static_cast<MoveStep>(stepTaken[state]));
+                }
+                std::reverse(out.begin(), out.end());
+                return true;
+            }
+        }
+
+        const auto visit = [&](const int next, const MoveStep step) {
+            if (parent[next] != -1) return;
+            parent[next] = static_cast<int16_t>(current);
+            stepTaken[next] = step;
+            queue.push_back(static_cast<int16_t>(next));
+        };
+
+        if (fitsAt(r, index, position - 1)) visit(encode(r, TAG_SHIFTED, index, position - 1), STEP_LEFT);
+        if (fitsAt(r, index, position + 1)) visit(encode(r, TAG_SHIFTED, index, position + 1), STEP_RIGHT);
+        for (const int direction: {1, 3}) {
+            const int to = (r + direction) % 4;
+            const SRS::KickSequence sequence = SRS::kickSequence(type, r, to, useSRS);
+            for (int k = 0; k < sequence.count; ++k) {
+                const SRS::Kick &kick = sequence.kicks[k];
+                if (!fitsAt(to, index - kick.y, position + kick.x)) continue;
+                visit(encode(to, rotationTag(k, kick), index - kick.y, position + kick.x), direction == 1 ? STEP_CW : STEP_CCW);
+                break;
+            }
+        }
+        int landing = index;
+        while (fitsAt(r, landing + 1, position)) ++landing;
+        if (landing != index) visit(encode(r, tag, landing, position), STEP_DROP);
+    }
+    return false;
+}
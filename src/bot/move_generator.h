@@ -0,0 +1,102 @@
+#ifndef TETISENGINE_MOVE_GENERATOR_H
+#define TETISENGINE_MOVE_GENERATOR_H
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "../engine/bitboard.h"
+#include "../engine/srs.h"
+
+/**
+ * A final resting position of a piece (where a hard drop would lock it)
+ */
+struct Placement {
+    int8_t x = 0, y = 0; // the bounding box position, same as the engine
+    int8_t rotation = 0;
+    SRS::SpinType spin = SRS::SPIN_NONE; // what the engine would report on lock
+
+    bool operator==(const Placement &other) const {
+        return x == other.x && y == other.y && rotation == other.rotation && spin == other.spin;
+    }
+};
+
+/**
+ * One step of a path, DROP moves the piece straight down to the ground (a soft drop held
+ * until it lands, it does not count as an action for spin detection, just like in the engine)
+ */
+enum MoveStep : int8_t {
+    STEP_LEFT,
+    STEP_RIGHT,
+    STEP_CW,
+    STEP_CCW,
+    STEP_DROP
+};
+
+/**
+ * Enumerates every placement a piece can reach from where it spawns, through shifts,
+ * rotations (with every SRS kick, same tables as the engine) and drops to the ground,
+ * in any order: tucks, kicks and spins included.
+ *
+ * Positions are handled as row masks of x-positions (bit X + 3 = x-position X), all the
+ * x-positions of a row are tested and moved at once with shifts, no per-cell collision check.
+ *
+ * The model: a piece can be shifted and rotated at the height it spawned at, then dropped to the
+ * ground and moved again (a bot drives the engine that way, gravity is ignored).
+ * Lock delay and the manipulation limit are not enforced.
+ *
+ * Placements that lock the same cells are reported once (S, Z, I and O have equivalent
+ * rotations), under the lowest rotation state. Spins are part of the identity: a T slot
+ * that can be filled with or without a T-spin is reported twice.
+ */
+class MoveGenerator {
+public:
+    /**
+     * @param useSRS if false, rotations never kick (same as TetrisConfig::srsEnabled)
+     */
+    explicit MoveGenerator(bool useSRS = true) : useSRS(useSRS) {}
+
+    /**
+     * Finds every reachable placement for a piece spawning on the given board
+     *
+     * @param rows the playfield, Bitboard::HEIGHT row masks
+     * @param type the piece ordinal
+     * @param out  cleared, then filled with the placements
+     */
+    void generate(const uint16_t *rows, int type, std::vector<Placement> &out) const {
+        generate(rows, type, Bitboard::spawnX(type), Bitboard::SPAWN_Y, 0, out);
+    }
+
+    /**
+     * Same as above, for a piece that is already somewhere on the board
+     */
+    void generate(const uint16_t *rows, int type, int x, int y, int rotation, std::vector<Placement> &out) const;
+
+    /**
+     * Finds one of the shortest step sequences that brings a spawning piece to the given placement
+     * (or to an equivalent one), a hard drop after the last step locks it there
+     *
+     * @param rows   the playfield, Bitboard::HEIGHT row masks
+     * @param type   the piece ordinal
+     * @param target the placement to reach, as returned by generate()
+     * @param out    cleared, then filled with the steps
+     * @return false if the placement can't be reached
+     */
+    bool findPath(const uint16_t *rows, int type, const Placement &target, std::vector<MoveStep> &out) const {
+        return findPath(rows, type, Bitboard::spawnX(type), Bitboard::SPAWN_Y, 0, target, out);
+    }
+
+    /**
+     * Same as above, for a piece that is already somewhere on the board
+     */
+    bool findPath(const uint16_t *rows, int type, int x, int y, int rotation,
+                  const Placement &target, std::vector<MoveStep> &out) const;
+
+    /**
+     * Maps a placement to the one generate() reports for the same cells
+     */
+    static Placement canonical(int type, const Placement &placement);
+
+private:
+    bool useSRS;
+};
+
+#endif //TETISENGINE_MOVE_GENERATOR_H
@@ -0,0 +1,133 @@
+#include "nn_eval.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    const char MAGIC[4] = {'T', 'N', 'N', 'E'};
+
+    int padded(const int count) {
+        return (count + NnEval::PAD - 1) / NnEval::PAD * NnEval::PAD;
+    }
+
+    void forwardScalar(const NnEval::Layer &layer, const uint8_t *in, int32_t *out) {
+        for (int o = 0; o < layer.outputs; ++o) {
+            const int8_t *weights = &layer.weights[static_cast<size_t>(o) * layer.inputs];
+            int32_t sum = layer.bias[o];
+            for (int i = 0; i < layer.inputs; ++i) sum += in[i] * weights[i];
+            out[o] = sum;
+        }
+    }
+
+    // the clipped ReLU between two layers
+    void activate(const NnEval::Layer &layer, const int32_t *sums, uint8_t *out) {
+        for (int o = 0; o < layer.outputs; ++o) {
+            out[o] = static_cast<uint8_t>(std::clamp(static_cast<int>(static_cast<float>(sums[o]) * layer.scale), 0, 127));
+        }
+    }
+
+    template<class T>
+    void readRaw(std::ifstream &in, T *values, const size_t count) {
+        in.read(reinterpret_cast<char *>(values), static_cast<std::streamsize>(count * sizeof(T)));
+    }
+
+    template<class T>
+    void writeRaw(std::ofstream &out, const T *values, const size_t count) {
+        out.write(reinterpret_cast<const char *>(values), static_cast<std::streamsize>(count * sizeof(T)));
+    }
+}
+
+NnEval::NnEval(const int rows, const int queue, std::vector<Layer> layers) : rows(rows), queue(queue), layers(std::move(layers)) {
+    if (rows < 1 || rows > Bitboard::HEIGHT || queue < 0 || queue > STATE_MAX_NEXT_QUEUE) {
+        throw std::invalid_argument("Bad network inputs");
+    }
+    const std::vector<Layer> &chain = this->layers;
+    bool valid = chain.size() == 3 && chain[0].inputs == padded(inputCount(rows, queue)) && chain[2].outputs == 1;
+    for (size_t i = 0; valid && i < chain.size(); ++i) {
+        const Layer &layer = chain[i];
+        valid = layer.outputs > 0 && layer.inputs % PAD == 0
+                && layer.weights.size() == static_cast<size_t>(layer.outputs) * layer.inputs
+                && layer.bias.size() == static_cast<size_t>(layer.outputs)
+                && (i == 0 || layer.inputs == padded(chain[i - 1].outputs));
+    }
+    if (!valid) throw std::invalid_argument("The layers of the network don't chain up");
+}
+
+std::shared_ptr<const NnEval> NnEval::load(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::invalid_argument("Cannot read " + path);
+    char magic[4];
+    uint32_t header[5]; // version, rows, queue, hidden1, hidden2
+    readRaw(in, magic, 4);
+    readRaw(in, header, 5);
+    if (!in || std::memcmp(magic, MAGIC, 4) != 0) throw std::invalid_argument(path + " is not a network");
+    if (header[0] != VERSION) throw std::invalid_argument(path + " is a network of another version");
+    // sizes a network this small never gets near, anything past them is a broken file
+    for (int i = 1; i < 5; ++i) {
+        if (header[i] > 4096) throw std::invalid_argument(path + " is broken");
+    }
+
+    const int rows = static_cast<int>(header[1]), queue = static_cast<int>(header[2]);
+    const int sizes[4] = {padded(inputCount(rows, queue)), static_cast<int>(header[3]), static_cast<int>(header[4]), 1};
+    std::vector<Layer> layers(3);
+    for (int i = 0; i < 3; ++i) {
+        Layer &layer = layers[i];
+        layer.inputs = i == 0 ? sizes[0] : padded(sizes[i]);
+        layer.outputs = sizes[i + 1];
+        layer.weights.resize(static_cast<size_t>(layer.outputs) * layer.inputs);
+        layer.bias.resize(layer.outputs);
+        readRaw(in, layer.weights.data(), layer.weights.size());
+        readRaw(in, layer.bias.data(), layer.bias.size());
+        readRaw(in, &layer.scale, 1);
+    }
+    if (!in) throw std::invalid_argument(path + " is truncated");
+    return std::make_shared<const NnEval>(rows, queue, std::move(layers));
+}
+
+void NnEval::save(const std::string &path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    const uint32_t header[5] = {VERSION, static_cast<uint32_t>(rows), static_cast<uint32_t>(queue),
+                                static_cast<uint32_t>(layers[0].outputs), static_cast<uint32_t>(layers[1].outputs)};
+    writeRaw(out, MAGIC, 4);
+    writeRaw(out, header, 5);
+    for (const Layer &layer: layers) {
+        writeRaw(out, layer.weights.data(), layer.weights.size());
+        writeRaw(out, layer.bias.data(), layer.bias.size());
+        writeRaw(out, &layer.scale, 1);
+    }
+    if (!out) throw std::runtime_error("Cannot write " + path);
+}
+
+void NnEval::encode(const Input &input, uint8_t *out) const {
+    std::memset(out, 0, layers[0].inputs);
+    // the bottom rows, row 0 is the floor
+    for (int row = 0; row < rows; ++row) {
+        const uint16_t mask = input.rows[Bitboard::HEIGHT - 1 - row];
+        for (int x = 0; x < Bitboard::WIDTH; ++x) out[row * Bitboard::WIDTH + x] = (mask >> x) & 1;
+    }
+    uint8_t *pieces = out + rows * Bitboard::WIDTH;
+    if (input.hold >= 0) pieces[input.hold] = 1;
+    for (int i = 0; i < queue && i < input.queueSize; ++i) {
+        if (input.queue[i] >= 0) pieces[(i + 1) * 7 + input.queue[i]] = 1;
+    }
+}
+
+void NnEval::evaluateBatch(const Input *inputs, const int count, float *out, const BoardEval::SimdLevel level) const {
+    const bool avx2 = std::min(level, BoardEval::detectSimdLevel()) == BoardEval::SIMD_AVX2;
+    const auto forward = avx2 ? NnEvalSimd::forwardAvx2 : forwardScalar;
+
+    // one buffer per layer input, the padding stays zero
+    std::vector<uint8_t> first(layers[0].inputs), second(layers[1].inputs, 0), third(layers[2].inputs, 0);
+    std::vector<int32_t> sums(std::max(layers[0].outputs, layers[1].outputs));
+    for (int i = 0; i < count; ++i) {
+        encode(inputs[i], first.data());
+        forward(layers[0], first.data(), sums.data());
+        activate(layers[0], sums.data(), second.data());
+        forward(layers[1], second.data(), sums.data());
+        activate(layers[1], sums.data(), third.data());
+        forward(layers[2], third.data(), sums.data());
+        out[i] = static_cast<float>(sums[0]) * layers[2].scale;
+    }
+}
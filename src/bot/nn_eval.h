@@ -0,0 +1,107 @@
+#ifndef TETISENGINE_NN_EVAL_H
+#define TETISENGINE_NN_EVAL_H
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "board_eval.h"
+#include "../engine/tetris_engine_state.h"
+
+/**
+ * A learned board evaluation: a small MLP with int8 weights, in place of
+ * BoardEval::evaluate() (same units, the lock rewards stay what they are).
+ *
+ * The inputs are 0/1: the cells of the bottom getRows() rows, then HOLD and the next getQueue()
+ * pieces one-hot (7 each, all zeros when there is none). Two hidden layers of clipped ReLUs
+ * (activations 0..127 in uint8), int32 accumulators, a float scale per layer to go from one to
+ * the next, so AVX2 does 32 multiply-adds per instruction (maddubs). The scalar path does the
+ * same integer math, both give the same scores.
+ *
+ * File (little endian): "TNNE", uint32 version, rows, queue, hidden1, hidden2, then per layer
+ * int8 weights[outputs][inputs, padded to 32], int32 bias[outputs], float scale
+ */
+class NnEval {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr int PAD = 32; // the inputs of every layer are padded to this
+
+    struct Layer {
+        int inputs = 0; // padded
+        int outputs = 0;
+        std::vector<int8_t> weights; // outputs * inputs, row-major
+        std::vector<int32_t> bias;
+        float scale = 1; // accumulator to activation (hidden) or to score (output)
+    };
+
+    /**
+     * What a board is evaluated with
+     */
+    struct Input {
+        const uint16_t *rows; // Bitboard::HEIGHT row masks
+        int8_t hold = -1;
+        const int8_t *queue = nullptr; // the pieces that come next, queueSize of them
+        int queueSize = 0;
+    };
+
+    /**
+     * @param layers input to hidden1, hidden1 to hidden2, hidden2 to the score (1 output)
+     * @throws std::invalid_argument if the sizes don't chain up
+     */
+    NnEval(int rows, int queue, std::vector<Layer> layers);
+
+    /**
+     * @throws std::invalid_argument if the file can't be read or isn't a network of this version
+     */
+    static std::shared_ptr<const NnEval> load(const std::string &path);
+
+    /**
+     * @throws std::runtime_error if the file can't be written
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * @return the amount of inputs before padding
+     */
+    static int inputCount(const int rows, const int queue) {
+        return rows * Bitboard::WIDTH + (queue + 1) * 7;
+    }
+
+    /**
+     * Writes the 0/1 inputs of a board (inputs of the first layer, padding included)
+     */
+    void encode(const Input &input, uint8_t *out) const;
+
+    /**
+     * Scores many boards in one call
+     * @param level the instruction set to use, capped by what the CPU supports (SSE2 = scalar here)
+     */
+    void evaluateBatch(const Input *inputs, int count, float *out,
+                       BoardEval::SimdLevel level = BoardEval::SIMD_AVX2) const;
+
+    int getRows() const {
+        return rows;
+    }
+
+    int getQueue() const {
+        return queue;
+    }
+
+    const std::vector<Layer> &getLayers() const {
+        return layers;
+    }
+
+private:
+    int rows, queue;
+    std::vector<Layer> layers;
+};
+
+// the AVX2 kernel, only nn_eval*.cpp should use this
+namespace NnEvalSimd {
+    /**
+     * out[o] = bias[o] + dot(in, weights[o]) for every output of the layer
+     */
+    void forwardAvx2(const NnEval::Layer &layer, const uint8_t *in, int32_t *out);
+}
+
+#endif //TETISENGINE_NN_EVAL_H
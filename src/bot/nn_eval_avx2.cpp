@@ -0,0 +1,65 @@
+// NnEval's dot products for AVX2: 32 uint8 activations times 32 int8 weights per maddubs,
+// 4 outputs of a layer at a time so every load of the inputs serves 4 rows of weights
+//
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#pragma GCC target("avx2")
+#include <immintrin.h>
+#define TETRIS_NN_AVX2 1
+#else
+#define TETRIS_NN_AVX2 0
+#endif
+#include "nn_eval.h"
+
+#if TETRIS_NN_AVX2
+namespace {
+    // the products of 32 pairs, summed into 8 int32 (no overflow: 2 * 127 * 127 fits an int16)
+    inline __m256i dot32(const __m256i in, const int8_t *weights) {
+        const __m256i products = _mm256_maddubs_epi16(in, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights)));
+        return _mm256_madd_epi16(products, _mm256_set1_epi16(1));
+    }
+
+    inline int32_t sum(const __m256i v) {
+        const __m128i half = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        const __m128i quarter = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtsi128_si32(_mm_add_epi32(quarter, _mm_shuffle_epi32(quarter, _MM_SHUFFLE(2, 3, 0, 1))));
+    }
+}
+
+void NnEvalSimd::forwardAvx2(const NnEval::Layer &layer, const uint8_t *in, int32_t *out) {
+    const int inputs = layer.inputs;
+    const int8_t *weights = layer.weights.data();
+    int o = 0;
+    for (; o + 4 <= layer.outputs; o += 4) {
+        const int8_t *row = weights + static_cast<size_t>(o) * inputs;
+        __m256i a = _mm256_setzero_si256(), b = a, c = a, d = a;
+        for (int i = 0; i < inputs; i += NnEval::PAD) {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+            a = _mm256_add_epi32(a, dot32(x, row + i));
+            b = _mm256_add_epi32(b, dot32(x, row + inputs + i));
+            c = _mm256_add_epi32(c, dot32(x, row + 2 * inputs + i));
+            d = _mm256_add_epi32(d, dot32(x, row + 3 * inputs + i));
+        }
+        out[o] = layer.bias[o] + sum(a);
+        out[o + 1] = layer.bias[o + 1] + sum(b);
+        out[o + 2] = layer.bias[o + 2] + sum(c);
+        out[o + 3] = layer.bias[o + 3] + sum(d);
+    }
+    for (; o < layer.outputs; ++o) {
+        const int8_t *row = weights + static_cast<size_t>(o) * inputs;
+        __m256i a = _mm256_setzero_si256();
+        for (int i = 0; i < inputs; i += NnEval::PAD) {
+            a = _mm256_add_epi32(a, dot32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)), row + i));
+        }
+        out[o] = layer.bias[o] + sum(a);
+    }
+}
+#else
+// never picked (BoardEval::detectSimdLevel() says scalar), here so that it links
+void NnEvalSimd::forwardAvx2(const NnEval::Layer &layer, const uint8_t *in, int32_t *out) {
+    for (int o = 0; o < layer.outputs; ++o) {
+        int32_t sum = layer.bias[o];
+        for (int i = 0; i < layer.inputs; ++i) sum += in[i] * layer.weights[static_cast<size_t>(o) * layer.inputs + i];
+        out[o] = sum;
+    }
+}
+#endif
@@ -0,0 +1,145 @@
+#include "opening_book.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "../engine/zobrist.h"
+
+namespace {
+    const char MAGIC[4] = {'T', 'B', 'O', 'K'};
+    constexpr size_t HEADER_SIZE = 4 + 4 * sizeof(uint32_t); // magic, version, bits, entries, setups
+    static_assert(sizeof(OpeningBook::Entry) == 16, "the entries are written as they are in memory");
+
+    uint32_t readUint32(const uint8_t *at) {
+        uint32_t value;
+        std::memcpy(&value, at, sizeof(value));
+        return value;
+    }
+}
+
+std::shared_ptr<const OpeningBook> OpeningBook::open(const std::string &path) {
+    std::shared_ptr<OpeningBook> book(new OpeningBook());
+    book->file.reset(new MappedFile(path));
+    const uint8_t *data = book->file->data();
+    const size_t dataSize = book->file->size();
+    if (dataSize < HEADER_SIZE || std::memcmp(data, MAGIC, 4) != 0) {
+        throw std::invalid_argument(path + " is not an opening book");
+    }
+    if (readUint32(data + 4) != VERSION) throw std::invalid_argument(path + " is an opening book of another version");
+    book->bucketBits = readUint32(data + 8);
+    book->entryCount = readUint32(data + 12);
+    book->setupCount = readUint32(data + 16);
+    // write() uses 1 to 24 bits, lookup() shifts by 64 - bits
+    if (book->bucketBits < 1 || book->bucketBits > 24 || book->setupCount > 127) throw std::invalid_argument(path + " is broken");
+
+    // everything has to be in the file before any of it is trusted
+    const size_t bucketCount = (size_t{1} << book->bucketBits) + 1;
+    const size_t namesAt = HEADER_SIZE;
+    const size_t bucketsAt = namesAt + static_cast<size_t>(book->setupCount) * NAME_LENGTH;
+    const size_t entriesAt = bucketsAt + bucketCount * sizeof(uint32_t);
+    if (dataSize != entriesAt + static_cast<size_t>(book->entryCount) * sizeof(Entry)) {
+        throw std::invalid_argument(path + " is broken");
+    }
+    book->names = reinterpret_cast<const char *>(data + namesAt);
+    book->buckets = reinterpret_cast<const uint32_t *>(data + bucketsAt);
+    book->entries = reinterpret_cast<const Entry *>(data + entriesAt);
+    // lookup() reads entries[buckets[b]] to entries[buckets[b + 1]], every offset is checked once here
+    if (book->buckets[0] != 0 || book->buckets[bucketCount - 1] != book->entryCount) throw std::invalid_argument(path + " is broken");
+    for (size_t i = 1; i < bucketCount; ++i) {
+        if (book->buckets[i] < book->buckets[i - 1]) throw std::invalid_argument(path + " is broken");
+    }
+    return book;
+}
+
+void OpeningBook::write(const std::string &path, std::vector<Entry> entries, const std::vector<std::string> &setups) {
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.key < b.key; });
+    for (size_t i = 1; i < entries.size(); ++i) {
+        if (entries[i].key == entries[i - 1].key) throw std::invalid_argument("Two moves for the same position");
+    }
+    if (setups.size() > 127) throw std::invalid_argument("Too many setups");
+
+    // about one entry per bucket
+    uint32_t bits = 1;
+    while (bits < 24 && (size_t{1} << bits) < entries.size()) ++bits;
+    std::vector<uint32_t> buckets((size_t{1} << bits) + 1, 0);
+    for (const Entry &entry: entries) ++buckets[(entry.key >> (64 - bits)) + 1];
+    for (size_t i = 1; i < buckets.size(); ++i) buckets[i] += buckets[i - 1];
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    const uint32_t header[4] = {VERSION, bits, static_cast<uint32_t>(entries.size()), static_cast<uint32_t>(setups.size())};
+    out.write(MAGIC, 4);
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for (const std::string &name: setups) {
+        char padded[NAME_LENGTH] = {};
+        std::memcpy(padded, name.data(), std::min<size_t>(name.size(), NAME_LENGTH - 1));
+        out.write(padded, NAME_LENGTH);
+    }
+    out.write(reinterpret_cast<const char *>(buckets.data()), static_cast<std::streamsize>(buckets.size() * sizeof(uint32_t)));
+    out.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+    if (!out) throw std::runtime_error("Cannot write " + path);
+}
+
+bool OpeningBook::key(const uint16_t *rows, const int current, const int hold, const int8_t *queue,
+                      const int queueSize, uint64_t &out) {
+    if (current < 0) return false;
+    int cells = 0;
+    for (int y = 0; y < Bitboard::HEIGHT; ++y) cells += __builtin_popcount(rows[y]);
+    if (cells % 4 != 0) return false; // garbage, or lines were cleared
+
+    // the bag so far: the placed pieces, HOLD, the falling one, the rest is at the front of the queue
+    // (with 6 to come, 5 of them tell which is the last)
+    const int rest = std::min(7 - cells / 4 - (hold >= 0) - 1, 5);
+    if (rest < 0 || rest > queueSize) return false;
+    uint64_t pieces = static_cast<uint64_t>(current + 1) | static_cast<uint64_t>(hold + 1) << 3;
+    for (int i = 0; i < rest; ++i) pieces |= static_cast<uint64_t>(queue[i] + 1) << (6 + 3 * i);
+    out = Zobrist::boardHash(rows) ^ Zobrist::mix(pieces | 2ULL << 40);
+    return true;
+}
+
+bool OpeningBook::lookup(const BotInput &input, BookMove &out) const {
+    uint64_t hash;
+    if (!key(input.rows, input.fallingType, input.holdType, input.nextQueue, input.nextQueueSize, hash)) return false;
+    const uint64_t bucket = hash >> (64 - bucketBits);
+    for (uint32_t i = buckets[bucket]; i < buckets[bucket + 1]; ++i) {
+        const Entry &entry = entries[i];
+        if (entry.key != hash) continue;
+        out.type = entry.type;
+        out.placement.rotation = entry.rotation;
+        out.placement.x = entry.x;
+        out.placement.y = entry.y;
+        out.placement.spin = static_cast<SRS::SpinType>(entry.spin);
+        out.setup = entry.setup;
+        return true;
+    }
+    return false;
+}
+
+bool OpeningBook::decide(const BotInput &input, const MoveGenerator &generator, BotDecision &out) const {
+    BookMove move;
+    if (!lookup(input, move)) return false;
+    const bool useHold = move.type != input.fallingType;
+    if (useHold) {
+        const int comesOut = input.holdType >= 0 ? input.holdType : input.nextQueueSize > 0 ? input.nextQueue[0] : -1;
+        if (!input.canHold || move.type != comesOut) return false;
+    }
+    // a HOLD spawns the other piece, its path starts at the spawn
+    std::vector<MoveStep> path;
+    const bool reachable = useHold ? generator.findPath(input.rows, move.type, move.placement, path)
+                                   : generator.findPath(input.rows, input.fallingType, input.fallingX, input.fallingY,
+                                                        input.fallingRotation, move.placement, path);
+    if (!reachable) return false;
+    out = BotDecision();
+    out.found = true;
+    out.useHold = useHold;
+    out.placement = move.placement;
+    out.path = std::move(path);
+    out.bookSetup = move.setup;
+    return true;
+}
+
+std::string OpeningBook::getSetupName(const int setup) const {
+    if (setup < 0 || static_cast<uint32_t>(setup) >= setupCount) return "";
+    const char *name = names + static_cast<size_t>(setup) * NAME_LENGTH;
+    return std::string(name, strnlen(name, NAME_LENGTH));
+}
@@ -0,0 +1,103 @@
+#ifndef TETISENGINE_OPENING_BOOK_H
+#define TETISENGINE_OPENING_BOOK_H
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "beam_search_bot.h"
+#include "../engine/mapped_file.h"
+
+/**
+ * A move of the book
+ */
+struct BookMove {
+    int8_t type = -1; // the piece to place: not the falling one = HOLD first
+    Placement placement;
+    int setup = -1; // index of the setup it builds, see OpeningBook::getSetupName()
+};
+
+/**
+ * Precompiled opening setups (TKI, DT, PCO...): for every first-bag position a setup can be built
+ * from, the move that builds it. Compiled by tetris_book, memory-mapped read-only, looked up in
+ * O(1) by a hash of the board, the piece, HOLD and what is left of the first bag.
+ *
+ * The book only knows boards of the first bag (no line cleared yet): the pieces placed so far
+ * follow from the cell count, so does how much of the NEXT queue is still that bag.
+ *
+ * File (little endian): "TBOK", uint32 version, bucket bits, entry count, setup count,
+ * setup names (char[16] each), uint32 bucket offsets[2^bits + 1], then the entries sorted by key.
+ * A key lands in bucket key >> (64 - bits), so a lookup scans one bucket (1-2 entries)
+ */
+class OpeningBook {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr int NAME_LENGTH = 16;
+
+    struct Entry {
+        uint64_t key;
+        int8_t type, rotation, x, y, spin;
+        int8_t setup;
+        uint8_t padding[2];
+    };
+
+    OpeningBook(const OpeningBook &) = delete;
+    OpeningBook &operator=(const OpeningBook &) = delete;
+
+    /**
+     * Maps a book into memory
+     * @throws std::invalid_argument if the file can't be read or isn't a book of this version
+     */
+    static std::shared_ptr<const OpeningBook> open(const std::string &path);
+
+    /**
+     * Sorts the entries and writes a book
+     * @throws std::invalid_argument if two entries share a key, std::runtime_error if the file can't be written
+     */
+    static void write(const std::string &path, std::vector<Entry> entries, const std::vector<std::string> &setups);
+
+    /**
+     * The key of a position, as the book stores it
+     *
+     * @param rows     the playfield, Bitboard::HEIGHT row masks
+     * @param current  the falling piece
+     * @param hold     the held piece (-1 = none)
+     * @param queue    the NEXT queue
+     * @param queueSize how many pieces it shows
+     * @return false if it can't be a first-bag position (or the queue doesn't show the rest of the bag)
+     */
+    static bool key(const uint16_t *rows, int current, int hold, const int8_t *queue, int queueSize, uint64_t &out);
+
+    /**
+     * @return false if the book has nothing for this position
+     */
+    bool lookup(const BotInput &input, BookMove &out) const;
+
+    /**
+     * The book move as a decision to play (path included), stats.depth = 0
+     * @return false if the book has nothing, or the move can't be played here (no HOLD, blocked path)
+     */
+    bool decide(const BotInput &input, const MoveGenerator &generator, BotDecision &out) const;
+
+    size_t size() const {
+        return entryCount;
+    }
+
+    /**
+     * @return the name of a setup (empty if there is no such setup)
+     */
+    std::string getSetupName(int setup) const;
+
+private:
+    // the mapped file, the pointers below point into it
+    std::unique_ptr<MappedFile> file;
+    uint32_t bucketBits = 0;
+    uint32_t entryCount = 0, setupCount = 0;
+    const char *names = nullptr;
+    const uint32_t *buckets = nullptr;
+    const Entry *entries = nullptr;
+
+    OpeningBook() = default;
+};
+
+#endif //TETISENGINE_OPENING_BOOK_H
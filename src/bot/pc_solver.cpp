@@ -0,0 +1,519 @@
+#include "pc_solver.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include "../engine/zobrist.h"
+
+namespace {
+    constexpr uint64_t SUFFIX_SALT = 1ULL << 48;
+    constexpr uint64_t EXPLORED_SALT = 1ULL << 49;
+    constexpr uint64_t BAG_SALT = 1ULL << 50;
+    constexpr uint8_t FULL_BAG = (1u << MinoType::valuesLength) - 1;
+
+    // bit Y = row Y, the bottom h rows of the playfield
+    uint64_t bottomRows(const int h) {
+        return ((1ULL << h) - 1) << (Bitboard::HEIGHT - h);
+    }
+
+    // the lines left of the board, packed 10 bits per row (MAX_LINES * 10 bits fit)
+    uint64_t boardKey(const uint16_t *rows, const int h) {
+        uint64_t packed = 0;
+        for (int y = Bitboard::HEIGHT - h; y < Bitboard::HEIGHT; ++y) packed = (packed << Bitboard::WIDTH) | rows[y];
+        return Zobrist::mix(packed);
+    }
+
+    int filledCells(const uint16_t *rows, const int h) {
+        int filled = 0;
+        for (int y = Bitboard::HEIGHT - h; y < Bitboard::HEIGHT; ++y) filled += __builtin_popcount(rows[y]);
+        return filled;
+    }
+
+    /**
+     * A piece can only cross from column c to c + 1 through a row where both cells are empty,
+     * and line clears never change which cells are side by side. If every row has one of them
+     * filled, the empty cells on the left have to be filled by pieces of their own: a multiple of 4
+     */
+    bool columnsSplitEvenly(const uint16_t *rows, const int h) {
+        uint16_t walls = Bitboard::FULL_ROW; // bit c: column c or c + 1 is filled on every row
+        for (int y = Bitboard::HEIGHT - h; y < Bitboard::HEIGHT; ++y) walls &= rows[y] | (rows[y] >> 1);
+        walls &= Bitboard::FULL_ROW >> 1;
+        for (; walls != 0; walls &= walls - 1) {
+            const int c = __builtin_ctz(walls);
+            const uint16_t left = static_cast<uint16_t>((2u << c) - 1);
+            int empty = 0;
+            for (int y = Bitboard::HEIGHT - h; y < Bitboard::HEIGHT; ++y) {
+                empty += __builtin_popcount(~rows[y] & left);
+            }
+            if (empty % 4 != 0) return false;
+        }
+        return true;
+    }
+
+    // every order the 7-bag can deal the next count pieces in, starting with what is left of the current bag
+    void enumerateBags(const uint8_t remaining, const int count, std::vector<int8_t> &prefix,
+                       std::vector<std::vector<int8_t>> &out) {
+        if (count == 0) {
+            out.push_back(prefix);
+            return;
+        }
+        const uint8_t bag = remaining != 0 ? remaining : FULL_BAG;
+        for (int type = 0; type < MinoType::valuesLength; ++type) {
+            if (!((bag >> type) & 1)) continue;
+            prefix.push_back(static_cast<int8_t>(type));
+            enumerateBags(static_cast<uint8_t>(bag & ~(1u << type)), count - 1, prefix, out);
+            prefix.pop_back();
+        }
+    }
+}
+
+PcInput PcInput::fromState(const TetrisEngineState &state, const bool holdEnabled) {
+    PcInput input;
+    std::memcpy(input.rows, state.rows, sizeof(input.rows));
+    input.fallingType = state.fallingType;
+    input.fallingX = state.fallingX;
+    input.fallingY = state.fallingY;
+    input.fallingRotation = state.fallingRotation;
+    input.holdType = state.holdType;
+    input.canHold = holdEnabled && state.canHold;
+    std::memcpy(input.nextQueue, state.nextQueue, sizeof(input.nextQueue));
+    input.nextQueueSize = state.nextQueueSize;
+    for (int i = 0; i < state.generator.bagSize; ++i) input.bagRemaining |= 1u << state.generator.bag[i];
+    return input;
+}
+
+/**
+ * One solve() at a given height
+ */
+struct PcSolver::Search {
+    // a piece placed somewhere, and what is left afterwards
+    struct Child {
+        uint16_t rows[Bitboard::HEIGHT];
+        int hold, next, lines; // lines = rows left to fill (0 = perfect clear)
+        uint8_t bag; // what the current bag still owes once the sequence is at next (0 = a new bag)
+        PcStep step;
+    };
+
+    // the whole sequence for one order of the hidden pieces
+    struct Order {
+        std::vector<int8_t> sequence; // the known pieces, then the hidden ones
+        std::vector<uint64_t> suffixHash; // [i] = hash of sequence[i..]
+    };
+
+    // what a thread reuses
+    struct Worker {
+        const Order *order = nullptr; // the one clears() works on
+        std::vector<Child> children[MAX_PIECES + 1]; // per recursion depth
+        std::vector<PcStep> line; // the visible placements that led to the board explore() is on
+        long long nodes = 0;
+    };
+
+    const PcSolver &solver;
+    const PcInput &input;
+    std::vector<int8_t> known; // the falling piece, then the NEXT queue
+    int length = 0; // the pieces the sequence needs (known + hidden)
+    std::vector<Worker> workers;
+    std::chrono::steady_clock::time_point deadline;
+    bool limited = false;
+    std::atomic<bool> expired{false};
+    std::atomic<bool> stop{false}; // the answer is known, the other threads can give up
+    std::mutex planMutex;
+    std::atomic<bool> planned{false};
+    std::vector<PcStep> plan;
+
+    // Settings::countOrders: every order the hidden pieces can come in (just one if nothing is hidden),
+    // and the ones no clear was found for yet (bit set, it only ever shrinks)
+    std::vector<Order> orders;
+    std::unique_ptr<std::atomic<uint64_t>[]> unsolved;
+    std::atomic<int> unsolvedCount{0};
+
+    Search(const PcSolver &solver, const PcInput &input) : solver(solver), input(input) {
+    }
+
+    void addOrder(const std::vector<int8_t> &hidden) {
+        Order order;
+        order.sequence = known;
+        order.sequence.insert(order.sequence.end(), hidden.begin(), hidden.end());
+        const int size = static_cast<int>(order.sequence.size());
+        order.suffixHash.assign(size + 1, Zobrist::mix(SUFFIX_SALT));
+        for (int i = size - 1; i >= 0; --i) {
+            order.suffixHash[i] = Zobrist::mix(order.suffixHash[i + 1] ^ (SUFFIX_SALT | static_cast<uint64_t>(order.sequence[i] + 1)));
+        }
+        orders.push_back(std::move(order));
+    }
+
+    bool interrupted() const {
+        return expired.load(std::memory_order_relaxed) || stop.load(std::memory_order_relaxed);
+    }
+
+    bool tick(Worker &worker) {
+        ++worker.nodes;
+        if (limited && (worker.nodes & 255) == 0 && std::chrono::steady_clock::now() >= deadline) {
+            expired.store(true, std::memory_order_relaxed);
+        }
+        return !interrupted();
+    }
+
+    // the first clear found becomes the answer
+    void record(const std::vector<PcStep> &prefix, const std::vector<PcStep> &steps) {
+        if (planned.load()) return;
+        std::lock_guard<std::mutex> lock(planMutex);
+        if (planned.load()) return;
+        plan = prefix;
+        plan.insert(plan.end(), steps.begin(), steps.end());
+        planned.store(true);
+    }
+
+    /**
+     * Every hard drop of piece that stays within the lines left. Everything above the lines is
+     * empty, so the piece gets anywhere over them by rotating and shifting right after it spawns
+     * @param newHold what HOLD has once the piece is placed
+     * @param next    where the sequence is once the piece is placed
+     */
+    void drops(const uint16_t *rows, const int lines, const int piece, const int newHold, const int next,
+               const uint8_t bag, const bool useHold, std::vector<Child> &out) const {
+        const uint64_t allowed = bottomRows(lines);
+        // rotations 2 and 3 of I, S and Z cover the same cells as 0 and 1, O has one
+        const int rotations = piece == Bitboard::PIECE_O ? 1
+                              : piece == Bitboard::PIECE_I || piece == Bitboard::PIECE_S || piece == Bitboard::PIECE_Z ? 2 : 4;
+        for (int rotation = 0; rotation < rotations; ++rotation) {
+            const int top = Bitboard::HEIGHT - lines - Bitboard::SHAPES.shapes[piece][rotation].size;
+            for (int x = -2; x < Bitboard::WIDTH; ++x) {
+                if (!Bitboard::fits(rows, piece, rotation, x, top)) continue;
+                int y = top;
+                while (Bitboard::fits(rows, piece, rotation, x, y + 1)) ++y;
+                if (Bitboard::pieceRows(piece, rotation, y) & ~allowed) continue;
+
+                Child child;
+                std::memcpy(child.rows, rows, sizeof(child.rows));
+                Bitboard::place(child.rows, piece, rotation, x, y);
+                const uint64_t cleared = Bitboard::fullRows(child.rows);
+                if (cleared != 0) Bitboard::clearRows(child.rows, cleared);
+                child.lines = lines - __builtin_popcountll(cleared);
+                child.hold = newHold;
+                child.next = next;
+                child.bag = bag;
+                child.step.useHold = useHold;
+                child.step.piece = static_cast<int8_t>(piece);
+                child.step.placement.x = static_cast<int8_t>(x);
+                child.step.placement.y = static_cast<int8_t>(y);
+                child.step.placement.rotation = static_cast<int8_t>(rotation);
+
+                if (child.lines > 0) {
+                    if (!columnsSplitEvenly(child.rows, child.lines)) continue;
+                    // enough pieces left to fill what is left
+                    const int needed = (Bitboard::WIDTH * child.lines - filledCells(child.rows, child.lines)) / 4;
+                    if (needed > length - next + (newHold != -1 ? 1 : 0)) continue;
+                }
+                out.push_back(child);
+            }
+        }
+    }
+
+    /**
+     * Every placement of the piece at i of a sequence, or of the HOLD one (swapping a piece for
+     * itself changes nothing)
+     * @param size the amount of pieces of the sequence that may be used
+     */
+    void expand(const uint16_t *rows, const int hold, const int i, const int lines, const bool root,
+                const int8_t *sequence, const int size, std::vector<Child> &out) const {
+        out.clear();
+        if (i >= size) return;
+        drops(rows, lines, sequence[i], hold, i + 1, 0, false, out);
+        if (root && !input.canHold) return;
+        if (hold == -1) {
+            if (i + 1 < size) drops(rows, lines, sequence[i + 1], sequence[i], i + 2, 0, true, out);
+        } else if (hold != sequence[i]) {
+            drops(rows, lines, hold, sequence[i], i + 1, 0, true, out);
+        }
+    }
+
+    /**
+     * Same as expand(), but the pieces past the known ones are whatever the bag can deal
+     */
+    void expandBag(const uint16_t *rows, const int hold, const int i, const uint8_t bag, const int lines,
+                   const bool root, std::vector<Child> &out) const {
+        out.clear();
+        const bool canHold = !root || input.canHold;
+        const uint8_t dealt = i < static_cast<int>(known.size()) ? 1u << known[i] : bag != 0 ? bag : FULL_BAG;
+        for (int piece = 0; piece < MinoType::valuesLength && i < length; ++piece) {
+            if (!((dealt >> piece) & 1)) continue;
+            const uint8_t after = i < static_cast<int>(known.size()) ? bag : static_cast<uint8_t>(dealt & ~(1u << piece));
+            drops(rows, lines, piece, hold, i + 1, after, false, out);
+            if (!canHold) continue;
+            if (hold == -1) {
+                if (i + 1 >= length) continue;
+                const uint8_t following = i + 1 < static_cast<int>(known.size()) ? 1u << known[i + 1]
+                                          : after != 0 ? after : FULL_BAG;
+                for (int second = 0; second < MinoType::valuesLength; ++second) {
+                    if (!((following >> second) & 1)) continue;
+                    const uint8_t left = i + 1 < static_cast<int>(known.size()) ? after
+                                         : static_cast<uint8_t>(following & ~(1u << second));
+                    drops(rows, lines, second, piece, i + 2, left, true, out);
+                }
+            } else if (hold != piece) {
+                drops(rows, lines, hold, piece, i + 1, after, true, out);
+            }
+        }
+    }
+
+    /**
+     * Can the pieces clear from here, if the bag deals them the right way (first answer wins)
+     * @param out if set, receives the placements of the clear
+     */
+    bool reaches(Worker &worker, const uint16_t *rows, const int hold, const int i, const uint8_t bag,
+                 const int lines, const bool root, const int depth, std::vector<PcStep> *out) {
+        if (!tick(worker)) return false;
+        const uint64_t key = boardKey(rows, lines) ^ Zobrist::stateKey(-1, hold, true, false, lines)
+                             ^ Zobrist::mix(BAG_SALT | bag);
+        float memoized;
+        if (!root && solver.memo->probe(key, i, memoized) && (memoized == 0 || out == nullptr)) return memoized != 0;
+
+        std::vector<Child> &children = worker.children[depth];
+        expandBag(rows, hold, i, bag, lines, root, children);
+        for (const Child &child: children) {
+            if (child.lines == 0 || reaches(worker, child.rows, child.hold, child.next, child.bag, child.lines, false,
+                                            depth + 1, out)) {
+                if (out != nullptr) out->insert(out->begin(), child.step);
+                solver.memo->insert(key, i, 1);
+                return true;
+            }
+            if (interrupted()) return false; // not a final answer, keep it out of the memo
+        }
+        solver.memo->insert(key, i, 0);
+        return false;
+    }
+
+    bool isUnsolved(const int order) const {
+        return (unsolved[order >> 6].load(std::memory_order_relaxed) >> (order & 63)) & 1;
+    }
+
+    // order can clear, steps = the placements after the worker's line
+    void solved(Worker &worker, const int order, const std::vector<PcStep> &steps) {
+        const uint64_t bit = 1ULL << (order & 63);
+        if (!(unsolved[order >> 6].fetch_and(~bit) & bit)) return; // another thread got it first
+        record(worker.line, steps);
+        if (--unsolvedCount == 0) stop.store(true);
+    }
+
+    /**
+     * Can the worker's order clear from here (first answer wins)
+     * @param out if set, receives the placements of the clear
+     */
+    bool clears(Worker &worker, const uint16_t *rows, const int hold, const int i, const int lines, const bool root,
+                const int depth, std::vector<PcStep> *out) {
+        if (!tick(worker)) return false;
+        const Order &order = *worker.order;
+        const uint64_t key = boardKey(rows, lines) ^ Zobrist::stateKey(-1, hold, true, false, lines)
+                             ^ order.suffixHash[std::min<size_t>(i, order.suffixHash.size() - 1)];
+        float memoized;
+        if (!root && solver.memo->probe(key, i, memoized) && (memoized == 0 || out == nullptr)) return memoized != 0;
+
+        std::vector<Child> &children = worker.children[depth];
+        expand(rows, hold, i, lines, root, order.sequence.data(), static_cast<int>(order.sequence.size()), children);
+        for (const Child &child: children) {
+            if (child.lines == 0 || clears(worker, child.rows, child.hold, child.next, child.lines, false, depth + 1, out)) {
+                if (out != nullptr) out->insert(out->begin(), child.step);
+                solver.memo->insert(key, i, 1);
+                return true;
+            }
+            if (interrupted()) return false;
+        }
+        solver.memo->insert(key, i, 0);
+        return false;
+    }
+
+    /**
+     * Places the visible pieces every possible way, and tries the orders that have no clear yet
+     * once the next piece is a hidden one.
+     * A board explored once never needs another look: the orders it failed for can only be fewer
+     */
+    void explore(Worker &worker, const uint16_t *rows, const int hold, const int i, const int lines, const bool root,
+                 const int depth) {
+        if (!tick(worker)) return;
+
+        if (i + 1 >= static_cast<int>(known.size())) {
+            std::vector<PcStep> steps;
+            for (int order = 0; order < static_cast<int>(orders.size()); ++order) {
+                if (!isUnsolved(order)) continue;
+                worker.order = &orders[order];
+                steps.clear();
+                if (clears(worker, rows, hold, i, lines, root, depth, planned.load() ? nullptr : &steps)) {
+                    solved(worker, order, steps);
+                }
+                if (interrupted()) return;
+            }
+            return;
+        }
+
+        const uint64_t key = boardKey(rows, lines) ^ Zobrist::stateKey(-1, hold, true, false, lines)
+                             ^ Zobrist::mix(EXPLORED_SALT);
+        float memoized;
+        if (!root && solver.memo->probe(key, i, memoized)) return;
+
+        std::vector<Child> &children = worker.children[depth];
+        expand(rows, hold, i, lines, root, known.data(), static_cast<int>(known.size()), children);
+        for (const Child &child: children) {
+            worker.line.push_back(child.step);
+            if (child.lines == 0) {
+                // cleared with visible pieces only, whatever comes next
+                for (int order = 0; order < static_cast<int>(orders.size()); ++order) {
+                    if (isUnsolved(order)) solved(worker, order, {});
+                }
+            } else {
+                explore(worker, child.rows, child.hold, child.next, child.lines, false, depth + 1);
+            }
+            worker.line.pop_back();
+            if (interrupted()) return; // not fully explored, keep it out of the memo
+        }
+        solver.memo->insert(key, i, 0);
+    }
+
+    // the first placements are spread over the threads
+    void run(const int lines) {
+        const bool counting = !orders.empty();
+        if (counting && known.size() < 2) {
+            // not even one visible placement
+            explore(workers[0], input.rows, input.holdType, 0, lines, true, 0);
+            return;
+        }
+        std::vector<Child> roots;
+        if (counting) {
+            expand(input.rows, input.holdType, 0, lines, true, known.data(), static_cast<int>(known.size()), roots);
+        } else {
+            expandBag(input.rows, input.holdType, 0, input.bagRemaining, lines, true, roots);
+        }
+        solver.pool->parallelFor(static_cast<int>(roots.size()), [&](const int item, const int index) {
+            Worker &worker = workers[index];
+            const Child &child = roots[item];
+            if (interrupted()) return;
+            worker.line.assign(1, child.step);
+            if (!counting) {
+                std::vector<PcStep> steps;
+                if (child.lines == 0 || reaches(worker, child.rows, child.hold, child.next, child.bag, child.lines,
+                                                false, 1, &steps)) {
+                    record(worker.line, steps);
+                    stop.store(true);
+                }
+            } else if (child.lines == 0) {
+                for (int order = 0; order < static_cast<int>(orders.size()); ++order) {
+                    if (isUnsolved(order)) solved(worker, order, {});
+                }
+            } else {
+                explore(worker, child.rows, child.hold, child.next, child.lines, false, 1);
+            }
+        });
+    }
+};
+
+PcSolver::PcSolver(const Settings &settings)
+        : settings(settings), generator(settings.useSRS), pool(std::make_unique<ThreadPool>(settings.threads)),
+          memo(std::make_unique<TranspositionTable>(settings.transpositionBits)) {
+    if (settings.maxLines < 1 || settings.maxLines > MAX_LINES) throw std::invalid_argument("Invalid perfect clear height!");
+}
+
+PcResult PcSolver::solve(const PcInput &input) {
+    const auto startedAt = std::chrono::steady_clock::now();
+    const auto deadline = startedAt + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(settings.timeBudgetMs));
+    PcResult result;
+    if (input.fallingType >= 0) {
+        // the lowest height that works, unless a higher one has better odds (when they are counted)
+        for (int lines = 1; lines <= settings.maxLines; ++lines) {
+            PcResult attempt;
+            if (!solveHeight(input, lines, deadline, attempt)) continue;
+            attempt.nodes += result.nodes;
+            if (attempt.found && (!result.found || attempt.chance > result.chance)) result = attempt;
+            else result.nodes = attempt.nodes;
+            if (!attempt.complete) {
+                result.complete = false;
+                break;
+            }
+            if (result.guaranteed || (result.found && !settings.countOrders)) break;
+        }
+    }
+    result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startedAt).count();
+    return result;
+}
+
+bool PcSolver::solveHeight(const PcInput &input, const int lines, const std::chrono::steady_clock::time_point deadline,
+                           PcResult &result) {
+    // everything has to sit in the bottom lines, and they have to take a whole amount of pieces
+    for (int y = 0; y < Bitboard::HEIGHT - lines; ++y) if (input.rows[y] != 0) return false;
+    const int empty = Bitboard::WIDTH * lines - filledCells(input.rows, lines);
+    if (empty % 4 != 0 || empty / 4 > MAX_PIECES) return false;
+    if (!columnsSplitEvenly(input.rows, lines)) return false;
+    const int pieces = empty / 4;
+
+    Search search(*this, input);
+    search.known.push_back(input.fallingType);
+    for (int i = 0; i < input.nextQueueSize; ++i) search.known.push_back(input.nextQueue[i]);
+    // an empty HOLD eats one more piece of the sequence
+    search.length = pieces + (input.holdType == -1 ? 1 : 0);
+    const int hiddenCount = std::max(0, search.length - static_cast<int>(search.known.size()));
+    if (hiddenCount == 0) search.known.resize(search.length);
+    int total = 1;
+    if (settings.countOrders) {
+        std::vector<int8_t> prefix;
+        std::vector<std::vector<int8_t>> hidden;
+        enumerateBags(input.bagRemaining, hiddenCount, prefix, hidden);
+        for (const auto &order: hidden) search.addOrder(order);
+        total = static_cast<int>(search.orders.size());
+        search.unsolved.reset(new std::atomic<uint64_t>[(total + 63) / 64]);
+        for (int k = 0; k < (total + 63) / 64; ++k) {
+            search.unsolved[k].store(k < total / 64 ? ~0ULL : (1ULL << (total % 64)) - 1);
+        }
+        search.unsolvedCount.store(total);
+    }
+    search.limited = settings.timeBudgetMs > 0;
+    search.deadline = deadline;
+    search.workers.resize(pool->size());
+    memo->newSearch();
+    search.run(lines);
+
+    for (const auto &worker: search.workers) result.nodes += worker.nodes;
+    result.complete = !search.expired.load();
+    if (!search.planned.load()) return true;
+
+    result.found = true;
+    result.lines = lines;
+    if (settings.countOrders) {
+        const int solved = total - search.unsolvedCount.load();
+        result.chance = static_cast<double>(solved) / total;
+        result.guaranteed = solved == total;
+    } else {
+        result.guaranteed = hiddenCount == 0;
+        result.chance = hiddenCount == 0 ? 1 : -1;
+    }
+
+    // keep the steps that only involve visible pieces
+    std::vector<PcStep> plan = std::move(search.plan);
+    int next = 0, hold = input.holdType;
+    size_t visible = 0;
+    for (; visible < plan.size(); ++visible) {
+        const PcStep &step = plan[visible];
+        const int consumed = step.useHold && hold == -1 ? 2 : 1;
+        if (next + consumed > static_cast<int>(search.known.size())) break;
+        if (step.useHold) hold = search.known[next];
+        next += consumed;
+    }
+    plan.resize(visible);
+
+    // the inputs of every step, the first piece starts where it is falling
+    uint16_t rows[Bitboard::HEIGHT];
+    std::memcpy(rows, input.rows, sizeof(rows));
+    for (size_t k = 0; k < plan.size(); ++k) {
+        PcStep &step = plan[k];
+        if (k == 0 && !step.useHold) {
+            generator.findPath(rows, step.piece, input.fallingX, input.fallingY, input.fallingRotation,
+                               step.placement, step.path);
+        } else {
+            generator.findPath(rows, step.piece, step.placement, step.path);
+        }
+        Bitboard::place(rows, step.piece, step.placement.rotation, step.placement.x, step.placement.y);
+        const uint64_t cleared = Bitboard::fullRows(rows);
+        if (cleared != 0) Bitboard::clearRows(rows, cleared);
+    }
+    result.steps = std::move(plan);
+    return true;
+}
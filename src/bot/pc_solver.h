@@ -0,0 +1,106 @@
+#ifndef TETISENGINE_PC_SOLVER_H
+#define TETISENGINE_PC_SOLVER_H
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "../engine/bitboard.h"
+#include "../engine/tetris_engine_state.h"
+#include "move_generator.h"
+#include "thread_pool.h"
+#include "transposition_table.h"
+
+/**
+ * What the perfect clear solver knows: the board, the pieces the player can see, and which
+ * pieces the 7-bag still owes (a player can count them, the order stays hidden)
+ */
+struct PcInput {
+    uint16_t rows[Bitboard::HEIGHT] = {};
+    int8_t fallingType = -1;
+    int8_t fallingX = 0, fallingY = 0, fallingRotation = 0;
+    int8_t holdType = -1;
+    bool canHold = true;
+    int8_t nextQueue[STATE_MAX_NEXT_QUEUE] = {};
+    int8_t nextQueueSize = 0;
+    uint8_t bagRemaining = 0; // bit = ordinal, the pieces of the current bag that come after the NEXT queue (0 = a new bag)
+
+    /**
+     * @param state a snapshot from TetrisEngine::saveState() (the live state has no generator)
+     * @param holdEnabled false if the engine has HOLD disabled
+     */
+    static PcInput fromState(const TetrisEngineState &state, bool holdEnabled = true);
+};
+
+/**
+ * One piece of a perfect clear
+ */
+struct PcStep {
+    bool useHold = false; // press HOLD first, the placement is for the piece that comes out
+    int8_t piece = -1;
+    Placement placement;
+    std::vector<MoveStep> path; // then hard drop
+};
+
+struct PcResult {
+    bool found = false; // a perfect clear is possible for at least one order of the hidden pieces
+    bool guaranteed = false; // ... for every order of them (only known if nothing is hidden, or they are counted)
+    double chance = 0; // the share of the hidden orders that clear (1 if nothing is hidden, -1 if not counted)
+    int lines = 0; // the height of the perfect clear
+    std::vector<PcStep> steps; // the clear, up to the first piece that is still hidden
+    bool complete = true; // false if the time budget ran out, the answer is a lower bound
+    long long nodes = 0;
+    double elapsedMs = 0;
+};
+
+/**
+ * Looks for a perfect clear within a few lines (4 by default), in the order the pieces come
+ * (HOLD included). Pieces are hard dropped: no tucks or spins.
+ *
+ * When the clear needs more pieces than the NEXT queue shows, the hidden ones can be anything
+ * the 7-bag can still deal: a clear is found if one way of dealing them works (the memo is keyed
+ * by what the bag still owes, so the orders share their work).
+ * With Settings::countOrders, every order is also solved on its own (as if it was visible, like
+ * sfinder does): the chance is the share of the orders that clear. That is a lot slower, the
+ * visible pieces are placed once for all the orders but every failing order is a full search.
+ * The first placements are spread over threads that share one memo of the boards already settled.
+ */
+class PcSolver {
+public:
+    static constexpr int MAX_LINES = 6;
+    static constexpr int MAX_PIECES = MAX_LINES * Bitboard::WIDTH / 4;
+
+    struct Settings {
+        int maxLines = 4; // up to MAX_LINES
+        unsigned threads = 0; // 0 = every core
+        bool useSRS = true; // same as TetrisConfig::srsEnabled
+        double timeBudgetMs = 50; // a solve gives up (PcResult::complete = false) after this, 0 = no limit
+        bool countOrders = false; // also solve every order of the hidden pieces (PcResult::chance)
+        int transpositionBits = 16; // log2 of the buckets of the memo (64 bytes each)
+    };
+
+    explicit PcSolver(const Settings &settings);
+
+    /**
+     * Searches a perfect clear (blocking, call it off the tick thread)
+     */
+    PcResult solve(const PcInput &input);
+
+    const Settings &getSettings() const {
+        return settings;
+    }
+
+private:
+    struct Search;
+
+    Settings settings;
+    MoveGenerator generator;
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<TranspositionTable> memo;
+
+    // false if the board can't be cleared at that height, whatever the pieces
+    bool solveHeight(const PcInput &input, int lines, std::chrono::steady_clock::time_point deadline, PcResult &result);
+};
+
+#endif //TETISENGINE_PC_SOLVER_H
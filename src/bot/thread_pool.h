@@ -0,0 +1,113 @@
+#ifndef TETISENGINE_THREAD_POOL_H
+#define TETISENGINE_THREAD_POOL_H
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads that split loops between them (the caller works too).
+ * One loop at a time: parallelFor() blocks until every item is done
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threads the total amount of threads working on a loop, the caller included (0 = every core)
+     */
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back([this, i] { workerLoop(static_cast<int>(i)); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto &worker: workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @return the amount of threads working on a loop, the caller included
+     */
+    int size() const {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    /**
+     * Runs body(item, worker) for every item in [0, count), spread over the threads
+     *
+     * @param count the amount of items
+     * @param body  the work, worker is in [0, size()) and unique among the running threads
+     *              (use it to index per-thread buffers)
+     */
+    void parallelFor(const int count, const std::function<void(int, int)> &body) {
+        if (count <= 0) return;
+        if (workers.empty()) {
+            for (int item = 0; item < count; ++item) body(item, 0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &body;
+            taskSize = count;
+            nextItem.store(0);
+            busyWorkers = static_cast<int>(workers.size());
+            ++generation;
+        }
+        wakeUp.notify_all();
+        runItems(0);
+
+        // wait for the workers to finish their last item
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this] { return busyWorkers == 0; });
+        task = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable allDone;
+    const std::function<void(int, int)> *task = nullptr;
+    int taskSize = 0;
+    std::atomic<int> nextItem{0};
+    int busyWorkers = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    void runItems(const int worker) {
+        for (int item = nextItem.fetch_add(1); item < taskSize; item = nextItem.fetch_add(1)) {
+            (*task)(item, worker);
+        }
+    }
+
+    void workerLoop(const int worker) {
+        unsigned long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this, seen] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            runItems(worker);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busyWorkers == 0) allDone.notify_one();
+            }
+        }
+    }
+};
+
+#endif //TETISENGINE_THREAD_POOL_H
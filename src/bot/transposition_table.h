@@ -0,0 +1,149 @@
+#ifndef TETISENGINE_TRANSPOSITION_TABLE_H
+#define TETISENGINE_TRANSPOSITION_TABLE_H
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+/**
+ * A fixed-size hash table of positions (Zobrist hashes) already seen by a search, shared by
+ * every search thread without any lock.
+ *
+ * An entry is 2 words: the data and the hash XOR the data. A reader that catches a half
+ * written entry sees a hash that doesn't match and treats it as a miss, so racing writers can
+ * only lose entries, never mix them up.
+ * Entries come 4 to a bucket, a bucket is one cache line.
+ */
+class TranspositionTable {
+public:
+    /**
+     * @param bucketBits log2 of the amount of buckets (64 bytes each)
+     */
+    explicit TranspositionTable(const int bucketBits = 16) {
+        if (bucketBits < 1 || bucketBits > 30) throw std::invalid_argument("Invalid transposition table size!");
+        mask = (1ULL << bucketBits) - 1;
+        buckets.reset(new Bucket[mask + 1]);
+        clear();
+    }
+
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+    /**
+     * Starts a new search: every entry stored so far counts as empty.
+     * @warning not thread-safe, call it between searches
+     */
+    void newSearch() {
+        if (++generation == 0) {
+            // wrapped around, entries from 65536 searches ago would look fresh
+            clear();
+            generation = 1;
+        }
+    }
+
+    /**
+     * Records a position reached with this score (higher = better)
+     *
+     * @param depth the depth it was reached at, positions only match at the same depth
+     * @return false if the position was already reached at this depth, during this search,
+     * with a score at least as good: the caller can drop it
+     */
+    bool insert(const uint64_t hash, const int depth, const float score) {
+        Bucket &bucket = buckets[hash & mask];
+        Entry *victim = nullptr;
+        int victimRank = 0x7FFFFFFF;
+        for (Entry &entry: bucket.entries) {
+            const uint64_t data = entry.data.load(std::memory_order_relaxed);
+            const uint64_t check = entry.check.load(std::memory_order_relaxed);
+            const bool fresh = generationOf(data) == generation;
+            if (fresh && (check ^ data) == hash && depthOf(data) == depth) {
+                if (scoreOf(data) >= score) return false;
+                victim = &entry; // same position, better score
+                break;
+            }
+            // replace an entry of an older search first, then the shallowest one
+            const int rank = fresh ? depthOf(data) + 1 : 0;
+            if (rank < victimRank) {
+                victimRank = rank;
+                victim = &entry;
+            }
+        }
+        const uint64_t data = pack(depth, score);
+        victim->data.store(data, std::memory_order_relaxed);
+        victim->check.store(hash ^ data, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @param score set to the recorded score on a hit
+     * @return true if the position was recorded at this depth during this search
+     */
+    bool probe(const uint64_t hash, const int depth, float &score) const {
+        const Bucket &bucket = buckets[hash & mask];
+        for (const Entry &entry: bucket.entries) {
+            const uint64_t data = entry.data.load(std::memory_order_relaxed);
+            const uint64_t check = entry.check.load(std::memory_order_relaxed);
+            if ((check ^ data) == hash && generationOf(data) == generation && depthOf(data) == depth) {
+                score = scoreOf(data);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @return the memory used by the entries
+     */
+    size_t sizeBytes() const {
+        return sizeof(Bucket) * (mask + 1);
+    }
+
+private:
+    // data: score (float bits) | depth << 32 | generation << 40
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    struct alignas(64) Bucket {
+        Entry entries[4];
+    };
+
+    std::unique_ptr<Bucket[]> buckets;
+    uint64_t mask = 0;
+    uint16_t generation = 1; // 0 = never written
+
+    void clear() {
+        for (uint64_t i = 0; i <= mask; ++i) {
+            for (Entry &entry: buckets[i].entries) {
+                entry.check.store(0, std::memory_order_relaxed);
+                entry.data.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    uint64_t pack(const int depth, const float score) const {
+        uint32_t bits;
+        std::memcpy(&bits, &score, sizeof(bits));
+        return bits | (static_cast<uint64_t>(depth & 0xFF) << 32) | (static_cast<uint64_t>(generation) << 40);
+    }
+
+    static int depthOf(const uint64_t data) {
+        return static_cast<int>((data >> 32) & 0xFF);
+    }
+
+    static uint16_t generationOf(const uint64_t data) {
+        return static_cast<uint16_t>(data >> 40);
+    }
+
+    static float scoreOf(const uint64_t data) {
+        const uint32_t bits = static_cast<uint32_t>(data);
+        float score;
+        std::memcpy(&score, &bits, sizeof(score));
+        return score;
+    }
+};
+
+#endif //TETISENGINE_TRANSPOSITION_TABLE_H
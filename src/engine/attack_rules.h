@@ -0,0 +1,47 @@
+#ifndef TETISENGINE_ATTACK_RULES_H
+#define TETISENGINE_ATTACK_RULES_H
+#pragma once
+#include <algorithm>
+
+/**
+ * How many garbage lines a clear sends, and how back-to-back chains go.
+ * The game (TetrisPlayer) and the headless simulations share these, so an APM measured
+ * offline is the APM a player would see
+ *
+ * @apiNote the back-to-back bonus is the whole chain and is not capped (TetrisPlayer never did),
+ * a bot that keeps a chain going sends quadratically more, see tetris_sim
+ */
+namespace AttackRules {
+    static constexpr int PERFECT_CLEAR_BONUS = 12;
+
+    /**
+     * @param chain the back-to-back chain before the clear (-1 = just broken, 0 = none)
+     * @return the chain after a clear (or a spin that cleared nothing)
+     */
+    constexpr int nextBackToBack(const int chain, const int cleared, const bool spin, const bool miniSpin) {
+        if (cleared >= 4 || ((spin || miniSpin) && cleared > 0)) return chain + 1;
+        if (cleared > 0 && chain > 0) return -1;
+        return chain;
+    }
+
+    /**
+     * The attack of a playfield event (a clear, a spin or a perfect clear), a spin that clears
+     * nothing still sends the back-to-back bonus
+     *
+     * @param chain the back-to-back chain, already updated for this clear (see nextBackToBack())
+     * @param combo the engine's combo counter (TetrisEngine::getComboCount())
+     * @return the lines sent, before any of them cancel incoming garbage
+     */
+    inline int attack(const int cleared, const bool spin, const bool perfectClear, const int chain, const int combo) {
+        // 2 lines = 1, 3 lines = 2, 4+ lines = all of them, a spin doubles its lines
+        int lines = cleared >= 4 ? cleared : (cleared <= 1 ? 0 : (cleared == 2 ? 1 : 2));
+        if (spin) lines = cleared * 2;
+
+        lines += std::max(0, chain);
+        lines += static_cast<int>(combo * 0.75); // combo bonus (primitive)
+        if (perfectClear) lines += PERFECT_CLEAR_BONUS;
+        return lines;
+    }
+}
+
+#endif //TETISENGINE_ATTACK_RULES_H
@@ -0,0 +1,180 @@
+#ifndef TETISENGINE_BITBOARD_H
+#define TETISENGINE_BITBOARD_H
+#pragma once
+#include <cstdint>
+
+/**
+ * Row-mask representation of the playfield, shared by the engine and everything
+ * that has to reason about the board fast (bots, solvers, simulations...)
+ *
+ * Bit X of a row = column X, row 0 is the TOP of the playfield (same as the engine)
+ */
+namespace Bitboard {
+    static constexpr int WIDTH = 10;
+    static constexpr int HEIGHT = 40;
+    static constexpr uint16_t FULL_ROW = (1 << WIDTH) - 1;
+    static constexpr uint64_t ALL_ROWS = (1ULL << HEIGHT) - 1; // bit Y = row Y, every row of the playfield
+
+    // the piece ordinals, same order as MinoType
+    enum PieceOrdinal : int8_t {
+        PIECE_T, PIECE_Z, PIECE_S, PIECE_L, PIECE_J, PIECE_I, PIECE_O
+    };
+
+    // every piece spawns with its bounding box on the 22nd row of the board
+    static constexpr int SPAWN_Y = HEIGHT - 22;
+
+    /**
+     * @return the x-position a piece spawns at (the O is one column further, its box is smaller)
+     */
+    constexpr int spawnX(const int type) {
+        return type == PIECE_O ? 4 : 3;
+    }
+
+    /**
+     * A tetromino in one rotation state, as the row masks of its bounding box
+     * (bit X of rows[Y] = the box cell at X, Y), same shapes as MinoType
+     */
+    struct PieceShape {
+        int8_t size = 0; // the bounding box size, 2 (O) to 4 (I)
+        uint16_t rows[4] = {};
+    };
+
+    /**
+     * Every piece in every rotation state, indexed [ordinal][rotation]
+     */
+    struct PieceShapeTable {
+        PieceShape shapes[7][4];
+    };
+
+    namespace detail {
+        // rotation 0 of each piece, in MinoType ordinal order (T, Z, S, L, J, I, O)
+        inline constexpr PieceShape SPAWN_SHAPES[7] = {
+                {3, {0b010, 0b111, 0b000, 0}},
+                {3, {0b011, 0b110, 0b000, 0}},
+                {3, {0b110, 0b011, 0b000, 0}},
+                {3, {0b100, 0b111, 0b000, 0}},
+                {3, {0b001, 0b111, 0b000, 0}},
+                {4, {0b0000, 0b1111, 0b0000, 0b0000}},
+                {2, {0b11, 0b11, 0, 0}}
+        };
+
+        // same rotation as MinoTypeEnum::rotateClockwise(), the cell (x, y) goes to (size - 1 - y, x)
+        constexpr PieceShape rotateClockwise(const PieceShape &shape) {
+            PieceShape rotated{shape.size, {0, 0, 0, 0}};
+            for (int y = 0; y < shape.size; ++y) {
+                for (int x = 0; x < shape.size; ++x) {
+                    if ((shape.rows[y] >> x) & 1) {
+                        rotated.rows[x] |= static_cast<uint16_t>(1 << (shape.size - 1 - y));
+                    }
+                }
+            }
+            return rotated;
+        }
+
+        constexpr PieceShapeTable buildShapeTable() {
+            PieceShapeTable table{};
+            for (int type = 0; type < 7; ++type) {
+                table.shapes[type][0] = SPAWN_SHAPES[type];
+                for (int rotation = 1; rotation < 4; ++rotation) {
+                    table.shapes[type][rotation] = rotateClockwise(table.shapes[type][rotation - 1]);
+                }
+            }
+            return table;
+        }
+    }
+
+    inline constexpr PieceShapeTable SHAPES = detail::buildShapeTable();
+
+    /**
+     * @return true if the cell at x, y is occupied, or out of bounds
+     */
+    inline bool occupied(const uint16_t *rows, const int x, const int y) {
+        return x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT || ((rows[y] >> x) & 1);
+    }
+
+    /**
+     * The row mask of one row of a piece, moved to column X
+     * @return the mask, or 0xFFFF if the row sticks out of the playfield horizontally
+     */
+    inline uint16_t shiftedRow(const uint16_t row, const int x) {
+        if (x >= 0) {
+            const uint32_t shifted = static_cast<uint32_t>(row) << x;
+            return shifted & ~static_cast<uint32_t>(FULL_ROW) ? 0xFFFF : static_cast<uint16_t>(shifted);
+        }
+        // the bits that fall off the left wall
+        if (row & ((1 << -x) - 1)) return 0xFFFF;
+        return static_cast<uint16_t>(row >> -x);
+    }
+
+    /**
+     * Checks if a piece fits at the given position (same rules as the engine: out of bounds = blocked)
+     *
+     * @param rows     the playfield, HEIGHT row masks
+     * @param type     the piece ordinal
+     * @param rotation the rotation state (0-3)
+     * @param x        the x-position of the bounding box
+     * @param y        the y-position of the bounding box
+     * @return true if no mino collides with the board or the walls
+     */
+    inline bool fits(const uint16_t *rows, const int type, const int rotation, const int x, const int y) {
+        const PieceShape &shape = SHAPES.shapes[type][rotation];
+        for (int r = 0; r < shape.size; ++r) {
+            if (shape.rows[r] == 0) continue;
+            const int row = y + r;
+            if (row < 0 || row >= HEIGHT) return false;
+            const uint16_t mask = shiftedRow(shape.rows[r], x);
+            if (mask == 0xFFFF || (mask & rows[row])) return false;
+        }
+        return true;
+    }
+
+    /**
+     * Sets the cells of a piece in the row masks (the piece must fit)
+     */
+    inline void place(uint16_t *rows, const int type, const int rotation, const int x, const int y) {
+        const PieceShape &shape = SHAPES.shapes[type][rotation];
+        for (int r = 0; r < shape.size; ++r) {
+            if (shape.rows[r] != 0) rows[y + r] |= shiftedRow(shape.rows[r], x);
+        }
+    }
+
+    /**
+     * The rows a piece covers at the given y-position
+     * @return bit Y set = the piece has a mino in row Y
+     */
+    inline uint64_t pieceRows(const int type, const int rotation, const int y) {
+        const PieceShape &shape = SHAPES.shapes[type][rotation];
+        uint64_t mask = 0;
+        for (int r = 0; r < shape.size; ++r) {
+            if (shape.rows[r] != 0 && y + r >= 0 && y + r < HEIGHT) mask |= 1ULL << (y + r);
+        }
+        return mask;
+    }
+
+    /**
+     * Finds the full rows
+     * @return bit Y set = row Y is full
+     */
+    inline uint64_t fullRows(const uint16_t *rows) {
+        uint64_t mask = 0;
+        for (int y = 0; y < HEIGHT; ++y) {
+            if (rows[y] == FULL_ROW) mask |= 1ULL << y;
+        }
+        return mask;
+    }
+
+    /**
+     * Removes the given rows, dragging every row above them down
+     * @param rowsMask bit Y set = remove row Y
+     */
+    inline void clearRows(uint16_t *rows, const uint64_t rowsMask) {
+        int write = HEIGHT - 1;
+        // bottom -> top, keep the rows that stay
+        for (int y = HEIGHT - 1; y >= 0; --y) {
+            if (!((rowsMask >> y) & 1)) rows[write--] = rows[y];
+        }
+        while (write >= 0) rows[write--] = 0;
+    }
+}
+
+#endif //TETISENGINE_BITBOARD_H
@@ -0,0 +1,360 @@
+#include "board_stream.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "byte_writer.h"
+
+namespace {
+    const char MAGIC[4] = {'T', 'B', 'S', 'T'};
+    const char COMPRESSED_MAGIC[4] = {'T', 'B', 'S', 'C'};
+
+    enum FrameFlag : uint8_t {
+        FRAME_BOARD = 1,
+        FRAME_PIECE_MOVE = 2,
+        FRAME_PIECE = 4,
+        FRAME_HOLD = 8,
+        FRAME_NEXT_PUSH = 16,
+        FRAME_NEXT = 32
+        // the top 2 bits are the tick delta
+    };
+    constexpr uint8_t RUN_LENGTH_ROW = 0x10;
+    constexpr uint64_t NIBBLE_LOW_BITS = 0x1111111111ULL; // bit 0 of the 10 cells
+
+    // bit X = cell X is occupied
+    uint32_t occupancyOf(const uint64_t colors) {
+        uint64_t cells = colors | colors >> 1;
+        cells = (cells | cells >> 2) & NIBBLE_LOW_BITS;
+        uint32_t mask = 0;
+        for (; cells != 0; cells &= cells - 1) mask |= 1u << (__builtin_ctzll(cells) / 4);
+        return mask;
+    }
+
+    // bit 0 of nibble X set for every bit X of the mask, times a color it paints those cells
+    uint64_t cellsOf(uint32_t mask) {
+        uint64_t cells = 0;
+        for (; mask != 0; mask &= mask - 1) cells |= uint64_t{1} << (__builtin_ctz(mask) * 4);
+        return cells;
+    }
+
+    void encodeRow(std::vector<uint8_t> &out, const uint64_t before, const uint64_t after) {
+        const uint32_t beforeMask = occupancyOf(before), afterMask = occupancyOf(after);
+        ByteWriter::varint(out, beforeMask ^ afterMask);
+        // what the decoder gets from the mask alone: the cells that stayed keep their color
+        const uint64_t kept = before & cellsOf(afterMask) * 0xF;
+        if (after == kept) {
+            out.push_back(0);
+            return;
+        }
+        const uint32_t appeared = afterMask & ~beforeMask;
+        if (appeared != 0) {
+            const auto color = static_cast<uint8_t>((after >> (__builtin_ctz(appeared) * 4)) & 0xF);
+            if ((kept | cellsOf(appeared) * color) == after) {
+                out.push_back(color);
+                return;
+            }
+        }
+        out.push_back(RUN_LENGTH_ROW);
+        for (int x = 0; x < Bitboard::WIDTH;) {
+            const uint64_t color = (after >> (x * 4)) & 0xF;
+            int run = 1;
+            while (x + run < Bitboard::WIDTH && ((after >> ((x + run) * 4)) & 0xF) == color) ++run;
+            out.push_back(static_cast<uint8_t>((run - 1) << 4 | color));
+            x += run;
+        }
+    }
+
+    // LZMA's range coder: 11 bit probabilities, moving by 1/32 of the distance each time
+    constexpr uint32_t PROBABILITY_BITS = 11, MOVE_BITS = 5, TOP = 1u << 24;
+
+    class RangeEncoder {
+    public:
+        explicit RangeEncoder(std::vector<uint8_t> &out) : out(out) {}
+
+        void encodeBit(uint16_t &probability, const int bit) {
+            const uint32_t bound = (range >> PROBABILITY_BITS) * probability;
+            if (bit == 0) {
+                range = bound;
+                probability += ((1u << PROBABILITY_BITS) - probability) >> MOVE_BITS;
+            } else {
+                low += bound;
+                range -= bound;
+                probability -= probability >> MOVE_BITS;
+            }
+            while (range < TOP) {
+                range <<= 8;
+                shiftLow();
+            }
+        }
+
+        void flush() {
+            for (int i = 0; i < 5; ++i) shiftLow();
+        }
+
+    private:
+        std::vector<uint8_t> &out;
+        uint64_t low = 0;
+        uint32_t range = 0xFFFFFFFF;
+        uint8_t cache = 0;
+        uint64_t cacheSize = 1;
+
+        // the carry can only be known once the bytes after it are
+        void shiftLow() {
+            if (static_cast<uint32_t>(low) < 0xFF000000u || (low >> 32) != 0) {
+                uint8_t carry = cache;
+                do {
+                    out.push_back(static_cast<uint8_t>(carry + (low >> 32)));
+                    carry = 0xFF;
+                } while (--cacheSize != 0);
+                cache = static_cast<uint8_t>(low >> 24);
+            }
+            ++cacheSize;
+            low = (low & 0x00FFFFFF) << 8;
+        }
+    };
+
+    class RangeDecoder {
+    public:
+        RangeDecoder(const uint8_t *data, const size_t size) : data(data), size(size) {
+            for (int i = 0; i < 5; ++i) code = code << 8 | nextByte();
+        }
+
+        int decodeBit(uint16_t &probability) {
+            const uint32_t bound = (range >> PROBABILITY_BITS) * probability;
+            int bit;
+            if (code < bound) {
+                range = bound;
+                probability += ((1u << PROBABILITY_BITS) - probability) >> MOVE_BITS;
+                bit = 0;
+            } else {
+                code -= bound;
+                range -= bound;
+                probability -= probability >> MOVE_BITS;
+                bit = 1;
+            }
+            while (range < TOP) {
+                range <<= 8;
+                code = code << 8 | nextByte();
+            }
+            return bit;
+        }
+
+    private:
+        const uint8_t *data;
+        size_t size, pos = 0;
+        uint32_t range = 0xFFFFFFFF, code = 0;
+
+        uint8_t nextByte() {
+            if (pos >= size) throw std::invalid_argument("The compressed board stream is cut short");
+            return data[pos++];
+        }
+    };
+}
+
+BoardFrame BoardFrame::of(const TetrisEngineState &state) {
+    BoardFrame frame;
+    frame.tick = state.ticksPassed;
+    std::copy(std::begin(state.rowColors), std::end(state.rowColors), frame.rowColors);
+    frame.fallingType = state.fallingType;
+    if (frame.fallingType >= 0) {
+        frame.fallingX = state.fallingX;
+        frame.fallingY = state.fallingY;
+        frame.fallingRotation = state.fallingRotation;
+    }
+    frame.holdType = state.holdType;
+    frame.canHold = state.canHold;
+    frame.nextQueueSize = state.nextQueueSize;
+    std::copy(state.nextQueue, state.nextQueue + state.nextQueueSize, frame.nextQueue);
+    return frame;
+}
+
+bool BoardFrame::operator==(const BoardFrame &other) const {
+    return tick == other.tick && std::equal(std::begin(rowColors), std::end(rowColors), other.rowColors)
+           && fallingType == other.fallingType && fallingX == other.fallingX && fallingY == other.fallingY
+           && fallingRotation == other.fallingRotation && holdType == other.holdType && canHold == other.canHold
+           && nextQueueSize == other.nextQueueSize && std::equal(nextQueue, nextQueue + nextQueueSize, other.nextQueue);
+}
+
+BoardStreamEncoder::BoardStreamEncoder() {
+    ByteWriter::magic(bytes, MAGIC);
+    ByteWriter::raw(bytes, VERSION);
+}
+
+void BoardStreamEncoder::encode(const BoardFrame &frame) {
+    if (frame.tick < previous.tick) throw std::invalid_argument("Frames must come in tick order!");
+    uint8_t flags = 0;
+
+    uint64_t changedRows = 0;
+    for (int y = 0; y < Bitboard::HEIGHT; ++y) {
+        if (frame.rowColors[y] != previous.rowColors[y]) changedRows |= uint64_t{1} << y;
+    }
+    if (changedRows != 0) flags |= FRAME_BOARD;
+
+    const int dx = frame.fallingX - previous.fallingX, dy = frame.fallingY - previous.fallingY;
+    if (frame.fallingType != previous.fallingType || dx != 0 || dy != 0 || frame.fallingRotation != previous.fallingRotation) {
+        const bool small = frame.fallingType == previous.fallingType && frame.fallingType >= 0 && std::abs(dx) <= 3 && std::abs(dy) <= 3;
+        flags |= small ? FRAME_PIECE_MOVE : FRAME_PIECE;
+    }
+    if (frame.holdType != previous.holdType || frame.canHold != previous.canHold) flags |= FRAME_HOLD;
+
+    const int size = frame.nextQueueSize;
+    if (size != previous.nextQueueSize || !std::equal(frame.nextQueue, frame.nextQueue + size, previous.nextQueue)) {
+        const bool pushed = size > 0 && size == previous.nextQueueSize && std::equal(frame.nextQueue, frame.nextQueue + size - 1, previous.nextQueue + 1);
+        flags |= pushed ? FRAME_NEXT_PUSH : FRAME_NEXT;
+    }
+    if (flags == 0) return; // the tick delta of the next frame covers this one
+
+    const int64_t delta = frame.tick - previous.tick;
+    bytes.push_back(static_cast<uint8_t>(flags | std::min<int64_t>(delta, 3) << 6));
+    if (delta >= 3) ByteWriter::varint(bytes, static_cast<uint64_t>(delta - 3));
+    if (flags & FRAME_BOARD) {
+        ByteWriter::varint(bytes, changedRows);
+        for (uint64_t rows = changedRows; rows != 0; rows &= rows - 1) {
+            const int y = __builtin_ctzll(rows);
+            encodeRow(bytes, previous.rowColors[y], frame.rowColors[y]);
+        }
+    }
+    if (flags & FRAME_PIECE_MOVE) {
+        bytes.push_back(static_cast<uint8_t>(frame.fallingRotation << 6 | (dx + 4) << 3 | (dy + 4)));
+    } else if (flags & FRAME_PIECE) {
+        bytes.push_back(static_cast<uint8_t>(frame.fallingType + 1));
+        bytes.push_back(static_cast<uint8_t>(frame.fallingX));
+        bytes.push_back(static_cast<uint8_t>(frame.fallingY));
+        bytes.push_back(static_cast<uint8_t>(frame.fallingRotation));
+    }
+    if (flags & FRAME_HOLD) bytes.push_back(static_cast<uint8_t>((frame.holdType + 1) | frame.canHold << 4));
+    if (flags & FRAME_NEXT_PUSH) {
+        bytes.push_back(static_cast<uint8_t>(frame.nextQueue[size - 1]));
+    } else if (flags & FRAME_NEXT) {
+        bytes.push_back(static_cast<uint8_t>(size));
+        for (int i = 0; i < size; ++i) bytes.push_back(static_cast<uint8_t>(frame.nextQueue[i]));
+    }
+    previous = frame;
+    ++frames;
+}
+
+BoardStreamDecoder::BoardStreamDecoder(const uint8_t *data, const size_t size) : data(data), size(size), pos(0) {
+    if (size < 6 || std::memcmp(data, MAGIC, 4) != 0) throw std::invalid_argument("Not a board stream");
+    if ((data[4] | data[5] << 8) != BoardStreamEncoder::VERSION) throw std::invalid_argument("A board stream of another version");
+    pos = 6;
+}
+
+bool BoardStreamDecoder::next() {
+    if (pos >= size) return false;
+    const uint8_t flags = readByte();
+    int64_t delta = flags >> 6;
+    if (delta == 3) delta += static_cast<int64_t>(readVarint());
+    frame.tick += delta;
+
+    if (flags & FRAME_BOARD) {
+        const uint64_t changedRows = readVarint();
+        if (changedRows >> Bitboard::HEIGHT) throw std::invalid_argument("The board stream is broken");
+        for (uint64_t rows = changedRows; rows != 0; rows &= rows - 1) {
+            const int y = __builtin_ctzll(rows);
+            const uint64_t before = frame.rowColors[y];
+            const uint32_t beforeMask = occupancyOf(before);
+            const uint64_t maskChange = readVarint();
+            if (maskChange >> Bitboard::WIDTH) throw std::invalid_argument("The board stream is broken");
+            const uint32_t afterMask = beforeMask ^ static_cast<uint32_t>(maskChange);
+            const uint64_t kept = before & cellsOf(afterMask) * 0xF;
+            const uint8_t colors = readByte();
+            if (colors < RUN_LENGTH_ROW) {
+                frame.rowColors[y] = kept | cellsOf(afterMask & ~beforeMask) * colors;
+                continue;
+            }
+            uint64_t after = 0;
+            for (int x = 0; x < Bitboard::WIDTH;) {
+                const uint8_t run = readByte();
+                const int length = (run >> 4) + 1;
+                if (x + length > Bitboard::WIDTH) throw std::invalid_argument("The board stream is broken");
+                for (int i = 0; i < length; ++i, ++x) after |= static_cast<uint64_t>(run & 0xF) << (x * 4);
+            }
+            frame.rowColors[y] = after;
+        }
+    }
+    if (flags & FRAME_PIECE_MOVE) {
+        const uint8_t move = readByte();
+        frame.fallingRotation = static_cast<int8_t>(move >> 6);
+        frame.fallingX = static_cast<int8_t>(frame.fallingX + ((move >> 3) & 7) - 4);
+        frame.fallingY = static_cast<int8_t>(frame.fallingY + (move & 7) - 4);
+    } else if (flags & FRAME_PIECE) {
+        frame.fallingType = static_cast<int8_t>(readByte() - 1);
+        frame.fallingX = static_cast<int8_t>(readByte());
+        frame.fallingY = static_cast<int8_t>(readByte());
+        frame.fallingRotation = static_cast<int8_t>(readByte());
+    }
+    if (flags & FRAME_HOLD) {
+        const uint8_t hold = readByte();
+        frame.holdType = static_cast<int8_t>((hold & 0xF) - 1);
+        frame.canHold = (hold >> 4) & 1;
+    }
+    if (flags & FRAME_NEXT_PUSH) {
+        if (frame.nextQueueSize == 0) throw std::invalid_argument("The board stream is broken");
+        std::copy(frame.nextQueue + 1, frame.nextQueue + frame.nextQueueSize, frame.nextQueue);
+        frame.nextQueue[frame.nextQueueSize - 1] = static_cast<int8_t>(readByte());
+    } else if (flags & FRAME_NEXT) {
+        const uint8_t queueSize = readByte();
+        if (queueSize > STATE_MAX_NEXT_QUEUE) throw std::invalid_argument("The board stream is broken");
+        frame.nextQueueSize = static_cast<int8_t>(queueSize);
+        for (int i = 0; i < queueSize; ++i) frame.nextQueue[i] = static_cast<int8_t>(readByte());
+    }
+    return true;
+}
+
+uint8_t BoardStreamDecoder::readByte() {
+    if (pos >= size) throw std::invalid_argument("The board stream is cut short");
+    return data[pos++];
+}
+
+uint64_t BoardStreamDecoder::readVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        const uint8_t byte = readByte();
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw std::invalid_argument("The board stream is broken");
+}
+
+std::vector<uint8_t> BoardStreamCompression::compress(const std::vector<uint8_t> &stream) {
+    std::vector<uint8_t> out;
+    ByteWriter::magic(out, COMPRESSED_MAGIC);
+    ByteWriter::raw(out, static_cast<uint64_t>(stream.size()));
+
+    // a bit tree of the byte under the byte before it
+    std::vector<uint16_t> probabilities(256 * 256, 1u << (PROBABILITY_BITS - 1));
+    RangeEncoder encoder(out);
+    uint8_t context = 0;
+    for (const uint8_t byte: stream) {
+        uint16_t *tree = probabilities.data() + context * 256;
+        for (int i = 7, node = 1; i >= 0; --i) {
+            const int bit = (byte >> i) & 1;
+            encoder.encodeBit(tree[node], bit);
+            node = node << 1 | bit;
+        }
+        context = byte;
+    }
+    encoder.flush();
+    return out;
+}
+
+std::vector<uint8_t> BoardStreamCompression::decompress(const uint8_t *data, const size_t size) {
+    if (size < 12 || std::memcmp(data, COMPRESSED_MAGIC, 4) != 0) throw std::invalid_argument("Not a compressed board stream");
+    uint64_t streamSize = 0;
+    for (int i = 0; i < 8; ++i) streamSize |= static_cast<uint64_t>(data[4 + i]) << (i * 8);
+    // a byte costs at least a few bits, anything bigger is a broken header
+    if (streamSize / 64 > size) throw std::invalid_argument("The compressed board stream is broken");
+
+    std::vector<uint16_t> probabilities(256 * 256, 1u << (PROBABILITY_BITS - 1));
+    RangeDecoder decoder(data + 12, size - 12);
+    std::vector<uint8_t> stream(streamSize);
+    uint8_t context = 0;
+    for (uint8_t &byte: stream) {
+        uint16_t *tree = probabilities.data() + context * 256;
+        int node = 1;
+        while (node < 256) node = node << 1 | decoder.decodeBit(tree[node]);
+        byte = static_cast<uint8_t>(node);
+        context = byte;
+    }
+    return stream;
+}
@@ -0,0 +1,119 @@
+#ifndef TETISENGINE_BOARD_STREAM_H
+#define TETISENGINE_BOARD_STREAM_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "tetris_engine_state.h"
+
+/**
+ * What a spectator draws at a tick: the locked cells, the falling piece, HOLD and NEXT
+ */
+struct BoardFrame {
+    int64_t tick = 0;
+    // nibble X of rowColors[Y] is the color of the cell, like TetrisEngineState
+    uint64_t rowColors[Bitboard::HEIGHT] = {};
+    int8_t fallingType = -1; // -1 = no falling piece
+    int8_t fallingX = 0, fallingY = 0, fallingRotation = 0;
+    int8_t holdType = -1;
+    bool canHold = true;
+    int8_t nextQueue[STATE_MAX_NEXT_QUEUE] = {};
+    int8_t nextQueueSize = 0;
+
+    static BoardFrame of(const TetrisEngineState &state);
+
+    bool operator==(const BoardFrame &other) const;
+};
+
+/**
+ * Board evolution as a stream of deltas, for replays and spectating. Only the ticks that changed
+ * something are written, each as a tagged record against the frame before it:
+ *
+ * - a byte of FRAME_* flags, the tick delta in its top 2 bits (3 = a varint of delta - 3 follows)
+ * - FRAME_BOARD: varint of the changed rows (bit Y = row Y), then for each of them the varint of
+ *   its occupancy mask XOR the previous one, and its colors: 0 if the cells that stayed kept theirs
+ *   and nothing appeared, the color if everything that appeared is one color (a locked piece, a
+ *   garbage row), else 0x10 and the row run-length coded ((run - 1) << 4 | color per run)
+ * - FRAME_PIECE_MOVE: the same piece moved by at most 3 cells each way, a byte of rotation << 6 |
+ *   dx + 4 << 3 | dy + 4. FRAME_PIECE: anything else, type + 1, x, y and rotation as bytes
+ * - FRAME_HOLD: a byte of hold + 1 | canHold << 4
+ * - FRAME_NEXT_PUSH: the queue moved by one, the new last piece. FRAME_NEXT: size, then the queue
+ *
+ * It starts with "TBST" and a uint16 version. A minute of play is about 7.5 kB, compress() halves
+ * that for storage (the stream itself stays decodable as it comes, for live spectating). See
+ * tetris_bench stream.
+ */
+class BoardStreamEncoder {
+public:
+    static constexpr uint16_t VERSION = 1;
+
+    BoardStreamEncoder();
+
+    /**
+     * Writes a frame as the changes since the previous one (nothing if nothing changed)
+     * @throws std::invalid_argument if it goes back in time
+     */
+    void encode(const BoardFrame &frame);
+
+    const std::vector<uint8_t> &getBytes() const {
+        return bytes;
+    }
+
+    /**
+     * @return how many frames changed something
+     */
+    size_t getFrameCount() const {
+        return frames;
+    }
+
+private:
+    std::vector<uint8_t> bytes;
+    BoardFrame previous;
+    size_t frames = 0;
+};
+
+/**
+ * Reads a board stream back, frame after frame, the whole frame is rebuilt every time
+ */
+class BoardStreamDecoder {
+public:
+    /**
+     * @throws std::invalid_argument if it is not a board stream of this version
+     */
+    BoardStreamDecoder(const uint8_t *data, size_t size);
+
+    /**
+     * Reads the next frame into getFrame()
+     * @return false at the end of the stream
+     * @throws std::invalid_argument if the stream is broken or cut short
+     */
+    bool next();
+
+    const BoardFrame &getFrame() const {
+        return frame;
+    }
+
+private:
+    const uint8_t *data;
+    size_t size, pos;
+    BoardFrame frame;
+
+    uint8_t readByte();
+
+    uint64_t readVarint();
+};
+
+/**
+ * The optional entropy coding of a stream for storage: an adaptive binary range coder (LZMA's)
+ * with the previous byte as the context. "TBSC", uint64 size, then the coded bytes
+ */
+namespace BoardStreamCompression {
+    std::vector<uint8_t> compress(const std::vector<uint8_t> &stream);
+
+    /**
+     * @throws std::invalid_argument if it is not a compressed board stream
+     */
+    std::vector<uint8_t> decompress(const uint8_t *data, size_t size);
+}
+
+#endif //TETISENGINE_BOARD_STREAM_H
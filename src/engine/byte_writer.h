@@ -0,0 +1,40 @@
+#ifndef TETISENGINE_BYTE_WRITER_H
+#define TETISENGINE_BYTE_WRITER_H
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Appends to the byte buffers of the binary formats (replays, board streams), little endian hosts only
+ */
+namespace ByteWriter {
+    /**
+     * A value as it is in memory
+     */
+    template<typename T> void raw(std::vector<uint8_t> &out, const T &value) {
+        const size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(out.data() + at, &value, sizeof(T));
+    }
+
+    /**
+     * The 4 characters a format starts with
+     */
+    inline void magic(std::vector<uint8_t> &out, const char (&magic)[4]) {
+        for (const char c: magic) out.push_back(static_cast<uint8_t>(c));
+    }
+
+    /**
+     * 7 bits a byte, the high bit set on all but the last
+     */
+    inline void varint(std::vector<uint8_t> &out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+}
+
+#endif //TETISENGINE_BYTE_WRITER_H
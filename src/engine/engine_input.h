@@ -0,0 +1,61 @@
+#ifndef TETISENGINE_ENGINE_INPUT_H
+#define TETISENGINE_ENGINE_INPUT_H
+#pragma once
+#include <cstdint>
+
+/**
+ * Every input the engine accepts through its per-tick input queue
+ * (key downs and key ups, like a keyboard)
+ */
+enum EngineInput : int8_t {
+    INPUT_LEFT_DOWN,
+    INPUT_LEFT_UP,
+    INPUT_RIGHT_DOWN,
+    INPUT_RIGHT_UP,
+    INPUT_SOFT_DROP_DOWN,
+    INPUT_SOFT_DROP_UP,
+    INPUT_ROTATE_CW,
+    INPUT_ROTATE_CCW,
+    INPUT_HARD_DROP,
+    INPUT_HOLD
+};
+
+/**
+ * An input and the time it was pressed at (any monotonic unit, e.g. SDL's event timestamp in ms)
+ */
+struct TimedInput {
+    uint32_t timestamp = 0;
+    EngineInput input = INPUT_HOLD;
+};
+
+/**
+ * What a replay event is: 0 to 9 are the EngineInput values (key downs / key ups, whether they
+ * went through the input queue or were called directly), the rest are the other ways the
+ * outside world changes a game
+ */
+enum ReplayEventType : uint8_t {
+    REPLAY_MOVE_LEFT = 10, // moveLeft(), a tap that does not hold the key
+    REPLAY_MOVE_RIGHT,
+    REPLAY_SOFT_DROP_TO_GROUND,
+    REPLAY_GARBAGE, // raiseGarbage(a, b)
+    REPLAY_INTERRUPT, // gameInterrupt(a)
+    REPLAY_CONFIG, // updateMutableConfig(a), with the mutable part of the config at that time
+    REPLAY_STOP, // stop()
+    REPLAY_RESET_PLAYFIELD, // resetPlayfield()
+    REPLAY_START, // start(), whatever came before it was set up before the first piece
+    REPLAY_END // the last tick and the hash of the position there
+};
+
+/**
+ * When, within its tick, an event happened. The player applies them at the same points
+ */
+enum ReplayPhase : uint8_t {
+    REPLAY_BETWEEN_TICKS, // before the tick ran (key handlers, the game between two ticks)
+    REPLAY_INPUT_QUEUE, // applied from the input queue, at the start of the tick
+    REPLAY_IN_TICK // anywhere else in the tick (callbacks, scheduled tasks, the tick end), applied at its end
+};
+
+// the room the input queue starts with, it grows past it (8 per 60Hz tick is already 480 inputs per second)
+static constexpr int INPUT_QUEUE_CAPACITY = 32;
+
+#endif //TETISENGINE_ENGINE_INPUT_H
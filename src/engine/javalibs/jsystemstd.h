@@ -10,6 +10,7 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <thread>
 
 #ifdef _WIN32
 typedef unsigned long DWORD;
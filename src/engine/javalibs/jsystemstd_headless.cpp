@@ -0,0 +1,26 @@
+// SysAudio for builds without SDL (benchmarks, simulations...), every call is a no-op
+//
+#include "jsystemstd.h"
+#include <string>
+
+namespace SysAudio {
+    int getBGMVolume() {
+        return 0;
+    }
+
+    int getSFXVolume() {
+        return 0;
+    }
+
+    bool initSoundSystem() {
+        return true;
+    }
+
+    void playSoundAsync(const std::string&, int, bool) {}
+
+    void stopAudio() {}
+
+    void shutdownSoundSystem() {}
+
+    void preloadDefinedAudioFiles() {}
+}
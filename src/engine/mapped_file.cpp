@@ -0,0 +1,70 @@
+#include "mapped_file.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+namespace {
+    struct Mapping {
+        HANDLE file = INVALID_HANDLE_VALUE, view = nullptr;
+    };
+}
+
+MappedFile::MappedFile(const std::string &path) {
+    auto *mapping = new Mapping();
+    mapping->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (mapping->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(mapping->file, &size) || size.QuadPart == 0) {
+        if (mapping->file != INVALID_HANDLE_VALUE) CloseHandle(mapping->file);
+        delete mapping;
+        throw std::invalid_argument("Cannot read " + path);
+    }
+    mapping->view = CreateFileMappingA(mapping->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *view = mapping->view ? MapViewOfFile(mapping->view, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        if (mapping->view) CloseHandle(mapping->view);
+        CloseHandle(mapping->file);
+        delete mapping;
+        throw std::invalid_argument("Cannot read " + path);
+    }
+    bytes = static_cast<const uint8_t *>(view);
+    length = static_cast<size_t>(size.QuadPart);
+    handles = mapping;
+}
+
+MappedFile::~MappedFile() {
+    auto *mapping = static_cast<Mapping *>(handles);
+    UnmapViewOfFile(bytes);
+    CloseHandle(mapping->view);
+    CloseHandle(mapping->file);
+    delete mapping;
+}
+#else
+MappedFile::MappedFile(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::invalid_argument("Cannot read " + path);
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        throw std::invalid_argument("Cannot read " + path);
+    }
+    void *view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file
+    if (view == MAP_FAILED) throw std::invalid_argument("Cannot read " + path);
+    bytes = static_cast<const uint8_t *>(view);
+    length = static_cast<size_t>(info.st_size);
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<uint8_t *>(bytes), length);
+}
+#endif
@@ -0,0 +1,38 @@
+#ifndef TETISENGINE_MAPPED_FILE_H
+#define TETISENGINE_MAPPED_FILE_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * A whole file mapped into memory, read-only (the opening book, replay archives).
+ * Pages are loaded when touched, so opening a big file costs nothing until it is read
+ */
+class MappedFile {
+public:
+    /**
+     * @throws std::invalid_argument if the file can't be read (or is empty)
+     */
+    explicit MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const uint8_t *bytes = nullptr;
+    size_t length = 0;
+    void *handles = nullptr; // the platform's, mapped_file.cpp knows what they are
+};
+
+#endif //TETISENGINE_MAPPED_FILE_H
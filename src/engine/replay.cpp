@@ -0,0 +1,300 @@
+#include "replay.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include "byte_writer.h"
+#include "../process/bag_generator.h"
+
+namespace {
+    const char MAGIC[4] = {'T', 'R', 'P', 'L'};
+
+    // the mutable part of the config, in the header and in every REPLAY_CONFIG
+    void writeMutableConfig(std::vector<uint8_t> &out, const TetrisConfig &config) {
+        ByteWriter::raw(out, config.secondsBeforePieceLock);
+        ByteWriter::raw(out, config.gravity);
+        ByteWriter::raw(out, config.softDropFactor);
+        ByteWriter::raw(out, config.delayedAutoShift);
+        ByteWriter::raw(out, config.autoRepeatRate);
+    }
+
+    class Reader {
+    public:
+        Reader(const uint8_t *data, const size_t size, const size_t pos = 0) : data(data), size(size), pos(pos) {}
+
+        template<typename T> T raw() {
+            need(sizeof(T));
+            T value;
+            std::memcpy(&value, data + pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+        }
+
+        uint64_t varint() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const auto byte = raw<uint8_t>();
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+            throw std::invalid_argument("The replay is broken");
+        }
+
+        size_t getPos() const {
+            return pos;
+        }
+
+    private:
+        const uint8_t *data;
+        size_t size, pos;
+
+        void need(const size_t bytes) const {
+            if (size - pos < bytes) throw std::invalid_argument("The replay is cut short");
+        }
+    };
+}
+
+void ReplayRecorder::attach(TetrisEngine *engine, const int64_t seed) {
+    if (this->engine != nullptr) throw std::logic_error("Already recording!");
+    if (engine->isStarted()) throw std::logic_error("The engine has already started, attach before start()");
+    this->engine = engine;
+    this->lastTick = engine->getTicksPassed();
+    bytes.clear();
+
+    const TetrisConfig &config = *engine->getCurrentConfig();
+    ByteWriter::magic(bytes, MAGIC);
+    ByteWriter::raw(bytes, VERSION);
+    ByteWriter::raw(bytes, seed);
+    bytes.push_back(static_cast<uint8_t>(config.holdEnabled | config.ghostPieceEnabled << 1 | config.srsEnabled << 2));
+    ByteWriter::raw(bytes, config.lineClearsDelaySecond);
+    ByteWriter::raw(bytes, static_cast<int32_t>(config.pieceMovementThreshold));
+    writeMutableConfig(bytes, config);
+    engine->setRecorder(this);
+}
+
+void ReplayRecorder::record(const int64_t tick, const ReplayPhase phase, const uint8_t type, const int a, const int b) {
+    ByteWriter::varint(bytes, static_cast<uint64_t>(tick >= lastTick ? tick - lastTick : 0));
+    lastTick = std::max(lastTick, tick);
+    bytes.push_back(static_cast<uint8_t>(type | phase << 5));
+    switch (type) {
+        case REPLAY_GARBAGE: {
+            bytes.push_back(static_cast<uint8_t>(a));
+            bytes.push_back(static_cast<uint8_t>(b));
+            break;
+        }
+        case REPLAY_INTERRUPT: bytes.push_back(static_cast<uint8_t>(a != 0)); break;
+        case REPLAY_CONFIG: {
+            const TetrisConfig &config = *engine->getCurrentConfig();
+            bytes.push_back(static_cast<uint8_t>((a != 0) | config.holdEnabled << 1));
+            writeMutableConfig(bytes, config);
+            break;
+        }
+        default: break;
+    }
+}
+
+void ReplayRecorder::finish() {
+    if (engine == nullptr) return;
+    record(engine->getTicksPassed(), REPLAY_BETWEEN_TICKS, REPLAY_END);
+    ByteWriter::raw(bytes, engine->getZobristHash());
+    engine->setRecorder(nullptr);
+    engine = nullptr;
+}
+
+void ReplayRecorder::save(const std::string &path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!out) throw std::runtime_error("Cannot write " + path);
+}
+
+ReplayHeader ReplayHeader::parse(const uint8_t *data, const size_t size) {
+    Reader reader(data, size);
+    char magic[4];
+    for (char &c: magic) c = static_cast<char>(reader.raw<uint8_t>());
+    if (std::memcmp(magic, MAGIC, 4) != 0) throw std::invalid_argument("Not a replay");
+    if (reader.raw<uint16_t>() != ReplayRecorder::VERSION) throw std::invalid_argument("A replay of another version");
+
+    ReplayHeader header;
+    header.seed = reader.raw<int64_t>();
+    const auto flags = reader.raw<uint8_t>();
+    header.config.holdEnabled = flags & 1;
+    header.config.ghostPieceEnabled = (flags >> 1) & 1;
+    header.config.srsEnabled = (flags >> 2) & 1;
+    header.config.lineClearsDelaySecond = reader.raw<double>();
+    header.config.pieceMovementThreshold = reader.raw<int32_t>();
+    header.config.secondsBeforePieceLock = reader.raw<double>();
+    header.config.gravity = reader.raw<int64_t>();
+    header.config.softDropFactor = reader.raw<int64_t>();
+    header.config.delayedAutoShift = reader.raw<double>();
+    header.config.autoRepeatRate = reader.raw<double>();
+    return header;
+}
+
+ReplayEventReader::ReplayEventReader(const uint8_t *data, const size_t size, const size_t offset, const int64_t tick)
+    : data(data), size(size), offset(offset), tick(tick) {}
+
+void ReplayEventReader::next(ReplayEvent &event) {
+    Reader reader(data, size, offset);
+    event = ReplayEvent();
+    tick += static_cast<int64_t>(reader.varint());
+    event.tick = tick;
+    const auto code = reader.raw<uint8_t>();
+    event.type = code & 0x1F;
+    event.phase = code >> 5;
+    if (event.type > REPLAY_END || event.phase > REPLAY_IN_TICK) throw std::invalid_argument("The replay is broken");
+
+    switch (event.type) {
+        case REPLAY_END: event.endHash = reader.raw<uint64_t>(); break;
+        case REPLAY_GARBAGE: {
+            event.a = reader.raw<int8_t>();
+            event.b = reader.raw<int8_t>();
+            break;
+        }
+        case REPLAY_INTERRUPT: event.a = reader.raw<int8_t>(); break;
+        case REPLAY_CONFIG: {
+            const auto configFlags = reader.raw<uint8_t>();
+            event.a = static_cast<int8_t>(configFlags & 1);
+            event.holdEnabled = (configFlags >> 1) & 1;
+            event.secondsBeforePieceLock = reader.raw<double>();
+            event.gravity = reader.raw<int64_t>();
+            event.softDropFactor = reader.raw<int64_t>();
+            event.delayedAutoShift = reader.raw<double>();
+            event.autoRepeatRate = reader.raw<double>();
+            break;
+        }
+        default: break;
+    }
+    offset = reader.getPos();
+}
+
+ReplayDriver::ReplayDriver(TetrisEngine *engine, TetrisConfig *config, const ReplayEventReader &reader)
+    : engine(engine), config(config), reader(reader) {
+    engine->runOnGameOver([] {});
+    engine->runOnTickEnd([this] {
+        for (const ReplayEvent &event: current) {
+            if (event.phase == REPLAY_IN_TICK) apply(event);
+        }
+    });
+    readPending();
+}
+
+void ReplayDriver::resume(const bool mach5Speed) {
+    this->resumed = true;
+    this->mach5Speed = mach5Speed;
+}
+
+bool ReplayDriver::runTo(const int64_t tick) {
+    for (;;) {
+        const int64_t now = engine->getTicksPassed();
+        if (currentTick != now) {
+            currentTick = now;
+            tickOffset = pendingOffset;
+            tickBase = pendingBase;
+            current.clear();
+            while (pending.type != REPLAY_END && pending.tick <= now) {
+                current.push_back(pending);
+                readPending();
+            }
+            for (const ReplayEvent &event: current) {
+                if (event.phase == REPLAY_BETWEEN_TICKS && !resumed) apply(event);
+            }
+            resumed = false;
+        }
+        if (now >= tick) return true;
+        if (now >= endTick || !engine->isStarted() || engine->isStopped()) return false;
+
+        for (const ReplayEvent &event: current) {
+            if (event.phase == REPLAY_INPUT_QUEUE) engine->queueInput(static_cast<EngineInput>(event.type), 0);
+        }
+        if (!engine->tick()) return false;
+    }
+}
+
+void ReplayDriver::readPending() {
+    pendingOffset = reader.getOffset();
+    pendingBase = reader.getTick();
+    reader.next(pending);
+    if (pending.type == REPLAY_END) {
+        endTick = pending.tick;
+        endHash = pending.endHash;
+    }
+}
+
+void ReplayDriver::apply(const ReplayEvent &event) {
+    switch (event.type) {
+        case INPUT_LEFT_DOWN: engine->leftKeyToggle(true); break;
+        case INPUT_LEFT_UP: engine->leftKeyToggle(false); break;
+        case INPUT_RIGHT_DOWN: engine->rightKeyToggle(true); break;
+        case INPUT_RIGHT_UP: engine->rightKeyToggle(false); break;
+        case INPUT_SOFT_DROP_DOWN: engine->softDropToggle(true); break;
+        case INPUT_SOFT_DROP_UP: engine->softDropToggle(false); break;
+        case INPUT_ROTATE_CW: engine->rotateCW(); break;
+        case INPUT_ROTATE_CCW: engine->rotateCCW(); break;
+        case INPUT_HARD_DROP: engine->hardDrop(); break;
+        case INPUT_HOLD: engine->hold(); break;
+        case REPLAY_MOVE_LEFT: engine->moveLeft(); break;
+        case REPLAY_MOVE_RIGHT: engine->moveRight(); break;
+        case REPLAY_SOFT_DROP_TO_GROUND: engine->softDropToGround(); break;
+        case REPLAY_GARBAGE: engine->raiseGarbage(event.a, event.b); break;
+        case REPLAY_INTERRUPT: engine->gameInterrupt(event.a != 0); break;
+        case REPLAY_CONFIG: {
+            config->holdEnabled = event.holdEnabled;
+            config->secondsBeforePieceLock = event.secondsBeforePieceLock;
+            config->gravity = event.gravity;
+            config->softDropFactor = event.softDropFactor;
+            config->delayedAutoShift = event.delayedAutoShift;
+            config->autoRepeatRate = event.autoRepeatRate;
+            mach5Speed = event.a != 0;
+            engine->updateMutableConfig(mach5Speed);
+            break;
+        }
+        case REPLAY_STOP: if (!engine->isStopped()) engine->stop(); break;
+        case REPLAY_RESET_PLAYFIELD: engine->resetPlayfield(); break;
+        case REPLAY_START: engine->start(false); break;
+        default: break;
+    }
+}
+
+ReplayPlayer ReplayPlayer::parse(const uint8_t *data, const size_t size) {
+    ReplayPlayer replay;
+    replay.header = ReplayHeader::parse(data, size);
+    // everything is read once here, play() can trust it
+    ReplayEventReader reader(data, size, ReplayRecorder::HEADER_SIZE, 0);
+    for (ReplayEvent event; ; ++replay.eventCount) {
+        reader.next(event);
+        if (event.type == REPLAY_END) {
+            replay.endTick = event.tick;
+            replay.endHash = event.endHash;
+            break;
+        }
+    }
+    replay.bytes.assign(data, data + reader.getOffset());
+    return replay;
+}
+
+ReplayPlayer ReplayPlayer::load(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::invalid_argument("Cannot read " + path);
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    try {
+        return parse(data.data(), data.size());
+    } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument(path + ": " + e.what());
+    }
+}
+
+ReplayResult ReplayPlayer::play() const {
+    TetrisConfig playConfig = header.config;
+    SevenBagGenerator generator(header.seed);
+    TetrisEngine engine(&playConfig, &generator);
+    ReplayDriver driver(&engine, &playConfig, ReplayEventReader(bytes.data(), bytes.size(), ReplayRecorder::HEADER_SIZE, 0));
+    driver.runTo(endTick);
+
+    ReplayResult result;
+    result.ticks = engine.getTicksPassed();
+    result.expectedHash = endHash;
+    result.actualHash = engine.getZobristHash();
+    result.matched = result.ticks == endTick && result.actualHash == endHash;
+    return result;
+}
@@ -0,0 +1,268 @@
+#ifndef TETISENGINE_REPLAY_H
+#define TETISENGINE_REPLAY_H
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tetris_engine.h"
+
+/**
+ * An outside change of a game, read back from a replay
+ */
+struct ReplayEvent {
+    int64_t tick = 0;
+    uint8_t phase = REPLAY_BETWEEN_TICKS;
+    uint8_t type = REPLAY_END;
+    int8_t a = 0, b = 0;
+    // REPLAY_CONFIG only
+    bool holdEnabled = true;
+    double secondsBeforePieceLock = 0, delayedAutoShift = 0, autoRepeatRate = 0;
+    int64_t gravity = 0, softDropFactor = 0;
+    // REPLAY_END only
+    uint64_t endHash = 0;
+};
+
+/**
+ * Records a game as the seed of its 7-bag, its TetrisConfig and whatever changed it from the
+ * outside, tick by tick. Everything else the engine does follows from those (the engine only
+ * counts ticks, gravity is in fixed point, DAS/ARR are in ticks), so ReplayPlayer gets the exact
+ * same game back without the game around it (enemies, bots, the renderer...).
+ *
+ * File (little endian): "TRPL", uint16 version, int64 seed, the config (a byte of flags, then its
+ * numbers as they are in TetrisConfig), then the events: varint tick delta, a byte of
+ * type | phase << 5, and the arguments of the type (see ReplayEventType). It ends with REPLAY_END, its tick and the uint64 Zobrist hash of the position (see
+ * TetrisEngine::getZobristHash()). A minute of play is a few kB.
+ *
+ * Usage:
+ * <pre>
+ *     TetrisEngine *engine = new TetrisEngine(config, new SevenBagGenerator(seed));
+ *     recorder.attach(engine, seed); // before start() and before anything changes the config
+ *     ...
+ *     recorder.finish(); // between two ticks
+ *     recorder.save(path);
+ * </pre>
+ *
+ * @apiNote restoreState() is not recorded, a replay of a game that rewound won't match
+ */
+class ReplayRecorder {
+public:
+    static constexpr uint16_t VERSION = 2;
+    // the events start right after it
+    static constexpr size_t HEADER_SIZE = 67;
+
+    /**
+     * Starts recording an engine, the header is written from its config right away
+     * @param seed the seed of its SevenBagGenerator
+     * @throws std::logic_error if the engine already started, or this recorder is already recording
+     */
+    void attach(TetrisEngine *engine, int64_t seed);
+
+    /**
+     * Ends the replay with the tick and the hash of the engine now, and stops recording it
+     */
+    void finish();
+
+    /**
+     * @throws std::runtime_error if the file can't be written
+     */
+    void save(const std::string &path) const;
+
+    const std::vector<uint8_t> &getBytes() const {
+        return bytes;
+    }
+
+    bool isRecording() const {
+        return engine != nullptr;
+    }
+
+    // the engine calls this (see ReplayEventType for a and b)
+    void record(int64_t tick, ReplayPhase phase, uint8_t type, int a = 0, int b = 0);
+
+private:
+    TetrisEngine *engine = nullptr;
+    std::vector<uint8_t> bytes;
+    int64_t lastTick = 0;
+};
+
+/**
+ * What a replay starts from: the seed of the 7-bag and the config
+ */
+struct ReplayHeader {
+    int64_t seed = 0;
+    TetrisConfig config;
+
+    /**
+     * @throws std::invalid_argument if it is not a replay of this version
+     */
+    static ReplayHeader parse(const uint8_t *data, size_t size);
+};
+
+/**
+ * Reads the events of a replay one after the other, straight from its bytes
+ */
+class ReplayEventReader {
+public:
+    /**
+     * @param offset where an event starts (ReplayRecorder::HEADER_SIZE for the first one)
+     * @param tick the tick of the event before it, ticks are stored as deltas
+     */
+    ReplayEventReader(const uint8_t *data, size_t size, size_t offset, int64_t tick);
+
+    /**
+     * Reads the next event, the last one is REPLAY_END
+     * @throws std::invalid_argument if the replay is broken or cut short
+     */
+    void next(ReplayEvent &event);
+
+    size_t getOffset() const {
+        return offset;
+    }
+
+    int64_t getTick() const {
+        return tick;
+    }
+
+private:
+    const uint8_t *data;
+    size_t size, offset;
+    int64_t tick;
+};
+
+/**
+ * Feeds the events of a replay to an engine where they happened: the between-tick ones before a
+ * tick, the queued inputs into its queue, the in-tick ones at its end
+ */
+class ReplayDriver {
+public:
+    /**
+     * Takes over the tick-end and game over callbacks of the engine (a top out does whatever
+     * the events say, a stop() is an event like the others)
+     * @param config the config the engine was made with, REPLAY_CONFIG changes it
+     */
+    ReplayDriver(TetrisEngine *engine, TetrisConfig *config, const ReplayEventReader &reader);
+
+    ReplayDriver(const ReplayDriver &) = delete;
+    ReplayDriver &operator=(const ReplayDriver &) = delete;
+
+    /**
+     * The engine was restored to a keyframe made at getTickOffset() (see ReplayArchive): the
+     * between-tick events of its tick are already applied
+     */
+    void resume(bool mach5Speed);
+
+    /**
+     * Runs the engine to a tick, the between-tick events of that tick applied
+     * @return false if the replay ended (or the engine stopped) before it
+     */
+    bool runTo(int64_t tick);
+
+    /**
+     * @return the tick of REPLAY_END, INT64_MAX until the reader got there
+     */
+    int64_t getEndTick() const {
+        return endTick;
+    }
+
+    uint64_t getEndHash() const {
+        return endHash;
+    }
+
+    bool isMach5Speed() const {
+        return mach5Speed;
+    }
+
+    // where the events of the tick runTo() stopped at start, to resume from
+    size_t getTickOffset() const {
+        return tickOffset;
+    }
+
+    int64_t getTickBase() const {
+        return tickBase;
+    }
+
+private:
+    TetrisEngine *engine;
+    TetrisConfig *config;
+    ReplayEventReader reader;
+    // the next event to apply, and where it was read from
+    ReplayEvent pending;
+    size_t pendingOffset = 0;
+    int64_t pendingBase = 0;
+    // the events of the tick being run
+    std::vector<ReplayEvent> current;
+    int64_t currentTick = -1;
+    size_t tickOffset = 0;
+    int64_t tickBase = 0;
+    bool resumed = false, mach5Speed = false;
+    int64_t endTick = INT64_MAX;
+    uint64_t endHash = 0;
+
+    void readPending();
+
+    void apply(const ReplayEvent &event);
+};
+
+/**
+ * The outcome of playing a replay back
+ */
+struct ReplayResult {
+    bool matched = false; // the final hash is the recorded one
+    int64_t ticks = 0;
+    uint64_t expectedHash = 0, actualHash = 0;
+};
+
+/**
+ * A replay read back: plays it headless, tick after tick with nothing in between, as fast as
+ * the engine runs
+ */
+class ReplayPlayer {
+public:
+    /**
+     * @throws std::invalid_argument if it is not a replay of this version, or it is cut short
+     */
+    static ReplayPlayer parse(const uint8_t *data, size_t size);
+
+    /**
+     * @throws std::invalid_argument if the file can't be read or isn't a replay (see parse())
+     */
+    static ReplayPlayer load(const std::string &path);
+
+    /**
+     * Re-simulates the whole game on a new engine and compares the position at the last tick
+     */
+    ReplayResult play() const;
+
+    int64_t getSeed() const {
+        return header.seed;
+    }
+
+    const TetrisConfig &getConfig() const {
+        return header.config;
+    }
+
+    const std::vector<uint8_t> &getBytes() const {
+        return bytes;
+    }
+
+    // without the REPLAY_END
+    size_t getEventCount() const {
+        return eventCount;
+    }
+
+    int64_t getEndTick() const {
+        return endTick;
+    }
+
+    uint64_t getEndHash() const {
+        return endHash;
+    }
+
+private:
+    ReplayHeader header;
+    std::vector<uint8_t> bytes;
+    size_t eventCount = 0;
+    int64_t endTick = 0;
+    uint64_t endHash = 0;
+};
+
+#endif //TETISENGINE_REPLAY_H
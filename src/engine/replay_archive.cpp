@@ -0,0 +1,193 @@
+#include "replay_archive.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+    const char MAGIC[4] = {'T', 'R', 'P', 'A'};
+    // magic, version, interval, keyframes, keyframe size, zero, end tick, end hash, replay size
+    constexpr size_t HEADER_SIZE = 4 + 5 * sizeof(uint32_t) + 3 * sizeof(uint64_t);
+
+    // the whole engine at a tick, as it is in memory
+    struct Keyframe {
+        TetrisEngineState state;
+        // the mutable config then (REPLAY_CONFIG changes it)
+        double secondsBeforePieceLock, delayedAutoShift, autoRepeatRate;
+        int64_t gravity, softDropFactor;
+        bool holdEnabled, mach5Speed;
+    };
+    static_assert(std::is_trivially_copyable<Keyframe>::value, "the keyframes are written as they are in memory");
+    static_assert(sizeof(ReplayArchive::IndexEntry) == 32, "the index is written as it is in memory");
+
+    template<typename T> T readRaw(const uint8_t *at) {
+        T value;
+        std::memcpy(&value, at, sizeof(T));
+        return value;
+    }
+
+    template<typename T> void writeRaw(std::ofstream &out, const T &value) {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    // keyframes start on a cache line, like TetrisEngineState
+    size_t alignUp(const size_t offset, const size_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+std::shared_ptr<const ReplayArchive> ReplayArchive::open(const std::string &path) {
+    std::shared_ptr<ReplayArchive> archive(new ReplayArchive());
+    archive->file.reset(new MappedFile(path));
+    const uint8_t *data = archive->file->data();
+    const size_t dataSize = archive->file->size();
+    if (dataSize < HEADER_SIZE || std::memcmp(data, MAGIC, 4) != 0) throw std::invalid_argument(path + " is not a replay archive");
+    if (readRaw<uint32_t>(data + 4) != VERSION) throw std::invalid_argument(path + " is a replay archive of another version");
+    archive->interval = readRaw<uint32_t>(data + 8);
+    archive->keyframeCount = readRaw<uint32_t>(data + 12);
+    if (readRaw<uint32_t>(data + 16) != sizeof(Keyframe)) throw std::invalid_argument(path + " was written by another build");
+    archive->endTick = readRaw<int64_t>(data + 24);
+    archive->endHash = readRaw<uint64_t>(data + 32);
+    archive->replaySize = readRaw<uint64_t>(data + 40);
+
+    // everything has to be in the file before any of it is trusted, sizes are checked before
+    // they are added up so a crafted one can't wrap around
+    if (archive->replaySize > dataSize - HEADER_SIZE
+        || archive->keyframeCount > (dataSize - HEADER_SIZE) / (sizeof(IndexEntry) + sizeof(Keyframe))) {
+        throw std::invalid_argument(path + " is broken");
+    }
+    const size_t indexAt = alignUp(HEADER_SIZE + archive->replaySize, 8);
+    const size_t keyframesAt = alignUp(indexAt + archive->keyframeCount * sizeof(IndexEntry), 64);
+    if (archive->interval == 0 || keyframesAt + archive->keyframeCount * sizeof(Keyframe) != dataSize) {
+        throw std::invalid_argument(path + " is broken");
+    }
+    archive->replay = data + HEADER_SIZE;
+    archive->index = data + indexAt;
+    try {
+        archive->header = ReplayHeader::parse(archive->replay, archive->replaySize);
+    } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument(path + ": " + e.what());
+    }
+    for (uint32_t i = 0; i < archive->keyframeCount; ++i) {
+        const auto entry = readRaw<IndexEntry>(archive->index + i * sizeof(IndexEntry));
+        if (entry.eventOffset < ReplayRecorder::HEADER_SIZE || entry.eventOffset >= archive->replaySize
+            || entry.keyframeOffset != keyframesAt + i * sizeof(Keyframe)) {
+            throw std::invalid_argument(path + " is broken");
+        }
+    }
+    if (archive->keyframeCount > 0 && readRaw<uint32_t>(data + keyframesAt) != TETRIS_ENGINE_STATE_VERSION) {
+        throw std::invalid_argument(path + " was written by another build");
+    }
+    return archive;
+}
+
+void ReplayArchive::write(const std::string &path, const std::vector<uint8_t> &replay, const int interval) {
+    if (interval < 1) throw std::invalid_argument("The keyframe interval must be positive!");
+    const ReplayPlayer player = ReplayPlayer::parse(replay.data(), replay.size());
+    const std::vector<uint8_t> &bytes = player.getBytes(); // without anything after REPLAY_END
+
+    // play it once, a keyframe every interval ticks
+    TetrisConfig config = player.getConfig();
+    SevenBagGenerator generator(player.getSeed());
+    TetrisEngine engine(&config, &generator);
+    ReplayDriver driver(&engine, &config, ReplayEventReader(bytes.data(), bytes.size(), ReplayRecorder::HEADER_SIZE, 0));
+    std::vector<IndexEntry> entries;
+    std::vector<Keyframe> keyframes;
+    for (int64_t tick = interval; tick <= player.getEndTick() && driver.runTo(tick) && !engine.isStopped(); tick += interval) {
+        // value-initialized in place, the padding that goes to the file is zeroed too
+        keyframes.emplace_back();
+        Keyframe &keyframe = keyframes.back();
+        keyframe.state = engine.saveState();
+        keyframe.secondsBeforePieceLock = config.secondsBeforePieceLock;
+        keyframe.delayedAutoShift = config.delayedAutoShift;
+        keyframe.autoRepeatRate = config.autoRepeatRate;
+        keyframe.gravity = config.gravity;
+        keyframe.softDropFactor = config.softDropFactor;
+        keyframe.holdEnabled = config.holdEnabled;
+        keyframe.mach5Speed = driver.isMach5Speed();
+        entries.push_back({tick, driver.getTickOffset(), driver.getTickBase(), 0});
+    }
+    driver.runTo(player.getEndTick());
+    if (engine.getTicksPassed() != player.getEndTick() || engine.getZobristHash() != player.getEndHash()) {
+        throw std::invalid_argument("The replay doesn't end on its recorded position");
+    }
+
+    const size_t indexAt = alignUp(HEADER_SIZE + bytes.size(), 8);
+    const size_t keyframesAt = alignUp(indexAt + entries.size() * sizeof(IndexEntry), 64);
+    for (size_t i = 0; i < entries.size(); ++i) entries[i].keyframeOffset = keyframesAt + i * sizeof(Keyframe);
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    out.write(MAGIC, 4);
+    writeRaw(out, VERSION);
+    writeRaw(out, static_cast<uint32_t>(interval));
+    writeRaw(out, static_cast<uint32_t>(entries.size()));
+    writeRaw(out, static_cast<uint32_t>(sizeof(Keyframe)));
+    writeRaw(out, uint32_t{0});
+    writeRaw(out, player.getEndTick());
+    writeRaw(out, player.getEndHash());
+    writeRaw(out, static_cast<uint64_t>(bytes.size()));
+    out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    const std::vector<char> padding(64, 0);
+    out.write(padding.data(), static_cast<std::streamsize>(indexAt - HEADER_SIZE - bytes.size()));
+    out.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(IndexEntry)));
+    out.write(padding.data(), static_cast<std::streamsize>(keyframesAt - indexAt - entries.size() * sizeof(IndexEntry)));
+    out.write(reinterpret_cast<const char *>(keyframes.data()), static_cast<std::streamsize>(keyframes.size() * sizeof(Keyframe)));
+    if (!out) throw std::runtime_error("Cannot write " + path);
+}
+
+const ReplayArchive::IndexEntry *ReplayArchive::findKeyframe(const int64_t tick) const {
+    const auto *entries = reinterpret_cast<const IndexEntry *>(index);
+    const IndexEntry *after = std::upper_bound(entries, entries + keyframeCount, tick, [](const int64_t t, const IndexEntry &entry) {
+        return t < entry.tick;
+    });
+    return after == entries ? nullptr : after - 1;
+}
+
+bool ReplayArchive::restore(const IndexEntry &entry, TetrisEngine &engine, TetrisConfig &config) const {
+    const auto keyframe = readRaw<Keyframe>(file->data() + entry.keyframeOffset);
+    // start() spawns from the generator, the state and the generator are overwritten right after
+    engine.start(false);
+    engine.restoreState(keyframe.state);
+    config.secondsBeforePieceLock = keyframe.secondsBeforePieceLock;
+    config.delayedAutoShift = keyframe.delayedAutoShift;
+    config.autoRepeatRate = keyframe.autoRepeatRate;
+    config.gravity = keyframe.gravity;
+    config.softDropFactor = keyframe.softDropFactor;
+    config.holdEnabled = keyframe.holdEnabled;
+    engine.updateMutableConfig(keyframe.mach5Speed);
+    return keyframe.mach5Speed;
+}
+
+ReplaySeeker::ReplaySeeker(std::shared_ptr<const ReplayArchive> archive) : archive(std::move(archive)) {
+    seek(0);
+}
+
+int64_t ReplaySeeker::seek(int64_t tick) {
+    tick = std::max<int64_t>(0, std::min(tick, archive->getEndTick()));
+    const ReplayArchive::IndexEntry *keyframe = archive->findKeyframe(tick);
+    const int64_t now = engine ? engine->getTicksPassed() : -1;
+    // running forward beats a keyframe behind where the engine already is
+    if (now >= (keyframe ? keyframe->tick : 0) && now <= tick) {
+        driver->runTo(tick);
+        return engine->getTicksPassed();
+    }
+
+    driver.reset();
+    engine.reset();
+    config.reset(new TetrisConfig(archive->getHeader().config));
+    generator.reset(new SevenBagGenerator(archive->getHeader().seed));
+    engine.reset(new TetrisEngine(config.get(), generator.get()));
+    if (keyframe == nullptr) {
+        driver.reset(new ReplayDriver(engine.get(), config.get(),
+                                      ReplayEventReader(archive->getReplay(), archive->getReplaySize(), ReplayRecorder::HEADER_SIZE, 0)));
+    } else {
+        const bool mach5Speed = archive->restore(*keyframe, *engine, *config);
+        driver.reset(new ReplayDriver(engine.get(), config.get(),
+                                      ReplayEventReader(archive->getReplay(), archive->getReplaySize(), keyframe->eventOffset, keyframe->eventBase)));
+        driver->resume(mach5Speed);
+    }
+    driver->runTo(tick);
+    return engine->getTicksPassed();
+}
@@ -0,0 +1,179 @@
+#ifndef TETISENGINE_SRS_H
+#define TETISENGINE_SRS_H
+#pragma once
+#include <cstdint>
+#include "bitboard.h"
+
+/**
+ * The rotation rules of the engine: SRS kick tables and spin detection.
+ * The engine and everything that predicts it (move generators, bots, solvers...)
+ * go through here, so they can never disagree
+ */
+namespace SRS {
+    /**
+     * A kick offset, y goes UP (SRS convention), the engine subtracts it from its y
+     */
+    struct Kick {
+        int8_t x, y;
+    };
+
+    /**
+     * The offsets to try, in order, for one rotation
+     */
+    struct KickSequence {
+        const Kick *kicks;
+        int count;
+    };
+
+    static constexpr int KICKS_PER_ROTATION = 5;
+
+    /*************** BEGIN SRS KICK TABLE *****************/
+    /** @see https://harddrop.com/wiki/SRS **/
+    inline constexpr Kick I_KICK_TABLE[8][KICKS_PER_ROTATION] = {
+            // 0 -> R
+            {{0, 0}, {-2, 0}, {1,  0}, {-2, -1}, {1,  2}},
+            // R -> 0
+            {{0, 0}, {2,  0}, {-1, 0}, {2,  1},  {-1, -2}},
+            // R -> 2
+            {{0, 0}, {-1, 0}, {2,  0}, {-1, 2},  {2,  -1}},
+            // 2 -> R
+            {{0, 0}, {1,  0}, {-2, 0}, {1,  -2}, {-2, 1}},
+            // 2 -> L
+            {{0, 0}, {2,  0}, {-1, 0}, {2,  1},  {-1, -2}},
+            // L -> 2
+            {{0, 0}, {-2, 0}, {1,  0}, {-2, -1}, {1,  2}},
+            // L -> 0
+            {{0, 0}, {1,  0}, {-2, 0}, {1,  -2}, {-2, 1}},
+            // 0 -> L
+            {{0, 0}, {-1, 0}, {2,  0}, {-1, 2},  {2,  -1}}
+    };
+
+    inline constexpr Kick OTHERS_KICK_TABLE[8][KICKS_PER_ROTATION] = {
+            // 0 -> R
+            {{0, 0}, {-1, 0}, {-1, 1},  {0, -2}, {-1, -2}},
+            // R -> 0
+            {{0, 0}, {1,  0}, {1,  -1}, {0, 2},  {1,  2}},
+            // R -> 2
+            {{0, 0}, {1,  0}, {1,  -1}, {0, 2},  {1,  2}},
+            // 2 -> R
+            {{0, 0}, {-1, 0}, {-1, 1},  {0, -2}, {-1, -2}},
+            // 2 -> L
+            {{0, 0}, {1,  0}, {1,  1},  {0, -2}, {1,  -2}},
+            // L -> 2
+            {{0, 0}, {-1, 0}, {-1, -1}, {0, 2},  {-1, 2}},
+            // L -> 0
+            {{0, 0}, {-1, 0}, {-1, -1}, {0, 2},  {-1, 2}},
+            // 0 -> L
+            {{0, 0}, {1,  0}, {1,  1},  {0, -2}, {1,  -2}}
+    };
+
+    inline constexpr Kick NO_KICK[1] = {{0, 0}};
+    /*************** END OF SRS KICK TABLE *****************/
+
+    /**
+     * Gets the kick sequence based on the initial and target rotation states.
+     *
+     * @param type         the piece ordinal
+     * @param initialState the origin state (0-3)
+     * @param finalState   the target state (0-3), one quarter turn away
+     * @param useSRS       if false, only the basic rotation is allowed
+     * @return the offsets to try, in order
+     */
+    inline KickSequence kickSequence(const int type, const int initialState, const int finalState, const bool useSRS = true) {
+        // O Tetromino does not kick (how do u rotate an O)
+        if (!useSRS || type == Bitboard::PIECE_O) return {NO_KICK, 1};
+
+        static constexpr int R = 1; // right
+        static constexpr int L = 3; // left
+        // compass for rotation
+        //      [0]
+        // [3]  rot  [1]
+        //      [2]
+        int index;
+        if (initialState == 0 && finalState == R) index = 0;
+        else if (initialState == R && finalState == 0) index = 1;
+        else if (initialState == R && finalState == 2) index = 2;
+        else if (initialState == 2 && finalState == R) index = 3;
+        else if (initialState == 2 && finalState == L) index = 4;
+        else if (initialState == L && finalState == 2) index = 5;
+        else if (initialState == L && finalState == 0) index = 6;
+        else index = 7; // 0 -> L
+
+        // I-pieces use a different kick table because they're longer
+        return {(type == Bitboard::PIECE_I ? I_KICK_TABLE : OTHERS_KICK_TABLE)[index], KICKS_PER_ROTATION};
+    }
+
+    /**
+     * Spin results, a mini spin is any kicked rotation (All-Spin), or a T-spin missing a front corner
+     */
+    enum SpinType : int8_t {
+        SPIN_NONE,
+        SPIN_MINI,
+        SPIN_FULL
+    };
+
+    /**
+     * Classifies a lock, TETR.IO All-Spin rules.
+     *
+     * @param rows        the playfield row masks (the piece's own cells may or may not be in them)
+     * @param type        the piece ordinal
+     * @param rotation    the rotation state the piece locked in
+     * @param x           the x-position of the piece's bounding box
+     * @param y           the y-position of the piece's bounding box
+     * @param rotatedLast true if the last successful player action was a rotation (drops don't count)
+     * @param kickUsed    the index of the kick that rotation used (0 = no kick)
+     * @param kickX       the x offset of that kick
+     * @param kickY       the y offset of that kick
+     * @return the spin
+     */
+    inline SpinType detectSpin(const uint16_t *rows, const int type, const int rotation, const int x, const int y,
+                               const bool rotatedLast, const int kickUsed, const int kickX, const int kickY) {
+        // only trigger if the last action was ROTATE (CCW and CW)
+        if (!rotatedLast) return SPIN_NONE;
+
+        // DETECT mini spins (except T), if the last rotation was a kick, it is considered a mini spin
+        if (type != Bitboard::PIECE_T) return kickUsed != 0 ? SPIN_MINI : SPIN_NONE;
+
+        // tea-spin detection: check the 3x3 grid around the center of the T piece
+        // Because x and y are not relative to the center we gonna treat it as relative to 0, 0
+        const bool c1 = Bitboard::occupied(rows, x, y) // upper left
+        , c2 = Bitboard::occupied(rows, x + 2, y) // upper right
+        , c3 = Bitboard::occupied(rows, x, y + 2) // lower left
+        , c4 = Bitboard::occupied(rows, x + 2, y + 2); // lower right
+
+        // the lookup table
+        const bool tMinoRelative[4][4] = {
+                {c1, c2, /*back*/ c3, c4},  // 0
+                {c2, c3, /*back*/ c1, c4},  // 1
+                {c3, c4, /*back*/ c1, c2},  // 2
+                {c4, c1, /*back*/ c2, c3}   // 3
+        };
+
+        // the front and back of the T mino relative to the rotation state
+        const bool *pair = tMinoRelative[rotation];
+        // 2 minoes in the front stem [0*0] filled
+        //							  [***]
+        // and at least 1 in the back [1-1] filled
+        if (pair[0] && pair[1] && (pair[2] || pair[3])) return SPIN_FULL;
+
+        // 2 minoes in the back 	  [1*1] filled
+        //							  [***]
+        // and  2 in the back 		  [0-0] filled
+        if (pair[2] && pair[3] && (pair[0] || pair[1])) {
+            // for ALL mini T-spin that moves the piece 1 by 2 (https://tetris.wiki/T-Spin)
+            // "upgrade" it to a NORMAL T-Spin
+            if (kickUsed != 0 && kickX == 1 && kickY == 2) return SPIN_FULL;
+            return SPIN_MINI;
+        }
+        return SPIN_NONE;
+    }
+
+    /**
+     * A clear that keeps (or starts) a back-to-back chain: a Tetris, or a line clear with a spin
+     */
+    inline bool isDifficultClear(const int lines, const SpinType spin) {
+        return lines == 4 || (lines > 0 && spin != SPIN_NONE);
+    }
+}
+
+#endif //TETISENGINE_SRS_H
@@ -5,6 +5,12 @@
 #ifndef TETRISENGINE_TETRIS_CONFIG_H
 #define TETRISENGINE_TETRIS_CONFIG_H
 #pragma once
+#include <cstdint>
+#include <cmath>
+
+// gravity is fixed point, in 1/65536 of a cell per tick, so every build (and every
+// compiler) drops the piece on the exact same tick, which replays and lockstep rely on
+static constexpr int64_t GRAVITY_SUBCELLS_PER_CELL = 1 << 16;
 
 class TetrisConfig {
 public:
@@ -14,8 +20,10 @@ public:
     double secondsBeforePieceLock = 0.5;
     double lineClearsDelaySecond = 0.0;
     int pieceMovementThreshold = 15;
-    double gravity = 0.0156;
-    double softDropFactor = 24.0;
+    int64_t gravity = 1022; // 0.0156G, in subcells (see GRAVITY_SUBCELLS_PER_CELL)
+    int64_t softDropFactor = 24;
+    double delayedAutoShift = 0.2;
+    double autoRepeatRate = 0.05;
 
 public:
     /**
@@ -102,12 +110,26 @@ public:
      * Sets the gravity, in G, affecting piece fall speed (cells per tick; aka frames)
      * {@link https://harddrop.com/wiki/Drop#Gravity}
      *
-     * @defaultValue 0.156 per tick (assumes 60 TPS)
+     * @apiNote The value is converted to subcells once, here. Prefer setGravitySubcells()
+     * when the value must be bit-identical across builds (replays, lockstep)
+     * @defaultValue 0.0156 per tick (assumes 60 TPS)
      *
      * @param gravity the gravity amount to set.
      */
     TetrisConfig& setGravity(double g) {
-        gravity = g;
+        gravity = llround(g * GRAVITY_SUBCELLS_PER_CELL);
+        return *this;
+    }
+
+    /**
+     * Sets the gravity in subcells per tick, GRAVITY_SUBCELLS_PER_CELL subcells = 1G
+     *
+     * @defaultValue 1022 (0.0156G)
+     *
+     * @param subcells the gravity amount to set.
+     */
+    TetrisConfig& setGravitySubcells(int64_t subcells) {
+        gravity = subcells;
         return *this;
     }
 
@@ -118,11 +140,38 @@ public:
      *
      * @param softDropFactor the soft drop factor to set.
      */
-    TetrisConfig& setSoftDropFactor(double factor) {
+    TetrisConfig& setSoftDropFactor(int64_t factor) {
         softDropFactor = factor;
         return *this;
     }
 
+    /**
+     * Sets the Delayed Auto Shift (DAS), how long LEFT/RIGHT must be held before the
+     * piece starts auto-repeating. The charge is kept across piece spawns.
+     *
+     * @defaultValue 0.2d (rounded to the nearest tick)
+     *
+     * @param seconds the DAS in seconds
+     */
+    TetrisConfig& setDelayedAutoShift(double seconds) {
+        delayedAutoShift = seconds;
+        return *this;
+    }
+
+    /**
+     * Sets the Auto Repeat Rate (ARR), the interval between each auto-repeated shift
+     * once DAS is charged.
+     *
+     * @apiNote An ARR of 0 shifts the piece straight to the wall
+     * @defaultValue 0.05d (rounded to the nearest tick)
+     *
+     * @param seconds the ARR in seconds
+     */
+    TetrisConfig& setAutoRepeatRate(double seconds) {
+        autoRepeatRate = seconds;
+        return *this;
+    }
+
     /**
     * Creates a new instance of TetrisConfig using default config (Modern-Guideline Tetris)
     * @warning This will allocate this object on the HEAP!
@@ -2,125 +2,180 @@
 // Created by GiaKhanhVN on 4/9/2025.
 //
 #include "tetris_engine.h"
-
-/************** BEGIN OF MEMORY MANAGEMENT BULLSHIT ***************/
-void TetrisEngine::markFallingPieceAsNull() {
-    this->deletionQueue.push_back(this->fallingPiece);
-    this->fallingPiece = nullptr;
-}
-
-void TetrisEngine::freeMemoryOfFallingPiece() {
-    for (Tetromino* piece: deletionQueue) {
-        // actually deleting the shit
-        delete piece;
-    }
-    deletionQueue.clear();
-}
-/****** END OF BULLSHIT (not really, the entire code is bs) ***********/
+#include "replay.h"
 
 void TetrisEngine::stop() {
     if (stopped) throw logic_error("Already stopped!");
+    if (cold->recorder) recordEvent(REPLAY_STOP);
     this->stopped = true;
-
-    if (this->fallingPiece != nullptr) {
-        this->markFallingPieceAsNull();
-    }
-    // because stop essentially kills the entire engine,
-    // there's no point waiting when to delete anymore
-    this->freeMemoryOfFallingPiece();
+    // invalidate the falling piece, nothing can be moved anymore
+    this->markFallingPieceAsNull();
 }
 
 void TetrisEngine::moveLeft() {
-    if (this->fallingPiece != nullptr) fallingPiece->translateHorizontally(true);
+    if (cold->recorder) recordEvent(REPLAY_MOVE_LEFT);
+    if (this->hasFallingPiece()) translateHorizontally(true);
 }
 
 void TetrisEngine::moveRight() {
-    if (this->fallingPiece != nullptr) fallingPiece->translateHorizontally(false);
+    if (cold->recorder) recordEvent(REPLAY_MOVE_RIGHT);
+    if (this->hasFallingPiece()) translateHorizontally(false);
 }
 
 void TetrisEngine::rotateCW() {
-    if (this->fallingPiece != nullptr) fallingPiece->rotate(false);
+    if (cold->recorder) recordEvent(INPUT_ROTATE_CW);
+    if (this->hasFallingPiece()) rotatePiece(false);
+    else this->state.irsRotation = static_cast<int8_t>((this->state.irsRotation + 1) % 4); // IRS, applied on spawn
 }
 
 void TetrisEngine::rotateCCW() {
-    if (this->fallingPiece != nullptr) fallingPiece->rotate(true);
+    if (cold->recorder) recordEvent(INPUT_ROTATE_CCW);
+    if (this->hasFallingPiece()) rotatePiece(true);
+    else this->state.irsRotation = static_cast<int8_t>((this->state.irsRotation + 3) % 4); // IRS, applied on spawn
 }
 
 void TetrisEngine::softDropToggle(const bool on) {
-    this->gravity = this->defaultGravity;
-    if (on) this->gravity *= softDropFactor;
+    if (cold->recorder) recordEvent(on ? INPUT_SOFT_DROP_DOWN : INPUT_SOFT_DROP_UP);
+    this->state.softDropHeld = on;
+}
+
+void TetrisEngine::leftKeyToggle(const bool held) {
+    if (cold->recorder) recordEvent(held ? INPUT_LEFT_DOWN : INPUT_LEFT_UP);
+    this->shiftKeyToggle(-1, held);
+}
+
+void TetrisEngine::rightKeyToggle(const bool held) {
+    if (cold->recorder) recordEvent(held ? INPUT_RIGHT_DOWN : INPUT_RIGHT_UP);
+    this->shiftKeyToggle(1, held);
+}
+
+void TetrisEngine::shiftKeyToggle(const int direction, const bool held) {
+    bool &key = direction < 0 ? this->state.leftHeld : this->state.rightHeld;
+    if (held) {
+        if (key) return; // already down
+        key = true;
+        // the latest side pressed wins, DAS starts charging from scratch
+        this->state.shiftDirection = static_cast<int8_t>(direction);
+        this->state.dasCharge = 0;
+        this->state.arrCharge = 0;
+        // move one time first (a tap), if no piece is falling yet, the tap goes to the next one
+        if (this->hasFallingPiece()) translateHorizontally(direction < 0);
+        else this->state.initialShift = static_cast<int8_t>(direction);
+        return;
+    }
+
+    key = false;
+    if (this->state.shiftDirection != direction) return;
+    // fall back to the other side if it is still held
+    const bool otherHeld = direction < 0 ? this->state.rightHeld : this->state.leftHeld;
+    this->state.shiftDirection = static_cast<int8_t>(otherHeld ? -direction : 0);
+    this->state.dasCharge = 0;
+    this->state.arrCharge = 0;
 }
 
 void TetrisEngine::hardDrop() {
-    if (this->fallingPiece != nullptr) fallingPiece->hardDrop();
+    if (cold->recorder) recordEvent(INPUT_HARD_DROP);
+    if (this->hasFallingPiece()) hardDropPiece();
+}
+
+void TetrisEngine::softDropToGround() {
+    if (cold->recorder) recordEvent(REPLAY_SOFT_DROP_TO_GROUND);
+    if (!this->hasFallingPiece()) return;
+    this->state.fallingY = static_cast<int8_t>(getGhostPieceY());
+    this->refreshFallingPieceRows();
 }
 
 void TetrisEngine::hold() {
-    if (this->fallingPiece != nullptr) this->holdButtonPressed = true;
-    // Signals the main game loop to execute onUserHold()
+    if (cold->recorder) recordEvent(INPUT_HOLD);
+    if (this->hasFallingPiece()) this->onUserHold();
+    else this->state.ihsRequested = true; // IHS, applied on spawn
+}
+
+void TetrisEngine::queueInput(const EngineInput input, const uint32_t timestamp) {
+    this->inputQueue.push_back({timestamp, input});
 }
 
 MinoTypeEnum* TetrisEngine::getFallingMinoType() {
-    if (fallingPiece != nullptr) return fallingPiece->type;
-    return nullptr;
+    return MinoType::fromOrdinal(state.fallingType);
 }
 
 void TetrisEngine::raiseGarbage(int height, int holeIndex) {
     // because the board is ACTUALLY not physically shifted during the clear delay active period
     // raising garbage during this time will cause the board to fracture, leaving behind empty lines
-    if (clearDelayActive) {
+    if (state.clearDelayActive) {
         cerr << "You should NOT interact with the board during clear delay, it will fuck the board up!" << endl;
         return;
     }
 
     // prerequisites, if height is too high or holeIndex is out of bounds, fuck off
-    if (height >= this->playfield[0].size() || holeIndex >= this->playfield.size()) {
+    if (height >= Bitboard::HEIGHT || holeIndex >= Bitboard::WIDTH) {
         throw invalid_argument("What is wrong with you?");
     }
 
+    if (cold->recorder) recordEvent(REPLAY_GARBAGE, height, holeIndex);
+
     // if there is no height to raise, return (probably user error)
     if (height <= 0 || holeIndex < 0) return;
 
     // from top to bottom
     // for each row, starting from the top to where the garbage starts rising
     // shift everything upwards by "height" units
-    for (int y = 0; y < this->playfield[0].size() - height; ++y) {
-        for (int x = 0; x < this->playfield.size(); ++x) {
-            // for each cell in the current row, copy the cell "height" rows below it
-            playfield[x][y] = playfield[x][y + height];
-        }
+    for (int y = 0; y < Bitboard::HEIGHT - height; ++y) {
+        state.rows[y] = state.rows[y + height];
+        state.rowColors[y] = state.rowColors[y + height];
     }
 
     // now fill the new garbage lines with blocks, leaving a hole at "holeIndex"
-    for (int y = this->playfield[0].size() - height; y < this->playfield[0].size(); ++y) {
-        for (int x = 0; x < this->playfield.size(); ++x) {
-            playfield[x][y] = holeIndex == x ? 0 : GARBAGE_MINO_CONVENTION; // 0 for the "air"
-        }
+    uint64_t garbageColors = 0;
+    for (int x = 0; x < Bitboard::WIDTH; ++x) {
+        if (x != holeIndex) garbageColors |= static_cast<uint64_t>(GARBAGE_MINO_CONVENTION) << (x * 4);
     }
-
-    if (this->fallingPiece != nullptr) {
-        this->fallingPiece->invalidateGhostPieceCache();
+    for (int y = Bitboard::HEIGHT - height; y < Bitboard::HEIGHT; ++y) {
+        state.rows[y] = static_cast<uint16_t>(Bitboard::FULL_ROW & ~(1 << holeIndex)); // 0 for the "air"
+        state.rowColors[y] = garbageColors;
     }
+    // every row moved, and the ghost with them
+    this->markRowsDirty(Bitboard::ALL_ROWS);
+    this->refreshFallingPieceRows();
 }
 
 const vector<vector<int> > &TetrisEngine::getBoardBuffer() const {
-    if (fallingPiece == nullptr)
-        return playfield; // no copy if there's nothing to modify (this is important for memory)
-    clonedPlayfield = playfield; // shallow copy (no deep)
-
-    int fallingPieceType = fallingPiece->type->ordinal + 1; // the piece type (ordinal + 1), because 0 is air
-    if (showGhostPiece) {
-        // ghost pieces will have a specific convention in the array
-        for (const auto &ghostPos: fallingPiece->getGhostPiecePosition()) {
-            clonedPlayfield[ghostPos[0]][ghostPos[1]] = GHOST_PIECE_CONVENTION;
+    vector<vector<int> > &clonedPlayfield = cold->clonedPlayfield;
+    if (clonedPlayfield.empty()) {
+        clonedPlayfield.assign(Bitboard::WIDTH, vector<int>(Bitboard::HEIGHT, 0));
+        staleBufferRows = Bitboard::ALL_ROWS;
+    }
+
+    // unpack the colors of the rows that changed since the last call (the piece and the ghost
+    // are drawn over again below, the rows they left are part of the stale ones)
+    for (int y = 0; y < Bitboard::HEIGHT; ++y) {
+        if (!((staleBufferRows >> y) & 1)) continue;
+        const uint64_t colors = state.rowColors[y];
+        for (int x = 0; x < Bitboard::WIDTH; ++x) {
+            clonedPlayfield[x][y] = static_cast<int>((colors >> (x * 4)) & 0xF);
+        }
+    }
+    staleBufferRows = 0;
+    if (!hasFallingPiece()) return clonedPlayfield;
+
+    const Bitboard::PieceShape &shape = Bitboard::SHAPES.shapes[state.fallingType][state.fallingRotation];
+    int fallingPieceType = state.fallingType + 1; // the piece type (ordinal + 1), because 0 is air
+    const int ghostY = getGhostPieceY();
+    for (int ry = 0; ry < shape.size; ++ry) {
+        for (int rx = 0; rx < shape.size; ++rx) {
+            if (!((shape.rows[ry] >> rx) & 1)) continue;
+            // ghost pieces will have a specific convention in the array
+            if (showGhostPiece) clonedPlayfield[state.fallingX + rx][ghostY + ry] = GHOST_PIECE_CONVENTION;
         }
     }
-    // the falling piece
-    for (const auto &minoPos: fallingPiece->getRelativeMinoCoordinates()) {
-        // if the piece is "falling" (not locked to the board yet)
-        // the color index will be the negative version of normal minos.
-        // To ignore this, use abs()
-        clonedPlayfield[minoPos[0]][minoPos[1]] = -fallingPieceType;
+    for (int ry = 0; ry < shape.size; ++ry) {
+        for (int rx = 0; rx < shape.size; ++rx) {
+            if (!((shape.rows[ry] >> rx) & 1)) continue;
+            // if the piece is "falling" (not locked to the board yet)
+            // the color index will be the negative version of normal minos.
+            // To ignore this, use abs()
+            clonedPlayfield[state.fallingX + rx][state.fallingY + ry] = -fallingPieceType;
+        }
     }
     return clonedPlayfield;
 }
@@ -133,16 +188,111 @@ void TetrisEngine::onEngineStart() {
 
 // this will run every single tick
 void TetrisEngine::onTickRun() {
+    // handle DAS/ARR
+    this->processAutoShift();
     // handle gravity
     this->moveCellOnGameGravity();
 }
 
+// applies the queued inputs, at the start of the tick
+void TetrisEngine::processInputQueue() {
+    if (this->inputQueue.empty()) return;
+    vector<TimedInput> &inputs = this->inputQueue;
+    // stable, so inputs pressed within the same millisecond keep their arrival order
+    stable_sort(inputs.begin(), inputs.end(),
+                [](const TimedInput &a, const TimedInput &b) { return a.timestamp < b.timestamp; });
+
+    size_t applied = 0;
+    this->tickPhase = REPLAY_INPUT_QUEUE;
+    for (; applied < inputs.size() && !this->stopped; ++applied) {
+        // a hard drop needs a piece, it (and everything pressed after it) waits for the next tick
+        if (inputs[applied].input == INPUT_HARD_DROP && !this->hasFallingPiece()) break;
+        // recorded as applied (what got pressed when does not matter to a replay)
+        if (cold->recorder) cold->recorder->record(state.ticksPassed, REPLAY_INPUT_QUEUE, inputs[applied].input);
+        this->applyInput(inputs[applied].input);
+    }
+    this->tickPhase = REPLAY_IN_TICK;
+
+    // the leftovers are older than anything queued later, they stay in front
+    inputs.erase(inputs.begin(), inputs.begin() + static_cast<ptrdiff_t>(applied));
+}
+
+void TetrisEngine::applyInput(const EngineInput input) {
+    switch (input) {
+        case INPUT_LEFT_DOWN: leftKeyToggle(true); break;
+        case INPUT_LEFT_UP: leftKeyToggle(false); break;
+        case INPUT_RIGHT_DOWN: rightKeyToggle(true); break;
+        case INPUT_RIGHT_UP: rightKeyToggle(false); break;
+        case INPUT_SOFT_DROP_DOWN: softDropToggle(true); break;
+        case INPUT_SOFT_DROP_UP: softDropToggle(false); break;
+        case INPUT_ROTATE_CW: rotateCW(); break;
+        case INPUT_ROTATE_CCW: rotateCCW(); break;
+        case INPUT_HARD_DROP: hardDrop(); break;
+        case INPUT_HOLD: hold(); break;
+    }
+}
+
+// IHS, then IRS, then the buffered tap, on the piece that just spawned
+void TetrisEngine::applyInitialActions() {
+    if (this->state.ihsRequested) {
+        this->state.ihsRequested = false;
+        if (canUseHold()) {
+            // the swapped piece spawns through putPieceInPlayfield() and gets the IRS there,
+            // if the hold was empty, the IRS waits for the next piece instead
+            this->onUserHold();
+            return;
+        }
+    }
+
+    // a buffered 180 is two quarter turns, kicks apply as usual
+    if (this->state.irsRotation == 3) {
+        this->rotatePiece(true);
+    } else {
+        for (int i = 0; i < this->state.irsRotation && this->hasFallingPiece(); ++i) {
+            this->rotatePiece(false);
+        }
+    }
+    this->state.irsRotation = 0;
+
+    if (this->state.initialShift != 0 && this->hasFallingPiece()) {
+        this->translateHorizontally(this->state.initialShift < 0);
+    }
+    this->state.initialShift = 0;
+}
+
+// DAS/ARR, tick based
+void TetrisEngine::processAutoShift() {
+    if (this->state.shiftDirection == 0) return;
+
+    // charge DAS (this keeps going between pieces, so the charge carries over)
+    bool justCharged = false;
+    if (this->state.dasCharge < this->dasTicks) {
+        if (++this->state.dasCharge < this->dasTicks) return;
+        justCharged = true;
+    }
+
+    if (!this->hasFallingPiece()) return;
+    const bool left = this->state.shiftDirection < 0;
+
+    // ARR = 0, straight to the wall
+    if (this->arrTicks == 0) {
+        this->shiftToWall(left);
+        return;
+    }
+
+    // the first repeat happens the moment DAS is charged, then every ARR ticks
+    if (justCharged || ++this->state.arrCharge >= this->arrTicks) {
+        this->state.arrCharge = 0;
+        this->translateHorizontally(left);
+    }
+}
+
 // on mino placed
-void TetrisEngine::onMinoLocked(Tetromino *locked) {
+void TetrisEngine::onMinoLocked() {
     // allow user to hold again
-    this->canHold = true;
+    this->state.canHold = true;
     // new mino
-    this->updatePlayfieldState(locked);
+    this->updatePlayfieldState();
     // Place the next piece in playfield, this also generates
     // a new piece at the end of the queue
     this->pushNextPieceToPlayfield();
@@ -151,7 +301,7 @@ void TetrisEngine::onMinoLocked(Tetromino *locked) {
 // on user hold
 void TetrisEngine::onUserHold() {
     if (!canUseHold()) return; // return if holding is not allowed or disabled altogether
-    MinoTypeEnum* toHold = this->fallingPiece->type; // get & store the type of the falling piece
+    const int8_t toHold = this->state.fallingType; // get & store the type of the falling piece
 
     /*
      * When the player presses HOLD, if there is no currently held piece, the system takes the falling piece and
@@ -161,16 +311,16 @@ void TetrisEngine::onUserHold() {
 
     // if a hold piece exists, place it into the playfield and push a new block from the generator into the queue.
     // otherwise, move the currently held piece into the playfield, effectively swapping it.
-    if (this->holdPiece != nullptr) {
+    if (this->state.holdType != -1) {
         this->markFallingPieceAsNull();
-        this->putPieceInPlayfield(this->holdPiece);
+        this->putPieceInPlayfield(this->state.holdType);
     } else {
         this->pushNextPieceToPlayfield();
     }
 
     // update holdPiece with the current falling piece and disable holding until the next piece is placed.
-    this->holdPiece = toHold;
-    this->canHold = false; // disable further holding until the next piece is placed
+    this->state.holdType = toHold;
+    this->state.canHold = false; // disable further holding until the next piece is placed
     // only in SDL
     SysAudio::playSoundAsync(PIECE_HOLD_AUD, SysAudio::getSFXVolume(), false);
 }
@@ -179,177 +329,110 @@ void TetrisEngine::onUserHold() {
 void TetrisEngine::onPieceManipulation() {
     // if the player has not exceeded the allowed manipulation count
     // (rotating or moving the piece too much)
-    if (manipulationCount < pieceMovementThreshold) {
-        // cancel any scheduled task that would lock the piece in place
-        cancelTask(this->pieceLockTaskId);
-        // reset the task ID as no lock task is active anymore
-        this->pieceLockTaskId = -1;
+    if (state.manipulationCount < pieceMovementThreshold) {
+        // cancel the pending lock, as no lock is active anymore
+        this->state.pieceLockTick = -1;
     }
         // otherwise,
-        // if there is an active lock task and a falling piece exists
-    else if (this->pieceLockTaskId != -1 && fallingPiece != nullptr) {
-        // force the piece to perform a hard drop, locking it instantly
-        hardDrop();
+        // if there is a pending lock and a falling piece exists
+    else if (this->state.pieceLockTick != -1 && hasFallingPiece()) {
+        // force the piece to perform a hard drop, locking it instantly (not the public one,
+        // this is no input of its own)
+        hardDropPiece();
     }
 
     // increment the manipulation counter since a rotation just occurred
-    manipulationCount++;
+    state.manipulationCount++;
 }
 
 // This runs on each tick and simulates the effect of gravity on the piece
 void TetrisEngine::moveCellOnGameGravity() {
-    // accumulate the movement caused by gravity in each tick
-    cellMoved += gravity;
-
-    // once cellMoved reaches or exceeds 1 (a full cell downward movement)
-    if (cellMoved >= 1) {
-        // move the piece down by the number of full cells accumulated
-        for (int cm = 0; cm < round(cellMoved); cm++) {
-            if (fallingPiece != nullptr) {
+    // accumulate the movement caused by gravity in each tick, in subcells (SDF applies while soft drop is held)
+    state.cellMoved += state.softDropHeld ? defaultGravity * softDropFactor : defaultGravity;
+
+    // once cellMoved reaches or exceeds 1 cell (a full cell downward movement)
+    if (state.cellMoved >= GRAVITY_SUBCELLS_PER_CELL) {
+        // move the piece down by the number of full cells accumulated (no more than the playfield height)
+        const int64_t cells = min<int64_t>(state.cellMoved / GRAVITY_SUBCELLS_PER_CELL, Bitboard::HEIGHT);
+        for (int cm = 0; cm < cells; cm++) {
+            if (hasFallingPiece()) {
                 // try to move the piece down by one cell
-                // if the piece can't move down further (landed) and no lock task is active
-                if (const bool landed = !fallingPiece->translateDown(); landed && this->pieceLockTaskId == -1) {
-                    Tetromino *piece = this->fallingPiece; // store a reference to the current piece
-
-                    // schedule a delayed task to lock the piece after the lockDelay (default 30 ticks; half a sec) time
-                    this->pieceLockTaskId = scheduleDelayedTask(lockDelay, [piece, this] {
-                        // after the delay, reset the task ID
-                        this->pieceLockTaskId = -1;
-
-                        // check if the piece is still the same and is still on the ground
-                        if (piece != nullptr && piece == this->fallingPiece && this->fallingPiece->onGround()) {
-                            // if so, lock the piece in place
-                            fallingPiece->lockIn();
-                        }
-                    });
+                // if the piece can't move down further (landed) and no lock is pending
+                if (const bool landed = !translateDown(); landed && this->state.pieceLockTick == -1) {
+                    // lock the piece after the lockDelay (default 30 ticks; half a sec) time
+                    // (the pending lock is dropped whenever a new piece spawns)
+                    this->state.pieceLockTick = state.ticksPassed + lockDelay;
                     break; // stop moving the piece down after scheduling the lock
                 }
             }
         }
-        // reset cellMoved to 0 after applying downward movement
-        cellMoved = 0;
-    }
-}
-
-void TetrisEngine::updatePlayfieldState(Tetromino* locked) {
-    // flags for the event
-    bool isSpin = false;
-    bool isMiniSpin = false;
-
-    // tea-spin detection
-    // only trigger if the locked piece is a T mino AND the last action was ROTATE (CCW and CW)
-    if (locked->type->ordinal == MinoType::T_MINO.ordinal &&
-        (locked->lastActionDone == CW_ROTATION || locked->lastActionDone == CCW_ROTATION)) {
-        // Assuming you track whether the last move was a rotation:
-        const int lockedX = locked->x, lockedY = locked->y;
-
-        // Check the 3x3 grid around the center of the T piece
-        // Because the Tetromino#x and #y are not relative to the center
-        // we gonna treat it as relative to 0, 0
-        bool c1 = hasMinoAt(lockedX, lockedY) // upper left
-        , c2 = hasMinoAt(lockedX + 2, lockedY) // upper right
-        , c3 = hasMinoAt(lockedX, lockedY + 2) // lower left
-        , c4 = hasMinoAt(lockedX + 2, lockedY + 2); // lower right
-
-        // the lookup table
-        vector<vector<bool> > tMinoRelative = {
-                {c1, c2, /*back*/ c3, c4},  // 0
-                {c2, c3, /*back*/ c1, c4},  // 1
-                {c3, c4, /*back*/ c1, c2},  // 2
-                {c4, c1, /*back*/ c2, c3}   // 3
-        };
-
-        // the front and back of the T mino relative to the rotation state
-        vector<bool> pair = tMinoRelative[locked->rotationState];
-        // 2 minoes in the front stem [0*0] filled
-        //							  [***]
-        // and at least 1 in the back [1-1] filled
-        if (pair[0] && pair[1] && (pair[2] || pair[3])) {
-            isSpin = true; // flag for T-Spin exclusive
-            isMiniSpin = false; // foolproof
-        } else
-            // 2 minoes in the back 	  [1*1] filled
-            //							  [***]
-            // and  2 in the back 		  [0-0] filled
-        if (pair[2] && pair[3] && (pair[0] || pair[1])) {
-            // for ALL mini T-spin that moves the piece 1 by 2 (https://tetris.wiki/T-Spin)
-            // "upgrade" it to a NORMAL T-Spin
-            if (lastSpinKickUsed != 0 && lastKickPositionUsed[0] == 1 && lastKickPositionUsed[1] == 2) {
-                isSpin = true; // flag for T-Spin exclusive
-                isMiniSpin = false; // foolproof
-            } else {
-                isSpin = false; // foolproof
-                isMiniSpin = true; // flag for any type of mini spin
-            }
-        }
-    }
-
-    // DETECT mini spins (except T) [mimicking the TETR.IO All-Spin ruleset]
-    // only if not a T piece AND last action is ROTATE
-    if (locked->type->ordinal != MinoType::T_MINO.ordinal &&
-        (locked->lastActionDone == CW_ROTATION || locked->lastActionDone == CCW_ROTATION)) {
-        // if the last rotation was a kick, it is considered a mini spin
-        if (lastSpinKickUsed != 0) {
-            isSpin = false; // foolproof
-            isMiniSpin = true; // flag for any type of mini spin
-        }
+        // keep only the fraction of a cell after applying downward movement
+        state.cellMoved %= GRAVITY_SUBCELLS_PER_CELL;
+        this->refreshFallingPieceRows();
     }
+}
 
-    // line clears
-    vector<int> clearedLines;
+void TetrisEngine::updatePlayfieldState() {
+    const int lockedType = state.fallingType;
+    const int lastAction = state.fallingLastAction;
+
+    // spin detection, shared with everything that predicts the engine (see SRS::detectSpin)
+    const SRS::SpinType spin = SRS::detectSpin(state.rows, lockedType, state.fallingRotation, state.fallingX, state.fallingY,
+                                               lastAction == CW_ROTATION || lastAction == CCW_ROTATION,
+                                               state.lastSpinKickUsed, state.lastKickPositionUsed[0], state.lastKickPositionUsed[1]);
+    const bool isSpin = spin == SRS::SPIN_FULL; // flag for T-Spin exclusive
+    const bool isMiniSpin = spin == SRS::SPIN_MINI; // flag for any type of mini spin
+
+    // line clears, 0 = up; 39 = bottom
+    // the cleared rows are turned empty first (below), this won't shift the board, however.
+    // the board is shifted in bulk at the end
+    const uint64_t clearedRowsMask = Bitboard::fullRows(state.rows); // bit Y = row Y
+    const int clearedCount = __builtin_popcountll(clearedRowsMask);
     bool perfectClear = true; // pc flag
-
-    // 0 = up; 39 = bottom
-    // top -> down
-    for (int y = 0; y < this->playfield[0].size(); ++y) {
-        // if the row is empty, skip this check altogether
-        if (isRowEmpty(y)) continue;
-        bool hasHoles = false;
-
-        // Check if the row has any holes
-        for (auto &x: playfield) {
-            if (x[y] == 0) {
-                hasHoles = true;
-                break;
-            }
-        }
-
-        // if the row has no holes, clear the row and move rows above it down
-        if (!hasHoles) {
-            // turns the cleared row empty first, this won't shift the board, however.
-            // the board is shifted in bulk at the end
-            nullifyRow(y);
-            clearedLines.push_back(y); // tell the listener which line got cleared
-        } else { // even if a single row has a mino, this ain't a PC
+    for (const uint16_t row: state.rows) {
+        // even if a single row has a mino (and is not cleared), this ain't a PC
+        if (row != 0 && row != Bitboard::FULL_ROW) {
             perfectClear = false;
+            break;
         }
     }
 
+    // turns the cleared rows empty (may be animated over the clear delay)
+    if (clearedRowsMask != 0) nullifyRows(clearedRowsMask);
+
+    // a clear starts or breaks the back-to-back chain, locking without clearing keeps it
+    if (clearedCount > 0) state.backToBack = SRS::isDifficultClear(clearedCount, spin);
+
     // update the combo counter
-    if (clearedLines.size() > 0) {
-        comboCount++; // increment a combo count
-        if (comboCount > 0 && onComboCallback != nullptr) {
-            onComboCallback(comboCount);
+    if (clearedCount > 0) {
+        state.comboCount++; // increment a combo count
+        if (state.comboCount > 0 && cold->onComboCallback != nullptr) {
+            cold->onComboCallback(state.comboCount);
         }
-    } else if (comboCount > 0) {
-        if (onComboBreaksCallback != nullptr) {
-            onComboBreaksCallback(comboCount);
+    } else if (state.comboCount > 0) {
+        if (cold->onComboBreaksCallback != nullptr) {
+            cold->onComboBreaksCallback(state.comboCount);
         }
-        comboCount = -1; // broke
+        state.comboCount = -1; // broke
     }
 
     // fire the event for user
-    if (this->onMinoLockedCallback != nullptr) onMinoLockedCallback(clearedLines.size());
+    if (cold->onMinoLockedCallback != nullptr) cold->onMinoLockedCallback(clearedCount);
 
     // the playfield event emitter
-    if (this->onPlayfieldEventCallback != nullptr &&
-        (isMiniSpin || isSpin || perfectClear || clearedLines.size() > 0)) {
+    if (cold->onPlayfieldEventCallback != nullptr &&
+        (isMiniSpin || isSpin || perfectClear || clearedCount > 0)) {
+        // tell the listener which line got cleared, top -> down
+        vector<int> clearedLines;
+        for (int y = 0; y < Bitboard::HEIGHT; ++y) {
+            if ((clearedRowsMask >> y) & 1) clearedLines.push_back(y);
+        }
         // fire the event
-        this->onPlayfieldEventCallback(
+        cold->onPlayfieldEventCallback(
                 PlayfieldEvent(
                         clearedLines,
                         perfectClear,
-                        locked->type,
+                        MinoType::fromOrdinal(lockedType),
                         isSpin, isMiniSpin
                 )
         );
@@ -358,23 +441,46 @@ void TetrisEngine::updatePlayfieldState(Tetromino* locked) {
     // if the playfield event triggered a line clear (or more)
     // This block of code is the one that ACTUALLY updates the playfield
     // by shifting all rows down for each cleared line
-    if (!clearedLines.empty()) {
-        this->clearDelayActive = true; // activate clear delay, halting piece spawning temporarily (this should be changed to interrupt, but fuck it)
+    if (clearedCount > 0) {
+        this->state.clearDelayActive = true; // activate clear delay, halting piece spawning temporarily (this should be changed to interrupt, but fuck it)
         if (lineClearsDelay > 0) {
-            // schedule playfield update to clear lines after delay (if > 0)
-            scheduleDelayedTask(lineClearsDelay, [this, clearedLines] {
-                this->updatePlayFieldLineClears(clearedLines);
-            });
-        } else updatePlayFieldLineClears(clearedLines); // run instantly if 0
+            // update the playfield to clear lines after delay (if > 0), see tick()
+            this->state.lineClearTick = state.ticksPassed + lineClearsDelay;
+        } else updatePlayFieldLineClears(clearedRowsMask); // run instantly if 0
     }
 }
 
 // internal function
-void TetrisEngine::updatePlayFieldLineClears(const vector<int> &clearedLines) {
-    for (const int row: clearedLines) {
-        clearRow(row);
+void TetrisEngine::updatePlayFieldLineClears(const uint64_t rowsMask) {
+    // bottom -> top, drag every row that stays down (masks and colors together)
+    int write = Bitboard::HEIGHT - 1;
+    for (int y = Bitboard::HEIGHT - 1; y >= 0; --y) {
+        if ((rowsMask >> y) & 1) continue;
+        state.rows[write] = state.rows[y];
+        state.rowColors[write] = state.rowColors[y];
+        --write;
+    }
+    for (; write >= 0; --write) {
+        state.rows[write] = 0;
+        state.rowColors[write] = 0;
+    }
+    // every row above the lowest cleared one moved down
+    if (rowsMask != 0) this->markRowsDirty((2ULL << (63 - __builtin_clzll(rowsMask))) - 1);
+    this->state.lineClearTick = -1;
+    this->state.lineWipeStartTick = -1;
+    this->state.clearedRowsMask = 0;
+    this->state.clearDelayActive = false;
+}
+
+void TetrisEngine::processPieceLock() {
+    if (this->state.pieceLockTick == -1 || state.ticksPassed < this->state.pieceLockTick) return;
+    // the delay is over, reset the pending lock
+    this->state.pieceLockTick = -1;
+
+    // check if the piece is still on the ground, if so, lock the piece in place
+    if (this->hasFallingPiece() && this->onGround()) {
+        this->lockIn();
     }
-    this->clearDelayActive = false;
 }
 
 void TetrisEngine::pushNextPieceToPlayfield() {
@@ -386,35 +492,42 @@ void TetrisEngine::pushNextPieceToPlayfield() {
     this->markFallingPieceAsNull();
 }
 
-void TetrisEngine::putPieceInPlayfield(MinoTypeEnum* type) {
-    if (type == nullptr || stopped) return; // if stopped or topped out, return
-
-    // this is when it's safe to delete older objects (because a new one is initialized below)
-    // temu garbage collector
-    this->freeMemoryOfFallingPiece();
+void TetrisEngine::putPieceInPlayfield(const int type) {
+    if (type < 0 || stopped) return; // if stopped or topped out, return
 
-    // create the dynamic tetromino instance (this will be placed on the heap)
-    this->fallingPiece = new Tetromino(this, type);
+    // a brand-new piece, nothing is pending and 0 manipulation
+    this->state.fallingType = static_cast<int8_t>(type);
+    this->state.fallingRotation = 0;
+    this->state.fallingLastAction = 0;
+    this->state.manipulationCount = 0;
+    this->state.pieceLockTick = -1;
 
     // set the initial X, Y position
-    this->fallingPiece->x = (type->ordinal == MinoType::O_MINO.ordinal) ? 4 : 3;
-    this->fallingPiece->y = static_cast<int>(playfield[0].size()) - 22; // the piece will always spawn on the 22nd row of the board
+    this->state.fallingX = static_cast<int8_t>(Bitboard::spawnX(type));
+    this->state.fallingY = Bitboard::SPAWN_Y; // the piece will always spawn on the 22nd row of the board
 
     // reset this measurement
-    this->cellMoved = 0;
+    this->state.cellMoved = 0;
 
     // check if the user topped out
     // this is the only method that can both spawn and clear at the same time
-    if (!this->fallingPiece->canFitBeingAt(this->fallingPiece->x, this->fallingPiece->y)) {
+    if (!this->canFitBeingAt(this->state.fallingX, this->state.fallingY)) {
         this->markFallingPieceAsNull();
-        this->shouldTopOut = true; // this will signal the game loop to execute onTopOut
+        this->state.shouldTopOut = true; // this will signal the game loop to execute onTopOut
+        return;
     }
+
+    this->refreshFallingPieceRows();
+
+    // whatever was pressed while waiting for this piece (IHS/IRS)
+    this->applyInitialActions();
 }
 
 void TetrisEngine::gameLoopStart(bool useCurrentThread) {
     if (this->stopped) throw logic_error("This instance has stopped! You must create a new instance!");
     if (this->started) throw logic_error("This instance is already started");
 
+    if (cold->recorder) recordEvent(REPLAY_START);
     // fire pre-start events
     this->onEngineStart();
     this->startedAt = System::currentTimeMillis();
@@ -430,16 +543,16 @@ void TetrisEngine::gameLoopStart(bool useCurrentThread) {
     }
 }
 
-bool TetrisEngine::gameLoopBody() {
+bool TetrisEngine::tick() {
     // stop on break signal
     if (this->stopped) return false;
-    // count nanoseconds passed for tick compensation if needed
-    auto tickTimeBegin = System::nanoTime();
+    TetrisEngineCold &cold = *this->cold;
+    this->tickPhase = REPLAY_IN_TICK;
 
     // run the external callback
-    if (this->onTickBeginCallback != nullptr) {
+    if (cold.onTickBeginCallback != nullptr) {
         try {
-            this->onTickBeginCallback();
+            cold.onTickBeginCallback();
         } catch (exception &e) {
             cerr << e.what() << endl;
         }
@@ -447,52 +560,53 @@ bool TetrisEngine::gameLoopBody() {
 
     // if the falling piece is null, spawns a new one
     // only if the clear delay period is not active and NOT interrupted
-    if (this->fallingPiece == nullptr && !clearDelayActive && !interrupted) {
-        if (!nextQueue.empty()) {
-            MinoTypeEnum* nextMino = nextQueue.front();
-            nextQueue.pop();
-            this->putPieceInPlayfield(nextMino);
+    if (!this->hasFallingPiece() && !state.clearDelayActive && !state.interrupted) {
+        if (state.nextQueueSize > 0) {
+            this->putPieceInPlayfield(this->popNextQueue());
         }
     }
 
-    // hold handling
-    if (this->holdButtonPressed) {
-        if (this->fallingPiece != nullptr) {
-            // c++ bullshittery
-            this->onUserHold();
-        }
-        this->holdButtonPressed = false;
-    }
+    // inputs from the previous tick, in the order they were pressed
+    this->processInputQueue();
 
     // run the main internal logic
     onTickRun();
 
+    // engine timers (lock delay, line clear delay & its animation)
+    this->processPieceLock();
+    this->advanceLineWipe();
+    if (this->state.lineClearTick != -1 && state.ticksPassed >= this->state.lineClearTick) {
+        this->updatePlayFieldLineClears(this->state.clearedRowsMask);
+    }
+
     // scheduled task handling (this is more primitive than Java because of c++ libs)
-    // find the first key that is strictly greater than ticksPassed
-    auto it = scheduledTasks.upper_bound(ticksPassed);
-    // if it is not the beginning, step back to get the greatest key <= ticksPassed
-    if (it != scheduledTasks.begin()) {
-        --it; // this is so fucking bad, why c++ don't have treemap
-        // ensure that this key is indeed <= ticksPassed
-        if (it->first <= ticksPassed) {
-            // c++ debugger bullshitery
-            LONG key = it->first;
-
-            // remove the key from the map
-            auto node = scheduledTasks.extract(key);
-            vector<function<void()>> tasks = move(node.mapped());
-
-            // execute one by one
-            for (auto &task: tasks) {
-                task();
+    if (!cold.scheduledTasks.empty()) {
+        // find the first key that is strictly greater than ticksPassed
+        auto it = cold.scheduledTasks.upper_bound(state.ticksPassed);
+        // if it is not the beginning, step back to get the greatest key <= ticksPassed
+        if (it != cold.scheduledTasks.begin()) {
+            --it; // this is so fucking bad, why c++ don't have treemap
+            // ensure that this key is indeed <= ticksPassed
+            if (it->first <= state.ticksPassed) {
+                // c++ debugger bullshitery
+                LONG key = it->first;
+
+                // remove the key from the map
+                auto node = cold.scheduledTasks.extract(key);
+                vector<function<void()>> tasks = move(node.mapped());
+
+                // execute one by one
+                for (auto &task: tasks) {
+                    task();
+                }
             }
         }
     }
 
     // run the external call
-    if (this->onTickEndCallback != nullptr) {
+    if (cold.onTickEndCallback != nullptr) {
         try {
-            this->onTickEndCallback();
+            cold.onTickEndCallback();
         } catch (exception &e) {
             cerr << e.what() << endl;
         }
@@ -501,19 +615,39 @@ bool TetrisEngine::gameLoopBody() {
     // if top out, execute the onTopOut external call
     // Usually, onTopOut will be assigned to TetrisEngine#stop(), which will
     // stop the main game loop, thus trigger the `if (this.stopped) break;` above
-    if (shouldTopOut) {
+    if (state.shouldTopOut) {
         // execute one last time (or not, the user can do sth to prevent `stop()` from being called
-        if (this->onTopOutCallback != nullptr) {
-            this->onTopOutCallback();
+        if (!cold.topOutOverridden) {
+            if (!this->stopped) this->stop();
+        } else if (cold.onTopOutCallback != nullptr) {
+            cold.onTopOutCallback();
         }
-        this->shouldTopOut = false; // the user may be creative and do something else with this
-
-        // since the last tetromino caused a top-out, we clear memory right now
-        this->freeMemoryOfFallingPiece();
+        this->state.shouldTopOut = false; // the user may be creative and do something else with this
     }
 
+    // publish the rows this tick changed
+    this->lastTickDirtyRows = this->dirtyRows;
+    if (this->dirtyRows != 0) ++this->boardVersion;
+    this->dirtyRows = 0;
+
     // increment tick counter, used for scheduling
-    ticksPassed++;
+    state.ticksPassed++;
+    this->tickPhase = REPLAY_BETWEEN_TICKS;
+    return true;
+}
+
+void TetrisEngine::recordEvent(const uint8_t type, const int a, const int b) {
+    // the actions a queued input is made of, the input itself is recorded
+    if (this->tickPhase == REPLAY_INPUT_QUEUE && type <= REPLAY_SOFT_DROP_TO_GROUND) return;
+    // anything else the input led to (a lock callback...) goes at the end of the tick
+    const ReplayPhase phase = this->tickPhase == REPLAY_BETWEEN_TICKS ? REPLAY_BETWEEN_TICKS : REPLAY_IN_TICK;
+    this->cold->recorder->record(state.ticksPassed, phase, type, a, b);
+}
+
+bool TetrisEngine::gameLoopBody() {
+    // count nanoseconds passed for tick compensation if needed
+    auto tickTimeBegin = System::nanoTime();
+    if (!this->tick()) return false;
 
     // lost-ticks compensation mechanism
     this->lastTickTime = (System::nanoTime() - tickTimeBegin) / 1000000;
@@ -529,5 +663,148 @@ bool TetrisEngine::gameLoopBody() {
     return true;
 }
 
+/******************** THE FALLING PIECE ********************/
+SRS::KickSequence TetrisEngine::getKickSequenceCheck(const int initialState, const int finalState) const {
+    // if SRS is not enabled, ignore the kick sequence, only allow basic rotation
+    return SRS::kickSequence(state.fallingType, initialState, finalState, useSRS);
+}
+
+void TetrisEngine::rotatePiece(const bool ccw) {
+    // store the variables to reverse the changes when needed
+    const int initialRotation = this->state.fallingRotation;
+
+    // update the rotation state (range 0-3)
+    const int targetRotation = (initialRotation + (ccw ? -1 : 1) + 4) % 4;
+
+    // kick sequence based on initial and target rotation states
+    const SRS::KickSequence kickSequence = this->getKickSequenceCheck(initialRotation, targetRotation);
+
+    // try each kick offset in the sequence
+    for (int kickUsed = 0; kickUsed < kickSequence.count; ++kickUsed) {
+        const SRS::Kick &kick = kickSequence.kicks[kickUsed];
+        // "kick" the tetromino to the new position
+        const int testingX = state.fallingX + kick.x;
+        const int testingY = state.fallingY - kick.y; // the board is upside down, so i subtract instead of add bruh, index wise
+
+        // this will return false if the tetromino won't fit
+        if (Bitboard::fits(state.rows, state.fallingType, targetRotation, testingX, testingY)) {
+            // set the new position
+            this->state.fallingX = static_cast<int8_t>(testingX);
+            this->state.fallingY = static_cast<int8_t>(testingY);
+            this->state.fallingRotation = static_cast<int8_t>(targetRotation);
+            this->refreshFallingPieceRows();
+
+            // if the kick used is NOT 0 (initial kick), then it was a valid "kick"
+            this->state.lastSpinKickUsed = kickUsed;
+            // the kick offset used (this will be used for T-Spin detection)
+            this->state.lastKickPositionUsed[0] = kick.x;
+            this->state.lastKickPositionUsed[1] = kick.y;
+
+            // last action of this piece
+            this->state.fallingLastAction = static_cast<int8_t>(ccw ? CCW_ROTATION : CW_ROTATION);
+            // a successful move
+            this->onPieceManipulation();
+
+            // only in SDL
+            SysAudio::playSoundAsync(ROTATE_AUD, SysAudio::getSFXVolume(), false);
+            return; // the rotation succeeded
+        }
+    }
+    // no valid kick was found, the piece stays as it was
+}
+
+void TetrisEngine::lockIn() {
+    const Bitboard::PieceShape &shape = Bitboard::SHAPES.shapes[state.fallingType][state.fallingRotation];
+    // set the cells to this tetromino color (type). This step is very important
+    // because the color presents itself as the "presence" of a piece (color > 0 == present)
+    const int color = state.fallingType + 1;
+    for (int ry = 0; ry < shape.size; ++ry) {
+        for (int rx = 0; rx < shape.size; ++rx) {
+            if ((shape.rows[ry] >> rx) & 1) state.setCell(state.fallingX + rx, state.fallingY + ry, color);
+        }
+    }
+    this->markRowsDirty(Bitboard::pieceRows(state.fallingType, state.fallingRotation, state.fallingY));
+    state.manipulationCount = 0; // reset everything all over
+    this->onMinoLocked(); // fire the event
+}
+
+void TetrisEngine::hardDropPiece() {
+    state.fallingY = static_cast<int8_t>(getGhostPieceY());
+    this->refreshFallingPieceRows();
+    this->lockIn();
+    // only in SDL
+    SysAudio::playSoundAsync(HARD_DROP_AUD, SysAudio::getSFXVolume(), false);
+}
+
+bool TetrisEngine::translateHorizontally(const bool left) {
+    if (!this->canFitBeingAt(state.fallingX + (left ? -1 : 1), state.fallingY)) return false;
+
+    state.fallingX = static_cast<int8_t>(state.fallingX + (left ? -1 : 1));
+    this->refreshFallingPieceRows();
+    // last action of this piece, 1 = left, 2 = right movement
+    state.fallingLastAction = static_cast<int8_t>(left ? MOVE_LEFT : MOVE_RIGHT);
+    this->onPieceManipulation();
+
+    // only in SDL
+    SysAudio::playSoundAsync(TETRO_MOVE_AUD, SysAudio::getSFXVolume(), false);
+    return true;
+}
+
+bool TetrisEngine::shiftToWall(const bool left) {
+    const int step = left ? -1 : 1;
+    // the distance to the wall (or the stack), like the ghost piece but sideways
+    int distance = 0;
+    while (this->canFitBeingAt(state.fallingX + step * (distance + 1), state.fallingY)) {
+        ++distance;
+    }
+    if (distance == 0) return false;
+
+    state.fallingX = static_cast<int8_t>(state.fallingX + step * distance);
+    this->refreshFallingPieceRows();
+    state.fallingLastAction = static_cast<int8_t>(left ? MOVE_LEFT : MOVE_RIGHT);
+    this->onPieceManipulation();
+
+    // only in SDL
+    SysAudio::playSoundAsync(TETRO_MOVE_AUD, SysAudio::getSFXVolume(), false);
+    return true;
+}
+
+/******************** SNAPSHOTS ********************/
+TetrisEngineState TetrisEngine::saveState() const {
+    // the hot state IS the snapshot, only the generator lives outside
+    TetrisEngineState snapshot = state;
+    snapshot.generator = TetrominoGeneratorState{}; // no stale bag entries from the restored blob
+    snapshot.generator.saved = pieceGenerator->saveState(snapshot.generator);
+    return snapshot;
+}
+
+void TetrisEngine::restoreState(const TetrisEngineState &snapshot) {
+    if (snapshot.version != TETRIS_ENGINE_STATE_VERSION) throw invalid_argument("Incompatible engine state version!");
+    if (this->stopped) throw logic_error("This instance has stopped! You must create a new instance!");
+    // snapshots come from disk too (crash-resume, replay archives), the piece fields index the shape tables
+    const auto isPiece = [](const int type) { return type >= 0 && type < MinoType::valuesLength; };
+    bool valid = (snapshot.fallingType == -1 || isPiece(snapshot.fallingType))
+                 && (snapshot.holdType == -1 || isPiece(snapshot.holdType))
+                 && snapshot.fallingRotation >= 0 && snapshot.fallingRotation < 4
+                 && snapshot.irsRotation >= 0 && snapshot.irsRotation < 4
+                 && snapshot.nextQueueSize >= 0 && snapshot.nextQueueSize <= STATE_MAX_NEXT_QUEUE;
+    for (int i = 0; valid && i < snapshot.nextQueueSize; ++i) valid = isPiece(snapshot.nextQueue[i]);
+    // a live falling piece always fits, which keeps its x and y on the board too
+    if (valid && snapshot.fallingType >= 0) {
+        valid = Bitboard::fits(snapshot.rows, snapshot.fallingType, snapshot.fallingRotation, snapshot.fallingX, snapshot.fallingY);
+    }
+    if (!valid) throw invalid_argument("The snapshot is corrupt!");
+    // the generator first, a refused snapshot leaves everything as it was
+    if (!snapshot.generator.saved || !this->pieceGenerator->restoreState(snapshot.generator)) {
+        throw invalid_argument("The piece generator cannot be restored from this snapshot!");
+    }
+    this->state = snapshot;
+    // they were pressed against the position that was just replaced
+    this->inputQueue.clear();
+    // the whole board may differ
+    this->markRowsDirty(Bitboard::ALL_ROWS);
+    this->refreshFallingPieceRows();
+}
+
 void TetrisEngine::printBoard() const { /* deprecated */ }
-#undef LONG
\ No newline at end of file
+#undef LONG
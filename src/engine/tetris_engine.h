@@ -39,6 +39,8 @@
 #include <thread>
 #include <map>
 #include <utility>
+#include <algorithm>
+#include <memory>
 
 // java mimic
 #include "javalibs/jsystemstd.h"
@@ -48,6 +50,11 @@
 #include "playfield_event.h"
 #include "tetromino_gen_blueprint.h"
 #include "tetris_config.h"
+#include "tetris_engine_state.h"
+#include "engine_input.h"
+#include "bitboard.h"
+#include "srs.h"
+#include "zobrist.h"
 
 /**
  * @caution The tick rate is tied to MANY important aspects of the Engine (gravity, timeout, intervals, ...)
@@ -74,61 +81,52 @@ static constexpr int GHOST_PIECE_CONVENTION = -121;
  */
 static constexpr int GARBAGE_MINO_CONVENTION = MinoType::valuesLength + 1;
 
-class Tetromino;
-/*************** BEGIN SRS KICK TABLE *****************/
-/** @see https://harddrop.com/wiki/SRS **/
-static vector<vector<vector<int> > > I_KICK_TABLE = {
-        // 0 -> R
-        {{0, 0}, {-2, 0}, {1,  0}, {-2, -1}, {1,  2}},
-        // R -> 0
-        {{0, 0}, {2,  0}, {-1, 0}, {2,  1},  {-1, -2}},
-        // R -> 2
-        {{0, 0}, {-1, 0}, {2,  0}, {-1, 2},  {2,  -1}},
-        // 2 -> R
-        {{0, 0}, {1,  0}, {-2, 0}, {1,  -2}, {-2, 1}},
-        // 2 -> L
-        {{0, 0}, {2,  0}, {-1, 0}, {2,  1},  {-1, -2}},
-        // L -> 2
-        {{0, 0}, {-2, 0}, {1,  0}, {-2, -1}, {1,  2}},
-        // L -> 0
-        {{0, 0}, {1,  0}, {-2, 0}, {1,  -2}, {-2, 1}},
-        // 0 -> L
-        {{0, 0}, {-1, 0}, {2,  0}, {-1, 2},  {2,  -1}}
-};
-
-static const vector<vector<vector<int> > > OTHERS_KICK_TABLE = {
-        // 0 -> R
-        {{0, 0}, {-1, 0}, {-1, 1},  {0, -2}, {-1, -2}},
-        // R -> 0
-        {{0, 0}, {1,  0}, {1,  -1}, {0, 2},  {1,  2}},
-        // R -> 2
-        {{0, 0}, {1,  0}, {1,  -1}, {0, 2},  {1,  2}},
-        // 2 -> R
-        {{0, 0}, {-1, 0}, {-1, 1},  {0, -2}, {-1, -2}},
-        // 2 -> L
-        {{0, 0}, {1,  0}, {1,  1},  {0, -2}, {1,  -2}},
-        // L -> 2
-        {{0, 0}, {-1, 0}, {-1, -1}, {0, 2},  {-1, 2}},
-        // L -> 0
-        {{0, 0}, {-1, 0}, {-1, -1}, {0, 2},  {-1, 2}},
-        // 0 -> L
-        {{0, 0}, {1,  0}, {1,  1},  {0, -2}, {1,  -2}}
-};
+/*************** SRS KICK TABLE: see srs.h *****************/
 
 /* LAST ACTION */
 static constexpr int MOVE_LEFT = 1, MOVE_RIGHT = 2, CW_ROTATION = 3, CCW_ROTATION = 4;
 
-/*************** END OF SRS KICK TABLE *****************/
+class ReplayRecorder; // replay.h
+
+/**
+ * The cold part of a TetrisEngine: everything that is set up once and barely touched
+ * during a tick (the config, the callbacks, user tasks and the render buffer).
+ * It lives in its own heap block so the hot state stays small and dense
+ */
+struct TetrisEngineCold {
+    // checked every tick, kept together at the front
+    function<void()> onTickBeginCallback = nullptr; // run at every tick begin
+    function<void()> onTickEndCallback = nullptr; // run at every tick end
+    // task manager (user tasks only, the engine's own timers are part of the hot state)
+    map<LONG, vector<function<void()>>> scheduledTasks;
+
+    // the configuration instance of engine behaviors
+    TetrisConfig *config = nullptr;
+
+    // external calls for various engine events
+    bool topOutOverridden = false; // if false, a top out simply stops the engine
+    function<void()> onTopOutCallback = nullptr; // game over, duh
+    function<void(int)> onMinoLockedCallback = nullptr; // runs on a mino locked
+    function<void(PlayfieldEvent)> onPlayfieldEventCallback = nullptr; // on special actions
+    function<void(int)> onComboCallback = nullptr; // on user do a combo
+    function<void(int)> onComboBreaksCallback = nullptr; // on user broke the combo
+
+    // the buffer returned by getBoardBuffer(), allocated on the first call
+    vector<vector<int> > clonedPlayfield;
+
+    // gets every outside change of the game, see ReplayRecorder::attach()
+    ReplayRecorder *recorder = nullptr;
+};
 
 class TetrisEngine {
-    friend class Tetromino; // allow child class (like java)
 public:
     double dExpectedSleepTime = 0.0; // metrics
     double dActualSleepTime = 0.0;
 private:
-    /**** configurations ********/
-    TetrisConfig *config;
+    // the gameplay state (playfield, pieces, timers...), see TetrisEngineState
+    TetrisEngineState state;
 
+    /**** configurations ********/
     /** static config, cannot be changed within the context of the Engine **/
     bool showGhostPiece = true; // if ghost piece is displayed or not
     // how many actions can be done before the piece locks in
@@ -143,80 +141,52 @@ private:
     int lineClearsDelay = 0;
 
     /** dynamic config, CAN be changed within the context of the Engine **/
-    double softDropFactor = 24; // TETR.IO replication, default is 24, max can be 1_000_000
-    // gravity, in G (TGM based)
-    double defaultGravity = 0.0156; // 0.0156 cells per tick
+    int64_t softDropFactor = 24; // TETR.IO replication, default is 24, max can be 1_000_000
+    // gravity, in subcells per tick (GRAVITY_SUBCELLS_PER_CELL subcells = 1G, TGM based)
+    int64_t defaultGravity = 1022; // 0.0156 cells per tick
     // lock delay, 0.5s by default (half of target tick-rate)
     int lockDelay = 0.5 * 60;
     // hold toggle, different from the HOLD flag that the context uses (canHold)
     bool holdEnabled = true;
+    // DAS and ARR, in ticks (ARR = 0 means "shift to wall")
+    int dasTicks = 12;
+    int arrTicks = 3;
     /**** end of configurations ********/
 
-    // playfield related stuff
-    private: vector<vector<int> > playfield{10, vector<int>(40, 0)}; // 10x40 matrix, a tetromino should spawn on the 22nd row
-
-    // the active piece (falling)
-    Tetromino* fallingPiece = nullptr;
+    // indicates whether the engine is currently started or not
+    bool started = false;
+    // indicates if the engine has been stopped
+    bool stopped = false;
 
     // the tetrominoes generator, can be implemented using the given interface (JAVA EXCLUSIVE, IN C++, ITS VIRTUAL)
     TetrominoGenerator* pieceGenerator = nullptr;
 
-    // if hold is available or not
-    bool canHold = true;
+    // config, callbacks, user tasks...
+    unique_ptr<TetrisEngineCold> cold;
 
-    // external fields related to the gameplay core
-    int lastSpinKickUsed = 0; // 0 is no kick, > 1 is kick
-    vector<int> lastKickPositionUsed = {0, 0}; // 0 is no kick, > 1 is kick
+    // inputs waiting for the next tick (see queueInput()), not part of the snapshot
+    vector<TimedInput> inputQueue;
 
-    int comboCount = -1; // the combo amount (2+ consecutive line clears w/o break), the combo begins at 2 lines
+    // dirty rows (bit Y = row Y), not part of the snapshot
+    uint64_t dirtyRows = 0; // rows changed since the last tick ended
+    uint64_t lastTickDirtyRows = Bitboard::ALL_ROWS; // rows changed by the last tick, see getDirtyRows()
+    uint64_t boardVersion = 0; // +1 for every tick that changed a row
+    uint64_t fallingPieceRows = 0; // rows covered by the falling piece and its ghost
+    mutable uint64_t staleBufferRows = Bitboard::ALL_ROWS; // rows getBoardBuffer() has to unpack again
 
-    // pieces queue and hold piece
-    MinoTypeEnum* holdPiece = nullptr; // the hold piece will be "spawned" again when recall
-    queue<MinoTypeEnum*> nextQueue; // the next queue
+    // the board part of the Zobrist hash, brought up to date by getZobristHash() from the dirty rows
+    mutable uint64_t boardHash = 0;
+    mutable uint64_t rowKeys[Bitboard::HEIGHT] = {}; // the key each row contributes to boardHash
+    mutable uint64_t unhashedRows = Bitboard::ALL_ROWS;
 
-    // actual gravity variable that will be used by the game loop, (NOT the one you SHOULD EVER FUCKING TOUCH!!!!!!!),
-    // @see defaultGravity
-    // IF YOU WANT TO SET IT YOU FUCKING NIGGER
-    // this can be multiplied with the SDF to make soft drop
-    double gravity = this->defaultGravity;
+    // where tick() is at, so the recorder knows when an outside change happened
+    ReplayPhase tickPhase = REPLAY_BETWEEN_TICKS;
 
     // internal systems flags / values
-    public: LONG ticksPassed = 0;
+public:
     LONG lastTickTime = 0;
     LONG startedAt = -1;
 
-    // indicates whether the engine is currently started or not
-    private: bool started = false;
-    // whether to allow/disallow dropping pieces or not
-    bool interrupted = false;
-    // indicates if the engine has been stopped
-    bool stopped = false;
-
-    // indicates if the user should top out (WARNING: This value is FUNCTIONALLY different from 'stopped'
-    // and will be reset to "false" after executing the onTopOut() block)
-    bool shouldTopOut = false;
-
-    // indicates whether the clear delay task is currently active
-    // this will temporarily halt the piece spawning process
-    bool clearDelayActive = false;
-
-    // external calls for various engine events
-    function<void()> onTickBeginCallback = nullptr; // run at every tick end
-    function<void()> onTickEndCallback = nullptr; // run at every tick end
-    function<void()> onTopOutCallback = [this] {
-        this->stop();
-    }; // game over, duh
-    function<void(int)> onMinoLockedCallback = nullptr; // runs on a mino locked
-    function<void(PlayfieldEvent)> onPlayfieldEventCallback = nullptr; // on special actions
-    function<void(int)> onComboCallback = nullptr; // on user do a combo
-    function<void(int)> onComboBreaksCallback = nullptr; // on user broke the combo
-
-    // input buffering
-    bool holdButtonPressed = false; /* HOLD button buffering */
-
-    // task manager
-    map<LONG, vector<function<void()>>> scheduledTasks;
-
 public:
     /**
      * Initialize a Modern, Guideline-compliant Tetris Engine
@@ -225,8 +195,9 @@ public:
      * @param config     the configuration instance of engine behaviors
      * @param generator  the pieces generator to use
      */
-    TetrisEngine(TetrisConfig *config, TetrominoGenerator *generator) {
-        this->config = config;
+    TetrisEngine(TetrisConfig *config, TetrominoGenerator *generator) : cold(make_unique<TetrisEngineCold>()) {
+        this->cold->config = config;
+        this->inputQueue.reserve(INPUT_QUEUE_CAPACITY);
 
         // configuration: static config will be set ONCE but dynamic ones (can be changed after TetrisConfig build)
         // can be updated on demand
@@ -246,7 +217,7 @@ public:
 
         // start the NEXT queue
         for (auto piece: bag) {
-            nextQueue.push(piece);
+            this->pushToNextQueue(piece->ordinal);
         }
     }
 
@@ -256,7 +227,7 @@ public:
      * @return a pointer to a heap based TetrisConfig
      */
     TetrisConfig* getCurrentConfig() {
-        return this->config;
+        return this->cold->config;
     }
 
     /**
@@ -266,15 +237,19 @@ public:
      * @param mach5Speed is a nonstandard parameter for this game alone, should not be used
      */
     void updateMutableConfig(bool mach5Speed = false) {
+        const TetrisConfig *config = this->cold->config;
         // if the user can press HOLD
         this->holdEnabled = config->holdEnabled;
         // lock delay = |seconds| * tickrate
         this->lockDelay = (int) round(abs(config->secondsBeforePieceLock) * EngineTimer::TARGETTED_TICK_RATE);
         // the soft drop scalar (soft-drop factor)
-        this->softDropFactor = abs(config->softDropFactor);
-        // update gravity amount
-        this->defaultGravity = abs(config->gravity * (mach5Speed ? 3 : 1));
-        this->gravity = defaultGravity;
+        this->softDropFactor = llabs(config->softDropFactor);
+        // update gravity amount (integers only, see GRAVITY_SUBCELLS_PER_CELL)
+        this->defaultGravity = llabs(config->gravity) * (mach5Speed ? 3 : 1);
+        // DAS & ARR = |seconds| * tickrate
+        this->dasTicks = (int) round(abs(config->delayedAutoShift) * EngineTimer::TARGETTED_TICK_RATE);
+        this->arrTicks = (int) round(abs(config->autoRepeatRate) * EngineTimer::TARGETTED_TICK_RATE);
+        if (this->cold->recorder) this->recordEvent(REPLAY_CONFIG, mach5Speed);
     }
 
     /**
@@ -289,8 +264,8 @@ public:
      */
     LONG scheduleDelayedTask(const LONG ticks, const function<void()> &task) {
         if (task == nullptr) throw invalid_argument("Task could not be null!");
-        const LONG execOnTick = ticksPassed + ticks;
-        scheduledTasks[execOnTick].push_back(task);
+        const LONG execOnTick = state.ticksPassed + ticks;
+        cold->scheduledTasks[execOnTick].push_back(task);
         return execOnTick;
     };
 
@@ -299,7 +274,7 @@ public:
      * @param tickExecuted The tick number at which your tasks are expected to be executed
      */
     void cancelTask(const LONG tickExecuted) {
-        scheduledTasks.erase(tickExecuted);
+        cold->scheduledTasks.erase(tickExecuted);
     }
 
     /**
@@ -310,7 +285,7 @@ public:
 	 * @param runnable The code to execute at the end of a tick.
 	 */
     void runOnTickEnd(function<void()> runnable) {
-        this->onTickEndCallback = std::move(runnable);
+        this->cold->onTickEndCallback = std::move(runnable);
     }
 
     /**
@@ -327,7 +302,8 @@ public:
      * @param runnable When the game ends (top out).
      */
     void runOnGameOver(function<void()> runnable) {
-        this->onTopOutCallback = std::move(runnable);
+        this->cold->topOutOverridden = true;
+        this->cold->onTopOutCallback = std::move(runnable);
     }
 
     /**
@@ -338,7 +314,7 @@ public:
      * by that action
      */
     void runOnMinoLocked(function<void(int)> onMinoEvent) {
-        this->onMinoLockedCallback = std::move(onMinoEvent);
+        this->cold->onMinoLockedCallback = std::move(onMinoEvent);
     }
 
     /**
@@ -348,7 +324,7 @@ public:
      * @param onPlayfieldEvent The consumer to handle the playfield event.
      */
     void onPlayfieldEvent(function<void(PlayfieldEvent)> onPlayfieldEvent) {
-        this->onPlayfieldEventCallback = std::move(onPlayfieldEvent);
+        this->cold->onPlayfieldEventCallback = std::move(onPlayfieldEvent);
     }
 
     /**
@@ -359,7 +335,7 @@ public:
      *                combo count as an argument.
      */
     void onCombo(function<void(int)> onCombo) {
-        this->onComboCallback = std::move(onCombo);
+        this->cold->onComboCallback = std::move(onCombo);
     }
 
     /**
@@ -370,7 +346,7 @@ public:
      *                      the last combo count before the break.
      */
     void onComboBreaks(function<void(int)> onComboBreaks) {
-        this->onComboBreaksCallback = std::move(onComboBreaks);
+        this->cold->onComboBreaksCallback = std::move(onComboBreaks);
     }
 
     /**
@@ -381,6 +357,29 @@ public:
      */
     void stop();
 
+    /**
+     * @return true if stop() has been called on this instance
+     */
+    bool isStopped() const {
+        return this->stopped;
+    }
+
+    /**
+     * @return true if start() has been called on this instance
+     */
+    bool isStarted() const {
+        return this->started;
+    }
+
+    /**
+     * Hands every change that comes from outside the engine (inputs, garbage, interrupts,
+     * config updates...) to a recorder, see ReplayRecorder::attach()
+     * @param recorder null to stop recording
+     */
+    void setRecorder(ReplayRecorder *recorder) {
+        this->cold->recorder = recorder;
+    }
+
     /**
      * Moves the falling piece one unit to the left if it exists.
      * This method delegates the horizontal movement to the falling piece's
@@ -395,6 +394,24 @@ public:
      */
     void moveRight();
 
+    /**
+     * Updates the held state of the LEFT key. Pressing it shifts the piece once,
+     * holding it charges DAS, then the piece auto-repeats every ARR ticks
+     * (or goes straight to the wall if ARR is 0).
+     *
+     * @apiNote The most recently pressed side wins, the DAS charge is kept across piece spawns
+     * @param held true if the key went down, false if it was released
+     */
+    void leftKeyToggle(bool held);
+
+    /**
+     * Updates the held state of the RIGHT key.
+     * @see leftKeyToggle
+     *
+     * @param held true if the key went down, false if it was released
+     */
+    void rightKeyToggle(bool held);
+
     /**
      * Rotates the falling piece clockwise if it exists.
      *
@@ -413,6 +430,7 @@ public:
      * Toggles the soft drop feature, which increases the falling speed of the
      * current piece. The speed increase is determined by the softDropFactor.
      *
+     * @apiNote This is a key state, it survives gravity changes (updateMutableConfig)
      * @param on A boolean indicating whether to enable or disable soft drop.
      */
     void softDropToggle(bool on);
@@ -425,20 +443,45 @@ public:
      */
     void hardDrop();
 
+    /**
+     * Moves the falling piece straight down to where the ghost is, without locking it
+     * (a soft drop held until it lands, in a single call). Like gravity, this is not an action:
+     * a rotation right before it still counts for spin detection
+     */
+    void softDropToGround();
+
     /**
      * Holds the current falling piece, if it exists.
      *
-     * This method calls the onUserHold() method indirectly to handle the logic
+     * This method calls the onUserHold() method to handle the logic
      * of saving the piece and potentially placing a new piece.
+     *
+     * @apiNote If no piece is falling (spawn, line clear delay), the hold is buffered
+     * and applied to the next piece as it spawns (IHS), rotateCW() and rotateCCW() do the same (IRS)
      */
     void hold();
 
+    /**
+     * Queues an input for the next tick. At the start of every tick, the queued inputs are
+     * applied in timestamp order (inputs with the same timestamp keep their arrival order),
+     * right after the next piece spawns.
+     *
+     * @apiNote Rotations and holds pressed while no piece is falling are buffered as IRS/IHS.
+     * A hard drop pressed while no piece is falling waits (along with every input after it)
+     * for the next tick, so nothing is dropped nor reordered. The queue grows as needed and is not
+     * part of the snapshot, restoreState() drops the inputs still waiting
+     *
+     * @param input     the input (key down / key up)
+     * @param timestamp the time it was pressed at, e.g. SDL's event.key.timestamp
+     */
+    void queueInput(EngineInput input, uint32_t timestamp);
+
     /**
      * Get the current combo count
      * @return combo count
      */
     int getComboCount() const {
-        return max(0, comboCount);
+        return max(0, state.comboCount);
     }
 
     /**
@@ -446,7 +489,7 @@ public:
      * @return true if available
      */
     bool canUseHold() const {
-        return this->holdEnabled && this->canHold;
+        return this->holdEnabled && this->state.canHold;
     }
 
     /**
@@ -457,20 +500,32 @@ public:
         return this->holdEnabled;
     }
 
+    /**
+     * If rotations kick (SRS) or not
+     * @return true if they do
+     */
+    bool srsEnabled() const {
+        return this->useSRS;
+    }
+
     /**
 	 * Get the hold piece type
 	 * @return MinoTypeEnum of the current hold piece
 	 */
     MinoTypeEnum* getHoldPiece() const {
-        return this->holdPiece;
+        return MinoType::fromOrdinal(state.holdType);
     }
 
     /**
      * Get the NEXT queue
-     * @return the current next queue
+     * @return a copy of the current next queue
      */
-    queue<MinoTypeEnum* > &getNextQueue() {
-        return this->nextQueue;
+    queue<MinoTypeEnum* > getNextQueue() const {
+        queue<MinoTypeEnum* > nextQueue;
+        for (int i = 0; i < state.nextQueueSize; ++i) {
+            nextQueue.push(MinoType::fromOrdinal(state.nextQueue[i]));
+        }
+        return nextQueue;
     }
 
     /**
@@ -483,9 +538,87 @@ public:
      * Get the amount of ticks passed since the start
      */
      LONG getTicksPassed() const {
-         return this->ticksPassed;
+         return this->state.ticksPassed;
      }
 
+    /**
+     * The rows that changed during the last tick (cells locked, cleared, raised, or the falling
+     * piece / ghost moving over them), bit Y = row Y. Inputs applied between two ticks are
+     * reported with the next one.
+     *
+     * @apiNote Only valid against the previous version: if getBoardVersion() moved by more than 1
+     * since you last looked, redraw everything
+     */
+    uint64_t getDirtyRows() const {
+        return this->lastTickDirtyRows;
+    }
+
+    /**
+     * Increments once for every tick that changed at least one row (see getDirtyRows())
+     */
+    uint64_t getBoardVersion() const {
+        return this->boardVersion;
+    }
+
+    /**
+     * The 64-bit Zobrist hash of the position: playfield, falling piece type (not where it is),
+     * HOLD, canHold, back-to-back and combo (see Zobrist). Equal positions have equal hashes,
+     * across instances and across the bots.
+     *
+     * @apiNote Only the rows that changed since the last call are hashed again
+     */
+    uint64_t getZobristHash() const {
+        for (uint64_t stale = this->unhashedRows; stale != 0; stale &= stale - 1) {
+            const int y = __builtin_ctzll(stale);
+            const uint64_t key = Zobrist::rowKey(y, state.rows[y]);
+            this->boardHash ^= this->rowKeys[y] ^ key;
+            this->rowKeys[y] = key;
+        }
+        this->unhashedRows = 0;
+        return this->boardHash ^ Zobrist::stateKey(state.fallingType, state.holdType, state.canHold,
+                                                   state.backToBack, state.comboCount);
+    }
+
+    /**
+     * If the last line clear was a difficult one (a Tetris or a spin), the next one is back-to-back
+     */
+    bool isBackToBack() const {
+        return this->state.backToBack;
+    }
+
+    /**
+     * Read-only access to the live gameplay state (board row masks, piece, queue...),
+     * no copy involved
+     * @return the hot state of this engine
+     */
+    const TetrisEngineState &getState() const {
+        return this->state;
+    }
+
+    /**
+     * Capture the entire state of the engine (playfield, falling piece, hold, NEXT queue, RNG,
+     * combo, timers and lock state) into a flat, trivially copyable blob.
+     *
+     * @apiNote Tasks scheduled with scheduleDelayedTask() are not captured
+     * @return the snapshot, safe to memcpy or write to disk
+     */
+    TetrisEngineState saveState() const;
+
+    /**
+     * Restore a snapshot previously taken by saveState(), the game continues
+     * exactly from the tick it was taken at (practice undo, crash-resume...)
+     *
+     * @apiNote The tick counter is restored too, tasks that were scheduled with
+     * scheduleDelayedTask() stay keyed on their original tick
+     *
+     * @param state the snapshot to restore
+     * @throws invalid_argument if the snapshot was made by an incompatible build, is corrupt (a
+     * piece, rotation or queue out of range, a falling piece that doesn't fit), or the piece
+     * generator can't take its state back (a generator without snapshot support, a bad RNG or bag)
+     * @throws logic_error if this instance has been stopped
+     */
+    void restoreState(const TetrisEngineState& state);
+
     /**
      * Resets the playfield of this instance (matrix).
      * The Hold piece and Next queue are left intact, preserving their state.
@@ -493,7 +626,11 @@ public:
      * @apiNote Use with caution.
      */
     void resetPlayfield() {
-        playfield.assign(10, std::vector<int>(40, 0));
+        if (this->cold->recorder) this->recordEvent(REPLAY_RESET_PLAYFIELD);
+        fill(begin(state.rows), end(state.rows), 0);
+        fill(begin(state.rowColors), end(state.rowColors), 0);
+        this->markRowsDirty(Bitboard::ALL_ROWS);
+        this->refreshFallingPieceRows(); // the ghost fell to the floor
     }
 
     /**
@@ -506,8 +643,6 @@ public:
 	 */
     void raiseGarbage(int height, int holeIndex);
 
-private: mutable vector<vector<int> > clonedPlayfield;
-public:
     /**
      * Returns a copy of the current playfield with the falling piece, if any,
      * merged into it. The cloned playfield includes the type of the falling
@@ -538,8 +673,8 @@ public:
      * @return true if has a mino at that position, or, out of bounds
      */
     bool hasMinoAt(const int x, const int y) const {
-        return (x < 0 || y < 0 || x >= playfield.size() || y >= this->playfield[0].size()) ||
-               (this->playfield[x][y] > 0);
+        return (x < 0 || y < 0 || x >= Bitboard::WIDTH || y >= Bitboard::HEIGHT) ||
+               ((this->state.rows[y] >> x) & 1);
     }
 
     /**
@@ -547,10 +682,7 @@ public:
      * @return true if empty (no minoes)
      */
     bool isRowEmpty(const int rowIndex) const {
-        for (auto &x: this->playfield) {
-            if (x[rowIndex] != 0) return false;
-        }
-        return true;
+        return this->state.rows[rowIndex] == 0;
     }
 
     /******************** INTERNAL IMPLEMENTATION OF THE TETRIS ENGINE ********************/
@@ -564,57 +696,90 @@ private:
     // on user hold
     void onUserHold();
 
-    // on mino placed (called from Tetromino)
-    void onMinoLocked(Tetromino *locked);
-
-    // ID of the scheduled task that locks a piece after it lands
-    LONG pieceLockTaskId = -1;
+    // on mino placed (called from lockIn())
+    void onMinoLocked();
 
-    // counter to track how many manipulations (moves/rotations) have been made
-    mutable int manipulationCount = 0;
+    // locks the falling piece if its lock delay has expired
+    void processPieceLock();
 
     // called when a piece is manipulated (rotated, moved by the player)
     void onPieceManipulation();
 
-    // accumulated cell move
-    double cellMoved = 0.0;
+    // applies the queued inputs, in timestamp order
+    void processInputQueue();
+
+    // applies one input, the same way the public methods do
+    void applyInput(EngineInput input);
+
+    // hands an outside change to the recorder, with the tick and phase it happened at
+    void recordEvent(uint8_t type, int a = 0, int b = 0);
+
+    // applies the buffered IHS/IRS/tap to the piece that just spawned
+    void applyInitialActions();
+
+    // shared by leftKeyToggle() and rightKeyToggle(), direction: -1 = left, 1 = right
+    void shiftKeyToggle(int direction, bool held);
+
+    // this runs on each tick and handles DAS/ARR for the held side
+    void processAutoShift();
 
     // this runs on each tick and simulates the effect of gravity on the piece
     void moveCellOnGameGravity();
 
     // row manipulation
-    // nullify a row by setting all of its cells to empty (0)
+    // nullify the rows (bit Y = row Y) by setting all of their cells to empty (0)
     // this creates the "line-disappear" effect
-    void nullifyRow(const int rowIndex) {
-        // makes an animation to "wipe" the line (this should not be included in
-        // the base engine, this is for university project only)
-        for (int x = 0; x < 10; ++x) {
-            int minoDelay;
-            if ((minoDelay = lineClearsDelay / 10) <= 1) {
-                this->playfield[x][rowIndex] = 0;
+    void nullifyRows(const uint64_t rowsMask) {
+        this->state.clearedRowsMask = rowsMask;
+        this->state.lineWipeStartTick = state.ticksPassed;
+        this->advanceLineWipe();
+    }
+
+    // makes an animation to "wipe" the lines (this should not be included in
+    // the base engine, this is for university project only)
+    // column X is wiped X * (lineClearsDelay / 10) ticks after the lock
+    void advanceLineWipe() {
+        if (state.lineWipeStartTick == -1) return;
+        const int minoDelay = lineClearsDelay / 10;
+        bool wiped = true;
+        for (int x = 0; x < Bitboard::WIDTH; ++x) {
+            // only play animation if the time budget is > 1 frames
+            if (minoDelay > 1 && state.ticksPassed < state.lineWipeStartTick + x * minoDelay) {
+                wiped = false;
                 continue;
             }
-            // only play animation if the time budget is > 1 frames
-            scheduleDelayedTask(x * minoDelay, [this, rowIndex, x]() {
-               this->playfield[x][rowIndex] = 0;
-            });
-        }
-    }
-
-    // clear the row by shifting down all rows above it by one
-    void clearRow(const int rowIndex) {
-        for (int y = rowIndex; y > 0; --y) {
-            for (auto &x: this->playfield) {
-                x[y] = x[y - 1]; // drag the block ABOVE it down, replacing itself
+            for (int y = 0; y < Bitboard::HEIGHT; ++y) {
+                if ((state.clearedRowsMask >> y) & 1) this->state.setCell(x, y, 0);
             }
         }
+        this->markRowsDirty(state.clearedRowsMask);
+        if (wiped) this->state.lineWipeStartTick = -1;
     }
 
     // this will run whenever a piece is locked in the playfield
-    void updatePlayfieldState(Tetromino *locked);
+    void updatePlayfieldState();
 
     // internal function
-    void updatePlayFieldLineClears(const vector<int> &clearedLines);
+    void updatePlayFieldLineClears(uint64_t rowsMask);
+
+    /**
+     * Appends an ordinal to the end of the NEXT queue
+     */
+    void pushToNextQueue(const int ordinal) {
+        if (state.nextQueueSize >= STATE_MAX_NEXT_QUEUE) return; // never happens, the queue is kept at 7
+        state.nextQueue[state.nextQueueSize++] = static_cast<int8_t>(ordinal);
+    }
+
+    /**
+     * Removes the first piece of the NEXT queue
+     * @return its ordinal
+     */
+    int popNextQueue() {
+        const int front = state.nextQueue[0];
+        move(state.nextQueue + 1, state.nextQueue + state.nextQueueSize, state.nextQueue);
+        --state.nextQueueSize;
+        return front;
+    }
 
     /**
 	 * Appends a new piece generated by the piece generator to the next queue.
@@ -623,8 +788,8 @@ private:
         // Adds the next piece to the NEXT queue, ensuring that the queue contains
         // at least the total number of available tetromino types.
         do {
-            this->nextQueue.push(this->pieceGenerator->next());
-        } while (this->nextQueue.size() < MinoType::valuesLength);
+            this->pushToNextQueue(this->pieceGenerator->next()->ordinal);
+        } while (this->state.nextQueueSize < MinoType::valuesLength);
     }
 
     /**
@@ -638,181 +803,67 @@ private:
 
     /**
      * Spawn a Tetromino in the playfield, movable by the player
-     * @param type
+     * @param type the ordinal of the piece
      */
-    void putPieceInPlayfield(MinoTypeEnum* type);
+    void putPieceInPlayfield(int type);
 
     /**
 	 * Start the game loop
 	 */
     void gameLoopStart(bool useCurrentThread);
 
-public:
-    /**
-     * @caution DO NOT USE, UNLESS YOU KNOW WHAT YOU ARE DOING!
-     * @returns FALSE if halted
-     */
-    bool gameLoopBody();
-
-private:
-    /**
-     * Memory management bullshit, don't use
-     */
-    vector<Tetromino *> deletionQueue; // queue to delete objects when they're out of scope
-    /**
-     * Mark current falling piece as null, the object is deleted only after
-     * <code>freeMemoryOfFallingPiece()</code> is called
-     */
-    void markFallingPieceAsNull();
-
+    /******************** THE FALLING PIECE ********************/
     /**
-     * Should only be called when it is CRUCIAL to free
-     * the memory occupied by <code>this->deletionQueue</code>
+     * @return true if a piece is falling
      */
-    void freeMemoryOfFallingPiece();
-
-public:
-    /**
-     * Start the Tetris Engine, beginning to accept user inputs
-    */
-    void start(bool useCurrentThread = true) {
-        this->gameLoopStart(useCurrentThread);
+    bool hasFallingPiece() const {
+        return this->state.fallingType >= 0;
     }
 
     /**
-     * Enables or disables the spawning of the next game piece.
-     *
-     * This method controls whether the game should continue spawning new pieces
-     * Setting the parameter to true allows the game to proceed normally
-     * Setting it to false pauses the game by preventing new pieces from spawning
-     * (will not despawn the current piece)
-     *
-     * @param interrupt true to temporarily pause piece spawning
+     * Mark current falling piece as null (no piece is falling)
      */
-    void gameInterrupt(bool interrupt) {
-        this->interrupted = interrupt;
+    void markFallingPieceAsNull() {
+        this->state.fallingType = -1;
+        this->refreshFallingPieceRows();
     }
 
-public:
     /**
-     * Internal debugging bullshit, dont use
-     * REMOVED
+     * Flags rows as changed, for getDirtyRows() and the board buffer
+     * @param rowsMask bit Y = row Y
      */
-    [[deprecated("debug")]] void printBoard() const;
-};
-
-/**
- * Representation of a falling Tetromino
- */
-class Tetromino {
-public:
-    int x = 0, y = 0; // Current coordinates of the top-left corner of the Tetromino on the playfield grid.
-
-    MinoTypeEnum* type = nullptr; // The type of Tetromino (e.g., T_MINO, Z_MINO, L_MINO) being represented.
-
-    int rotationState = 0; // 0, R, 2, L represented as 0, 1, 2, 3
-    int size; // The size of the Tetromino's bounding box (usually 3x3).
-
-    int lastActionDone = 0; // 0 = nothing, 1 = move left, 2 = move right, 3 = cw, 4 = ccw
-
-    // link the parent to this
-    TetrisEngine* parent;
-
-    explicit Tetromino(TetrisEngine* parent, MinoTypeEnum* type) : type() {
-        this->parent = parent;
-        this->type = type;
-        // the size of this tetromino bounding box, ranging from 2 (O piece) to 4 (I piece)
-        this->size = static_cast<int>(type->getStruct(0).size());
-        parent->manipulationCount = 0; // new piece, 0 manipulation
+    void markRowsDirty(const uint64_t rowsMask) {
+        this->dirtyRows |= rowsMask;
+        this->staleBufferRows |= rowsMask;
+        this->unhashedRows |= rowsMask;
     }
 
-    ~Tetromino() = default;
-
     /**
-     * Gets the matrix structure of this tetromino in the current rotation state.
-     *
-     * @return a 2D array representing the current structure of the tetromino
+     * Must be called whenever the falling piece (or its ghost) may have moved:
+     * the rows it left and the rows it now covers become dirty
      */
-    [[nodiscard]] const vector<vector<int> > &getStruct() const {
-        return type->getStruct(rotationState);
-    }
-
-    /**
-    * Checks if this tetromino occupies the specified x, y position on the board.
-     *
-    * @deprecated In favor of getRelativeMinoCoordinates()
-    *
-    * @param x the x-coordinate on the board
-    * @param y the y-coordinate on the board
-    * @return true if the tetromino occupies the specified coordinates, false otherwise
-    */
-    [[maybe_unused]] [[nodiscard]] bool occupyAt(const int x, const int y) const {
-        if (this->x <= x && x < this->x + size // b1 <= x < b1 + size_t
-            && this->y <= y && y < this->y + size) {
-            // b1 <= y < b1 + size_t
-            return getStruct()[y - this->y][x - this->x] >= 1;
+    void refreshFallingPieceRows() {
+        uint64_t rows = 0;
+        if (hasFallingPiece()) {
+            rows = Bitboard::pieceRows(state.fallingType, state.fallingRotation, state.fallingY);
+            if (showGhostPiece) rows |= Bitboard::pieceRows(state.fallingType, state.fallingRotation, getGhostPieceY());
         }
-        return false;
+        this->markRowsDirty(this->fallingPieceRows | rows);
+        this->fallingPieceRows = rows;
     }
 
     /**
-    * Gets the relative positions of each mino of this tetromino.
-    *
-    * @return a 2D array representing the x, y coordinates of each mino relative to the board
-    */
-    [[nodiscard]] vector<vector<int> > getRelativeMinoCoordinates() const {
-        return this->getRelativeMinoCoordinates(this->x, this->y);
-    }
-
-    /**
-     * Gets the relative positions of each mino of this tetromino from a specified offset.
-     *
-     * @param x the x-coordinate offset
-     * @param y the y-coordinate offset
-     * @return a 2D array representing the x, y coordinates of each mino relative to the board with the specified offset
-     */
-    [[nodiscard]] vector<vector<int> > getRelativeMinoCoordinates(const int x, const int y) const {
-        const auto &minoStruct = this->getStruct(); // the structure of this mino with the rotation state applied
-        // a Mino can have as many "minoes" inside them as you want, each has an x, y coordinate pair
-        vector<vector<int> > relative;
-        relative.reserve(type->blockCount);
-
-        for (int ry = 0; ry < minoStruct.size(); ry++) {
-            for (int rx = 0; rx < minoStruct[ry].size(); rx++) {
-                if (const int mx = minoStruct[ry][rx]; mx != 0) {
-                    // skip empty spaces (0s)
-                    relative.push_back({x + rx, y + ry}); // add transformed coordinates
-                }
-            }
-        }
-        return relative;
-    }
-
-    /**
-    * Checks if the tetromino can fit at the specified position on the board.
+    * Checks if the falling piece can fit at the specified position on the board,
+    * in the current rotation state.
     *
     * @param ax the x-coordinate where the tetromino is to be placed
     * @param ay the y-coordinate where the tetromino is to be placed
     * @return true if the tetromino can fit, false otherwise
     */
-    [[nodiscard]] bool canFitBeingAt(const int ax, const int ay) const {
-        for (const auto &xyPair: getRelativeMinoCoordinates(ax, ay)) {
-            const int x = xyPair[0], y = xyPair[1];
-            // Check if the mino is out of bounds or collides with another mino
-            if (parent->hasMinoAt(x, y)) {
-                return false;
-            }
-        }
-        return true;
+    bool canFitBeingAt(const int ax, const int ay) const {
+        return Bitboard::fits(state.rows, state.fallingType, state.fallingRotation, ax, ay);
     }
 
-    static constexpr int R = 1; // right
-    static constexpr int L = 3; // left
-    // compass for rotation
-    //      [0]
-    // [3]  rot  [1]
-    //      [2]
-
     /**
      * Gets the kick sequence based on the initial and target rotation states.
      *
@@ -823,138 +874,43 @@ public:
      * @param finalState the target state
      * @return kick sequence
      */
-    [[nodiscard]] vector<vector<int> > getKickSequenceCheck(const int initialState, const int finalState) const {
-        // if SRS is not enabled, ignore the kick sequence, only allow basic rotation
-        if (!parent->useSRS || type->ordinal == MinoType::O_MINO.ordinal) {
-            // O Tetromino does not kick (how do u rotate an O)
-            return {{0, 0}};
-        }
-
-        int index;
-        // get which set of kick data to use based on the initial and final state
-        if (initialState == 0 && finalState == R) index = 0;
-        else if (initialState == R && finalState == 0) index = 1;
-        else if (initialState == R && finalState == 2) index = 2;
-        else if (initialState == 2 && finalState == R) index = 3;
-        else if (initialState == 2 && finalState == L) index = 4;
-        else if (initialState == L && finalState == 2) index = 5;
-        else if (initialState == L && finalState == 0) index = 6;
-        else if (initialState == 0 && finalState == L) index = 7;
-        else index = -1;
-
-        // I-pieces use a different kick table because they're longer
-        return (type->ordinal == MinoType::I_MINO.ordinal ? I_KICK_TABLE : OTHERS_KICK_TABLE)[index];
-    }
+    SRS::KickSequence getKickSequenceCheck(int initialState, int finalState) const;
 
     /**
-    * Rotates the tetromino.
+    * Rotates the falling piece.
     *
     * If a rotation is not possible due to a collision, the function tries applying a kick.
     * If none of the kicks succeed, the rotation is reverted.
     *
     * @param ccw true if the rotation is counter-clockwise, false if clockwise
     */
-    void rotate(const bool ccw) {
-        // store the variables to reverse the changes when needed
-        const int initialRotation = this->rotationState;
-
-        // update the rotation state (range 0-3)
-        this->rotationState = (initialRotation + (ccw ? -1 : 1) + 4) % 4;
-
-        // kick sequence based on initial and target rotation states
-        auto kickSequence = this->getKickSequenceCheck(initialRotation, this->rotationState);
-
-        bool validMove = false; // if any kick results in a valid move
-
-        int kickUsed = -1;
-        // try each kick offset in the sequence
-        for (vector<int> kick: kickSequence) {
-            // "kick" the tetromino to the new position
-            const int testingX = this->x + kick[0];
-            const int testingY = this->y - kick[1]; // the board is upside down, so i subtract instead of add bruh, index wise
-
-            // increment the kick identifier
-            ++kickUsed;
-
-            // this will return false if the tetromino won't fit
-            if (canFitBeingAt(testingX, testingY)) {
-                // set the new position
-                this->x = testingX;
-                this->y = testingY;
-                validMove = true; // A valid kick has been found
-                break; // Exit the loop as the rotation succeeded
-            }
-        }
-
-        // If no valid move was found, revert to the initial position
-        if (!validMove) {
-            this->rotationState = initialRotation;
-        } else {
-            // if the kick used is NOT 0 (initial kick), then it was a valid "kick"
-            parent->lastSpinKickUsed = kickUsed;
-            // the kick offset used (this will be used for T-Spin detection)
-            parent->lastKickPositionUsed = kickSequence[kickUsed];
-
-            // a successful move
-            parent->onPieceManipulation();
-            // last action of this piece
-            this->lastActionDone = ccw ? CCW_ROTATION : CW_ROTATION;
-
-            // invalidate the ghost piece cache, forcing a recalculation
-            this->invalidateGhostPieceCache();
-
-            // only in SDL
-            SysAudio::playSoundAsync(ROTATE_AUD, SysAudio::getSFXVolume(), false);
-        }
-    }
+    void rotatePiece(bool ccw);
 
     /**
-    * Locks the tetromino in place, overriding the occupied playfield
+    * Locks the falling piece in place, overriding the occupied playfield
     * positions
     */
-    void lockIn() {
-        for (vector<int>& minoPosition : getRelativeMinoCoordinates()) {
-            // get the position relative to the playfield and set the cell
-            // to this tetromino color (type). This step is very important
-            // because the color presents itself as the "presence" of a piece (color > 0 == present)
-            parent->playfield[minoPosition[0]][minoPosition[1]] = type->ordinal + 1;
-        }
-        parent->manipulationCount = 0; // reset everything all over
-        parent->onMinoLocked(this); // fire the event
-    }
+    void lockIn();
 
     /**
-     * Yank the piece to the bottom of the stack
+     * Yank the falling piece to the bottom of the stack
      */
-    void hardDrop() {
-        do {
-        } while (translateDown());
-        this->lockIn();
-        // only in SDL
-        SysAudio::playSoundAsync(HARD_DROP_AUD, SysAudio::getSFXVolume(), false);
-    }
+    void hardDropPiece();
 
     /**
      * Translate left or right by 1 cell
      * @param left the side to translate to
      * @return true if can move, false if not
      */
-    bool translateHorizontally(const bool left) {
-        if (!this->canFitBeingAt(x + (left ? -1 : 1), y)) return false;
-
-        this->x += left ? -1 : 1;
-        parent->onPieceManipulation();
-
-        // last action of this piece, 1 = left, 2 = right movement
-        this->lastActionDone = left ? MOVE_LEFT : MOVE_RIGHT;
+    bool translateHorizontally(bool left);
 
-        // invalidate the ghost piece cache, forcing a recalculation (ghost pieces do not care about Y)
-        this->invalidateGhostPieceCache();
-
-        // only in SDL
-        SysAudio::playSoundAsync(TETRO_MOVE_AUD, SysAudio::getSFXVolume(), false);
-        return true;
-    }
+    /**
+     * Translate left or right as far as the piece can go, in one single
+     * manipulation (this is ARR = 0)
+     * @param left the side to translate to
+     * @return true if moved at least 1 cell, false if not
+     */
+    bool shiftToWall(bool left);
 
     /**
      * Translate down 1 cell
@@ -962,7 +918,7 @@ public:
      */
     bool translateDown() {
         if (onGround()) return false;
-        ++this->y; // this feels cursed right? the board is upside down, so live with it
+        ++this->state.fallingY; // this feels cursed right? the board is upside down, so live with it
         return true;
     }
 
@@ -972,34 +928,66 @@ public:
      * @return True if the piece cannot fit one unit down, indicating it is on the ground;
      *         otherwise, returns false.
      */
-    [[nodiscard]] bool onGround() const {
-        return !this->canFitBeingAt(x, y + 1);
+    bool onGround() const {
+        return !this->canFitBeingAt(state.fallingX, state.fallingY + 1);
     }
 
-    vector<vector<int> > cachedGhostPiecePosition;
-
     /**
-     * Calculates the position of the ghost piece for the current tetromino.
-     * @apiNote The ghost piece will only be re-calculated during movement along the X-axis
-     *
-     * @return a 2D array of [x, y] coordinates representing the position of the ghost piece's minos
+     * Calculates the y-position the falling piece would land at (the ghost piece)
      */
-    vector<vector<int> > getGhostPiecePosition() {
-        if (!cachedGhostPiecePosition.empty()) return this->cachedGhostPiecePosition;
-        int ghostY = this->y; // Start with the current y position of the tetromino
+    int getGhostPieceY() const {
+        int ghostY = state.fallingY; // Start with the current y position of the tetromino
         // keep moving the ghost down until it can't move any further
-        while (canFitBeingAt(this->x, ghostY + 1)) {
+        while (canFitBeingAt(state.fallingX, ghostY + 1)) {
             ghostY++;
         }
-        return cachedGhostPiecePosition = this->getRelativeMinoCoordinates(this->x, ghostY);
+        return ghostY;
     }
 
+public:
     /**
-     * Invalidate the ghost piece cache, forcing a recalc
+     * Runs exactly one tick of the game (spawn, inputs, gravity, timers, callbacks),
+     * without sleeping. This is what headless simulations should drive.
+     *
+     * @returns FALSE if halted
      */
-    void invalidateGhostPieceCache() {
-        this->cachedGhostPiecePosition.clear();
+    bool tick();
+
+    /**
+     * @caution DO NOT USE, UNLESS YOU KNOW WHAT YOU ARE DOING!
+     * Runs one tick, then sleeps the rest of the tick interval (60 TPS cap)
+     * @returns FALSE if halted
+     */
+    bool gameLoopBody();
+
+    /**
+     * Start the Tetris Engine, beginning to accept user inputs
+    */
+    void start(bool useCurrentThread = true) {
+        this->gameLoopStart(useCurrentThread);
     }
+
+    /**
+     * Enables or disables the spawning of the next game piece.
+     *
+     * This method controls whether the game should continue spawning new pieces
+     * Setting the parameter to true allows the game to proceed normally
+     * Setting it to false pauses the game by preventing new pieces from spawning
+     * (will not despawn the current piece)
+     *
+     * @param interrupt true to temporarily pause piece spawning
+     */
+    void gameInterrupt(bool interrupt) {
+        if (this->cold->recorder) this->recordEvent(REPLAY_INTERRUPT, interrupt);
+        this->state.interrupted = interrupt;
+    }
+
+public:
+    /**
+     * Internal debugging bullshit, dont use
+     * REMOVED
+     */
+    [[deprecated("debug")]] void printBoard() const;
 };
 
 #endif //TETRIS_ENGINE_CPP
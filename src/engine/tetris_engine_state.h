@@ -0,0 +1,107 @@
+#ifndef TETISENGINE_TETRIS_ENGINE_STATE_H
+#define TETISENGINE_TETRIS_ENGINE_STATE_H
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include "tetromino_gen_blueprint.h"
+#include "bitboard.h"
+
+// bump this whenever the layout below changes, so old blobs on disk are rejected
+static constexpr uint32_t TETRIS_ENGINE_STATE_VERSION = 8;
+
+// the NEXT queue never grows past this (the engine keeps it at valuesLength)
+static constexpr int STATE_MAX_NEXT_QUEUE = 16;
+
+/**
+ * The gameplay state of a TetrisEngine: everything it needs to continue a game from a
+ * given tick (playfield, pieces, timers, key states...)
+ *
+ * This is the hot part of the engine, it lives inline in TetrisEngine as one cache-aligned
+ * block and a tick never leaves it (callbacks, config and user tasks live in the cold part).
+ * A snapshot is a plain copy of it.
+ *
+ * @apiNote Tasks scheduled by the user through scheduleDelayedTask() are NOT
+ * part of the snapshot, they are closures owned by whoever scheduled them.
+ * The generator is owned by the user too, it is only copied in by saveState().
+ * The blob is only meant to be read back by the same build (see version)
+ */
+struct alignas(64) TetrisEngineState {
+    uint32_t version = TETRIS_ENGINE_STATE_VERSION;
+
+    // the 10x40 matrix, y = 0 is the top. Nibble X of rowColors[Y] is the color of the cell
+    // (0 = air, ordinal + 1, or GARBAGE_MINO_CONVENTION), bit X of rows[Y] is set if it is occupied
+    uint64_t rowColors[Bitboard::HEIGHT] = {};
+    uint16_t rows[Bitboard::HEIGHT] = {};
+
+    // the falling piece (type -1 = no falling piece)
+    int8_t fallingType = -1;
+    int8_t fallingX = 0, fallingY = 0;
+    int8_t fallingRotation = 0;
+    int8_t fallingLastAction = 0;
+
+    // hold and next queue (ordinals, -1 = none)
+    int8_t holdType = -1;
+    bool canHold = true;
+    int8_t nextQueue[STATE_MAX_NEXT_QUEUE] = {};
+    int8_t nextQueueSize = 0;
+
+    // the piece generator (RNG + current bag), only filled in by TetrisEngine::saveState()
+    TetrominoGeneratorState generator;
+
+    // spin, combo & back-to-back tracking
+    int32_t comboCount = -1;
+    bool backToBack = false; // the last clear was a difficult one (see SRS::isDifficultClear)
+    int32_t lastSpinKickUsed = 0;
+    int8_t lastKickPositionUsed[2] = {0, 0};
+
+    // timers
+    int64_t ticksPassed = 0;
+    int64_t cellMoved = 0; // subcells
+
+    // input key states (DAS/ARR/soft drop)
+    bool softDropHeld = false;
+    bool leftHeld = false;
+    bool rightHeld = false;
+    int8_t shiftDirection = 0;
+    int32_t dasCharge = 0;
+    int32_t arrCharge = 0;
+
+    // lock state
+    int64_t pieceLockTick = -1;
+    int32_t manipulationCount = 0;
+
+    // line clear delay
+    bool clearDelayActive = false;
+    int64_t lineClearTick = -1;
+    int64_t lineWipeStartTick = -1;
+    uint64_t clearedRowsMask = 0;
+
+    // the initial actions (IRS/IHS) buffered for the next spawn
+    int8_t irsRotation = 0;
+    bool ihsRequested = false;
+    int8_t initialShift = 0;
+
+    // flags
+    bool interrupted = false;
+    bool shouldTopOut = false;
+
+    /**
+     * @return the color of the cell at x, y (0 = air)
+     */
+    int cellAt(const int x, const int y) const {
+        return static_cast<int>((rowColors[y] >> (x * 4)) & 0xF);
+    }
+
+    /**
+     * Sets the color of the cell at x, y, keeping the row mask in sync (0 = air)
+     */
+    void setCell(const int x, const int y, const int color) {
+        rowColors[y] = (rowColors[y] & ~(0xFULL << (x * 4))) | (static_cast<uint64_t>(color & 0xF) << (x * 4));
+        if (color != 0) rows[y] |= static_cast<uint16_t>(1 << x);
+        else rows[y] &= static_cast<uint16_t>(~(1 << x));
+    }
+};
+
+static_assert(std::is_trivially_copyable<TetrisEngineState>::value, "TetrisEngineState must stay a POD blob");
+
+#endif //TETISENGINE_TETRIS_ENGINE_STATE_H
@@ -5,8 +5,20 @@
 #ifndef TETISENGINE_TETROMINO_GEN_BLUEPRINT_H
 #define TETISENGINE_TETROMINO_GEN_BLUEPRINT_H
 #pragma once
+#include <cstdint>
 #include "tetrominoes.h"
 
+/**
+ * Flat (trivially copyable) copy of a generator's internal state,
+ * used by the engine snapshot
+ */
+struct TetrominoGeneratorState {
+    int64_t rngState = 0; // the raw seed/state of the RNG
+    int8_t bag[MinoType::valuesLength] = {}; // ordinals left in the current bag
+    int8_t bagSize = 0;
+    bool saved = false; // false if the generator has no snapshot support (see TetrisEngine::restoreState())
+};
+
 /**
  * Represents a generator for Tetrominoes.
  */
@@ -24,6 +36,25 @@ public:
      */
     [[nodiscard]] virtual MinoTypeEnum* next() = 0;
 
+    /**
+     * Copy the internal state of this generator into a flat struct
+     * @param out the state to write into
+     * @return false if this generator does not support snapshots
+     */
+    virtual bool saveState(TetrominoGeneratorState&) const {
+        return false;
+    }
+
+    /**
+     * Restore a state previously written by saveState()
+     * @param in the state to restore
+     * @return false if this generator does not support snapshots, or the state is not one it
+     * could have written (nothing is changed then)
+     */
+    virtual bool restoreState(const TetrominoGeneratorState&) {
+        return false;
+    }
+
     virtual ~TetrominoGenerator() = default;
 };
 
@@ -50,4 +50,13 @@ namespace MinoType {
     MinoTypeEnum J_MINO("J_MINO", {{1, 0, 0}, {1, 1, 1}, {0, 0, 0}}, RenderMatrixMino::J_PIECE, 4);
     MinoTypeEnum I_MINO("I_MINO", {{0, 0, 0, 0}, {1, 1, 1, 1}, {0, 0, 0, 0}, {0, 0, 0, 0}}, RenderMatrixMino::I_PIECE, 5);
     MinoTypeEnum O_MINO("O_MINO", {{1, 1}, {1, 1}}, RenderMatrixMino::O_PIECE, 6);
-}
\ No newline at end of file
+
+    MinoTypeEnum* fromOrdinal(const int ordinal) {
+        // same order as the ordinals above
+        static MinoTypeEnum* VALUES[valuesLength] = {
+                &T_MINO, &Z_MINO, &S_MINO, &L_MINO, &J_MINO, &I_MINO, &O_MINO
+        };
+        if (ordinal < 0 || ordinal >= valuesLength) return nullptr;
+        return VALUES[ordinal];
+    }
+}
@@ -32,6 +32,13 @@ namespace MinoType {
     extern MinoTypeEnum I_MINO;
     extern MinoTypeEnum O_MINO;
     inline constexpr int valuesLength = 7;
+
+    /**
+     * Replicate of Java's values()[ordinal]
+     * @param ordinal the ordinal of the enum
+     * @return the matching enum, nullptr if out of range
+     */
+    MinoTypeEnum* fromOrdinal(int ordinal);
 }
 
 class MinoTypeEnum {
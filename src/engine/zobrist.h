@@ -0,0 +1,62 @@
+#ifndef TETISENGINE_ZOBRIST_H
+#define TETISENGINE_ZOBRIST_H
+#pragma once
+#include <cstdint>
+#include "bitboard.h"
+
+/**
+ * 64-bit Zobrist hashing of a game position: the playfield, the piece to place, HOLD,
+ * canHold, back-to-back and combo.
+ *
+ * The board part is a XOR of one key per (row, row mask) pair instead of one per cell, so a
+ * changed row costs one key and the keys need no table (they are mixed on the fly). An empty
+ * row has key 0: only the stack is hashed.
+ * The engine (TetrisEngine::getZobristHash()) and the bots share these, so a hash means the
+ * same thing everywhere (as long as they run the same build)
+ */
+namespace Zobrist {
+    // splitmix64 finalizer
+    constexpr uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    /**
+     * @return the key of row y holding these cells (0 if the row is empty)
+     */
+    constexpr uint64_t rowKey(const int y, const uint16_t row) {
+        return row == 0 ? 0 : mix((static_cast<uint64_t>(y) << 16) | row);
+    }
+
+    /**
+     * @param rows the playfield, Bitboard::HEIGHT row masks
+     * @return the board part of the hash
+     */
+    inline uint64_t boardHash(const uint16_t *rows) {
+        uint64_t hash = 0;
+        for (int y = 0; y < Bitboard::HEIGHT; ++y) hash ^= rowKey(y, rows[y]);
+        return hash;
+    }
+
+    /**
+     * The part of the hash that is not the board, XOR it with boardHash()
+     *
+     * @param pieceType the piece to place (-1 = none)
+     * @param holdType  the held piece (-1 = none)
+     * @param combo     the combo counter, -1 = no combo (everything past 254 looks the same)
+     */
+    constexpr uint64_t stateKey(const int pieceType, const int holdType, const bool canHold, const bool backToBack,
+                                const int combo) {
+        const uint64_t comboKey = combo < -1 ? 0 : combo > 254 ? 255 : combo + 1;
+        return mix((1ULL << 40)
+                   | static_cast<uint64_t>(pieceType + 1)
+                   | (static_cast<uint64_t>(holdType + 1) << 4)
+                   | (static_cast<uint64_t>(canHold) << 8)
+                   | (static_cast<uint64_t>(backToBack) << 9)
+                   | (comboKey << 10));
+    }
+}
+
+#endif //TETISENGINE_ZOBRIST_H
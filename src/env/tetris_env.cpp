@@ -0,0 +1,286 @@
+#include "tetris_env.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "../engine/bitboard.h"
+#include "../engine/attack_rules.h"
+#include "../engine/zobrist.h"
+#include "../bot/move_generator.h"
+#include "../bot/thread_pool.h"
+#include "../engine/javalibs/jsystemstd.h" // bag_generator.h needs System
+#include "../process/bag_generator.h"
+
+namespace {
+    constexpr int QUEUE = 1 + TETRIS_ENV_NEXT; // the current piece, then the NEXT queue
+    constexpr int FIRST_ROW = Bitboard::HEIGHT - TETRIS_ENV_ROWS; // the top row of the observation
+    constexpr int GARBAGE_ENTRIES = 8; // attacks queued one by one, the rest piles on the last one
+    constexpr int CHUNK = 16; // games per parallelFor item
+
+    static_assert(TETRIS_ENV_OBS_GARBAGE < TETRIS_ENV_OBS_MASK, "the observation fields overlap");
+    static_assert(TETRIS_ENV_OBS_SIZE % 16 == 0, "every game starts on a 16-byte boundary");
+
+    // the leftmost column a placement fills
+    int leftColumn(const int type, const Placement &placement) {
+        const Bitboard::PieceShape &shape = Bitboard::SHAPES.shapes[type][placement.rotation];
+        int column = Bitboard::WIDTH;
+        for (int r = 0; r < shape.size; ++r) {
+            if (shape.rows[r] != 0) column = std::min(column, placement.x + __builtin_ctz(shape.rows[r]));
+        }
+        return column;
+    }
+}
+
+// one game per index, the fields side by side (structure of arrays): a chunk of games is a
+// contiguous slice of every array
+struct TetrisEnv {
+    TetrisEnvConfig config{};
+    MoveGenerator generator;
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<std::vector<Placement>> scratch; // per worker
+
+    std::vector<uint16_t> rows; // count * Bitboard::HEIGHT
+    std::vector<int8_t> queue; // count * QUEUE
+    std::vector<int8_t> hold;
+    std::vector<int32_t> combo; // the engine's counter, -1 = none
+    std::vector<int32_t> backToBack; // the chain of AttackRules
+    std::vector<int32_t> placed;
+    std::vector<uint32_t> games; // games started in the slot, picks the seed of the next one
+    std::vector<int16_t> garbage; // count * GARBAGE_ENTRIES
+    std::vector<uint8_t> garbageSize;
+    std::vector<uint64_t> garbageRng; // where the holes go
+    std::vector<Placement> targets; // count * TETRIS_ENV_ACTIONS, what each action locks
+    std::vector<uint8_t> legal; // count * TETRIS_ENV_ACTIONS
+    std::vector<std::unique_ptr<SevenBagGenerator>> bags;
+
+    explicit TetrisEnv(const TetrisEnvConfig &config) : config(config), generator(config.use_srs != 0) {
+        pool = std::make_unique<ThreadPool>(static_cast<unsigned>(config.threads));
+        scratch.resize(pool->size());
+        const size_t count = config.count;
+        rows.resize(count * Bitboard::HEIGHT);
+        queue.resize(count * QUEUE);
+        hold.resize(count);
+        combo.resize(count);
+        backToBack.resize(count);
+        placed.resize(count);
+        games.resize(count);
+        garbage.resize(count * GARBAGE_ENTRIES);
+        garbageSize.resize(count);
+        garbageRng.resize(count);
+        targets.resize(count * TETRIS_ENV_ACTIONS);
+        legal.resize(count * TETRIS_ENV_ACTIONS);
+        bags.resize(count);
+    }
+
+    // runs body(game, worker) over every game, a chunk per item
+    template<typename Body>
+    void forEachGame(const Body &body) {
+        const int chunks = (config.count + CHUNK - 1) / CHUNK;
+        pool->parallelFor(chunks, [&](const int chunk, const int worker) {
+            const int end = std::min(config.count, (chunk + 1) * CHUNK);
+            for (int game = chunk * CHUNK; game < end; ++game) body(game, worker);
+        });
+    }
+
+    void newGame(const int game, std::vector<Placement> &placements) {
+        const uint32_t seed = config.seed + static_cast<uint32_t>(game) +
+                              games[game]++ * static_cast<uint32_t>(config.count);
+        bags[game] = std::make_unique<SevenBagGenerator>(seed);
+        std::fill_n(&rows[game * Bitboard::HEIGHT], Bitboard::HEIGHT, 0);
+        for (int i = 0; i < QUEUE; ++i) queue[game * QUEUE + i] = static_cast<int8_t>(bags[game]->next()->ordinal);
+        hold[game] = -1;
+        combo[game] = -1;
+        backToBack[game] = 0;
+        placed[game] = 0;
+        garbageSize[game] = 0;
+        garbageRng[game] = Zobrist::mix(seed);
+        findActions(game, placements);
+    }
+
+    // the current piece is gone (placed or held), the queue moves up
+    void nextPiece(const int game) {
+        int8_t *pieces = &queue[game * QUEUE];
+        std::memmove(pieces, pieces + 1, QUEUE - 1);
+        pieces[QUEUE - 1] = static_cast<int8_t>(bags[game]->next()->ordinal);
+    }
+
+    /**
+     * Fills the action table of a game
+     * @return false if no piece fits anywhere (topped out)
+     */
+    bool findActions(const int game, std::vector<Placement> &placements) {
+        const uint16_t *board = &rows[game * Bitboard::HEIGHT];
+        Placement *target = &targets[game * TETRIS_ENV_ACTIONS];
+        uint8_t *mask = &legal[game * TETRIS_ENV_ACTIONS];
+        std::memset(mask, 0, TETRIS_ENV_ACTIONS);
+        const int8_t current = queue[game * QUEUE];
+        // the engine tops out when a piece can't spawn, HOLD or not
+        if (!Bitboard::fits(board, current, 0, Bitboard::spawnX(current), Bitboard::SPAWN_Y)) return false;
+        bool any = false;
+        for (int held = 0; held < 2; ++held) {
+            const int type = !held ? current : hold[game] >= 0 ? hold[game] : queue[game * QUEUE + 1];
+            if (!Bitboard::fits(board, type, 0, Bitboard::spawnX(type), Bitboard::SPAWN_Y)) continue;
+            generator.generate(board, type, placements);
+            for (const Placement &placement: placements) {
+                const int column = leftColumn(type, placement);
+                const int action = held * 40 + placement.rotation * TETRIS_ENV_COLUMNS + column;
+                // the lowest spot, with a spin if there is one for the same cells
+                const Placement &known = target[action];
+                if (mask[action] && (known.y > placement.y || (known.y == placement.y && known.spin >= placement.spin))) continue;
+                target[action] = placement;
+                mask[action] = 1;
+                any = true;
+            }
+        }
+        return any;
+    }
+
+    /**
+     * Plays an action in one game
+     * @return true if the game is over
+     */
+    bool play(const int game, int action, float &reward) {
+        const uint8_t *mask = &legal[game * TETRIS_ENV_ACTIONS];
+        if (action < 0 || action >= TETRIS_ENV_ACTIONS || !mask[action]) {
+            action = static_cast<int>(std::find(mask, mask + TETRIS_ENV_ACTIONS, 1) - mask);
+            if (action == TETRIS_ENV_ACTIONS) return true;
+        }
+        const Placement placement = targets[game * TETRIS_ENV_ACTIONS + action];
+
+        // HOLD the same way as the engine: an empty HOLD takes the piece, the next one comes out
+        int type = queue[game * QUEUE];
+        if (action >= 40) {
+            const int8_t held = hold[game];
+            hold[game] = static_cast<int8_t>(type);
+            if (held < 0) nextPiece(game);
+            type = held >= 0 ? held : queue[game * QUEUE];
+        }
+        nextPiece(game);
+
+        uint16_t *board = &rows[game * Bitboard::HEIGHT];
+        Bitboard::place(board, type, placement.rotation, placement.x, placement.y);
+        const uint64_t full = Bitboard::fullRows(board);
+        const int cleared = __builtin_popcountll(full);
+        bool perfectClear = true;
+        for (int y = 0; y < Bitboard::HEIGHT && perfectClear; ++y) perfectClear = board[y] == 0 || board[y] == Bitboard::FULL_ROW;
+        if (cleared > 0) Bitboard::clearRows(board, full);
+
+        // same bookkeeping as TetrisEngine::updatePlayfieldState() and the simulations
+        const bool spin = placement.spin == SRS::SPIN_FULL, mini = placement.spin == SRS::SPIN_MINI;
+        backToBack[game] = AttackRules::nextBackToBack(backToBack[game], cleared, spin, mini);
+        combo[game] = cleared > 0 ? combo[game] + 1 : -1;
+        // the engine only fires a playfield event for clears and spins, a plain lock sends nothing
+        int sent = cleared > 0 || spin || mini ? AttackRules::attack(cleared, spin, perfectClear, backToBack[game], combo[game]) : 0;
+        reward = static_cast<float>(sent);
+        ++placed[game];
+
+        // the attack cancels the garbage first, what's left of it rises when nothing clears
+        int16_t *waiting = &garbage[game * GARBAGE_ENTRIES];
+        uint8_t &size = garbageSize[game];
+        while (sent > 0 && size > 0) {
+            const int cancelled = std::min<int>(sent, waiting[0]);
+            sent -= cancelled;
+            waiting[0] = static_cast<int16_t>(waiting[0] - cancelled);
+            if (waiting[0] > 0) continue;
+            --size;
+            std::memmove(waiting, waiting + 1, size * sizeof(int16_t));
+        }
+        if (cleared == 0 && size > 0) {
+            const int lines = std::min<int>(waiting[0], Bitboard::HEIGHT);
+            --size;
+            std::memmove(waiting, waiting + 1, size * sizeof(int16_t));
+            for (int y = 0; y < lines; ++y) {
+                if (board[y] != 0) return true; // pushed out of the top
+            }
+            garbageRng[game] = Zobrist::mix(garbageRng[game]);
+            const int hole = static_cast<int>(garbageRng[game] % Bitboard::WIDTH);
+            std::memmove(board, board + lines, (Bitboard::HEIGHT - lines) * sizeof(uint16_t));
+            std::fill_n(board + Bitboard::HEIGHT - lines, lines, static_cast<uint16_t>(Bitboard::FULL_ROW & ~(1 << hole)));
+        }
+        return config.max_pieces > 0 && placed[game] >= config.max_pieces;
+    }
+
+    void observe(const int game, uint8_t *out) const {
+        std::memset(out, 0, TETRIS_ENV_OBS_SIZE);
+        const uint16_t *board = &rows[game * Bitboard::HEIGHT + FIRST_ROW];
+        for (int r = 0; r < TETRIS_ENV_ROWS; ++r) {
+            for (int x = 0; x < TETRIS_ENV_COLUMNS; ++x) out[TETRIS_ENV_OBS_BOARD + r * TETRIS_ENV_COLUMNS + x] = board[r] >> x & 1;
+        }
+        const int8_t *pieces = &queue[game * QUEUE];
+        out[TETRIS_ENV_OBS_PIECES] = static_cast<uint8_t>(pieces[0] + 1);
+        out[TETRIS_ENV_OBS_PIECES + 1] = static_cast<uint8_t>(hold[game] + 1);
+        for (int i = 1; i < QUEUE; ++i) out[TETRIS_ENV_OBS_PIECES + 1 + i] = static_cast<uint8_t>(pieces[i] + 1);
+        out[TETRIS_ENV_OBS_COMBO] = static_cast<uint8_t>(std::min(combo[game] + 1, 255));
+        out[TETRIS_ENV_OBS_B2B] = static_cast<uint8_t>(std::clamp(backToBack[game], 0, 255));
+        int lines = 0;
+        for (int i = 0; i < garbageSize[game]; ++i) lines += garbage[game * GARBAGE_ENTRIES + i];
+        out[TETRIS_ENV_OBS_GARBAGE] = static_cast<uint8_t>(std::min(lines, 255));
+        std::memcpy(out + TETRIS_ENV_OBS_MASK, &legal[game * TETRIS_ENV_ACTIONS], TETRIS_ENV_ACTIONS);
+    }
+};
+
+extern "C" {
+
+TetrisEnvConfig tetris_env_default_config(void) {
+    TetrisEnvConfig config;
+    config.count = 64;
+    config.seed = 1;
+    config.threads = 0;
+    config.max_pieces = 0;
+    config.use_srs = 1;
+    return config;
+}
+
+TetrisEnv *tetris_env_create(const TetrisEnvConfig *config) {
+    if (config == nullptr || config->count < 1 || config->threads < 0 || config->max_pieces < 0) return nullptr;
+    // nothing may throw across the C boundary
+    try {
+        return new TetrisEnv(*config);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void tetris_env_destroy(TetrisEnv *env) {
+    delete env;
+}
+
+int32_t tetris_env_count(const TetrisEnv *env) {
+    return env != nullptr ? env->config.count : 0;
+}
+
+int32_t tetris_env_reset(TetrisEnv *env, uint8_t *observations) {
+    if (env == nullptr || observations == nullptr) return -1;
+    env->forEachGame([env, observations](const int game, const int worker) {
+        env->newGame(game, env->scratch[worker]);
+        env->observe(game, observations + static_cast<size_t>(game) * TETRIS_ENV_OBS_SIZE);
+    });
+    return 0;
+}
+
+int32_t tetris_env_step(TetrisEnv *env, const uint16_t *actions, uint8_t *observations, float *rewards, uint8_t *dones) {
+    if (env == nullptr || actions == nullptr || observations == nullptr || rewards == nullptr || dones == nullptr) return -1;
+    env->forEachGame([&](const int game, const int worker) {
+        std::vector<Placement> &placements = env->scratch[worker];
+        rewards[game] = 0;
+        bool done = env->play(game, actions[game], rewards[game]);
+        // a piece that can't go anywhere (or can't even spawn) tops out
+        if (!done) done = !env->findActions(game, placements);
+        if (done) env->newGame(game, placements);
+        dones[game] = done;
+        env->observe(game, observations + static_cast<size_t>(game) * TETRIS_ENV_OBS_SIZE);
+    });
+    return 0;
+}
+
+int32_t tetris_env_add_garbage(TetrisEnv *env, const int32_t index, const int32_t lines) {
+    if (env == nullptr || index < 0 || index >= env->config.count || lines < 0 || lines > 255) return -1;
+    if (lines == 0) return 0;
+    int16_t *waiting = &env->garbage[index * GARBAGE_ENTRIES];
+    uint8_t &size = env->garbageSize[index];
+    if (size < GARBAGE_ENTRIES) waiting[size++] = static_cast<int16_t>(lines);
+    else waiting[GARBAGE_ENTRIES - 1] = static_cast<int16_t>(waiting[GARBAGE_ENTRIES - 1] + lines);
+    return 0;
+}
+
+}
@@ -0,0 +1,119 @@
+// Batched training environment with a C ABI (libtetris_env), for reinforcement learning:
+// steps K games at once, each action places one piece.
+//
+//   TetrisEnvConfig config = tetris_env_default_config();
+//   config.count = 1024;
+//   TetrisEnv *env = tetris_env_create(&config);
+//   uint8_t *obs = malloc(config.count * TETRIS_ENV_OBS_SIZE);
+//   tetris_env_reset(env, obs);
+//   for (;;) tetris_env_step(env, actions, obs, rewards, dones);
+//   tetris_env_destroy(env);
+//
+// The games follow the engine's rules (SRS kicks and spins, 7-bag of SevenBagGenerator, the
+// attack table of AttackRules) without the timing: no gravity, no lock delay.
+//
+// Action (0 to TETRIS_ENV_ACTIONS - 1): hold * 40 + rotation * 10 + column
+//   hold     1 = press HOLD first and place the piece that comes out
+//   rotation the rotation state the piece locks in (0-3)
+//   column   the leftmost column of the locked piece
+// The observation says which are legal: a legal action locks the piece at the lowest spot of
+// that rotation and column it can reach (a spin if it can get there with one). An illegal
+// action plays the first legal one instead.
+//
+// Observation (TETRIS_ENV_OBS_SIZE bytes per game, written straight into the caller's tensor):
+//   [TETRIS_ENV_OBS_BOARD]   the bottom 24 rows, row by row from the top, 1 = filled
+//   [TETRIS_ENV_OBS_PIECES]  current, hold, next 1-5: piece ordinal + 1 (T Z S L J I O), 0 = none
+//   [TETRIS_ENV_OBS_COMBO]   combo counter + 1 (0 = no combo), capped at 255
+//   [TETRIS_ENV_OBS_B2B]     back-to-back chain, capped at 255
+//   [TETRIS_ENV_OBS_GARBAGE] garbage lines waiting to rise, capped at 255
+//   [TETRIS_ENV_OBS_MASK]    one byte per action, 1 = legal
+//
+// Reward: the lines the placement sends (before they cancel the garbage waiting).
+// Done: the game topped out or reached max_pieces, the game starts over by itself on the same
+// step (the observation is the new game's), on the next seed of that slot.
+//
+
+#ifndef TETISENGINE_TETRIS_ENV_H
+#define TETISENGINE_TETRIS_ENV_H
+#include <stdint.h>
+
+#if defined(_WIN32)
+#ifdef TETRIS_ENV_BUILD
+#define TETRIS_ENV_API __declspec(dllexport)
+#else
+#define TETRIS_ENV_API __declspec(dllimport)
+#endif
+#else
+#define TETRIS_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    TETRIS_ENV_ROWS = 24,
+    TETRIS_ENV_COLUMNS = 10,
+    TETRIS_ENV_NEXT = 5,
+    TETRIS_ENV_ACTIONS = 2 * 4 * TETRIS_ENV_COLUMNS,
+
+    TETRIS_ENV_OBS_BOARD = 0,
+    TETRIS_ENV_OBS_PIECES = TETRIS_ENV_ROWS * TETRIS_ENV_COLUMNS,
+    TETRIS_ENV_OBS_COMBO = TETRIS_ENV_OBS_PIECES + 2 + TETRIS_ENV_NEXT,
+    TETRIS_ENV_OBS_B2B = TETRIS_ENV_OBS_COMBO + 1,
+    TETRIS_ENV_OBS_GARBAGE = TETRIS_ENV_OBS_B2B + 1,
+    TETRIS_ENV_OBS_MASK = 256, // the bytes in between are 0
+    TETRIS_ENV_OBS_SIZE = TETRIS_ENV_OBS_MASK + TETRIS_ENV_ACTIONS
+};
+
+typedef struct TetrisEnv TetrisEnv;
+
+typedef struct TetrisEnvConfig {
+    int32_t count; // games stepped together
+    uint32_t seed; // game i plays the 7-bag of seed + i, its next game seed + i + count...
+    int32_t threads; // 0 = every core
+    int32_t max_pieces; // a game is done after this many pieces, 0 = only when it tops out
+    int32_t use_srs; // 0 = rotations never kick (TetrisConfig::srsEnabled)
+} TetrisEnvConfig;
+
+TETRIS_ENV_API TetrisEnvConfig tetris_env_default_config(void);
+
+/**
+ * @return the environment, NULL if the config is wrong (count < 1...)
+ */
+TETRIS_ENV_API TetrisEnv *tetris_env_create(const TetrisEnvConfig *config);
+
+TETRIS_ENV_API void tetris_env_destroy(TetrisEnv *env);
+
+TETRIS_ENV_API int32_t tetris_env_count(const TetrisEnv *env);
+
+/**
+ * Starts every game over (each on the next seed of its slot)
+ * @param observations count * TETRIS_ENV_OBS_SIZE bytes
+ * @return 0, -1 if a pointer is NULL
+ */
+TETRIS_ENV_API int32_t tetris_env_reset(TetrisEnv *env, uint8_t *observations);
+
+/**
+ * Plays one piece in every game
+ * @param actions      count actions
+ * @param observations count * TETRIS_ENV_OBS_SIZE bytes, overwritten
+ * @param rewards      count floats
+ * @param dones        count bytes, 1 = that game ended (and started over)
+ * @return 0, -1 if a pointer is NULL
+ */
+TETRIS_ENV_API int32_t tetris_env_step(TetrisEnv *env, const uint16_t *actions, uint8_t *observations,
+                                       float *rewards, uint8_t *dones);
+
+/**
+ * Queues garbage for one game (an opponent's attack): it rises after the next placement that
+ * clears nothing, unless the game's own attacks cancel it first
+ * @return 0, -1 if index or lines is out of range
+ */
+TETRIS_ENV_API int32_t tetris_env_add_garbage(TetrisEnv *env, int32_t index, int32_t lines);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TETISENGINE_TETRIS_ENV_H
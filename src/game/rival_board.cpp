@@ -0,0 +1,93 @@
+#include "rival_board.h"
+#include "../engine/attack_rules.h"
+#include "../pve/pve_rules.h"
+
+RivalBoard::RivalBoard(const int64_t seed, const double pps, const BeamSearchBot::Settings &settings)
+        : config(TetrisConfig::builder()), generator(std::make_unique<SevenBagGenerator>(seed)),
+          holeSeed(static_cast<uint64_t>(seed) * 0x9E3779B97F4A7C15ULL + 1) {
+    config->setLineClearsDelay(0.35); // same as the player's (MainMenu)
+    engine = std::make_unique<TetrisEngine>(config.get(), generator.get());
+    engine->runOnMinoLocked([this](const int cleared) { onMinoLocked(cleared); });
+    engine->onPlayfieldEvent([this](const PlayfieldEvent &event) { onPlayfieldEvent(event); });
+    engine->runOnGameOver([this]() {
+        toppedOut = true;
+        engine->stop();
+        if (onToppedOut) onToppedOut();
+    });
+
+    BeamSearchBot::Settings botSettings = settings;
+    botSettings.useSRS = engine->srsEnabled();
+    bot = std::make_unique<BotController>(engine.get(), botSettings);
+    bot->setPiecesPerSecond(pps);
+    engine->runOnTickEnd([this]() { bot->update(); });
+
+    updateLevel(1);
+    engine->start(false); // ticked by tick(), not by a loop of its own
+}
+
+RivalBoard::~RivalBoard() {
+    bot.reset(); // its thread goes before the engine it plays
+}
+
+void RivalBoard::tick() {
+    if (toppedOut) return;
+    engine->tick();
+}
+
+void RivalBoard::receiveGarbage(const int lines) {
+    if (lines > 0 && !toppedOut) garbageQueue.push_back(lines);
+}
+
+void RivalBoard::updateLevel(const int newLevel) {
+    level = std::min(15, newLevel);
+    config->setGravitySubcells(defaultPveRules().levelGravity[level]);
+    engine->updateMutableConfig(false);
+}
+
+void RivalBoard::onMinoLocked(const int cleared) {
+    ++piecesPlaced;
+    // rise garbage, one entry of the queue per piece that clears nothing (TetrisPlayer::onMinoLocked())
+    if (cleared > 0 || garbageQueue.empty()) return;
+    const int amount = garbageQueue.front();
+    garbageQueue.pop_front();
+
+    // splitmix64, the holes don't touch rand() (the player's thread uses it)
+    uint64_t z = (holeSeed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    const int hole = static_cast<int>((z ^ (z >> 31)) % Bitboard::WIDTH);
+
+    engine->gameInterrupt(true);
+    for (int i = 0; i < amount; ++i) {
+        engine->scheduleDelayedTask(i * 5, [this, i, amount, hole]() {
+            engine->raiseGarbage(1, hole);
+            if (i >= amount - 1) engine->gameInterrupt(false);
+        });
+    }
+}
+
+void RivalBoard::onPlayfieldEvent(const PlayfieldEvent &event) {
+    const int cleared = static_cast<int>(event.getLinesCleared().size());
+    if (cleared > 0) {
+        clearedLines += cleared;
+        if (const int newLevel = defaultPveRules().level(clearedLines); newLevel != level) updateLevel(newLevel);
+    }
+
+    backToBack = AttackRules::nextBackToBack(backToBack, cleared, event.isSpin(), event.isMiniSpin());
+    int damage = AttackRules::attack(cleared, event.isSpin(), event.isPerfectClear(), backToBack, engine->getComboCount());
+
+    // counter-attack
+    while (!garbageQueue.empty() && damage > 0) {
+        const int amount = garbageQueue.front();
+        garbageQueue.pop_front();
+        if (damage >= amount) {
+            damage -= amount;
+        } else {
+            garbageQueue.push_front(amount - damage);
+            damage = 0;
+        }
+    }
+    if (damage <= 0) return;
+    totalDamage += damage;
+    if (onAttack) onAttack(damage);
+}
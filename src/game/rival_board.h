@@ -0,0 +1,90 @@
+#ifndef TETISENGINE_RIVAL_BOARD_H
+#define TETISENGINE_RIVAL_BOARD_H
+#pragma once
+#include <deque>
+#include <functional>
+#include <memory>
+#include "../engine/tetris_engine.h"
+#include "../process/bag_generator.h"
+#include "../bot/bot_controller.h"
+
+/**
+ * The CPU side of VS mode: a second TetrisEngine, played by a BotController capped at some PPS.
+ *
+ * It has no loop of its own, tick() runs one tick of it and the player's tick calls it, so both
+ * boards move in lockstep in the same ExecutionContext task (and the renderer can read it right
+ * after). The bot searches on the controller's thread, the tick only hands pieces over.
+ *
+ * Garbage works like the player's: attacks cancel the queue first, the rest goes to onAttack,
+ * the front of the queue rises when a piece clears nothing.
+ */
+class RivalBoard {
+public:
+    /**
+     * @param seed     of its 7-bag (the player's seed = the same pieces)
+     * @param pps      pieces per second it plays at most
+     * @param settings the search settings of its bot
+     */
+    RivalBoard(int64_t seed, double pps, const BeamSearchBot::Settings &settings);
+
+    ~RivalBoard();
+
+    RivalBoard(const RivalBoard &) = delete;
+    RivalBoard &operator=(const RivalBoard &) = delete;
+
+    /**
+     * One tick of the rival (engine, then its bot), call it once per tick of the player
+     */
+    void tick();
+
+    /**
+     * Garbage from the player, rises after the next piece that clears nothing (unless cancelled)
+     */
+    void receiveGarbage(int lines);
+
+    TetrisEngine *getEngine() const {
+        return engine.get();
+    }
+
+    const std::deque<int> &getGarbageQueue() const {
+        return garbageQueue;
+    }
+
+    bool isToppedOut() const {
+        return toppedOut;
+    }
+
+    int getPiecesPlaced() const {
+        return piecesPlaced;
+    }
+
+    int getTotalDamage() const {
+        return totalDamage;
+    }
+
+    // lines it sends to the player (after cancelling its own garbage)
+    std::function<void(int)> onAttack = nullptr;
+    // it topped out, the player won
+    std::function<void()> onToppedOut = nullptr;
+
+private:
+    std::unique_ptr<TetrisConfig> config;
+    std::unique_ptr<SevenBagGenerator> generator;
+    std::unique_ptr<TetrisEngine> engine;
+    std::unique_ptr<BotController> bot; // after the engine, it plays it
+
+    std::deque<int> garbageQueue;
+    uint64_t holeSeed;
+    int backToBack = 0;
+    int clearedLines = 0;
+    int level = 0;
+    int piecesPlaced = 0;
+    int totalDamage = 0;
+    bool toppedOut = false;
+
+    void onMinoLocked(int cleared);
+    void onPlayfieldEvent(const PlayfieldEvent &event);
+    void updateLevel(int newLevel);
+};
+
+#endif //TETISENGINE_RIVAL_BOARD_H
@@ -10,10 +10,7 @@ class Nigga final : public NormalEntity {
 public:
     Nigga(TetrisPlayer* tetrisPlayer) : NormalEntity(tetrisPlayer) {
         this->setTextureFile(NIGGA_SHEET); // very strong mob
-        this->setDamageThresholds(3, 6); // 3-6 dmg
-        this->setAttackSpeed(15); // 20s between attacks
-        this->setDifficulty(HARD); // this is a hard boss
-        this->setMaxHealth(20); // 20HP (5 tetris(s) to clear)
+        this->setStats(defaultPveRules().stats(ENEMY_NIGGA)); // see PveRules
     }
 };
 #endif //NIGGA_H
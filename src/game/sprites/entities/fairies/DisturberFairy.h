@@ -11,13 +11,7 @@ class DisturberFairy : public DebuffFairy {
 public:
     DisturberFairy(TetrisPlayer* tetrisPlayer) : DebuffFairy(tetrisPlayer) {
         this->setTextureFile(FAIRY_DISTURBER_SHEET); // blue nigga
-        this->setDamageThresholds(15, 30); // 13-25s debuff
-
-        this->setAttackSpeed(30); // 30s between attacks
-        this->setDifficulty(EASY); // this is a hard mini boss
-        this->setMaxHealth(18); // 14HP
-
-        this->availableDebuffs = { NO_HOLD };
+        this->setStats(defaultPveRules().stats(ENEMY_DISTURBER_FAIRY)); // see PveRules
     }
 };
 
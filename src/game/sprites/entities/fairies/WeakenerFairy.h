@@ -10,13 +10,7 @@ class WeakenerFairy : public DebuffFairy {
 public:
     WeakenerFairy(TetrisPlayer* tetrisPlayer) : DebuffFairy(tetrisPlayer) {
         this->setTextureFile(FAIRY_WEAKENER_SHEET); // blue nigga
-        this->setDamageThresholds(8, 20); // 13-25s debuff blind
-
-        this->setAttackSpeed(30); // 30s between attacks
-        this->setDifficulty(MEDIUM); // this is a hard mini boss
-        this->setMaxHealth(18); // 14HP
-
-        this->availableDebuffs = { WEAKNESS, FRAGILE };
+        this->setStats(defaultPveRules().stats(ENEMY_WEAKENER_FAIRY)); // see PveRules
     }
 };
 
@@ -2,15 +2,6 @@
 #define TIAF_H
 #include "../normal_entity.h"
 
-// available debuff(s)
-enum Debuff {
-    BLIND,
-    NO_HOLD,
-    SUPER_SONIC,
-    WEAKNESS,
-    FRAGILE
-};
-
 class DebuffFairy : public NormalEntity {
 public:
     vector<Debuff> availableDebuffs;
@@ -20,6 +11,15 @@ public:
         this->availableDebuffs = { WEAKNESS, FRAGILE };
     }
 
+    // the stats, and the debuffs it casts
+    void setStats(const EnemyStats& stats) {
+        NormalEntity::setStats(stats);
+        this->availableDebuffs.clear();
+        for (int debuff = 0; debuff < DEBUFF_COUNT; ++debuff) {
+            if (stats.debuffs & (1u << debuff)) this->availableDebuffs.push_back(static_cast<Debuff>(debuff));
+        }
+    }
+
     void attackPlayer();
 };
 
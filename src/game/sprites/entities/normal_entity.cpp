@@ -90,9 +90,9 @@ KillRewards NormalEntity::damageEntity(int damage) {
 
     if (currentHealth <= 0) {
         // the entity has been killed
-        KillRewards rewards = { rand() % 2, (rand() % 6) + 1 };
+        KillRewards rewards = defaultPveRules().killRewards([](const int bound) { return rand() % bound; });
         die(rewards.type == 0);
-        return rewards; // 1->5
+        return rewards; // 1->6
     }
     return {-1, -1}; // not killed
 }
@@ -145,16 +145,7 @@ void NormalEntity::onDrawCall() {
         this->frameSpeed = defaultFrameSpeed;
         this->animationAfterAttackAnimation = nullptr;
     }
-
-    // only count in seconds
-    if (internalClock % 60 == 0) { // every second (16.6MS)
-        attackDelayCounter++;
-        // check if it's time to perform the attack
-        if (attackDelayCounter >= (minAttackInterval + rand() % (maxAttackInterval - minAttackInterval))) {
-            attackPlayer();
-            attackDelayCounter = 0; // reset the counter
-        }
-    }
+    // when to attack is up to TetrisPlayer::director (every tick), not the sprite
 }
 
 void NormalEntity::onDrawCallExtended(SDL_Renderer *renderer) {
@@ -6,22 +6,12 @@
 #define NORMAL_ENTITY_H
 #include "../../spritesystem/sprite.h"
 #include "../entity_prop.h"
+#include "../../../pve/pve_rules.h"
 #include <cmath>
 #include <functional>
 
 using namespace std;
 
-typedef struct {
-    int type; // 0 = armor, 1 = energy, (-1 = none)
-    int amount;
-} KillRewards;
-
-typedef enum {
-    HARD,
-    MEDIUM,
-    EASY
-} EnemyDifficulty;
-
 class TetrisPlayer;
 class NormalEntity : public Sprite {
 public:
@@ -54,10 +44,10 @@ public:
 
     /**
      * The amount of time the entity will wait before make you shit your pants again
+     * (when it actually does is up to the director, see TetrisPlayer::director)
      */
     double attackSpeed = 10; // speed at which the entity attacks
-    int attackDelayCounter = 0; // counter to track time until the next attack
-    int minAttackInterval, maxAttackInterval; // attack interval range (min, max)
+    EnemyStats stats{}; // what setStats() was given
 
     /**
      * The amount of health the entity has
@@ -76,8 +66,7 @@ public:
 
     void setAttackSpeed(double speed) {
         this->attackSpeed = speed;
-        this->minAttackInterval = static_cast<int>(attackSpeed * 0.7); // 70%
-        this->maxAttackInterval = static_cast<int>(attackSpeed * 1.3); // 130%
+        this->stats.attackSpeed = speed;
     }
 
     void setMaxHealth(int health) {
@@ -92,6 +81,19 @@ public:
         this->difficulty = enemyDifficulty;
     }
 
+    /**
+     * Damage, attack speed, difficulty and health from the balance table
+     * @param stats usually defaultPveRules().stats(kind)
+     */
+    void setStats(const EnemyStats& stats) {
+        this->stats = stats;
+        this->setDamageThresholds(stats.damageMin, stats.damageMax);
+        this->setAttackSpeed(stats.attackSpeed);
+        this->setDifficulty(stats.difficulty);
+        this->setMaxHealth(stats.maxHealth);
+        this->isMiniboss = stats.miniboss;
+    }
+
     KillRewards damageEntity(int damage);
 
     void die(bool isArmor);
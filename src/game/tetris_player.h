@@ -2,6 +2,7 @@
 // Created by GiaKhanhVN on 3/3/2025.
 //
 #include <random>
+#include <filesystem>
 #include "tetris_renderer.h"
 #include "sprites/gameworld.cpp"
 #include "sprites/entities/Redgga.h"
@@ -15,33 +16,19 @@
 #include "sprites/entities/fairies/WeakenerFairy.h"
 #include "sprites/entities/fairies/DistractorFairy.h"
 #include "sprites/entities/fairies/DisturberFairy.h"
+#include "../pve/pve_rules.h"
+#include "../pve/pve_director.h"
 #include "../process/gamescene.h"
 #include "../process/hooker.h"
+#include "../bot/external_bot.h"
+#include "../bot/hint_controller.h"
+#include "rival_board.h"
+#include "../engine/replay.h"
 
 #ifndef TETRIS_PLAYER_H
 #define TETRIS_PLAYER_H
 
 static int TETRIS_SCORE[5] = { 0, 50, 110, 630, 2300 }; // score for each type of line clears
-static int LEVEL_THRESHOLD = 35; // advance every X lines
-static double LEVELS_GRAVITY[16] = { // speed of each level
-        0, // lvl 0 does not exist
-        0.01667,
-        0.021017,
-        0.026977,
-        0.035256,
-        0.04693,
-        0.06361,
-        0.0879,
-        0.1236,
-        0.1775,
-        0.2598,
-        0.388,
-        0.59,
-        0.92,
-        1.46,
-        2.36,
-};
-
 static int Y_LANES[4] = {
         10, 190, 380, 550
 };
@@ -76,34 +63,6 @@ static int MINO_COLORS[7] = {
 #define X_LANE_PLAYER 840
 #define X_LANE_ENEMIES 1400
 
-enum WaveDifficulty {
-    WAVE_EASY,
-    WAVE_MEDIUM,
-    WAVE_HARD
-};
-
-enum FairyType {
-    WEAKENER,
-    DISTRACTOR,
-    BLINDER,
-    DISTURBER
-};
-
-enum GameMode {
-    CAMPAIGN,
-    ENDLESS,
-};
-
-/**
- * Choose a random element with a specific RNG bias
- */
-template<typename T> T chooseRandomWithBias(const vector<T>& options) {
-    static random_device rd;
-    static mt19937 rng(rd());
-    uniform_int_distribution<size_t> dist(0, options.size() - 1);
-    return options[dist(rng)];
-}
-
 class TetrisPlayer : public GameScene {
 public:
     // text
@@ -132,6 +91,11 @@ public:
     // engine handler
     TetrisEngine* tetrisEngine;
     deque<int> garbageQueue;
+    uint64_t holeSeed; // splitmix64 state of the garbage holes, from the seed of the game
+
+    // the whole game, saved to replays/<seed>.replay when the scene stops
+    ReplayRecorder replay;
+    int64_t seed;
 
     // context
     int tetrisEngineExecId = 0;
@@ -173,6 +137,8 @@ public:
 
     // enemies
     NormalEntity* enemyOnLanes[4] = {nullptr, nullptr, nullptr, nullptr}; // 4 lanes, 4 available monsters (initialized as 0)
+    // when they attack: reads the board and the garbage queue, keeps the pressure steady
+    EnemyDirector director{defaultPveRules()};
     /*** end of player attacks ***/
 
     /*** status effects ***/
@@ -185,21 +151,6 @@ public:
     int sDebuffTime[5] = { 0, 0, 0, 0, 0 };
     /*** end of status effects ***/
 
-    /*** input handling (ARR, DAS) ***/
-    // DAS (ARR) for the entire game
-    bool leftHeld = false;
-    bool rightHeld = false;
-    // timestamps
-    int64_t leftPressTime = 0;
-    int64_t rightPressTime = 0;
-    int64_t nextLeftShiftTime = 0;
-    int64_t nextRightShiftTime = 0;
-
-    // const (this is my personal value in TETR.IO) [ms]
-    const int DAS = 200; // delay before auto-repeat begins (ms)
-    const int ARR = 50; // Auto Repeat Rate (interval between moves after the initial DAS)
-    /*** end of input handling (ARR, DAS) ***/
-
     bool showDebug = false;
     // gameplay
     GameMode gamemode = CAMPAIGN;
@@ -215,13 +166,51 @@ public:
     // the execution context (nullptr if none)
     ExecutionContext* context = nullptr;
 
+    // plays instead of the keyboard when the game was started with -bot (nullptr if none)
+    ExternalBotController* externalBot = nullptr;
+
+    // practice hints (F2, or -practice): where the bot would put the piece (nullptr until asked for)
+    HintController* hints = nullptr;
+    bool showHints = false;
+
+    /**
+     * Show or hide the placement hints, the search starts the first time
+     */
+    void setHintsShown(bool shown);
+
+    // the CPU board of VS mode (nullptr in the other modes), ticked by onTetrisTick()
+    RivalBoard* rival = nullptr;
+
+    /**
+     * VS mode: start the CPU board, before startScene()
+     * @param seed of its 7-bag (the player's one = the same pieces)
+     */
+    void startRival(int64_t seed);
+
+    /**
+     * (Event) the CPU sent garbage
+     * @param lines after its own garbage was cancelled
+     */
+    void onRivalAttack(int lines);
+
+    /**
+     * (Event) the CPU topped out, the player wins
+     */
+    void onRivalToppedOut();
+
+    /**
+     * Render the CPU's board, its garbage queue and its speed
+     */
+    void renderRivalBoard(const int ox, const int oy);
+
     /**
      * Initialize a game of Tetris: Diarrhea Edition
      * @param context the exec context (can be nullptr)
      * @param sdlRenderer the SDL renderer
      * @param engine the main engine
+     * @param seed the seed of the engine's 7-bag (for the replay, and the garbage holes)
      */
-    TetrisPlayer(ExecutionContext* context, SDL_Renderer* sdlRenderer, TetrisEngine* engine, GameMode gamemode = CAMPAIGN);
+    TetrisPlayer(ExecutionContext* context, SDL_Renderer* sdlRenderer, TetrisEngine* engine, int64_t seed, GameMode gamemode = CAMPAIGN);
 
     /**
      * This destructor deletes TetrisEngine, which is very dangerous if left
@@ -296,6 +285,11 @@ public:
      */
     void inflictDebuff(int debuff, int timeInSeconds, int oldLane);
 
+    /**
+     * Ask the director which enemies attack on this tick, and have them attack
+     */
+    void directEnemies();
+
     /**
      * Release all damage on the current lane
      */
@@ -345,7 +339,7 @@ public:
      * Render the Tetris Board's external features
      */
     void renderTetrisStatistics(const int ox, const int oy);
-    void renderGarbageQueue(const int ox, const int oy);
+    void renderGarbageQueue(const int ox, const int oy, const deque<int>& queue);
     void renderTetrisInterface(const int ox, const int oy);
 
     function<void(ExecutionContext*, SDL_Renderer*)> gameOverSceneCallback = nullptr;
@@ -356,17 +350,26 @@ public:
     void showGameOverScreen(const bool lost = true);
 
     /**
-     * Create a fairy entity using typeset
-     * @param type
-     * @return the heap-allocated fairy
+     * End the replay and write it to replays/<seed>.replay (errors go to cerr, the game goes on)
+     */
+    void saveReplay();
+
+    /**
+     * Create an entity of a kind
+     * @param kind
+     * @return the heap-allocated entity
      */
-    DebuffFairy* createFairy(FairyType type) {
-        switch (type) {
-            case WEAKENER:  return new WeakenerFairy(this);
-            case DISTRACTOR: return new DistractorFairy(this);
-            case BLINDER:   return new BlinderFairy(this);
-            case DISTURBER: return new DisturberFairy(this);
-            default:        return nullptr;
+    NormalEntity* createEnemy(EnemyKind kind) {
+        switch (kind) {
+            case ENEMY_GRIGGA: return new Grigga(this);
+            case ENEMY_BLUGGA: return new Blugga(this);
+            case ENEMY_REDGGA: return new Redgga(this);
+            case ENEMY_NIGGA: return new Nigga(this);
+            case ENEMY_WEAKENER_FAIRY: return new WeakenerFairy(this);
+            case ENEMY_DISTRACTOR_FAIRY: return new DistractorFairy(this);
+            case ENEMY_BLINDER_FAIRY: return new BlinderFairy(this);
+            case ENEMY_DISTURBER_FAIRY: return new DisturberFairy(this);
+            default: return nullptr;
         }
     }
 
@@ -380,16 +383,14 @@ public:
      * @param wave a valid number from 1 - infinity
      */
     void startWave(int wave) {
-        WaveDifficulty wDifficulty = WAVE_EASY;
+        const WaveDifficulty wDifficulty = defaultPveRules().waveDifficulty(wave);
         string waveText = "easy";
         int waveColor = MINO_COLORS[2]; // green
 
-        if (wave >= 3 && wave <= 5) {
-            wDifficulty = WAVE_MEDIUM;
+        if (wDifficulty == WAVE_MEDIUM) {
             waveText = "medium";
             waveColor = MINO_COLORS[6]; // yellow
-        } else if (wave > 5) {
-            wDifficulty = WAVE_HARD;
+        } else if (wDifficulty == WAVE_HARD) {
             waveText = "hard";
             waveColor = MINO_COLORS[1]; // red
         }
@@ -409,92 +410,10 @@ public:
      * @param difficulty
      */
     void populateLane(WaveDifficulty difficulty) {
+        // the composition is in PveRules::rollWave() (the headless simulations roll the same waves)
         vector<NormalEntity*> toSpawn;
-        switch (difficulty) {
-            case WAVE_EASY:
-                // 4 random easy DPS mob
-                for (int i = 0; i < 4; ++i) {
-                    int roll = rand() % 100;
-                    if (roll < 60) {
-                        toSpawn.push_back(new Grigga(this)); // easy
-                    } else {
-                        toSpawn.push_back(new Blugga(this)); // medium
-                    }
-                }
-                break;
-            case WAVE_MEDIUM: {
-                // either 3dps + 1 fairy or 4dps (like easy)
-                int roll = rand() % 100;
-                if (roll < 60) {
-                    // 3 DPS + 1 fairy (prefer medium fairies)
-                    for (int i = 0; i < 3; ++i) {
-                        int dpsRoll = rand() % 100;
-                        if (dpsRoll < 50) {
-                            toSpawn.push_back(new Blugga(this));
-                        } else {
-                            toSpawn.push_back(new Grigga(this));
-                        }
-                    }
-
-                    FairyType fairyChoice = chooseRandomWithBias(vector<FairyType>{
-                        WEAKENER, DISTRACTOR, DISTURBER
-                    });
-                    toSpawn.push_back(createFairy(fairyChoice));
-                } else {
-                    // 4 DPS
-                    for (int i = 0; i < 4; ++i) {
-                        int dpsRoll = rand() % 100;
-                        if (dpsRoll < 10) {
-                            toSpawn.push_back(new Redgga(this)); // Rare hard mob
-                        }
-                        else if (dpsRoll < 60) {
-                            toSpawn.push_back(new Blugga(this));
-                        } else {
-                            toSpawn.push_back(new Grigga(this));
-                        }
-                    }
-                }
-                break;
-            }
-            case WAVE_HARD: {
-                // 3dps + 1fairy or 2 dps + 2 fairy (prioritize hardest ones)
-                int roll = rand() % 100;
-                if (roll < 50) { // 50%
-                    // 3 DPS + 1 fairy (only medium or hard fairies)
-                    for (int i = 0; i < 3; ++i) {
-                        int dpsRoll = rand() % 100;
-                        if (dpsRoll < 30) { // 30%
-                            toSpawn.push_back(new Nigga(this));
-                        } else if (dpsRoll < 80) { // 80%
-                            toSpawn.push_back(new Redgga(this));
-                        } else { // 20%
-                            toSpawn.push_back(new Blugga(this));
-                        }
-                    }
-
-                    FairyType fairyChoice = chooseRandomWithBias(vector<FairyType>{
-                        WEAKENER, DISTRACTOR, BLINDER, DISTURBER
-                    });
-                    toSpawn.push_back(createFairy(fairyChoice));
-                } else {
-                    // 2 DPS + 2 fairies
-                    for (int i = 0; i < 2; ++i) {
-                        int dpsRoll = rand() % 100;
-                        if (dpsRoll < 30) {
-                            toSpawn.push_back(new Nigga(this));
-                        } else {
-                            toSpawn.push_back(new Redgga(this));
-                        }
-                    }
-
-                    vector<FairyType> hardFairyOptions = { WEAKENER, DISTRACTOR, BLINDER };
-                    toSpawn.push_back(createFairy(chooseRandomWithBias(hardFairyOptions)));
-                    toSpawn.push_back(createFairy(chooseRandomWithBias(hardFairyOptions)));
-                }
-                break;
-            }
-
-            default: break;
+        for (const EnemyKind kind : defaultPveRules().rollWave(difficulty, [](const int bound) { return rand() % bound; })) {
+            toSpawn.push_back(createEnemy(kind));
         }
 
         // finalize lane population
@@ -519,6 +438,16 @@ public:
             this->processSceneInput(event);
         }
 
+        // the bot asks for its move as soon as the piece spawns, plays it when it's back
+        if (externalBot) externalBot->update();
+        // the hint search runs on its own thread, this only hands it the new pieces
+        if (hints && showHints) hints->update();
+
+        // the enemies that attack now
+        if (gameStarted && !isGameOver) directEnemies();
+        // the CPU plays its tick right after the player's, both boards stay in lockstep
+        if (rival && gameStarted && !isGameOver) rival->tick();
+
         // handle debuffs
         for (int i = 0; i < 5; ++i) {
             if (sDebuffTime[i] == INT_MIN) continue; // infinite debuff
@@ -529,22 +458,6 @@ public:
             --sDebuffTime[i];
         }
 
-        // ARR + DAS handling
-        int64_t now = System::currentTimeMillis();
-
-        // if it is time to shift, move accordingly
-        if (leftHeld && now >= nextLeftShiftTime) {
-            tetrisEngine->moveLeft();
-            // this could count as an "artificial" keypress, so handle it like we did before
-            nextLeftShiftTime = now + ARR;
-        }
-
-        if (rightHeld && now >= nextRightShiftTime) {
-            tetrisEngine->moveRight();
-            // this could count as an "artificial" keypress, so handle it like we did before
-            nextRightShiftTime = now + ARR;
-        }
-
         // handle death animation
         if (boardFallAnimationCount) {
             smallClock++;
@@ -557,8 +470,9 @@ public:
         // render low priority sprites first
         SpritesRenderingPipeline::renderNormal(renderer);
 
-        // then the tetris board
+        // then the tetris board (and the CPU's, on the enemies' side)
         renderTetrisInterface(100, 90);
+        if (rival) renderRivalBoard(1040, 90 + boardDrop);
 
         // then the high priority ones
         SpritesRenderingPipeline::renderPriority(renderer);
@@ -3,13 +3,20 @@
 //
 #include "tetris_player.h"
 #include "../process/scenes/game_over_screen.h"
+#include "../engine/attack_rules.h"
+#include "../bot/opening_book.h"
 
-TetrisPlayer::TetrisPlayer(ExecutionContext* context, SDL_Renderer* sdlRenderer, TetrisEngine* engine, GameMode gamemode) {
+TetrisPlayer::TetrisPlayer(ExecutionContext* context, SDL_Renderer* sdlRenderer, TetrisEngine* engine, const int64_t seed, GameMode gamemode) {
     // register constants
     this->renderer = sdlRenderer;
     this->tetrisEngine = engine;
     this->context = context;
     this->gamemode = gamemode;
+    this->seed = seed;
+    this->holeSeed = static_cast<uint64_t>(seed) * 0x9E3779B97F4A7C15ULL + 1;
+
+    // record everything from here on (the level below included)
+    this->replay.attach(engine, seed);
 
     // hook into events
     this->tetrisEngine->runOnTickEnd([&] { onTetrisTick(); });
@@ -20,11 +27,26 @@ TetrisPlayer::TetrisPlayer(ExecutionContext* context, SDL_Renderer* sdlRenderer,
             firstPiecePlacedTime = System::currentTimeMillis();
         }
         this->piecesPlaced++;
+        if (hints) hints->cancel(); // that hint was for the piece that just locked
         this->onMinoLocked(cleared);
     });
     this->tetrisEngine->onComboBreaks([&](const int combo) { });
     this->tetrisEngine->onPlayfieldEvent([&](const PlayfieldEvent& event) { playFieldEvent(event); });
 
+    // let the external bot play, if there is one
+    if (context && !context->externalBotCommand.empty()) {
+        try {
+            this->externalBot = new ExternalBotController(engine, context->externalBotCommand, engine->srsEnabled());
+        } catch (const runtime_error& e) {
+            cerr << "[BOT] " << e.what() << endl;
+        }
+    }
+
+    // hints from the first piece in practice
+    if (context && context->practiceHints && !this->externalBot) {
+        setHintsShown(true);
+    }
+
     // init gravity to lvl 1
     updateLevelAndGravity(1);
     // first lane is 0 (top)
@@ -32,9 +54,67 @@ TetrisPlayer::TetrisPlayer(ExecutionContext* context, SDL_Renderer* sdlRenderer,
 }
 
 TetrisPlayer::~TetrisPlayer() {
+    delete this->externalBot; // before the engine it plays
+    delete this->hints;
+    delete this->rival;
     delete this->tetrisEngine; // unhook the tetris engine memory space
 }
 
+void TetrisPlayer::setHintsShown(const bool shown) {
+    if (shown && !this->hints) {
+        // a couple of threads, the game keeps the rest
+        BeamSearchBot::Settings settings;
+        settings.beamWidth = 128;
+        settings.maxDepth = 6;
+        settings.timeBudgetMs = 400;
+        settings.threads = 2;
+        settings.useSRS = this->tetrisEngine->srsEnabled();
+        try {
+            settings.book = OpeningBook::open(std::string(ASSETS_FOLDER) + "/book/openers.book");
+        } catch (const invalid_argument& e) {
+            cerr << "[HINT] " << e.what() << ", no opening book" << endl;
+        }
+        this->hints = new HintController(this->tetrisEngine, settings);
+    }
+    // shown again later = a new search for whatever is falling by then
+    if (!shown && this->hints) this->hints->cancel();
+    this->showHints = shown;
+}
+
+void TetrisPlayer::startRival(const int64_t seed) {
+    if (this->rival) return;
+    // one thread and a short budget, the CPU is capped way below what it could do anyway
+    BeamSearchBot::Settings settings;
+    settings.beamWidth = 64;
+    settings.maxDepth = 4;
+    settings.timeBudgetMs = 50;
+    settings.threads = 1;
+    this->rival = new RivalBoard(seed, context ? context->rivalPps : 1.5, settings);
+    this->rival->onAttack = [this](const int lines) { onRivalAttack(lines); };
+    this->rival->onToppedOut = [this]() { onRivalToppedOut(); };
+}
+
+void TetrisPlayer::onRivalAttack(const int lines) {
+    if (!this->gameStarted || this->isGameOver) return;
+    // straight into the garbage queue, no lanes and no armor in VS
+    garbageQueue.push_back(lines);
+    director.onGarbage(lines);
+    this->spawnDamageIndicator(getLocation().x + 40, getLocation().y + 20, lines, false);
+    SysAudio::playSoundAsync(ENTITY_ATTACK_AUD, SysAudio::getSFXVolume(), false);
+    this->flandre->damagedAnimation(true);
+    boardRumble = 10; // rumble for 10 frames
+}
+
+void TetrisPlayer::onRivalToppedOut() {
+    if (this->isGameOver) return;
+    // same as clearing the campaign (see onWaveCompletion())
+    this->isGameOver = true;
+    this->tetrisEngine->gameInterrupt(true);
+    spawnPhysicsBoundText("cpu topped out!", 1600, 400, -10, 0, 300, 0, 4, 50, 15, nullptr, MINO_COLORS[2]);
+    this->fadeOutTicks = 60;
+    tetrisEngine->scheduleDelayedTask(80, [&]() { showGameOverScreen(false); });
+}
+
 void TetrisPlayer::startScene() {
     // clean current rendering context to begin a new life
     SpritesRenderingPipeline::stopAndCleanCurrentContext();
@@ -80,6 +160,14 @@ void TetrisPlayer::startScene() {
 
                 // start the first wave of monsters
                 // introduction
+                if (gamemode == VERSUS) {
+                    // no monsters, the CPU is the enemy
+                    spawnPhysicsBoundText("versus mode!", 1600, 400, -10, 0, 300, 0, 4, 50, 15, nullptr, MINO_COLORS[5]);
+                    tetrisEngine->scheduleDelayedTask(10, [&]() {
+                        spawnPhysicsBoundText("goal: top out the cpu", 1600, 480, -10, 0, 300, 0, 3.5, 40, 15, nullptr, 0xFFFFFF);
+                    });
+                    return;
+                }
                 spawnPhysicsBoundText(gamemode == CAMPAIGN ? "campaign mode!" : "endless mode!", 1600, 400, -10, 0, 300, 0, 4, 50, 15, nullptr, gamemode == CAMPAIGN ? MINO_COLORS[0] : MINO_COLORS[1]);
                 tetrisEngine->scheduleDelayedTask(10, [&]() {
                     // the subtitle
@@ -109,6 +197,8 @@ void TetrisPlayer::stopScene() {
      // unhook the engine from the context, wait for it to unhook, then
      // delete TetrisPlayer alongside with the Engine (inside ~)
      context->unhook(tetrisEngineExecId, [this]() {
+         // the engine is not ticking anymore, the replay ends here
+         saveReplay();
          // return to game over screen
          if (gameOverSceneCallback) gameOverSceneCallback(this->context, this->renderer);
          // cleanup afterwards
@@ -124,6 +214,18 @@ void TetrisPlayer::stopScene() {
     }
 }
 
+void TetrisPlayer::saveReplay() {
+    replay.finish();
+    const string path = "replays/" + to_string(seed) + ".replay";
+    try {
+        filesystem::create_directories("replays");
+        replay.save(path);
+        cout << "[REPLAY] Saved " << path << " (" << replay.getBytes().size() << " bytes)" << endl;
+    } catch (const exception& e) {
+        cerr << "[REPLAY] " << e.what() << endl;
+    }
+}
+
 void TetrisPlayer::onGameOver() {
     // disallow player input the moment the game is over
     this->isGameOver = true;
@@ -214,6 +316,7 @@ void TetrisPlayer::initParallaxBackground() {
 
 void TetrisPlayer::spawnEnemyOnLane(int lane, NormalEntity *entity) {
     enemyOnLanes[lane] = entity;
+    director.spawn(lane, entity->stats, [](const int bound) { return rand() % bound; });
     // spawn hidden
     entity->teleportStrict(X_LANE_ENEMIES + 300, Y_LANES_ENEMIES[lane]);
     // move slowly to its designated position
@@ -229,8 +332,25 @@ void TetrisPlayer::killEnemyOnLane(int lane) {
     if (enemyOnLanes[lane] == nullptr) return;
     enemyOnLanes[lane]->remove();
     enemyOnLanes[lane] = nullptr;
+    director.remove(lane);
 };
 
+void TetrisPlayer::directEnemies() {
+    unsigned ready = 0;
+    for (int lane = 0; lane < 4; ++lane) {
+        const NormalEntity* enemy = enemyOnLanes[lane];
+        if (enemy == nullptr || enemy->isDead || enemy->isAttacking) continue;
+        // fairies do not wait until they arrived (DebuffFairy::attackPlayer())
+        if (enemy->isSpawning && !enemy->stats.isFairy()) continue;
+        ready |= 1u << lane;
+    }
+
+    const unsigned attacks = director.tick(ready, [](const int bound) { return rand() % bound; });
+    for (int lane = 0; lane < 4; ++lane) {
+        if (attacks & (1u << lane)) enemyOnLanes[lane]->attackPlayer();
+    }
+}
+
 void TetrisPlayer::moveToLane(const int targetLane) {
     if (this->isMovingToAnotherLane || this->isAttacking || !this->gameStarted || this->isGameOver) return; // prevent overlapping
     this->isMovingToAnotherLane = true;
@@ -256,7 +376,12 @@ void TetrisPlayer::onDamageSend(const int damage) {
         firstDamageInflictedTime = System::currentTimeMillis();
     }
     totalDamage += damage;
-    if (accumulatedCharge < 40) {
+    // VS: the attack goes to the CPU's garbage queue, there is no charge
+    if (rival) {
+        rival->receiveGarbage(damage);
+        return;
+    }
+    if (accumulatedCharge < defaultPveRules().chargeCap) {
         addStats(true, damage);
     } else {
         // overflow, then send the entire shit away
@@ -271,23 +396,18 @@ void TetrisPlayer::inflictDamage(int damage, int oldLane) {
         return;
     }
 
-    if (currentArmorPoints > 0 && !sFragile) {
-        if (currentArmorPoints == 1) {
-            damage *= 0.75;
-            --currentArmorPoints;
-            spawnMiscIndicator(270, 55, "-1", 0xc9c9c9);
-        } else {
-            damage *= 0.5;
-            currentArmorPoints -= 2;
-            spawnMiscIndicator(270, 55, "-2", 0xc9c9c9);
-        }
+    // armor (see PveRules::absorbDamage())
+    const int armorBefore = currentArmorPoints;
+    damage = defaultPveRules().absorbDamage(damage, currentArmorPoints, sFragile);
+    if (currentArmorPoints != armorBefore) {
+        spawnMiscIndicator(270, 55, "-" + to_string(armorBefore - currentArmorPoints), 0xc9c9c9);
     } else if (sFragile) {
         // ineffective
         spawnMiscIndicator(270, 55, "-0", 0xc9c9c9);
     }
 
-    damage = max(1, damage);
     garbageQueue.push_back(damage);
+    director.onGarbage(damage);
     this->spawnDamageIndicator(getLocation().x + 40, getLocation().y + 20, damage, false);
 
     SysAudio::playSoundAsync(ENTITY_ATTACK_AUD, SysAudio::getSFXVolume(), false);
@@ -320,7 +440,7 @@ void TetrisPlayer::releaseDamageOnCurrentLane() {
         return; // if the enemy is attacking or playing the spawn animation, we cannot release damage
     }
 
-    const int finalDamage = accumulatedCharge * (sWeakness ? 0.75 : 1); // 25% less effective if weakness
+    const int finalDamage = defaultPveRules().releasedDamage(accumulatedCharge, sWeakness); // 25% less effective if weakness
     accumulatedCharge = 0; // reset charges
 
     // if there's no enemy on the current lane OR the enemy there is dead, user missed
@@ -353,10 +473,11 @@ void TetrisPlayer::releaseDamageOnCurrentLane() {
                 addStats(rewards.type == 1, rewards.amount);
                 // free the memory of the thing
                 this->enemyOnLanes[currentLaneRef] = nullptr; // mark the enemy as none
+                director.remove(currentLaneRef);
                 // increment the counter
                 waveKilledEnemies++;
                 totalKilledEnemies++;
-                if (waveKilledEnemies >= 4) {
+                if (waveKilledEnemies >= defaultPveRules().enemiesPerWave) {
                     onWaveCompletion();
                 }
             }
@@ -380,16 +501,23 @@ void TetrisPlayer::onMinoLocked(const int linesCleared) {
     if (linesCleared <= 0 && accumulatedCharge > 0) {
         releaseDamageOnCurrentLane();
     }
+    // the director only looks at the board when it changes
+    director.observeBoard(tetrisEngine->getState().rows);
 
     // manage the garbage thingy (rise garbage)
     // if empty, no garbage, we no care
     if (linesCleared <= 0 && !garbageQueue.empty()) {
         // queue the garbage up
-        int currentHoleIndex = rand() % 10; // the garbage hole
+        // the garbage hole, splitmix64 off the seed so the game replays the same
+        uint64_t z = (holeSeed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        int currentHoleIndex = static_cast<int>((z ^ (z >> 31)) % Bitboard::WIDTH);
         int amount = garbageQueue.front(); // amount of garbo to raise
         garbageQueue.pop_front();
 
         if (amount <= 0) return;
+        director.onGarbage(-amount); // from the queue to the board
         // lock the game while we raise the garbage
         tetrisEngine->gameInterrupt(true);
         // raise
@@ -400,6 +528,7 @@ void TetrisPlayer::onMinoLocked(const int linesCleared) {
                 if (i >= amount - 1) {
                     // resume
                     tetrisEngine->gameInterrupt(false);
+                    director.observeBoard(tetrisEngine->getState().rows);
                 }
             });
         }
@@ -424,32 +553,17 @@ void TetrisPlayer::playFieldEvent(const PlayfieldEvent& event) {
         score += max(0, currentBackToBack) * 50; // each back to back gives +50 score
 
         tetrisScore += static_cast<long long>(score);
-        if (const int newLevel = 1 + (clearedLines / LEVEL_THRESHOLD); newLevel != currentTetrisLevel) {
+        if (const int newLevel = defaultPveRules().level(clearedLines); newLevel != currentTetrisLevel) {
             updateLevelAndGravity(newLevel);
         }
     }
 
     // check for back-to-back events
-    if (cleared >= 4 || ((event.isSpin() || event.isMiniSpin()) && cleared > 0)) {
-        currentBackToBack++; // increase back-to-back count
-        //if (currentBackToBack >= 1) setTextFor(this.backToBackInd, "&6&lB2B x" + this.currentBackToBack); // Update the back-to-back indicator
-    } else if (cleared > 0 && currentBackToBack > 0) {
-        currentBackToBack = -1; // Reset back-to-back count
-        //setTextFor(this.backToBackInd, "&c&lB2B x0"); // Update the back-to-back indicator
-        //engine.scheduleDelayedTask(30, () -> setTextFor(this.backToBackInd, "")); // Clear back-to-back indicator after delay
-    }
-
-    // calculate damage throughput
-    int baseDamage = cleared >= 4 ? cleared : (cleared <= 1 ? 0 : (cleared == 2 ? 1 : 2));
-    // spin bonus
-    if (event.isSpin()) {
-        baseDamage = cleared * 2;
-    }
+    currentBackToBack = AttackRules::nextBackToBack(currentBackToBack, cleared, event.isSpin(), event.isMiniSpin());
 
-    // b2b bonus
-    baseDamage += max(0, currentBackToBack);
-    // combo bonus (primitive)
-    baseDamage += static_cast<int>(tetrisEngine->getComboCount() * 0.75);
+    // calculate damage throughput (b2b, combo and perfect clear bonuses included)
+    int baseDamage = AttackRules::attack(cleared, event.isSpin(), event.isPerfectClear(), currentBackToBack,
+                                         tetrisEngine->getComboCount());
 
     // play audio
     if (cleared > 0) {
@@ -462,9 +576,8 @@ void TetrisPlayer::playFieldEvent(const PlayfieldEvent& event) {
         }
     }
 
-    // a perfect clear = +12 attack
+    // a perfect clear = +12 attack (counted above)
     if (event.isPerfectClear()) {
-        baseDamage += 12;
         // TODO: add the thing later
         SysAudio::playSoundAsync(LC_PERFC_AUD, SysAudio::getSFXVolume(), false);
     }
@@ -499,6 +612,7 @@ void TetrisPlayer::playFieldEvent(const PlayfieldEvent& event) {
             baseDamage = 0;
         }
     }
+    director.onGarbage(-counteredDamage);
 
     // if the player countered damage, show it (left side)
     if (counteredDamage > 0) spawnPriorityIndicator(230, 640, to_string(counteredDamage), MINO_COLORS[5]);
@@ -510,7 +624,7 @@ void TetrisPlayer::playFieldEvent(const PlayfieldEvent& event) {
 void TetrisPlayer::updateLevelAndGravity(const int newLevel) {
     currentTetrisLevel = min(15, newLevel);
     // increase engine gravity
-    this->tetrisEngine->getCurrentConfig()->setGravity(LEVELS_GRAVITY[min(15, currentTetrisLevel)]);
+    this->tetrisEngine->getCurrentConfig()->setGravitySubcells(defaultPveRules().levelGravity[currentTetrisLevel]);
     this->tetrisEngine->updateMutableConfig(sSuperSonic);
 }
 
@@ -670,7 +784,7 @@ void TetrisPlayer::renderTetrisStatistics(const int ox, const int oy) {
 
     // render the goal
     render_component_string_rvs(renderer, 1306 + (gap * 2), 795, "goal", 1.55, 1, 15, 14);
-    render_component_string_rvs(renderer, 1300 + (gap * 2) + 6, 820, gamemode == ENDLESS ? "none" : " 20 ", 2, 1, 17, 12);
+    render_component_string_rvs(renderer, 1300 + (gap * 2) + 6, 820, gamemode == CAMPAIGN ? " 20 " : "none", 2, 1, 17, 12);
 
     // render a small logo
     auto logo = disk_cache::bmp_load_and_cache(renderer, GAME_LOGO_SHEET);
@@ -681,7 +795,7 @@ void TetrisPlayer::renderTetrisStatistics(const int ox, const int oy) {
     render_component(renderer, logo, logoStruct, 1);
 }
 
-void TetrisPlayer::renderGarbageQueue(const int ox, const int oy) {
+void TetrisPlayer::renderGarbageQueue(const int ox, const int oy, const deque<int>& queue) {
     const int GBQ_X_OFFSET = ox - (MINO_SIZE) + 180;
     const int GBQ_Y_OFFSET = oy + (Y_OFFSET) + 540;
 
@@ -690,7 +804,7 @@ void TetrisPlayer::renderGarbageQueue(const int ox, const int oy) {
 
     // garbage is red
     SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255); // red
-    for (auto &garbo : garbageQueue) {
+    for (auto &garbo : queue) {
         if (garbo <= 0) continue;
         int toRisePixels = 30 * garbo; // each 30 pixels represent a line in the matrix (playfield)
 
@@ -717,10 +831,15 @@ void TetrisPlayer::renderTetrisInterface(const int ox, const int oy) {
 
     // render the board body first
     render_tetris_board(ox + shakeFactor, oy + boardDrop, renderer, this->tetrisEngine, isInvisible);
+    // the practice hint goes over it, like a second ghost
+    Hint hint;
+    if (hints && showHints && !isInvisible && !isGameOver && hints->getHint(hint)) {
+        render_placement_hint(ox + shakeFactor, oy + boardDrop, renderer, hint.type, hint.placement.rotation, hint.placement.x, hint.placement.y, MINO_COLORS[hint.type]);
+    }
     // and then the statistics
     renderTetrisStatistics(ox, oy + boardDrop);
     // render garbage queue
-    renderGarbageQueue(ox + shakeFactor, oy + boardDrop);
+    renderGarbageQueue(ox + shakeFactor, oy + boardDrop, garbageQueue);
 
     // count down the rumble
     if (boardRumble > 0) {
@@ -728,6 +847,18 @@ void TetrisPlayer::renderTetrisInterface(const int ox, const int oy) {
     }
 }
 
+void TetrisPlayer::renderRivalBoard(const int ox, const int oy) {
+    // the CPU only ticks on this thread, its engine can be read as it is
+    render_tetris_board(ox, oy, renderer, rival->getEngine(), false);
+    renderGarbageQueue(ox, oy, rival->getGarbageQueue());
+
+    // who it is, and how fast it goes
+    const double secondsElapsed = gameStartTime == -1 ? 0 : (System::currentTimeMillis() - gameStartTime) / 1000.0;
+    const auto ppsString = str_printf("%.2f/s", secondsElapsed > 0 ? rival->getPiecesPlaced() / secondsElapsed : 0.0);
+    render_component_string(renderer, ox + PLAYFIELD_RENDER_OFFSET, oy + 15, "cpu", 2, 1, 26);
+    render_component_string(renderer, ox + PLAYFIELD_RENDER_OFFSET + 130, oy + 20, ppsString, 1.55, 1, 15, 14);
+}
+
 void TetrisPlayer::onWaveCompletion() {
     // audio cue
     SysAudio::playSoundAsync(WAVE_CLEAR_AUD, SysAudio::getSFXVolume(), false);
@@ -735,8 +866,9 @@ void TetrisPlayer::onWaveCompletion() {
 
     // rewards
     this->tetrisEngine->scheduleDelayedTask(30, [&]() {
-        int amount = 2 + lastWaveDifficulty + (rand() % 10);
-        bool isArmor = (rand() % 2) == 1;
+        const KillRewards rewards = defaultPveRules().waveRewards(lastWaveDifficulty, [](const int bound) { return rand() % bound; });
+        const int amount = rewards.amount;
+        const bool isArmor = rewards.type == 0;
 
         addStats(!isArmor, amount);
         spawnPhysicsBoundText("+" + to_string(amount) + " " + (isArmor ? "armor" : "attack") + "!", 1600, 480, -10, 0, 300, 0, 4, 50, 15, nullptr, !isArmor ? MINO_COLORS[5] : 0xc9c9c9);
@@ -747,7 +879,7 @@ void TetrisPlayer::onWaveCompletion() {
         if (this->isGameOver) return;
 
         // if this level is 20 and campaign mode, end the game now
-        if (lastWave >= 20 && gamemode == CAMPAIGN) {
+        if (lastWave >= defaultPveRules().campaignWaves && gamemode == CAMPAIGN) {
             this->isGameOver = true; // stop players from controlling the game
             this->tetrisEngine->gameInterrupt(true);
             // fade the game out
@@ -771,7 +903,7 @@ void TetrisPlayer::showGameOverScreen(const bool lost) {
         auto* gameOver = new GameOverScreen({
             tetrisScore, totalKilledEnemies,
              totalDamage, lastWave - (lost ? 1 : 0), lost, System::currentTimeMillis() - this->gameStartTime,
-             gamemode == ENDLESS
+             gamemode == ENDLESS, gamemode == VERSUS
         }, context, renderer);
         // this screen takes over
         gameOver->startScene();
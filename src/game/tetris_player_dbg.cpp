@@ -10,7 +10,7 @@ void TetrisPlayer::sprintfcdbg(TetrisEngine *tetris, int spriteCount) {
 
     char buffer[50];
 
-    snprintf(buffer, sizeof(buffer), "tps: %.2f", tetris->ticksPassed / ((System::currentTimeMillis() - tetris->startedAt) / 1000.0));
+    snprintf(buffer, sizeof(buffer), "tps: %.2f", tetris->getTicksPassed() / ((System::currentTimeMillis() - tetris->startedAt) / 1000.0));
     render_component_string(renderer, xPos, 670 + offset, buffer, 2, 1, fontSize);
 
     snprintf(buffer, sizeof(buffer), "cpu: %.2f", tetris->lastTickTime);
@@ -30,34 +30,21 @@ void TetrisPlayer::sprintfcdbg(TetrisEngine *tetris, int spriteCount) {
 
 void TetrisPlayer::processSceneInput(SDL_Event &event) {
     if (this->isGameOver) return;
+    // the engine applies these at the start of the next tick, in the order they were pressed
+    const Uint32 pressedAt = event.common.timestamp;
     if (event.type == SDL_KEYDOWN && !event.key.repeat) {  // avoid key repeat events
         // uh wtf
         switch (event.key.keysym.sym) {
-            case SDLK_LEFT: {
-                // move left one time first
-                tetrisEngine->moveLeft();
-                // and then do DAS
-                leftHeld = true;
-                leftPressTime = System::currentTimeMillis();
-                nextLeftShiftTime = leftPressTime + DAS; // the next time it "repeats" the moving action again
-                break;
-            }
-            case SDLK_RIGHT: {
-                // move right one time first
-                tetrisEngine->moveRight();
-                // DAS right
-                rightHeld = true;
-                rightPressTime = System::currentTimeMillis();
-                nextRightShiftTime = rightPressTime + DAS;  // the next time it "repeats" the moving action again
-                break;
-            }
+            // move one time first, and then DAS/ARR (handled by the engine)
+            case SDLK_LEFT: { tetrisEngine->queueInput(INPUT_LEFT_DOWN, pressedAt); break; }
+            case SDLK_RIGHT: { tetrisEngine->queueInput(INPUT_RIGHT_DOWN, pressedAt); break; }
             case SDLK_UP: // ^ + x = the same
-            case SDLK_x: { tetrisEngine->rotateCW(); break; }
-            case SDLK_z: { tetrisEngine->rotateCCW(); break; }
+            case SDLK_x: { tetrisEngine->queueInput(INPUT_ROTATE_CW, pressedAt); break; }
+            case SDLK_z: { tetrisEngine->queueInput(INPUT_ROTATE_CCW, pressedAt); break; }
             // gravity *= SDF const
-            case SDLK_DOWN: { tetrisEngine->softDropToggle(true); break; }
-            case SDLK_SPACE: { tetrisEngine->hardDrop(); break; }
-            case SDLK_c: { tetrisEngine->hold(); break; }
+            case SDLK_DOWN: { tetrisEngine->queueInput(INPUT_SOFT_DROP_DOWN, pressedAt); break; }
+            case SDLK_SPACE: { tetrisEngine->queueInput(INPUT_HARD_DROP, pressedAt); break; }
+            case SDLK_c: { tetrisEngine->queueInput(INPUT_HOLD, pressedAt); break; }
 #ifdef DEBUG_BUILD
             case SDLK_t: { inflictDamage(12, currentLane); break; }
 #endif
@@ -77,6 +64,9 @@ void TetrisPlayer::processSceneInput(SDL_Event &event) {
                 break;
             default: break;
             /* BULLSHIT */
+            case SDLK_F2:
+                setHintsShown(!showHints);
+                break;
             case SDLK_F3:
                 showDebug = !showDebug;
                 break;
@@ -86,17 +76,17 @@ void TetrisPlayer::processSceneInput(SDL_Event &event) {
         switch (event.key.keysym.sym) {
             case SDLK_LEFT: {
                 // no longer holding LEFT
-                leftHeld = false;
+                tetrisEngine->queueInput(INPUT_LEFT_UP, pressedAt);
                 break;
             }
             case SDLK_RIGHT: {
                 // no longer holding RIGHT
-                rightHeld = false;
+                tetrisEngine->queueInput(INPUT_RIGHT_UP, pressedAt);
                 break;
             }
             case SDLK_DOWN: {
                 // no speed boost (SDF)
-                tetrisEngine->softDropToggle(false);
+                tetrisEngine->queueInput(INPUT_SOFT_DROP_UP, pressedAt);
                 break;
             }
             default: break;
@@ -7,6 +7,7 @@
 #include <utility>
 
 #include "../engine/tetris_engine.h"
+#include "../engine/bitboard.h"
 #include "sdl_components.h"
 
 // because the internal Enums' ordinal and the sprite.bmp uses different indexes, we map INTERNAL -> BMP
@@ -127,7 +128,7 @@ inline void render_tetris_board(const int ox, const int oy, SDL_Renderer* render
     // the board will pulse red once the 17th row has a mino in it
     if (!engine->isRowEmpty(DANGER_THRESHOLD)) {
         // pulsing red (based on tick rate)
-        const double pulseStrength = ((sin(engine->ticksPassed * 0.1) + 2) / 4) + 0.25; // what the fuck
+        const double pulseStrength = ((sin(engine->getTicksPassed() * 0.1) + 2) / 4) + 0.25; // what the fuck
         SDL_SetRenderDrawColor(renderer, 255 * pulseStrength, 0, 0, 255); // red
     } else {
         SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // white
@@ -219,4 +220,23 @@ inline void render_tetris_board(const int ox, const int oy, SDL_Renderer* render
         }
     }
 }
+// outline where a piece should go (practice hints), same grid as render_tetris_board
+inline void render_placement_hint(const int ox, const int oy, SDL_Renderer* renderer, const int type, const int rotation, const int px, const int py, const int color) {
+    const Bitboard::PieceShape& shape = Bitboard::SHAPES.shapes[type][rotation];
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF, 220);
+    for (int r = 0; r < shape.size; ++r) {
+        for (int c = 0; c < shape.size; ++c) {
+            if (!((shape.rows[r] >> c) & 1)) continue;
+            const int y = py + r - 18; // the buffer zone is hidden, same as the playfield
+            if (y < 0) continue;
+            // 3 pixels thick, inside the cell
+            for (int inset = 0; inset < 3; ++inset) {
+                const SDL_Rect cell = {ox + PLAYFIELD_RENDER_OFFSET + (MINO_SIZE * (px + c)) + inset, oy + (MINO_SIZE * y) + inset, MINO_SIZE - (2 * inset), MINO_SIZE - (2 * inset)};
+                SDL_RenderDrawRect(renderer, &cell);
+            }
+        }
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+}
 #endif //SDL_INC_H
@@ -12,19 +12,29 @@ class SevenBagGenerator : public TetrominoGenerator {
 public:
     class TetrioRNG {
     private:
-        mutable long t;
+        // 64-bit on every platform, 16807 * t overflows a 32-bit long (MSVC/MinGW)
+        mutable int64_t t;
     public:
-        explicit TetrioRNG(long seed) : t(seed % 2147483647) {
+        explicit TetrioRNG(int64_t seed) : t(seed % 2147483647) {
             if (t <= 0) {
                 t += 2147483646;
             }
         }
 
-        long next() {
+        int64_t next() {
             t = (16807 * t) % 2147483647;
             return t;
         }
 
+        // raw state, for snapshots
+        int64_t getState() const {
+            return t;
+        }
+
+        void setState(int64_t state) {
+            t = state;
+        }
+
         float nextFloat() {
             float result = static_cast<float>(next() - 1) / 2147483646.0f;
             // replicates java
@@ -67,7 +77,7 @@ private:
         bag.push_back(&MinoType::J_MINO);
         bag.push_back(&MinoType::T_MINO);
 
-        srand(System::currentTimeMillis());
+        // the seed alone decides the order (replays and lockstep rely on it), no rand() in here
         random.shuffleList(this->bag);
     }
 
@@ -76,7 +86,7 @@ public:
      * Constructor.
      * @param seed Seed for the RNG.
      */
-    explicit SevenBagGenerator(long seed) : random(seed) {
+    explicit SevenBagGenerator(int64_t seed) : random(seed) {
         refillBag();
     }
 
@@ -107,6 +117,31 @@ public:
         bag.erase(bag.begin());
         return nextMino;
     }
+
+    bool saveState(TetrominoGeneratorState& out) const override {
+        out.rngState = random.getState();
+        out.bagSize = static_cast<int8_t>(bag.size());
+        for (std::size_t i = 0; i < bag.size(); ++i) {
+            out.bag[i] = static_cast<int8_t>(bag[i]->ordinal);
+        }
+        return true;
+    }
+
+    bool restoreState(const TetrominoGeneratorState& in) override {
+        // only what saveState() can write: a state of the Park-Miller RNG, at most a whole bag
+        if (in.rngState < 1 || in.rngState > 2147483646) return false;
+        if (in.bagSize < 0 || in.bagSize > MinoType::valuesLength) return false;
+        for (int i = 0; i < in.bagSize; ++i) {
+            if (in.bag[i] < 0 || in.bag[i] >= MinoType::valuesLength) return false;
+        }
+
+        random.setState(in.rngState);
+        bag.clear();
+        for (int i = 0; i < in.bagSize; ++i) {
+            bag.push_back(MinoType::fromOrdinal(in.bag[i]));
+        }
+        return true;
+    }
 };
 
 #endif //TETISENGINE_BAG_GENERATOR_H
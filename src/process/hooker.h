@@ -33,6 +33,12 @@ protected:
     unordered_map<int, function<void()>> ON_UNHOOK_SUCCESS_CALLBACK;
 public:
     function<void()> contextReturnMainMenu = nullptr;
+    // the bot that plays every game (-bot), empty = the player does
+    string externalBotCommand;
+    // placement hints from the first piece (-practice), F2 toggles them in any game
+    bool practiceHints = false;
+    // how fast the CPU of VS mode plays (-rival-pps), pieces per second
+    double rivalPps = 1.5;
 
     /**
      * Hook a task into this Context
@@ -21,6 +21,7 @@ typedef struct {
     bool lost;
     long long gameLength;
     bool endless;
+    bool versus;
 } GameOverInfo;
 
 class GameOverScreen : public GameScene {
@@ -41,14 +42,14 @@ class GameOverScreen : public GameScene {
 
     int clock;
     void menuLoop() {
-        string text = info.lost ? "game over!" : "stage clear!";
+        string text = info.lost ? "game over!" : (info.versus ? "you win!" : "stage clear!");
         renderWavyString(CENTER_X_POS + 260, CENTER_Y_POS - 280, text, 4, 60);
 
         const int infoTitleX = CENTER_X_POS - 70;
         const int infoTitleY = CENTER_Y_POS - 80;
 
         // render mode
-        Button::renderString(renderer, infoTitleX + 120, CENTER_Y_POS - 200, (info.endless ? "endless " : "campaign") + std::string(" mode"), 2, 1, 30);
+        Button::renderString(renderer, infoTitleX + 120, CENTER_Y_POS - 200, (info.versus ? "versus  " : info.endless ? "endless " : "campaign") + std::string(" mode"), 2, 1, 30);
 
         // render info - score
         Button::renderString(renderer, infoTitleX, infoTitleY, "score:", 2, 1, 30);
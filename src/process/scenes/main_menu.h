@@ -68,12 +68,15 @@ class MainMenu : public GameScene {
             SysAudio::stopAudio();
 
             // initialize 7 bag gen with seed = current time
-            TetrominoGenerator* generator = new SevenBagGenerator(System::currentTimeMillis());
+            const int64_t seed = System::currentTimeMillis();
+            TetrominoGenerator* generator = new SevenBagGenerator(seed);
             TetrisConfig* config = TetrisConfig::builder();
             config->setLineClearsDelay(0.35);
 
             auto* engine = new TetrisEngine(config, generator);
-            auto* player = new TetrisPlayer(icontext, irenderer, engine, mode);
+            auto* player = new TetrisPlayer(icontext, irenderer, engine, seed, mode);
+            // the CPU gets the same pieces
+            if (mode == VERSUS) player->startRival(seed);
 
             // start scene first
             player->startScene();
@@ -104,6 +107,14 @@ class MainMenu : public GameScene {
         endlessButton->teleport(MENU_X_POS, MENU_Y_POS + 60);
         endlessButton->spawn();
 
+        // PLAY VERSUS BUTTON
+        Button* versusButton = (new Button(600, 50, "play versus", 70, -5));
+        versusButton->onButtonClick([&](int m) {
+            startTetrisGame(GameMode::VERSUS);
+        });
+        versusButton->teleport(MENU_X_POS, MENU_Y_POS + 120);
+        versusButton->spawn();
+
         // SETTINGS BUTTON
         Button* settingsButton = (new Button(300, 50, "settings", 7, -5));
         settingsButton->onButtonClick([](int m) {
@@ -114,7 +125,7 @@ class MainMenu : public GameScene {
                     nullptr
             );
         });
-        settingsButton->teleport(MENU_X_POS + 10, MENU_Y_POS + 150);
+        settingsButton->teleport(MENU_X_POS + 10, MENU_Y_POS + 210);
         settingsButton->spawn();
 
         // QUIT BUTTON
@@ -123,12 +134,13 @@ class MainMenu : public GameScene {
             // quit the game, that's it
             exit(0);
         });
-        quitButton->teleport(MENU_X_POS + 10 + 300, MENU_Y_POS + 150);
+        quitButton->teleport(MENU_X_POS + 10 + 300, MENU_Y_POS + 210);
         quitButton->spawn();
 
         // boilerplate
         campaignButton->onButtonHover([]() {});
         endlessButton->onButtonHover([]() {});
+        versusButton->onButtonHover([]() {});
         settingsButton->onButtonHover(  []() {});
         quitButton->onButtonHover([]() {});
     }
@@ -16,11 +16,20 @@ void AttachConsoleToSDL() {
 #define WINDOW_WIDTH 1720
 
 int main(int argc, char* argv[]) {
-    // attach console to this game window
+    // attach console to this game window, -bot "<command>" lets an external bot play, -practice shows hints,
+    // -rival-pps N caps the CPU of VS mode
+    string botCommand;
+    bool practiceHints = false;
+    double rivalPps = 1.5;
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "-console") == 0) {
             AttachConsoleToSDL();
-            break;
+        } else if (strcmp(argv[i], "-bot") == 0 && i + 1 < argc) {
+            botCommand = argv[++i];
+        } else if (strcmp(argv[i], "-practice") == 0) {
+            practiceHints = true;
+        } else if (strcmp(argv[i], "-rival-pps") == 0 && i + 1 < argc) {
+            rivalPps = max(0.1, atof(argv[++i]));
         }
     }
 
@@ -31,6 +40,9 @@ int main(int argc, char* argv[]) {
 
     // create the execution context for the entire lifecycle
     auto* context = new ExecutionContext();
+    context->externalBotCommand = botCommand;
+    context->practiceHints = practiceHints;
+    context->rivalPps = rivalPps;
     initFontSystem(); // the loading screen uses font, too (this is fast)
     srand(System::currentTimeMillis()); // main thread rng
 
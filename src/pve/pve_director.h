@@ -0,0 +1,183 @@
+#ifndef TETISENGINE_PVE_DIRECTOR_H
+#define TETISENGINE_PVE_DIRECTOR_H
+#pragma once
+#include <cstdint>
+#include <climits>
+#include <algorithm>
+#include "pve_rules.h"
+#include "../engine/bitboard.h"
+
+/**
+ * Decides when the enemies attack, from how much trouble the player is in.
+ *
+ * The danger (permille) is the stack height plus the garbage waiting to rise plus half a row per
+ * hole, over PveRules::directorRows. It only changes when the board or the garbage queue does, so
+ * it is kept up to date from those events (observeBoard(), onGarbage()) and tick() only adds
+ * numbers: every enemy fills up towards its rolled interval (PveRules::attackInterval()) faster
+ * when the player is below the target danger and slower above it, within the same 70%-130% the
+ * intervals are rolled in. On top of that two attacks keep some room between them, and the
+ * fairies hold their debuffs while the player is drowning, both for a while at most.
+ *
+ * With PveRules::director = 0 it is the shipped cadence (NormalEntity::onDrawCall()) instead:
+ * every second an enemy counts one more and rolls its interval again, it attacks once the count
+ * reaches the roll, and an enemy that isn't ready then loses that attack.
+ *
+ * Usage (both the game and PveSession):
+ * <pre>
+ *     EnemyDirector director(rules);
+ *     director.spawn(lane, stats, roll); // and remove(lane) when it dies
+ *     director.observeBoard(rows); // after every lock and garbage rise
+ *     director.onGarbage(+lines); // hit, and -lines when it rises or gets cancelled
+ *     unsigned attacks = director.tick(readyLanes, roll); // every tick, bit N = lane N attacks now
+ * </pre>
+ */
+class EnemyDirector {
+public:
+    static constexpr int LANES = 4;
+    static constexpr int TICKS_PER_SECOND = 60; // EngineTimer::TARGETTED_TICK_RATE
+
+    /**
+     * @param rules the balance (and the director's knobs), must outlive the director
+     */
+    explicit EnemyDirector(const PveRules &rules) : rules(&rules) {
+        updatePace();
+    }
+
+    /**
+     * Height and holes of the board, a pass over the rows (call it when the board changed)
+     * @param rows Bitboard::HEIGHT rows, row 0 is the top
+     */
+    void observeBoard(const uint16_t *rows) {
+        int filled = 0, holeCount = 0;
+        uint16_t covered = 0; // columns with something above
+        for (int y = 0; y < Bitboard::HEIGHT; ++y) {
+            if (rows[y] == 0) continue; // empty, or a cleared row that did not fall yet
+            ++filled;
+            holeCount += __builtin_popcount(covered & ~rows[y]);
+            covered |= rows[y];
+        }
+        height = filled;
+        holes = holeCount;
+        updatePace();
+    }
+
+    /**
+     * The garbage queue grew (a hit) or shrank (lines rose, or were cancelled by an attack)
+     */
+    void onGarbage(const int lines) {
+        garbage = std::max(0, garbage + lines);
+        updatePace();
+    }
+
+    /**
+     * A new enemy on a lane, its first attack is an interval away
+     * @param roll roll(n) gives a random number in [0, n)
+     */
+    template<typename Roll> void spawn(const int lane, const EnemyStats &stats, Roll &&roll) {
+        Lane &slot = lanes[lane];
+        slot.present = true;
+        slot.fairy = stats.isFairy();
+        slot.stats = stats;
+        slot.progress = 0;
+        slot.held = 0;
+        slot.secondTicks = 0;
+        slot.seconds = 0;
+        slot.due = rules->director ? dueOf(stats, roll) : 0;
+    }
+
+    void remove(const int lane) {
+        lanes[lane].present = false;
+    }
+
+    /**
+     * One tick for every lane
+     * @param ready bit N = the enemy of lane N can attack now (not attacking, not walking in...),
+     *              an attack that is due waits until it is
+     * @return bit N = the enemy of lane N attacks now
+     */
+    template<typename Roll> unsigned tick(const unsigned ready, Roll &&roll) {
+        unsigned attacks = 0;
+        ++ticks;
+        for (int lane = 0; lane < LANES; ++lane) {
+            Lane &slot = lanes[lane];
+            if (!slot.present) continue;
+            if (!rules->director) {
+                // the interval is rolled again on every check, not once per attack
+                if (++slot.secondTicks % TICKS_PER_SECOND != 0 || ++slot.seconds < rules->attackInterval(slot.stats, roll)) continue;
+                slot.seconds = 0;
+                if (ready & (1u << lane)) {
+                    attacks |= 1u << lane;
+                    lastAttack = ticks;
+                }
+                continue;
+            }
+            slot.progress += pace;
+            if (slot.progress < slot.due || !(ready & (1u << lane))) continue;
+
+            if (rules->director && slot.held < rules->directorMaxHold) {
+                const bool tooSoon = ticks - lastAttack < rules->directorSpacing;
+                const bool spare = slot.fairy && danger > rules->directorDebuffCeiling;
+                if (tooSoon || spare) {
+                    ++slot.held;
+                    continue;
+                }
+            }
+            attacks |= 1u << lane;
+            lastAttack = ticks;
+            slot.progress = 0;
+            slot.held = 0;
+            slot.due = dueOf(slot.stats, roll);
+        }
+        return attacks;
+    }
+
+    // permille, see the class
+    int getDanger() const {
+        return danger;
+    }
+
+    int getHeight() const {
+        return height;
+    }
+
+    int getHoles() const {
+        return holes;
+    }
+
+    int getGarbage() const {
+        return garbage;
+    }
+
+private:
+    struct Lane {
+        bool present = false, fairy = false;
+        EnemyStats stats{};
+        int64_t progress = 0, due = 0; // in ticks * 1000, it attacks once progress reaches due
+        int held = 0; // ticks it waited while due
+        int secondTicks = 0, seconds = 0; // director = 0 only: ticks since it spawned, seconds counted towards the roll
+    };
+
+    const PveRules *rules;
+    Lane lanes[LANES];
+    int height = 0, holes = 0, garbage = 0;
+    int danger = 0;
+    int pace = 1000; // added to every lane's progress per tick, 1000 = the rolled intervals as they are
+    int64_t ticks = 0, lastAttack = INT32_MIN;
+
+    template<typename Roll> int64_t dueOf(const EnemyStats &stats, Roll &&roll) const {
+        return static_cast<int64_t>(rules->attackInterval(stats, roll)) * TICKS_PER_SECOND * 1000;
+    }
+
+    void updatePace() {
+        const int rows = std::max(1, rules->directorRows);
+        danger = std::min(1000, (height + garbage + holes / 2) * 1000 / rows);
+        if (!rules->director) {
+            pace = 1000;
+            return;
+        }
+        // below the target = faster, within 1 / 130% and 1 / 70% of the normal pace
+        pace = std::clamp(1000 + rules->directorTarget - danger, 769, 1428);
+    }
+};
+
+#endif //TETISENGINE_PVE_DIRECTOR_H
@@ -0,0 +1,350 @@
+#ifndef TETISENGINE_PVE_RULES_H
+#define TETISENGINE_PVE_RULES_H
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+// available debuff(s)
+enum Debuff {
+    BLIND,
+    NO_HOLD,
+    SUPER_SONIC,
+    WEAKNESS,
+    FRAGILE
+};
+static constexpr int DEBUFF_COUNT = 5;
+
+typedef enum {
+    HARD,
+    MEDIUM,
+    EASY
+} EnemyDifficulty;
+
+enum WaveDifficulty {
+    WAVE_EASY,
+    WAVE_MEDIUM,
+    WAVE_HARD
+};
+
+enum GameMode {
+    CAMPAIGN,
+    ENDLESS,
+    VERSUS, // against a CPU board instead of the enemies (the game only, see RivalBoard)
+};
+
+typedef struct {
+    int type; // 0 = armor, 1 = energy, (-1 = none)
+    int amount;
+} KillRewards;
+
+/**
+ * Every monster a wave can roll
+ */
+enum EnemyKind {
+    ENEMY_GRIGGA,
+    ENEMY_BLUGGA,
+    ENEMY_REDGGA,
+    ENEMY_NIGGA,
+    ENEMY_WEAKENER_FAIRY,
+    ENEMY_DISTRACTOR_FAIRY,
+    ENEMY_BLINDER_FAIRY,
+    ENEMY_DISTURBER_FAIRY,
+    ENEMY_KIND_COUNT
+};
+
+struct EnemyStats {
+    const char *name; // lowercase, what PveRules::set() keys start with
+    int damageMin, damageMax; // garbage lines per hit (fairies: seconds of debuff)
+    double attackSpeed; // seconds between attacks, give or take 30%
+    EnemyDifficulty difficulty;
+    int maxHealth;
+    unsigned debuffs; // (1 << Debuff) of every debuff it can cast, 0 = deals damage instead
+    bool miniboss;
+
+    bool isFairy() const {
+        return debuffs != 0;
+    }
+};
+
+/**
+ * How long the animations of the game hold the PvE logic up, in ticks (60 TPS).
+ * The game gets these from its sprites (distance / speed, frames * frame speed), the headless
+ * session (PveSession) waits them out instead
+ */
+struct PveTimings {
+    int countdown = 180; // 3, 2, 1, go!
+    int firstWave = 170; // after the countdown
+    int spawnJitter = 80; // every enemy of a wave shows up within this
+    int enemyEnter = 60; // 300px at 5px/frame, cannot attack until then
+    int enemyWindup = 40; // ENTITY_APPROACH
+    int enemyTravel = 38; // ~560px at 15px/frame, then the hit
+    int enemyReturn = 56; // 10px/frame
+    int playerWindup = 30; // RUN_BACKWARD
+    int playerTravel = 31; // ~460px at 15px/frame, then the hit
+    int playerRecover = 92; // ATTACK_01 then 10px/frame back
+    int laneSwitch = 18; // per lane, ~180px at 10px/frame
+    int garbageRise = 5; // per garbage line, the game is paused meanwhile
+    int waveReward = 30; // after the last kill of a wave
+    int nextWave = 180; // after the last kill of a wave
+};
+
+/**
+ * The PvE balance: enemy stats, armor and charge math, wave composition and rewards.
+ * The game (TetrisPlayer and the entities) plays by defaultPveRules(), the headless
+ * simulations can play by any copy of it (see PveSession)
+ */
+struct PveRules {
+    EnemyStats enemies[ENEMY_KIND_COUNT] = {
+            // name, damage, attack speed, difficulty, HP, debuffs, miniboss
+            {"grigga", 1, 2, 30, EASY, 6, 0, false}, // 6HP (1 tetris + 1 double to clear)
+            {"blugga", 1, 4, 30, MEDIUM, 10, 0, false},
+            {"redgga", 2, 5, 20, HARD, 16, 0, false}, // 16HP (4 tetris(s) to clear)
+            {"nigga", 3, 6, 15, HARD, 20, 0, false}, // 20HP (5 tetris(s) to clear)
+            {"weakener", 8, 20, 30, MEDIUM, 18, (1u << WEAKNESS) | (1u << FRAGILE), true},
+            {"distractor", 10, 20, 30, MEDIUM, 16, 1u << SUPER_SONIC, true},
+            {"blinder", 10, 20, 28, HARD, 12, 1u << BLIND, true},
+            {"disturber", 15, 30, 30, EASY, 18, 1u << NO_HOLD, true},
+    };
+
+    // player
+    int chargeCap = 40; // an attack past this releases the charge instead of adding to it
+    double weaknessFactor = 0.75; // releases deal this much under WEAKNESS
+    double lastArmorFactor = 0.75; // a hit on the last armor point (takes 1 point)
+    double armorFactor = 0.5; // a hit on 2+ armor points (takes 2 points)
+
+    // waves
+    int mediumFromWave = 3;
+    int hardFromWave = 6;
+    int campaignWaves = 20;
+    int enemiesPerWave = 4; // one per lane
+    int killRewardMax = 6; // 1..max armor or charge per kill
+    int waveRewardBase = 2; // + difficulty + 0..random-1 armor or charge per wave
+    int waveRewardRandom = 10;
+
+    // wave rolls (percent)
+    int easyGriggaChance = 60; // otherwise Blugga
+    int mediumFairyWaveChance = 60; // 3 mobs + 1 fairy, otherwise 4 mobs
+    int mediumBluggaChance = 50; // in a fairy wave, otherwise Grigga
+    int mediumRedggaChance = 10; // in a 4 mob wave, then Blugga, then Grigga
+    int mediumMobBluggaChance = 50;
+    int hardFairyWaveChance = 50; // 3 mobs + 1 fairy, otherwise 2 mobs + 2 fairies
+    int hardNiggaChance = 30; // then Redgga, then Blugga
+    int hardRedggaChance = 50;
+    int hardDuoNiggaChance = 30; // in a 2 fairy wave, otherwise Redgga
+
+    // gravity goes up a level every linesPerLevel lines
+    int linesPerLevel = 35;
+    int64_t levelGravity[16] = { // speed of each level, in subcells (see GRAVITY_SUBCELLS_PER_CELL)
+            0, // lvl 0 does not exist
+            1092, // 0.01667G
+            1377, // 0.021017G
+            1768, // 0.026977G
+            2311, // 0.035256G
+            3076, // 0.04693G
+            4169, // 0.06361G
+            5761, // 0.0879G
+            8100, // 0.1236G
+            11633, // 0.1775G
+            17026, // 0.2598G
+            25428, // 0.388G
+            38666, // 0.59G
+            60293, // 0.92G
+            95683, // 1.46G
+            154665, // 2.36G
+    };
+
+    // the enemy director (see EnemyDirector), the danger is in permille
+    int director = 1; // 0 = the shipped cadence (the interval rolled again every second), whatever the board looks like
+    int directorTarget = 400; // the danger it keeps the player around
+    int directorRows = 20; // danger 1000 = this many rows of stack, garbage waiting and holes / 2
+    int directorDebuffCeiling = 600; // fairies hold their debuffs while the danger is over this
+    int directorSpacing = 60; // ticks between two attacks, of any lane
+    int directorMaxHold = 300; // ticks an attack that is due waits at most for the two above
+
+    PveTimings timings;
+
+    const EnemyStats &stats(const EnemyKind kind) const {
+        return enemies[kind];
+    }
+
+    WaveDifficulty waveDifficulty(const int wave) const {
+        if (wave >= hardFromWave) return WAVE_HARD;
+        if (wave >= mediumFromWave) return WAVE_MEDIUM;
+        return WAVE_EASY;
+    }
+
+    int level(const int clearedLines) const {
+        return std::min(15, 1 + clearedLines / std::max(1, linesPerLevel));
+    }
+
+    /**
+     * The enemies of a wave, lane 0 first
+     * @param roll roll(n) gives a random number in [0, n)
+     */
+    template<typename Roll> std::vector<EnemyKind> rollWave(const WaveDifficulty difficulty, Roll &&roll) const {
+        std::vector<EnemyKind> wave;
+        switch (difficulty) {
+            case WAVE_EASY:
+                // 4 random easy DPS mob
+                for (int i = 0; i < 4; ++i) {
+                    wave.push_back(roll(100) < easyGriggaChance ? ENEMY_GRIGGA : ENEMY_BLUGGA);
+                }
+                break;
+            case WAVE_MEDIUM:
+                // either 3dps + 1 fairy or 4dps (like easy)
+                if (roll(100) < mediumFairyWaveChance) {
+                    for (int i = 0; i < 3; ++i) {
+                        wave.push_back(roll(100) < mediumBluggaChance ? ENEMY_BLUGGA : ENEMY_GRIGGA);
+                    }
+                    // prefer medium fairies
+                    static constexpr EnemyKind fairies[] = {ENEMY_WEAKENER_FAIRY, ENEMY_DISTRACTOR_FAIRY, ENEMY_DISTURBER_FAIRY};
+                    wave.push_back(fairies[roll(3)]);
+                } else {
+                    for (int i = 0; i < 4; ++i) {
+                        const int dpsRoll = roll(100);
+                        if (dpsRoll < mediumRedggaChance) wave.push_back(ENEMY_REDGGA); // rare hard mob
+                        else if (dpsRoll < mediumRedggaChance + mediumMobBluggaChance) wave.push_back(ENEMY_BLUGGA);
+                        else wave.push_back(ENEMY_GRIGGA);
+                    }
+                }
+                break;
+            case WAVE_HARD:
+                // 3dps + 1fairy or 2 dps + 2 fairy (prioritize hardest ones)
+                if (roll(100) < hardFairyWaveChance) {
+                    for (int i = 0; i < 3; ++i) {
+                        const int dpsRoll = roll(100);
+                        if (dpsRoll < hardNiggaChance) wave.push_back(ENEMY_NIGGA);
+                        else if (dpsRoll < hardNiggaChance + hardRedggaChance) wave.push_back(ENEMY_REDGGA);
+                        else wave.push_back(ENEMY_BLUGGA);
+                    }
+                    static constexpr EnemyKind fairies[] = {ENEMY_WEAKENER_FAIRY, ENEMY_DISTRACTOR_FAIRY, ENEMY_BLINDER_FAIRY, ENEMY_DISTURBER_FAIRY};
+                    wave.push_back(fairies[roll(4)]);
+                } else {
+                    for (int i = 0; i < 2; ++i) {
+                        wave.push_back(roll(100) < hardDuoNiggaChance ? ENEMY_NIGGA : ENEMY_REDGGA);
+                    }
+                    static constexpr EnemyKind fairies[] = {ENEMY_WEAKENER_FAIRY, ENEMY_DISTRACTOR_FAIRY, ENEMY_BLINDER_FAIRY};
+                    wave.push_back(fairies[roll(3)]);
+                    wave.push_back(fairies[roll(3)]);
+                }
+                break;
+        }
+        return wave;
+    }
+
+    /**
+     * A hit on the player, after armor
+     * @param armor the armor points, the ones the hit breaks are taken off
+     * @param fragile FRAGILE is on (armor does nothing)
+     * @return the garbage lines that go to the garbage queue
+     */
+    int absorbDamage(int damage, int &armor, const bool fragile) const {
+        if (armor > 0 && !fragile) {
+            if (armor == 1) {
+                damage = static_cast<int>(damage * lastArmorFactor);
+                --armor;
+            } else {
+                damage = static_cast<int>(damage * armorFactor);
+                armor -= 2;
+            }
+        }
+        return std::max(1, damage);
+    }
+
+    // the damage a release of the whole charge deals
+    int releasedDamage(const int charge, const bool weakness) const {
+        return static_cast<int>(charge * (weakness ? weaknessFactor : 1));
+    }
+
+    // seconds between 2 attacks of an enemy, rolled again after every attack
+    template<typename Roll> int attackInterval(const EnemyStats &enemy, Roll &&roll) const {
+        const int minInterval = static_cast<int>(enemy.attackSpeed * 0.7); // 70%
+        const int maxInterval = static_cast<int>(enemy.attackSpeed * 1.3); // 130%
+        return minInterval + (maxInterval > minInterval ? roll(maxInterval - minInterval) : 0);
+    }
+
+    template<typename Roll> KillRewards killRewards(Roll &&roll) const {
+        const int type = roll(2);
+        return {type, roll(killRewardMax) + 1};
+    }
+
+    template<typename Roll> KillRewards waveRewards(const WaveDifficulty difficulty, Roll &&roll) const {
+        const int amount = waveRewardBase + difficulty + roll(waveRewardRandom);
+        const bool isArmor = roll(2) == 1;
+        return {isArmor ? 0 : 1, amount};
+    }
+
+    /**
+     * Change one knob by name, e.g. "charge_cap", "hard_from_wave" or "<enemy>.<stat>" with
+     * stat one of health, damage_min, damage_max, attack_speed ("redgga.health")
+     * @throws std::invalid_argument if there is no such knob
+     */
+    void set(const std::string &key, const double value) {
+        const size_t dot = key.find('.');
+        if (dot != std::string::npos) {
+            const std::string enemy = key.substr(0, dot), stat = key.substr(dot + 1);
+            for (EnemyStats &stats : enemies) {
+                if (enemy != stats.name) continue;
+                if (stat == "health") stats.maxHealth = static_cast<int>(value);
+                else if (stat == "damage_min") stats.damageMin = static_cast<int>(value);
+                else if (stat == "damage_max") stats.damageMax = static_cast<int>(value);
+                else if (stat == "attack_speed") stats.attackSpeed = value;
+                else throw std::invalid_argument("Unknown enemy stat: " + stat);
+                return;
+            }
+            throw std::invalid_argument("Unknown enemy: " + enemy);
+        }
+
+        struct Knob {
+            const char *name;
+            int PveRules::*integer;
+            double PveRules::*real;
+        };
+        static const Knob knobs[] = {
+                {"charge_cap", &PveRules::chargeCap, nullptr},
+                {"weakness_factor", nullptr, &PveRules::weaknessFactor},
+                {"last_armor_factor", nullptr, &PveRules::lastArmorFactor},
+                {"armor_factor", nullptr, &PveRules::armorFactor},
+                {"medium_from_wave", &PveRules::mediumFromWave, nullptr},
+                {"hard_from_wave", &PveRules::hardFromWave, nullptr},
+                {"campaign_waves", &PveRules::campaignWaves, nullptr},
+                {"kill_reward_max", &PveRules::killRewardMax, nullptr},
+                {"wave_reward_base", &PveRules::waveRewardBase, nullptr},
+                {"wave_reward_random", &PveRules::waveRewardRandom, nullptr},
+                {"easy_grigga_chance", &PveRules::easyGriggaChance, nullptr},
+                {"medium_fairy_wave_chance", &PveRules::mediumFairyWaveChance, nullptr},
+                {"medium_blugga_chance", &PveRules::mediumBluggaChance, nullptr},
+                {"medium_redgga_chance", &PveRules::mediumRedggaChance, nullptr},
+                {"medium_mob_blugga_chance", &PveRules::mediumMobBluggaChance, nullptr},
+                {"hard_fairy_wave_chance", &PveRules::hardFairyWaveChance, nullptr},
+                {"hard_nigga_chance", &PveRules::hardNiggaChance, nullptr},
+                {"hard_redgga_chance", &PveRules::hardRedggaChance, nullptr},
+                {"hard_duo_nigga_chance", &PveRules::hardDuoNiggaChance, nullptr},
+                {"lines_per_level", &PveRules::linesPerLevel, nullptr},
+                {"director", &PveRules::director, nullptr},
+                {"director_target", &PveRules::directorTarget, nullptr},
+                {"director_rows", &PveRules::directorRows, nullptr},
+                {"director_debuff_ceiling", &PveRules::directorDebuffCeiling, nullptr},
+                {"director_spacing", &PveRules::directorSpacing, nullptr},
+                {"director_max_hold", &PveRules::directorMaxHold, nullptr},
+        };
+        for (const Knob &knob : knobs) {
+            if (key != knob.name) continue;
+            if (knob.integer != nullptr) this->*knob.integer = static_cast<int>(value);
+            else this->*knob.real = value;
+            return;
+        }
+        throw std::invalid_argument("Unknown balance knob: " + key);
+    }
+};
+
+// the rules the game ships with
+inline const PveRules &defaultPveRules() {
+    static const PveRules rules;
+    return rules;
+}
+
+#endif //TETISENGINE_PVE_RULES_H
@@ -0,0 +1,322 @@
+#include <cstdlib>
+#include <cmath>
+#include "pve_session.h"
+#include "../engine/attack_rules.h"
+
+PveSession::PveSession(const PveRules &rules, const TetrisConfig &config, const PveSettings &settings)
+        : rules(rules), director(this->rules), settings(settings), config(config),
+          generator(std::make_unique<SevenBagGenerator>(settings.seed)),
+          rng(settings.seed * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL) {
+    engine = std::make_unique<TetrisEngine>(&this->config, generator.get());
+    engine->runOnMinoLocked([this](const int cleared) {
+        ++result.pieces;
+        onMinoLocked(cleared);
+    });
+    engine->onPlayfieldEvent([this](const PlayfieldEvent &event) { onPlayfieldEvent(event); });
+    engine->runOnGameOver([this]() {
+        result.toppedOut = true;
+        finish(false);
+    });
+
+    // init gravity to lvl 1
+    updateLevel(1);
+
+    // countdown, then the first wave (see TetrisPlayer::startScene())
+    engine->gameInterrupt(true);
+    later(this->rules.timings.countdown, [this]() {
+        engine->gameInterrupt(false);
+        started = true;
+        later(this->rules.timings.firstWave, [this]() { startWave(1); });
+    });
+    engine->start(false);
+}
+
+bool PveSession::tick() {
+    if (over) return false;
+    engine->tick();
+    result.ticks = ++ticks;
+    if (over) return false;
+
+    // handle debuffs
+    for (int i = 0; i < DEBUFF_COUNT; ++i) {
+        if (debuffTicks[i] <= 0) {
+            if (debuffs[i]) setDebuff(static_cast<Debuff>(i), false);
+            continue;
+        }
+        --debuffTicks[i];
+    }
+    updateEnemies();
+
+    if (settings.maxTicks > 0 && ticks >= settings.maxTicks) finish(false);
+    return !over;
+}
+
+// splitmix64, every PvE roll of the session comes from here
+int PveSession::roll(const int bound) {
+    uint64_t z = (rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return static_cast<int>(z % static_cast<uint64_t>(bound));
+}
+
+void PveSession::later(const long long delay, const std::function<void()> &task) {
+    engine->scheduleDelayedTask(delay, task);
+}
+
+void PveSession::updateLevel(const int newLevel) {
+    level = std::min(15, newLevel);
+    config.setGravitySubcells(rules.levelGravity[level]);
+    engine->updateMutableConfig(debuffs[SUPER_SONIC]);
+}
+
+void PveSession::setDebuff(const Debuff debuff, const bool value) {
+    if (debuffs[debuff] == value) return;
+    debuffs[debuff] = value;
+    switch (debuff) {
+        case NO_HOLD:
+            config.setHoldEnabled(!value);
+            engine->updateMutableConfig(debuffs[SUPER_SONIC]);
+            break;
+        case SUPER_SONIC:
+            engine->updateMutableConfig(value);
+            break;
+        default: break; // BLIND is visual, WEAKNESS and FRAGILE are checked where they apply
+    }
+}
+
+void PveSession::moveToLane(const int targetLane) {
+    if (moving || attacking || !started || over) return; // prevent overlapping
+    const int target = ((targetLane % LANES) + LANES) % LANES;
+    const int distance = std::abs(target - lane);
+    moving = true;
+    lane = target;
+    later(distance * rules.timings.laneSwitch, [this]() { moving = false; });
+}
+
+void PveSession::startWave(const int wave) {
+    result.wave = wave;
+    waveKills = 0;
+
+    const std::vector<EnemyKind> kinds = rules.rollWave(rules.waveDifficulty(wave), [this](const int bound) { return roll(bound); });
+    for (int onLane = 0; onLane < static_cast<int>(kinds.size()) && onLane < LANES; ++onLane) {
+        const EnemyKind kind = kinds[onLane];
+        later(roll(rules.timings.spawnJitter), [this, onLane, kind]() { spawnEnemy(onLane, kind); });
+    }
+}
+
+void PveSession::spawnEnemy(const int onLane, const EnemyKind kind) {
+    const int serial = ++serials[onLane];
+    enemies[onLane] = std::make_unique<Enemy>(Enemy{kind, rules.stats(kind).maxHealth});
+    director.spawn(onLane, rules.stats(kind), [this](const int bound) { return roll(bound); });
+    // walks in, then it is ready to be fucked
+    later(rules.timings.enemyEnter, [this, onLane, serial]() {
+        if (serials[onLane] == serial && enemies[onLane] != nullptr) enemies[onLane]->spawning = false;
+    });
+}
+
+void PveSession::updateEnemies() {
+    // the director picks who attacks and when (see EnemyDirector)
+    unsigned ready = 0, present = 0;
+    for (int onLane = 0; onLane < LANES; ++onLane) {
+        const Enemy *enemy = enemies[onLane].get();
+        if (enemy == nullptr) continue;
+        present |= 1u << onLane;
+        // fairies do not wait until they arrived (DebuffFairy::attackPlayer())
+        if (!enemy->attacking && (!enemy->spawning || rules.stats(enemy->kind).isFairy())) ready |= 1u << onLane;
+    }
+    if (present == 0) return;
+
+    const unsigned attacks = director.tick(ready, [this](const int bound) { return roll(bound); });
+    for (int onLane = 0; onLane < LANES; ++onLane) {
+        if (attacks & (1u << onLane)) enemyAttack(onLane);
+    }
+
+    const double danger = director.getDanger();
+    ++dangerTicks;
+    dangerSum += danger;
+    dangerSquares += danger * danger;
+}
+
+void PveSession::enemyAttack(const int onLane) {
+    Enemy &enemy = *enemies[onLane];
+    const EnemyStats &stats = rules.stats(enemy.kind);
+    // fairies do not wait until they arrived (DebuffFairy::attackPlayer())
+    if (enemy.attacking || (enemy.spawning && !stats.isFairy())) return;
+
+    const int serial = serials[onLane];
+    const int target = lane;
+    const long long delay = rules.timings.enemyWindup + rules.timings.enemyTravel;
+    enemy.attacking = true;
+    enemy.targetLane = target;
+    enemy.hitTick = ticks + delay;
+
+    later(delay, [this, onLane, serial, target]() {
+        if (serials[onLane] != serial || enemies[onLane] == nullptr) return; // died on the way
+        const EnemyStats &stats = rules.stats(enemies[onLane]->kind);
+        if (started && !over) {
+            if (attacking || moving || lane != target) {
+                ++result.misses;
+            } else if (stats.isFairy()) {
+                Debuff available[DEBUFF_COUNT];
+                int count = 0;
+                for (int debuff = 0; debuff < DEBUFF_COUNT; ++debuff) {
+                    if (stats.debuffs & (1u << debuff)) available[count++] = static_cast<Debuff>(debuff);
+                }
+                const Debuff debuff = available[roll(count)];
+                const int seconds = stats.damageMin + roll(stats.damageMax - stats.damageMin + 1);
+                setDebuff(debuff, true);
+                debuffTicks[debuff] = seconds * static_cast<int>(EngineTimer::TARGETTED_TICK_RATE);
+                ++result.hits;
+                ++result.debuffs;
+            } else {
+                const int damage = stats.damageMin + roll(stats.damageMax - stats.damageMin + 1);
+                const int taken = rules.absorbDamage(damage, armor, debuffs[FRAGILE]);
+                garbageQueue.push_back(taken);
+                director.onGarbage(taken);
+                result.damageTaken += taken;
+                ++result.hits;
+            }
+        }
+
+        // return to the spawn point
+        later(rules.timings.enemyReturn, [this, onLane, serial]() {
+            if (serials[onLane] != serial || enemies[onLane] == nullptr) return;
+            enemies[onLane]->attacking = false;
+            enemies[onLane]->targetLane = -1;
+            enemies[onLane]->hitTick = -1;
+        });
+    });
+}
+
+void PveSession::killEnemy(const int onLane) {
+    enemies[onLane] = nullptr;
+    director.remove(onLane);
+    ++serials[onLane]; // whatever it was waiting for is off
+}
+
+void PveSession::addStats(const KillRewards &rewards) {
+    if (rewards.type == 1) charge += rewards.amount;
+    else armor += rewards.amount;
+}
+
+void PveSession::releaseCharge() {
+    if (!started || over) return; // prerequisite
+    if (attacking || moving) return; // currently moving, do NOT attack
+    const Enemy *target = enemies[lane].get();
+    if (target != nullptr && (target->attacking || target->spawning)) {
+        return; // if the enemy is attacking or walking in, we cannot release damage
+    }
+
+    const int finalDamage = rules.releasedDamage(charge, debuffs[WEAKNESS]);
+    charge = 0;
+    // nobody on the lane, the charge is gone
+    if (target == nullptr) return;
+
+    attacking = true;
+    const int onLane = lane;
+    const int serial = serials[onLane];
+    later(rules.timings.playerWindup + rules.timings.playerTravel, [this, onLane, serial, finalDamage]() {
+        if (serials[onLane] == serial && enemies[onLane] != nullptr) {
+            Enemy &enemy = *enemies[onLane];
+            enemy.health = std::max(0, enemy.health - finalDamage);
+            if (enemy.health <= 0) {
+                addStats(rules.killRewards([this](const int bound) { return roll(bound); }));
+                killEnemy(onLane);
+                ++result.kills;
+                if (++waveKills >= rules.enemiesPerWave) onWaveCompletion();
+            }
+        }
+        // attack animation, then back to the lane
+        later(rules.timings.playerRecover, [this]() { attacking = false; });
+    });
+}
+
+void PveSession::onWaveCompletion() {
+    result.wavesCleared = result.wave;
+
+    later(rules.timings.waveReward, [this]() {
+        addStats(rules.waveRewards(rules.waveDifficulty(result.wave), [this](const int bound) { return roll(bound); }));
+    });
+    later(rules.timings.nextWave, [this]() {
+        if (over) return;
+        if (result.wave >= rules.campaignWaves && settings.mode == CAMPAIGN) {
+            finish(true);
+            return;
+        }
+        startWave(result.wave + 1);
+    });
+}
+
+void PveSession::onMinoLocked(const int cleared) {
+    // release damage if no lines cleared but charge is present
+    if (cleared <= 0 && charge > 0) releaseCharge();
+    director.observeBoard(engine->getState().rows);
+
+    // rise garbage, one entry of the queue per piece that clears nothing
+    if (cleared <= 0 && !garbageQueue.empty()) {
+        const int hole = roll(10);
+        const int amount = garbageQueue.front();
+        garbageQueue.pop_front();
+        if (amount <= 0) return;
+        director.onGarbage(-amount); // from the queue to the board
+
+        // lock the game while the garbage rises, a line every few ticks
+        engine->gameInterrupt(true);
+        for (int i = 0; i < amount; ++i) {
+            later(i * rules.timings.garbageRise, [this, i, amount, hole]() {
+                engine->raiseGarbage(1, hole);
+                if (i >= amount - 1) {
+                    engine->gameInterrupt(false);
+                    director.observeBoard(engine->getState().rows);
+                }
+            });
+        }
+    }
+}
+
+void PveSession::onPlayfieldEvent(const PlayfieldEvent &event) {
+    const int cleared = static_cast<int>(event.getLinesCleared().size());
+    result.lines += cleared;
+    if (cleared > 0) {
+        if (const int newLevel = rules.level(result.lines); newLevel != level) updateLevel(newLevel);
+    }
+
+    backToBack = AttackRules::nextBackToBack(backToBack, cleared, event.isSpin(), event.isMiniSpin());
+    int damage = AttackRules::attack(cleared, event.isSpin(), event.isPerfectClear(), backToBack, engine->getComboCount());
+
+    // counter-attack
+    const int attack = damage;
+    while (!garbageQueue.empty() && damage > 0) {
+        const int amount = garbageQueue.front();
+        garbageQueue.pop_front();
+        if (damage >= amount) {
+            damage -= amount;
+        } else {
+            garbageQueue.push_front(amount - damage);
+            damage = 0;
+        }
+    }
+    if (damage != attack) director.onGarbage(damage - attack);
+    if (damage > 0) onDamageSend(damage);
+}
+
+void PveSession::onDamageSend(const int damage) {
+    result.damageSent += damage;
+    if (charge < rules.chargeCap) {
+        charge += damage;
+    } else {
+        // overflow, then send the entire thing away
+        releaseCharge();
+    }
+}
+
+void PveSession::finish(const bool won) {
+    if (over) return;
+    over = true;
+    result.won = won;
+    if (dangerTicks > 0) {
+        result.meanDanger = dangerSum / dangerTicks;
+        result.dangerSpread = std::sqrt(std::max(0.0, dangerSquares / dangerTicks - result.meanDanger * result.meanDanger));
+    }
+}
@@ -0,0 +1,174 @@
+#ifndef TETISENGINE_PVE_SESSION_H
+#define TETISENGINE_PVE_SESSION_H
+#pragma once
+#include <array>
+#include <deque>
+#include <memory>
+#include "pve_rules.h"
+#include "pve_director.h"
+#include "../engine/tetris_engine.h"
+#include "../process/bag_generator.h"
+
+struct PveSettings {
+    GameMode mode = CAMPAIGN;
+    uint32_t seed = 1; // the 7-bag and every PvE roll (waves, damage, rewards...)
+    long long maxTicks = 0; // 0 = no limit (an endless session then only ends on a top out)
+};
+
+/**
+ * How a session went
+ */
+struct PveResult {
+    bool won = false; // cleared the campaign
+    bool toppedOut = false;
+    int wave = 0; // the last wave that started
+    int wavesCleared = 0;
+    int kills = 0;
+    int damageSent = 0; // attack that went to the charge (not counting counter-attack)
+    int damageTaken = 0; // garbage lines queued by hits, after armor
+    int hits = 0, misses = 0; // enemy attacks (damage and debuffs) that landed, or missed the player
+    int debuffs = 0; // debuffs that landed
+    int pieces = 0;
+    int lines = 0;
+    long long ticks = 0;
+    // EnemyDirector::getDanger() over the ticks the enemies were around: the mean and how far it
+    // strays from it (standard deviation), the steadier the pressure the lower
+    double meanDanger = 0, dangerSpread = 0;
+};
+
+/**
+ * The PvE rules of TetrisPlayer without the renderer: the lanes, the enemies, armor, charge,
+ * garbage and debuffs, driven by a headless TetrisEngine.
+ * The animations of the game become waits (PveRules::timings), the rolls come from the seed,
+ * so a session only depends on its rules, settings, and whoever plays it.
+ *
+ * The player (a bot) plays getEngine() between tick()s, and picks the lanes with moveToLane()
+ */
+class PveSession {
+public:
+    static constexpr int LANES = 4;
+
+    struct Enemy {
+        EnemyKind kind;
+        int health;
+        bool spawning = true; // walking in, cannot be hit (or hit)
+        bool attacking = false;
+        int targetLane = -1; // the lane its attack goes for
+        long long hitTick = -1; // when that attack lands
+    };
+
+    PveSession(const PveRules &rules, const TetrisConfig &config, const PveSettings &settings);
+    PveSession(const PveSession &) = delete;
+    PveSession &operator=(const PveSession &) = delete;
+
+    /**
+     * Runs one tick (the engine, then the PvE logic)
+     * @return false once the session is over
+     */
+    bool tick();
+
+    bool isOver() const {
+        return over;
+    }
+
+    TetrisEngine &getEngine() {
+        return *engine;
+    }
+
+    const PveRules &getRules() const {
+        return rules;
+    }
+
+    long long getTick() const {
+        return ticks;
+    }
+
+    /**
+     * Starts moving to a lane, ignored while moving or attacking (like the game)
+     */
+    void moveToLane(int lane);
+
+    int getLane() const {
+        return lane;
+    }
+
+    bool isMoving() const {
+        return moving;
+    }
+
+    bool isAttacking() const {
+        return attacking;
+    }
+
+    // the enemy on a lane, nullptr if there is none
+    const Enemy *getEnemy(const int onLane) const {
+        return enemies[onLane].get();
+    }
+
+    int getCharge() const {
+        return charge;
+    }
+
+    int getArmor() const {
+        return armor;
+    }
+
+    bool hasDebuff(const Debuff debuff) const {
+        return debuffs[debuff];
+    }
+
+    const PveResult &getResult() const {
+        return result;
+    }
+
+private:
+    PveRules rules;
+    EnemyDirector director; // after the rules it reads
+    PveSettings settings;
+    TetrisConfig config; // the debuffs and the levels change it, every session has its own
+    std::unique_ptr<SevenBagGenerator> generator;
+    std::unique_ptr<TetrisEngine> engine;
+    uint64_t rng;
+    PveResult result;
+
+    long long ticks = 0;
+    bool started = false, over = false;
+
+    // the player
+    int lane = 0;
+    bool moving = false, attacking = false;
+    int charge = 0, armor = 0;
+    int level = 0;
+    int backToBack = 0;
+    std::deque<int> garbageQueue;
+    bool debuffs[DEBUFF_COUNT] = {};
+    int debuffTicks[DEBUFF_COUNT] = {};
+
+    // the enemies, a serial per spawn so that the waits of a dead one do nothing
+    std::array<std::unique_ptr<Enemy>, LANES> enemies;
+    std::array<int, LANES> serials = {};
+    int waveKills = 0;
+    long long dangerTicks = 0;
+    double dangerSum = 0, dangerSquares = 0;
+
+    int roll(int bound);
+    void later(long long delay, const std::function<void()> &task);
+    void updateLevel(int newLevel);
+    void setDebuff(Debuff debuff, bool value);
+
+    void startWave(int wave);
+    void spawnEnemy(int onLane, EnemyKind kind);
+    void updateEnemies();
+    void enemyAttack(int onLane);
+    void killEnemy(int onLane);
+    void onWaveCompletion();
+
+    void onMinoLocked(int cleared);
+    void onPlayfieldEvent(const PlayfieldEvent &event);
+    void onDamageSend(int damage);
+    void addStats(const KillRewards &rewards);
+    void releaseCharge();
+    void finish(bool won);
+};
+
+#endif //TETISENGINE_PVE_SESSION_H
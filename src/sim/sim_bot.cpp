@@ -0,0 +1,131 @@
+#include <stdexcept>
+#include "sim_bot.h"
+
+SimBot::SimBot(const SimBotSettings &settings, const TetrisConfig &config)
+        : beam(beamSettings(settings, config)), random(settings.bot == "random") {
+    if (settings.bot != "beam" && settings.bot != "pc" && settings.bot != "mcts" && !random) {
+        throw std::invalid_argument("Unknown bot: " + settings.bot);
+    }
+    if (settings.bot == "pc") {
+        PcSolver::Settings pcSettings;
+        pcSettings.threads = 1;
+        pcSettings.timeBudgetMs = settings.budgetMs > 0 ? settings.budgetMs : 0; // the games only depend on the seeds
+        pcSettings.useSRS = config.srsEnabled;
+        solver = std::make_unique<PcSolver>(pcSettings);
+    }
+    if (settings.bot == "mcts") {
+        MctsBot::Settings mctsSettings;
+        mctsSettings.playouts = settings.playouts;
+        mctsSettings.timeBudgetMs = settings.budgetMs > 0 ? settings.budgetMs : 1e9;
+        mctsSettings.threads = 1;
+        mctsSettings.useSRS = config.srsEnabled;
+        mctsSettings.weights = settings.weights;
+        mctsSettings.book = settings.book;
+        mcts = std::make_unique<MctsBot>(mctsSettings);
+    }
+}
+
+void SimBot::newGame(const uint32_t seed) {
+    pending = false;
+    rng = seed * 2654435761ULL + 1;
+}
+
+bool SimBot::update(TetrisEngine &engine) {
+    const TetrisEngineState &state = engine.getState();
+    if (state.fallingType < 0) return false;
+    if (random) return mashKeys(engine);
+
+    // HOLD on an empty slot: the piece from the queue came out, its path was ready
+    if (pending) {
+        pending = false;
+        play(engine, pendingPath);
+        return true;
+    }
+
+    bool found = false, useHold = false;
+    std::vector<MoveStep> path;
+    if (solver != nullptr) {
+        // a perfect clear, if there is one in sight
+        PcResult clear = solver->solve(PcInput::fromState(engine.saveState(), engine.holdAllowed()));
+        if (clear.found && !clear.steps.empty()) {
+            found = true;
+            useHold = clear.steps[0].useHold;
+            path = std::move(clear.steps[0].path);
+        }
+    }
+    if (mcts != nullptr) {
+        // the generator is only in the snapshot
+        BotDecision decision = mcts->search(BotInput::fromState(state, engine.holdAllowed()),
+                                            MctsBot::bagRemaining(engine.saveState()));
+        lastStats = decision.stats;
+        found = decision.found;
+        useHold = decision.useHold;
+        path = std::move(decision.path);
+    } else if (!found) {
+        BotDecision decision = beam.search(BotInput::fromState(state, engine.holdAllowed()));
+        lastStats = decision.stats;
+        found = decision.found;
+        useHold = decision.useHold;
+        path = std::move(decision.path);
+    }
+
+    if (!found) {
+        // every placement loses, let it go
+        engine.hardDrop();
+        return true;
+    }
+    if (useHold) {
+        engine.hold();
+        if (engine.getState().fallingType < 0) {
+            // the next piece spawns on the next tick
+            pending = true;
+            pendingPath = std::move(path);
+            return false;
+        }
+    }
+    play(engine, path);
+    return true;
+}
+
+// one random key per tick, a hard drop every 16 ticks or so (xorshift64)
+bool SimBot::mashKeys(TetrisEngine &engine) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    switch (rng % 16) {
+        case 0: engine.moveLeft(); break;
+        case 1: engine.moveRight(); break;
+        case 2: engine.rotateCW(); break;
+        case 3: engine.rotateCCW(); break;
+        case 4: engine.hold(); break;
+        case 5: engine.hardDrop(); return true;
+        default: break;
+    }
+    return false;
+}
+
+BeamSearchBot::Settings SimBot::beamSettings(const SimBotSettings &settings, const TetrisConfig &config) {
+    BeamSearchBot::Settings beamSettings;
+    beamSettings.beamWidth = settings.beamWidth;
+    beamSettings.maxDepth = settings.depth;
+    beamSettings.timeBudgetMs = settings.budgetMs > 0 ? settings.budgetMs : 1e9;
+    beamSettings.threads = 1; // the games are the parallel part
+    beamSettings.useSRS = config.srsEnabled;
+    beamSettings.weights = settings.weights;
+    beamSettings.network = settings.network;
+    beamSettings.book = settings.book;
+    return beamSettings;
+}
+
+void SimBot::play(TetrisEngine &engine, const std::vector<MoveStep> &path) {
+    for (const MoveStep step: path) {
+        switch (step) {
+            case STEP_LEFT: engine.moveLeft(); break;
+            case STEP_RIGHT: engine.moveRight(); break;
+            case STEP_CW: engine.rotateCW(); break;
+            case STEP_CCW: engine.rotateCCW(); break;
+            case STEP_DROP: engine.softDropToGround(); break;
+        }
+    }
+    engine.hardDrop();
+}
@@ -0,0 +1,65 @@
+#ifndef TETISENGINE_SIM_BOT_H
+#define TETISENGINE_SIM_BOT_H
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "../engine/tetris_engine.h"
+#include "../bot/beam_search_bot.h"
+#include "../bot/pc_solver.h"
+#include "../bot/mcts_bot.h"
+#include "../bot/opening_book.h"
+
+struct SimBotSettings {
+    std::string bot = "beam"; // beam, pc (a perfect clear when there is one, beam otherwise), mcts or random
+    int beamWidth = 32;
+    int depth = 3;
+    int playouts = 400; // mcts, per decision
+    BotWeights weights; // of the board evaluation (beam and mcts)
+    std::shared_ptr<const NnEval> network; // beam only, in place of the weights (null = the handcrafted evaluation)
+    std::shared_ptr<const OpeningBook> book; // beam and mcts, the first bag comes from it when it can (null = none)
+    double budgetMs = 0; // per decision, 0 = no limit (the depth is the limit)
+};
+
+/**
+ * A bot that plays right away, on the simulation thread (no BotController: nothing to
+ * keep up with, the game only moves when it ticks).
+ * Shared by the headless simulations (tetris_sim, tetris_pve)
+ */
+class SimBot {
+public:
+    /**
+     * @throws std::invalid_argument on an unknown bot
+     */
+    SimBot(const SimBotSettings &settings, const TetrisConfig &config);
+
+    // forget the last game
+    void newGame(uint32_t seed);
+
+    /**
+     * Plays the falling piece, if there is one
+     * @return true if a piece was played
+     */
+    bool update(TetrisEngine &engine);
+
+    // of the last search (beam or mcts)
+    const BotStats &getLastStats() const {
+        return lastStats;
+    }
+
+private:
+    BeamSearchBot beam;
+    std::unique_ptr<PcSolver> solver; // bot = pc
+    std::unique_ptr<MctsBot> mcts; // bot = mcts
+    bool random; // bot = random
+    uint64_t rng = 1;
+    bool pending = false;
+    BotStats lastStats;
+    std::vector<MoveStep> pendingPath;
+
+    bool mashKeys(TetrisEngine &engine);
+    static BeamSearchBot::Settings beamSettings(const SimBotSettings &settings, const TetrisConfig &config);
+    static void play(TetrisEngine &engine, const std::vector<MoveStep> &path);
+};
+
+#endif //TETISENGINE_SIM_BOT_H
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cstdlib>
+#include <tuple>
+#include "sim_games.h"
+#include "../engine/attack_rules.h"
+#include "../process/bag_generator.h"
+
+namespace {
+    // the lane with the enemy that dies first, -1 if there is none to hit
+    int weakestLane(const PveSession &session, const int except) {
+        int best = -1;
+        for (int lane = 0; lane < PveSession::LANES; ++lane) {
+            const PveSession::Enemy *enemy = session.getEnemy(lane);
+            if (lane == except || enemy == nullptr) continue;
+            if (best == -1) {
+                best = lane;
+                continue;
+            }
+            const PveSession::Enemy *other = session.getEnemy(best);
+            // the ones already there first, then the weakest, then the closest
+            const auto key = [&session](const PveSession::Enemy *e, const int l) {
+                return std::make_tuple(e->spawning, e->health, std::abs(l - session.getLane()));
+            };
+            if (key(enemy, lane) < key(other, best)) best = lane;
+        }
+        return best;
+    }
+
+    void steer(PveSession &session, const SimGames::LanePolicy policy) {
+        if (policy == SimGames::LANES_STAY || session.isMoving() || session.isAttacking()) return;
+        const int lane = session.getLane();
+
+        if (policy == SimGames::LANES_DODGE) {
+            // any move before the hit is a miss: go somewhere else as soon as it winds up
+            for (int l = 0; l < PveSession::LANES; ++l) {
+                const PveSession::Enemy *enemy = session.getEnemy(l);
+                if (enemy == nullptr || !enemy->attacking || enemy->targetLane != lane || enemy->hitTick <= session.getTick()) continue;
+                const int target = weakestLane(session, lane);
+                session.moveToLane(target != -1 ? target : (lane + 1) % PveSession::LANES);
+                return;
+            }
+        }
+
+        const PveSession::Enemy *here = session.getEnemy(lane);
+        if (here != nullptr) return;
+        const int target = weakestLane(session, -1);
+        if (target != -1) session.moveToLane(target);
+    }
+
+    long long ticksPerPiece(const double pps) {
+        return pps > 0 ? static_cast<long long>(EngineTimer::TARGETTED_TICK_RATE / pps) : 0;
+    }
+}
+
+SimGameRecord SimGames::playGame(TetrisConfig &config, SimBot &bot, const uint32_t seed, const GameSettings &settings) {
+    SimGameRecord record;
+    record.seed = seed;
+
+    bot.newGame(seed);
+    SevenBagGenerator generator(seed);
+    TetrisEngine engine(&config, &generator);
+    long long tick = 0;
+    int backToBack = 0;
+    bool toppedOut = false;
+    engine.runOnMinoLocked([&record](const int cleared) {
+        ++record.pieces;
+        record.lines += cleared;
+    });
+    engine.onPlayfieldEvent([&](const PlayfieldEvent &event) {
+        const int cleared = static_cast<int>(event.getLinesCleared().size());
+        backToBack = AttackRules::nextBackToBack(backToBack, cleared, event.isSpin(), event.isMiniSpin());
+        record.attack += AttackRules::attack(cleared, event.isSpin(), event.isPerfectClear(), backToBack,
+                                             engine.getComboCount());
+        record.maxCombo = std::max(record.maxCombo, engine.getComboCount());
+        if (cleared > 0 && (event.isSpin() || event.isMiniSpin()) &&
+            event.getLastMino()->ordinal == Bitboard::PIECE_T) {
+            ++record.tSpins;
+        }
+        if (event.isPerfectClear()) ++record.perfectClears;
+    });
+    engine.runOnGameOver([&]() {
+        toppedOut = true;
+        record.topOutTick = tick;
+    });
+    engine.start(false);
+
+    const long long wait = ticksPerPiece(settings.pps);
+    long long nextPiece = 0;
+    while (!toppedOut && record.pieces < settings.pieces && (settings.maxTicks == 0 || tick < settings.maxTicks)) {
+        if (!engine.tick()) break;
+        ++tick;
+        if (tick >= nextPiece && bot.update(engine)) nextPiece = tick + wait;
+    }
+
+    record.ticks = tick;
+    const double seconds = tick * EngineTimer::TICK_INTERVAL_MS / 1000.0;
+    record.pps = seconds > 0 ? record.pieces / seconds : 0;
+    record.apm = seconds > 0 ? record.attack * 60.0 / seconds : 0;
+    return record;
+}
+
+PveResult SimGames::playPveSession(const PveRules &rules, const TetrisConfig &config, SimBot &bot,
+                                   const PveSettings &settings, const double pps, const LanePolicy lanes) {
+    bot.newGame(settings.seed);
+    PveSession session(rules, config, settings);
+    const long long wait = ticksPerPiece(pps);
+    long long nextPiece = 0;
+    while (session.tick()) {
+        steer(session, lanes);
+        if (session.getTick() >= nextPiece && bot.update(session.getEngine())) nextPiece = session.getTick() + wait;
+    }
+    return session.getResult();
+}
@@ -0,0 +1,37 @@
+#ifndef TETISENGINE_SIM_GAMES_H
+#define TETISENGINE_SIM_GAMES_H
+#pragma once
+#include "sim_bot.h"
+#include "sim_stats.h"
+#include "../pve/pve_session.h"
+
+/**
+ * One headless game (or PvE session) of a SimBot, the loops tetris_sim, tetris_pve and
+ * tetris_tune share. Both only depend on the seed, the settings and the bot
+ */
+namespace SimGames {
+    struct GameSettings {
+        int pieces = 500; // the game ends after this many pieces
+        long long maxTicks = 0; // 0 = no limit
+        double pps = 0; // the bot waits between pieces to stay under this, 0 = as fast as the engine lets it
+    };
+
+    enum LanePolicy {
+        LANES_STAY, // never moves, lane 0 all game
+        LANES_FOCUS, // parks on the weakest enemy, moves on once it is dead
+        LANES_DODGE, // focus, and steps off a lane an attack is coming for
+    };
+
+    /**
+     * A marathon game on a 7-bag of the seed (record.game is left to the caller)
+     */
+    SimGameRecord playGame(TetrisConfig &config, SimBot &bot, uint32_t seed, const GameSettings &settings);
+
+    /**
+     * A PvE session, the bot plays the pieces and the lane policy picks the lanes
+     */
+    PveResult playPveSession(const PveRules &rules, const TetrisConfig &config, SimBot &bot,
+                             const PveSettings &settings, double pps, LanePolicy lanes);
+}
+
+#endif //TETISENGINE_SIM_GAMES_H
@@ -0,0 +1,38 @@
+#ifndef TETISENGINE_SIM_STATS_H
+#define TETISENGINE_SIM_STATS_H
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * The statistics of one simulated game, as tetris_sim writes them.
+ *
+ * Binary output: a SimFileHeader, then header.count records, little endian (the host's layout,
+ * the file is only meant to be read back on the same kind of machine).
+ * CSV output: one line per game, the columns in the order of the fields
+ */
+struct SimGameRecord {
+    uint32_t game = 0; // the index of the game in the run
+    uint32_t seed = 0; // the seed of its 7-bag
+    int32_t pieces = 0;
+    int32_t lines = 0;
+    int32_t attack = 0; // lines sent (see AttackRules)
+    int32_t tSpins = 0; // T-spins that cleared lines (minis included)
+    int32_t perfectClears = 0;
+    int32_t maxCombo = 0;
+    int64_t ticks = 0; // ticks played
+    int64_t topOutTick = -1; // -1 = survived until the end of the game
+    double pps = 0; // pieces per second of game time
+    double apm = 0; // attack per minute of game time
+};
+
+static_assert(std::is_trivially_copyable<SimGameRecord>::value, "SimGameRecord must stay a POD blob");
+
+struct SimFileHeader {
+    char magic[4] = {'T', 'S', 'I', 'M'};
+    uint32_t version = 1; // bump this whenever SimGameRecord changes
+    uint32_t recordSize = sizeof(SimGameRecord);
+    uint32_t count = 0;
+};
+
+#endif //TETISENGINE_SIM_STATS_H
@@ -0,0 +1,276 @@
+// Compiles opening setups into an OpeningBook
+//   tetris_book [--source file] [--out file] [--no-srs]
+//
+// The source draws every setup as the bottom rows of the board, a piece letter per cell and '.' for
+// empty (see assets/book/openers.txt). For each of the 5040 orders of the first bag, the first setup
+// that can be built (HOLD allowed, every piece reachable with the engine's moves, no line cleared)
+// goes in the book, one move per position on the way. A position gets one move only: an order
+// meeting a position another order already has follows that move, so the book plays consistently
+//
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include "../bot/opening_book.h"
+#include "../bot/bot_protocol.h"
+
+namespace {
+    struct BookOptions {
+        std::string source = "assets/book/openers.txt";
+        std::string out = "assets/book/openers.book";
+        bool useSRS = true;
+    };
+
+    // a setup as drawn: the cells of each of its pieces
+    struct Setup {
+        int name = 0; // index in the name list
+        uint16_t cells[7][Bitboard::HEIGHT] = {}; // per piece type, empty = not in the setup
+        bool uses[7] = {};
+        int pieces = 0;
+    };
+
+    void printUsage(const char *program) {
+        std::cerr << "usage: " << program << " [--source file] [--out file] [--no-srs]" << std::endl;
+    }
+
+    // throws std::invalid_argument on anything it doesn't know
+    BookOptions parseOptions(const int argc, char **argv) {
+        BookOptions options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string name = argv[i];
+            if (name == "--no-srs") {
+                options.useSRS = false;
+                continue;
+            }
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + name);
+            const std::string value = argv[++i];
+
+            if (name == "--source") options.source = value;
+            else if (name == "--out") options.out = value;
+            else throw std::invalid_argument("Unknown option: " + name);
+        }
+        return options;
+    }
+
+    // S <-> Z, L <-> J, the columns flipped
+    Setup mirrored(const Setup &setup) {
+        static const int OTHER[7] = {0, 2, 1, 4, 3, 5, 6}; // T Z S L J I O
+        Setup mirror;
+        mirror.name = setup.name;
+        mirror.pieces = setup.pieces;
+        for (int type = 0; type < 7; ++type) {
+            mirror.uses[OTHER[type]] = setup.uses[type];
+            for (int y = 0; y < Bitboard::HEIGHT; ++y) {
+                uint16_t flipped = 0;
+                for (int x = 0; x < Bitboard::WIDTH; ++x) {
+                    if (setup.cells[type][y] >> x & 1) flipped |= static_cast<uint16_t>(1 << (Bitboard::WIDTH - 1 - x));
+                }
+                mirror.cells[OTHER[type]][y] = flipped;
+            }
+        }
+        return mirror;
+    }
+
+    /*
+     * setup <name> [mirror]
+     * <rows, top to bottom, the last one is the bottom of the board>
+     * end
+     */
+    std::vector<Setup> readSource(const std::string &path, std::vector<std::string> &names) {
+        std::ifstream in(path);
+        if (!in) throw std::invalid_argument("Cannot read " + path);
+        std::vector<Setup> setups;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            std::istringstream words(line);
+            std::string word, name, flag;
+            if (!(words >> word) || word[0] == '#') continue;
+            if (word != "setup" || !(words >> name)) throw std::invalid_argument("Expected a setup, got: " + line);
+            words >> flag;
+
+            std::vector<std::string> rows;
+            while (std::getline(in, line) && line.rfind("end", 0) != 0) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (line.size() != Bitboard::WIDTH) throw std::invalid_argument(name + ": rows are " + std::to_string(Bitboard::WIDTH) + " cells wide");
+                rows.push_back(line);
+            }
+            if (rows.empty() || rows.size() > 8) throw std::invalid_argument(name + ": 1 to 8 rows");
+
+            Setup setup;
+            setup.name = static_cast<int>(std::find(names.begin(), names.end(), name) - names.begin());
+            if (setup.name == static_cast<int>(names.size())) names.push_back(name);
+            for (size_t r = 0; r < rows.size(); ++r) {
+                const int y = Bitboard::HEIGHT - static_cast<int>(rows.size()) + static_cast<int>(r);
+                for (int x = 0; x < Bitboard::WIDTH; ++x) {
+                    if (rows[r][x] == '.') continue;
+                    const int type = BotProtocol::pieceFromLetter(rows[r][x]);
+                    if (type < 0) throw std::invalid_argument(name + ": unknown piece " + rows[r][x]);
+                    setup.cells[type][y] |= static_cast<uint16_t>(1 << x);
+                }
+            }
+            uint16_t board[Bitboard::HEIGHT] = {};
+            for (int type = 0; type < 7; ++type) {
+                int count = 0;
+                for (int y = 0; y < Bitboard::HEIGHT; ++y) {
+                    count += __builtin_popcount(setup.cells[type][y]);
+                    board[y] |= setup.cells[type][y];
+                }
+                if (count != 0 && count != 4) throw std::invalid_argument(name + ": every piece is drawn once, 4 cells");
+                setup.uses[type] = count == 4;
+                setup.pieces += setup.uses[type];
+            }
+            if (Bitboard::fullRows(board) != 0) throw std::invalid_argument(name + ": a setup can't clear lines");
+            setups.push_back(setup);
+            if (flag == "mirror") setups.push_back(mirrored(setup));
+        }
+        return setups;
+    }
+
+    struct Step {
+        uint64_t key;
+        BookMove move;
+    };
+
+    class Compiler {
+    public:
+        Compiler(const bool useSRS, const std::vector<Setup> &setups) : generator(useSRS), setups(setups) {}
+
+        std::unordered_map<uint64_t, OpeningBook::Entry> book;
+
+        /**
+         * @return the setup built for this bag order, -1 if none
+         */
+        int compile(const int8_t *order) {
+            for (size_t s = 0; s < setups.size(); ++s) {
+                std::vector<Step> steps;
+                uint16_t rows[Bitboard::HEIGHT] = {};
+                bool placed[7] = {};
+                if (!build(setups[s], order, 0, -1, rows, placed, steps)) continue;
+                for (const Step &step: steps) {
+                    OpeningBook::Entry entry{};
+                    entry.key = step.key;
+                    entry.type = step.move.type;
+                    entry.rotation = step.move.placement.rotation;
+                    entry.x = step.move.placement.x;
+                    entry.y = step.move.placement.y;
+                    entry.spin = step.move.placement.spin;
+                    entry.setup = static_cast<int8_t>(setups[s].name);
+                    book.emplace(step.key, entry);
+                }
+                return setups[s].name;
+            }
+            return -1;
+        }
+
+    private:
+        MoveGenerator generator;
+        const std::vector<Setup> &setups;
+        std::vector<Placement> placements;
+
+        // where the piece has to go for the setup, if it can get there
+        bool findPlacement(const uint16_t *rows, const Setup &setup, const int type, Placement &out) {
+            generator.generate(rows, type, placements);
+            for (const Placement &placement: placements) {
+                uint16_t after[Bitboard::HEIGHT];
+                std::memcpy(after, rows, sizeof(after));
+                Bitboard::place(after, type, placement.rotation, placement.x, placement.y);
+                bool matches = true;
+                for (int y = 0; y < Bitboard::HEIGHT && matches; ++y) matches = (after[y] ^ rows[y]) == setup.cells[type][y];
+                if (matches) {
+                    out = placement;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // depth first, current = order[next]
+        bool build(const Setup &setup, const int8_t *order, const int next, const int hold,
+                   uint16_t *rows, bool *placed, std::vector<Step> &steps) {
+            int done = 0;
+            for (int type = 0; type < 7; ++type) done += placed[type];
+            if (done == setup.pieces) return true;
+            if (next >= 7) return false;
+
+            uint64_t key;
+            const int queueSize = 6 - next;
+            if (!OpeningBook::key(rows, order[next], hold, order + next + 1, queueSize, key)) return false;
+            const auto known = book.find(key);
+
+            // the falling piece, or what HOLD gives
+            const int holdOut = hold >= 0 ? hold : next + 1 < 7 ? order[next + 1] : -1;
+            const int candidates[2] = {order[next], holdOut};
+            for (int option = 0; option < 2; ++option) {
+                const int type = candidates[option];
+                if (type < 0 || !setup.uses[type] || placed[type]) continue;
+                if (known != book.end() && known->second.type != type) continue;
+                Placement placement;
+                if (!findPlacement(rows, setup, type, placement)) continue;
+                // the cells are the setup's, the book may still have reached them with another spin
+                if (known != book.end() && known->second.spin != placement.spin) continue;
+
+                uint16_t saved[Bitboard::HEIGHT];
+                std::memcpy(saved, rows, sizeof(saved));
+                Bitboard::place(rows, type, placement.rotation, placement.x, placement.y);
+                placed[type] = true;
+                steps.push_back({key, {static_cast<int8_t>(type), placement, setup.name}});
+                const bool built = option == 0 ? build(setup, order, next + 1, hold, rows, placed, steps)
+                                               : hold >= 0 ? build(setup, order, next + 1, order[next], rows, placed, steps)
+                                                           : build(setup, order, next + 2, order[next], rows, placed, steps);
+                if (built) return true;
+                steps.pop_back();
+                placed[type] = false;
+                std::memcpy(rows, saved, sizeof(saved));
+            }
+            return false;
+        }
+    };
+}
+
+int main(int argc, char **argv) {
+    BookOptions options;
+    std::vector<std::string> names;
+    std::vector<Setup> setups;
+    try {
+        options = parseOptions(argc, argv);
+        setups = readSource(options.source, names);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Compiler compiler(options.useSRS, setups);
+    std::vector<int> built(names.size(), 0);
+    int8_t order[7] = {0, 1, 2, 3, 4, 5, 6};
+    int orders = 0, covered = 0;
+    do {
+        ++orders;
+        const int setup = compiler.compile(order);
+        if (setup >= 0) {
+            ++covered;
+            ++built[setup];
+        }
+    } while (std::next_permutation(order, order + 7));
+
+    std::vector<OpeningBook::Entry> entries;
+    entries.reserve(compiler.book.size());
+    for (const auto &[key, entry]: compiler.book) entries.push_back(entry);
+    try {
+        OpeningBook::write(options.out, entries, names);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    for (size_t i = 0; i < names.size(); ++i) std::cout << names[i] << ": " << built[i] << " orders\n";
+    std::cout << covered << " of " << orders << " bag orders covered, " << entries.size() << " positions -> "
+              << options.out << std::endl;
+    return 0;
+}
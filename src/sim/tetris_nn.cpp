@@ -0,0 +1,366 @@
+// Trains a first NnEval by distillation: the network learns the handcrafted evaluation
+// (BoardEval::evaluate() of the weights) on boards from self-play, then is quantized to int8
+//   tetris_nn [--games N] [--pieces N] [--samples N] [--epochs N] [--rows N] [--queue N]
+//             [--hidden A,B] [--rate R] [--weights file] [--seed N] [--out file]
+//
+// The boards are the placements of every position of --games beam search games (a few random
+// ones per position, so the bad boards are in there too). Training is float, the quantized
+// network is checked against the float one on the held out tenth of the boards.
+// The result is a starting point with the strength of the weights it copies, not better:
+// learning past them (from game outcomes) is for whatever reads the file next
+//
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <numeric>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "../engine/tetris_engine.h"
+#include "../process/bag_generator.h"
+#include "../bot/nn_eval.h"
+#include "sim_bot.h"
+#include "weights_file.h"
+
+namespace {
+    struct NnOptions {
+        int games = 40;
+        int pieces = 400; // per game
+        int samples = 8; // boards kept per position
+        int epochs = 20;
+        int rows = 24; // up to where the pieces spawn, the danger is up there
+        int queue = 3;
+        int hidden1 = 64, hidden2 = 32;
+        double rate = 1e-3; // Adam
+        BotWeights weights; // the teacher
+        uint32_t seed = 1;
+        std::string out = "tetris_nn.bin";
+    };
+
+    struct Sample {
+        std::vector<uint16_t> active; // the inputs that are 1
+        float target;
+    };
+
+    // plays the games, keeps a few placements of every position
+    std::vector<Sample> collect(const NnOptions &options, const NnEval &layout) {
+        TetrisConfig *config = TetrisConfig::builder();
+        SimBotSettings botSettings;
+        botSettings.beamWidth = 16;
+        botSettings.depth = 2;
+        botSettings.weights = options.weights;
+        SimBot bot(botSettings, *config);
+        MoveGenerator generator(config->srsEnabled);
+        std::mt19937_64 random(options.seed);
+        std::vector<Placement> placements;
+        std::vector<uint8_t> encoded(layout.getLayers()[0].inputs);
+        std::vector<Sample> samples;
+
+        for (int game = 0; game < options.games; ++game) {
+            const uint32_t seed = options.seed + static_cast<uint32_t>(game);
+            SevenBagGenerator bag(seed);
+            TetrisEngine engine(config, &bag);
+            int pieces = 0;
+            bool toppedOut = false;
+            engine.runOnMinoLocked([&pieces](int) { ++pieces; });
+            engine.runOnGameOver([&toppedOut]() { toppedOut = true; });
+            engine.start(false);
+            bot.newGame(seed);
+
+            int lastSampled = -1;
+            while (!toppedOut && pieces < options.pieces && engine.tick()) {
+                const TetrisEngineState &state = engine.getState();
+                if (state.fallingType >= 0 && pieces != lastSampled) {
+                    lastSampled = pieces;
+                    generator.generate(state.rows, state.fallingType, state.fallingX, state.fallingY, state.fallingRotation, placements);
+                    std::shuffle(placements.begin(), placements.end(), random);
+                    const int following = state.nextQueueSize > 0 ? state.nextQueue[0] : -1;
+                    int kept = 0;
+                    for (const Placement &placement: placements) {
+                        if (kept >= options.samples) break;
+                        uint16_t rows[Bitboard::HEIGHT];
+                        std::memcpy(rows, state.rows, sizeof(rows));
+                        Bitboard::place(rows, state.fallingType, placement.rotation, placement.x, placement.y);
+                        const uint64_t cleared = Bitboard::fullRows(rows);
+                        if (cleared != 0) Bitboard::clearRows(rows, cleared);
+                        if (following >= 0 && !Bitboard::fits(rows, following, 0, Bitboard::spawnX(following), Bitboard::SPAWN_Y)) continue;
+
+                        // what the bot would see after this placement: the queue moved up by one
+                        NnEval::Input input{rows, state.holdType, state.nextQueue + 1, std::max(0, state.nextQueueSize - 1)};
+                        layout.encode(input, encoded.data());
+                        Sample sample;
+                        for (int i = 0; i < static_cast<int>(encoded.size()); ++i) {
+                            if (encoded[i]) sample.active.push_back(static_cast<uint16_t>(i));
+                        }
+                        sample.target = BoardEval::evaluate(BoardEval::extractFeatures(rows), options.weights);
+                        samples.push_back(std::move(sample));
+                        ++kept;
+                    }
+                }
+                bot.update(engine);
+            }
+        }
+        delete config;
+        return samples;
+    }
+
+    /**
+     * The float network being trained: clipped ReLUs (0..1) like the quantized one
+     */
+    struct FloatNet {
+        int inputs, h1, h2;
+        std::vector<float> w1, b1, w2, b2, w3; // w1 is [inputs][h1] (sparse inputs), w2 [h2][h1], w3 [h2]
+        float b3 = 0;
+
+        FloatNet(const int inputs, const int h1, const int h2, std::mt19937_64 &random)
+                : inputs(inputs), h1(h1), h2(h2), w1(inputs * h1), b1(h1, 0), w2(h2 * h1), b2(h2, 0), w3(h2) {
+            const auto init = [&random](std::vector<float> &w, const int fanIn) {
+                std::normal_distribution<float> normal(0, std::sqrt(2.0F / static_cast<float>(fanIn)));
+                for (float &v: w) v = normal(random);
+            };
+            init(w1, 64); // about the amount of inputs that are 1
+            init(w2, h1);
+            init(w3, h2);
+        }
+
+        // the activations of a sample, returns the output
+        float forward(const Sample &sample, std::vector<float> &a1, std::vector<float> &a2) const {
+            a1.assign(b1.begin(), b1.end());
+            for (const uint16_t i: sample.active) {
+                const float *column = &w1[static_cast<size_t>(i) * h1];
+                for (int j = 0; j < h1; ++j) a1[j] += column[j];
+            }
+            for (float &v: a1) v = std::clamp(v, 0.0F, 1.0F);
+            a2.resize(h2);
+            float out = b3;
+            for (int k = 0; k < h2; ++k) {
+                float sum = b2[k];
+                for (int j = 0; j < h1; ++j) sum += w2[k * h1 + j] * a1[j];
+                a2[k] = std::clamp(sum, 0.0F, 1.0F);
+                out += w3[k] * a2[k];
+            }
+            return out;
+        }
+    };
+
+    // Adam over one parameter vector
+    struct Adam {
+        std::vector<float> m, v;
+
+        explicit Adam(const size_t size) : m(size, 0), v(size, 0) {}
+
+        void apply(std::vector<float> &params, std::vector<float> &gradients, const float rate, const int t) {
+            const float c1 = 1 - std::pow(0.9F, static_cast<float>(t)), c2 = 1 - std::pow(0.999F, static_cast<float>(t));
+            for (size_t i = 0; i < params.size(); ++i) {
+                if (gradients[i] == 0) continue; // the cells no board of the batch had (most of w1)
+                m[i] = 0.9F * m[i] + 0.1F * gradients[i];
+                v[i] = 0.999F * v[i] + 0.001F * gradients[i] * gradients[i];
+                params[i] -= rate * (m[i] / c1) / (std::sqrt(v[i] / c2) + 1e-8F);
+                gradients[i] = 0;
+            }
+        }
+    };
+
+    void train(FloatNet &net, std::vector<Sample> &samples, const NnOptions &options, const float targetScale, std::mt19937_64 &random) {
+        std::vector<float> gw1(net.w1.size(), 0), gb1(net.h1, 0), gw2(net.w2.size(), 0), gb2(net.h2, 0), gw3(net.h2, 0), gb3(1, 0);
+        Adam aw1(gw1.size()), ab1(gb1.size()), aw2(gw2.size()), ab2(gb2.size()), aw3(gw3.size()), ab3(1);
+        std::vector<float> b3{net.b3};
+        std::vector<float> a1, a2, d1(net.h1), d2(net.h2);
+        const int batch = 64;
+        int t = 0;
+
+        for (int epoch = 0; epoch < options.epochs; ++epoch) {
+            std::shuffle(samples.begin(), samples.end(), random);
+            double loss = 0;
+            for (size_t start = 0; start < samples.size(); start += batch) {
+                const size_t end = std::min(samples.size(), start + batch);
+                for (size_t s = start; s < end; ++s) {
+                    const Sample &sample = samples[s];
+                    net.b3 = b3[0];
+                    const float error = net.forward(sample, a1, a2) - sample.target / targetScale;
+                    loss += error * error;
+                    const float g = 2 * error / static_cast<float>(end - start);
+
+                    gb3[0] += g;
+                    std::fill(d1.begin(), d1.end(), 0.0F);
+                    for (int k = 0; k < net.h2; ++k) {
+                        gw3[k] += g * a2[k];
+                        d2[k] = a2[k] > 0 && a2[k] < 1 ? g * net.w3[k] : 0; // the clip lets nothing through
+                        if (d2[k] == 0) continue;
+                        gb2[k] += d2[k];
+                        for (int j = 0; j < net.h1; ++j) {
+                            gw2[k * net.h1 + j] += d2[k] * a1[j];
+                            d1[j] += d2[k] * net.w2[k * net.h1 + j];
+                        }
+                    }
+                    for (int j = 0; j < net.h1; ++j) {
+                        if (a1[j] <= 0 || a1[j] >= 1) d1[j] = 0;
+                        gb1[j] += d1[j];
+                    }
+                    for (const uint16_t i: sample.active) {
+                        float *column = &gw1[static_cast<size_t>(i) * net.h1];
+                        for (int j = 0; j < net.h1; ++j) column[j] += d1[j];
+                    }
+                }
+                ++t;
+                const float rate = static_cast<float>(options.rate);
+                aw1.apply(net.w1, gw1, rate, t);
+                ab1.apply(net.b1, gb1, rate, t);
+                aw2.apply(net.w2, gw2, rate, t);
+                ab2.apply(net.b2, gb2, rate, t);
+                aw3.apply(net.w3, gw3, rate, t);
+                ab3.apply(b3, gb3, rate, t);
+            }
+            net.b3 = b3[0];
+            std::cerr << "epoch " << epoch + 1 << ": rms error " << std::sqrt(loss / samples.size()) * targetScale << std::endl;
+        }
+    }
+
+    // int8 weights scaled to their largest, the biases and scales follow (see NnEval)
+    NnEval quantize(const FloatNet &net, const NnOptions &options, const float targetScale) {
+        const int inputs = NnEval::inputCount(options.rows, options.queue);
+        const auto largest = [](const std::vector<float> &w) {
+            float most = 1e-6F;
+            for (const float v: w) most = std::max(most, std::fabs(v));
+            return 127.0F / most;
+        };
+        const auto pad = [](const int count) { return (count + NnEval::PAD - 1) / NnEval::PAD * NnEval::PAD; };
+        const auto toInt8 = [](const float v) { return static_cast<int8_t>(std::clamp(std::lround(v), -127L, 127L)); };
+
+        std::vector<NnEval::Layer> layers(3);
+        const float s1 = largest(net.w1), s2 = largest(net.w2), s3 = largest(net.w3);
+        NnEval::Layer &first = layers[0], &second = layers[1], &third = layers[2];
+
+        first.inputs = pad(inputs);
+        first.outputs = net.h1;
+        first.weights.assign(static_cast<size_t>(first.inputs) * first.outputs, 0);
+        for (int j = 0; j < net.h1; ++j) {
+            for (int i = 0; i < inputs; ++i) first.weights[static_cast<size_t>(j) * first.inputs + i] = toInt8(net.w1[static_cast<size_t>(i) * net.h1 + j] * s1);
+            first.bias.push_back(static_cast<int32_t>(std::lround(net.b1[j] * s1)));
+        }
+        first.scale = 127.0F / s1;
+
+        second.inputs = pad(net.h1);
+        second.outputs = net.h2;
+        second.weights.assign(static_cast<size_t>(second.inputs) * second.outputs, 0);
+        for (int k = 0; k < net.h2; ++k) {
+            for (int j = 0; j < net.h1; ++j) second.weights[static_cast<size_t>(k) * second.inputs + j] = toInt8(net.w2[k * net.h1 + j] * s2);
+            second.bias.push_back(static_cast<int32_t>(std::lround(net.b2[k] * 127.0F * s2)));
+        }
+        second.scale = 1.0F / s2;
+
+        third.inputs = pad(net.h2);
+        third.outputs = 1;
+        third.weights.assign(third.inputs, 0);
+        for (int k = 0; k < net.h2; ++k) third.weights[k] = toInt8(net.w3[k] * s3);
+        third.bias.push_back(static_cast<int32_t>(std::lround(net.b3 * 127.0F * s3)));
+        third.scale = targetScale / (127.0F * s3);
+        return {options.rows, options.queue, std::move(layers)};
+    }
+
+    void printUsage(const char *program) {
+        std::cerr << "usage: " << program << " [--games N] [--pieces N] [--samples N] [--epochs N] [--rows N] [--queue N]\n"
+                  << "    [--hidden A,B] [--rate R] [--weights file] [--seed N] [--out file]" << std::endl;
+    }
+
+    // throws std::invalid_argument on anything it doesn't know
+    NnOptions parseOptions(const int argc, char **argv) {
+        NnOptions options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string name = argv[i];
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + name);
+            const std::string value = argv[++i];
+
+            if (name == "--games") options.games = std::stoi(value);
+            else if (name == "--pieces") options.pieces = std::stoi(value);
+            else if (name == "--samples") options.samples = std::stoi(value);
+            else if (name == "--epochs") options.epochs = std::stoi(value);
+            else if (name == "--rows") options.rows = std::stoi(value);
+            else if (name == "--queue") options.queue = std::stoi(value);
+            else if (name == "--hidden") {
+                const size_t comma = value.find(',');
+                if (comma == std::string::npos) throw std::invalid_argument("Expected --hidden A,B");
+                options.hidden1 = std::stoi(value.substr(0, comma));
+                options.hidden2 = std::stoi(value.substr(comma + 1));
+            } else if (name == "--rate") options.rate = std::stod(value);
+            else if (name == "--weights") options.weights = WeightsFile::read(value);
+            else if (name == "--seed") options.seed = static_cast<uint32_t>(std::stoul(value));
+            else if (name == "--out") options.out = value;
+            else throw std::invalid_argument("Unknown option: " + name);
+        }
+        if (options.games < 1 || options.pieces < 1 || options.samples < 1 || options.epochs < 1
+            || options.hidden1 < 1 || options.hidden2 < 1 || options.rate <= 0) {
+            throw std::invalid_argument("Counts must be positive!");
+        }
+        return options;
+    }
+}
+
+int main(int argc, char **argv) {
+    NnOptions options;
+    try {
+        options = parseOptions(argc, argv);
+        // an empty network of the right shape, for the encoding
+        std::mt19937_64 random(options.seed);
+        FloatNet shape(NnEval::inputCount(options.rows, options.queue), options.hidden1, options.hidden2, random);
+        const NnEval layout = quantize(shape, options, 1);
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<Sample> samples = collect(options, layout);
+        if (samples.size() < 10) throw std::invalid_argument("Not enough boards, play more games");
+        std::cerr << samples.size() << " boards from " << options.games << " games in "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+
+        // a tenth is held out to check the quantized network
+        std::shuffle(samples.begin(), samples.end(), random);
+        std::vector<Sample> held(samples.end() - static_cast<long>(samples.size() / 10), samples.end());
+        samples.resize(samples.size() - held.size());
+        float targetScale = 0;
+        for (const Sample &sample: samples) targetScale = std::max(targetScale, std::fabs(sample.target));
+        targetScale = std::max(targetScale, 1.0F);
+
+        FloatNet net(NnEval::inputCount(options.rows, options.queue), options.hidden1, options.hidden2, random);
+        train(net, samples, options, targetScale, random);
+        const NnEval quantized = quantize(net, options, targetScale);
+
+        // the held out boards: float and int8 against the teacher
+        std::vector<float> a1, a2;
+        double floatError = 0, quantizedError = 0;
+        std::vector<uint8_t> encoded(quantized.getLayers()[0].inputs);
+        for (const Sample &sample: held) {
+            const float expected = sample.target;
+            floatError += std::pow(net.forward(sample, a1, a2) * targetScale - expected, 2);
+            // back to a board, the network only takes boards
+            uint16_t rows[Bitboard::HEIGHT] = {};
+            int8_t queue[STATE_MAX_NEXT_QUEUE];
+            int8_t hold = -1;
+            std::fill(std::begin(queue), std::end(queue), -1);
+            const int cells = options.rows * Bitboard::WIDTH;
+            for (const uint16_t i: sample.active) {
+                if (i < cells) rows[Bitboard::HEIGHT - 1 - i / Bitboard::WIDTH] |= static_cast<uint16_t>(1u << (i % Bitboard::WIDTH));
+                else if (i < cells + 7) hold = static_cast<int8_t>(i - cells);
+                else queue[(i - cells) / 7 - 1] = static_cast<int8_t>((i - cells) % 7);
+            }
+            const NnEval::Input input{rows, hold, queue, options.queue};
+            float score;
+            quantized.evaluateBatch(&input, 1, &score);
+            quantizedError += std::pow(score - expected, 2);
+        }
+        std::cerr << held.size() << " held out boards, rms error: float " << std::sqrt(floatError / held.size())
+                  << ", int8 " << std::sqrt(quantizedError / held.size()) << std::endl;
+
+        quantized.save(options.out);
+        std::cerr << "wrote " << options.out << std::endl;
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
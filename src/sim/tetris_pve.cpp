@@ -0,0 +1,212 @@
+// Headless PvE balance runs: N campaign (or endless) sessions of a bot, per balance variant
+//   tetris_pve [--sessions N] [--threads N] [--seed N] [--mode campaign|endless] [--minutes N]
+//              [--bot beam|pc|mcts|random] [--width N] [--depth N] [--playouts N] [--weights file] [--network file] [--book file] [--budget ms] [--pps N]
+//              [--lanes stay|focus|dodge] [--set knob=value] [--variant knob=value[,knob=value...]]
+//              [--out file]
+//
+// The baseline (the game's rules, plus every --set) always runs, then one run per --variant.
+// Every variant plays the same seeds, so the differences come from the change and not the luck
+// of the draw. Knobs are the ones of PveRules::set(), e.g. charge_cap or redgga.health.
+//
+// One line per variant goes to stdout: win rate, then how many sessions ended on each wave.
+// --out writes every session (CSV). The totals (sessions/s) go to stderr
+//
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include "../bot/thread_pool.h"
+#include "sim_games.h"
+#include "weights_file.h"
+
+namespace {
+    struct Variant {
+        std::string name;
+        PveRules rules;
+    };
+
+    struct PveOptions {
+        int sessions = 200;
+        unsigned threads = 0; // 0 = every core
+        uint32_t seed = 1; // session i plays seed + i (in every variant)
+        GameMode mode = CAMPAIGN;
+        double minutes = 60; // of game time per session, 0 = no limit
+        SimBotSettings bot;
+        double pps = 2; // a human pace by default, the balance is for humans
+        SimGames::LanePolicy lanes = SimGames::LANES_FOCUS;
+        std::vector<Variant> variants; // the baseline first
+        std::string out; // empty = no per session output
+    };
+
+    PveResult runSession(const PveOptions &options, const Variant &variant, const TetrisConfig &config, SimBot &bot, const int index) {
+        PveSettings settings;
+        settings.mode = options.mode;
+        settings.seed = options.seed + static_cast<uint32_t>(index);
+        settings.maxTicks = static_cast<long long>(options.minutes * 60 * EngineTimer::TARGETTED_TICK_RATE);
+
+        return SimGames::playPveSession(variant.rules, config, bot, settings, options.pps, options.lanes);
+    }
+
+    void writeSessions(std::ostream &out, const PveOptions &options, const std::vector<PveResult> &results) {
+        out << "variant,session,seed,won,topped_out,wave,waves_cleared,kills,damage_sent,damage_taken,hits,misses,debuffs,pieces,lines,ticks,mean_danger,danger_spread\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const PveResult &r = results[i];
+            const size_t session = i % options.sessions;
+            out << '"' << options.variants[i / options.sessions].name << "\"," << session << ',' << options.seed + session << ','
+                << r.won << ',' << r.toppedOut << ',' << r.wave << ',' << r.wavesCleared << ',' << r.kills << ','
+                << r.damageSent << ',' << r.damageTaken << ',' << r.hits << ',' << r.misses << ',' << r.debuffs << ','
+                << r.pieces << ',' << r.lines << ',' << r.ticks << ',' << r.meanDanger << ',' << r.dangerSpread << '\n';
+        }
+    }
+
+    // one line per variant: the win rate, then how many sessions ended on wave 0, 1, 2...
+    void writeSummary(std::ostream &out, const PveOptions &options, const std::vector<PveResult> &results) {
+        int maxWave = 0;
+        for (const PveResult &r : results) maxWave = std::max(maxWave, r.wave);
+
+        out << "variant,sessions,wins,win_rate,top_outs,mean_wave,mean_kills,mean_danger,danger_spread";
+        for (int wave = 0; wave <= maxWave; ++wave) out << ",wave_" << wave;
+        out << '\n';
+        for (size_t v = 0; v < options.variants.size(); ++v) {
+            std::vector<int> histogram(maxWave + 1, 0);
+            int wins = 0, topOuts = 0;
+            double waves = 0, kills = 0, danger = 0, spread = 0;
+            for (int s = 0; s < options.sessions; ++s) {
+                const PveResult &r = results[v * options.sessions + s];
+                wins += r.won;
+                topOuts += r.toppedOut;
+                waves += r.wave;
+                kills += r.kills;
+                danger += r.meanDanger;
+                spread += r.dangerSpread;
+                ++histogram[r.wave];
+            }
+            out << '"' << options.variants[v].name << "\"," << options.sessions << ',' << wins << ','
+                << static_cast<double>(wins) / options.sessions << ',' << topOuts << ','
+                << waves / options.sessions << ',' << kills / options.sessions << ','
+                << danger / options.sessions << ',' << spread / options.sessions;
+            for (const int count : histogram) out << ',' << count;
+            out << '\n';
+        }
+    }
+
+    void printUsage(const char *program) {
+        std::cerr << "usage: " << program << " [--sessions N] [--threads N] [--seed N] [--mode campaign|endless] [--minutes N]\n"
+                  << "    [--bot beam|pc|mcts|random] [--width N] [--depth N] [--playouts N] [--weights file] [--network file] [--book file] [--budget ms] [--pps N]\n"
+                  << "    [--lanes stay|focus|dodge] [--set knob=value] [--variant knob=value[,knob=value...]]\n"
+                  << "    [--out file]" << std::endl;
+    }
+
+    // "knob=value[,knob=value...]", throws std::invalid_argument on a bad knob or value
+    void applyKnobs(PveRules &rules, const std::string &knobs) {
+        std::stringstream stream(knobs);
+        std::string knob;
+        while (std::getline(stream, knob, ',')) {
+            const size_t equals = knob.find('=');
+            if (equals == std::string::npos) throw std::invalid_argument("Expected knob=value: " + knob);
+            rules.set(knob.substr(0, equals), std::stod(knob.substr(equals + 1)));
+        }
+    }
+
+    // throws std::invalid_argument on anything it doesn't know
+    PveOptions parseOptions(const int argc, char **argv) {
+        PveOptions options;
+        PveRules base = defaultPveRules();
+        std::vector<std::string> variants;
+        for (int i = 1; i < argc; ++i) {
+            const std::string name = argv[i];
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + name);
+            const std::string value = argv[++i];
+
+            if (name == "--sessions") options.sessions = std::stoi(value);
+            else if (name == "--threads") options.threads = static_cast<unsigned>(std::stoul(value));
+            else if (name == "--seed") options.seed = static_cast<uint32_t>(std::stoul(value));
+            else if (name == "--mode") {
+                if (value != "campaign" && value != "endless") throw std::invalid_argument("Unknown mode: " + value);
+                options.mode = value == "campaign" ? CAMPAIGN : ENDLESS;
+            } else if (name == "--minutes") options.minutes = std::stod(value);
+            else if (name == "--bot") options.bot.bot = value;
+            else if (name == "--width") options.bot.beamWidth = std::stoi(value);
+            else if (name == "--depth") options.bot.depth = std::stoi(value);
+            else if (name == "--playouts") options.bot.playouts = std::stoi(value);
+            else if (name == "--weights") options.bot.weights = WeightsFile::read(value);
+            else if (name == "--network") options.bot.network = NnEval::load(value);
+            else if (name == "--book") options.bot.book = OpeningBook::open(value);
+            else if (name == "--budget") options.bot.budgetMs = std::stod(value);
+            else if (name == "--pps") options.pps = std::stod(value);
+            else if (name == "--lanes") {
+                if (value == "stay") options.lanes = SimGames::LANES_STAY;
+                else if (value == "focus") options.lanes = SimGames::LANES_FOCUS;
+                else if (value == "dodge") options.lanes = SimGames::LANES_DODGE;
+                else throw std::invalid_argument("Unknown lane policy: " + value);
+            } else if (name == "--set") applyKnobs(base, value);
+            else if (name == "--variant") variants.push_back(value);
+            else if (name == "--out") options.out = value;
+            else throw std::invalid_argument("Unknown option: " + name);
+        }
+        if (options.sessions < 1 || options.bot.beamWidth < 1 || options.bot.depth < 1 || options.bot.playouts < 1) {
+            throw std::invalid_argument("Counts must be positive!");
+        }
+
+        options.variants.push_back({"baseline", base});
+        for (const std::string &knobs : variants) {
+            Variant variant{knobs, base};
+            applyKnobs(variant.rules, knobs);
+            options.variants.push_back(variant);
+        }
+        return options;
+    }
+}
+
+int main(int argc, char **argv) {
+    PveOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // the game's config (see MainMenu)
+    TetrisConfig config;
+    config.setLineClearsDelay(0.35);
+
+    // one bot per thread, every session of that thread reuses it
+    ThreadPool pool(options.threads);
+    std::vector<std::unique_ptr<SimBot>> bots(pool.size());
+    const int total = options.sessions * static_cast<int>(options.variants.size());
+    std::vector<PveResult> results(total);
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        pool.parallelFor(total, [&](const int job, const int worker) {
+            if (bots[worker] == nullptr) bots[worker] = std::make_unique<SimBot>(options.bot, config);
+            results[job] = runSession(options, options.variants[job / options.sessions], config, *bots[worker], job % options.sessions);
+        });
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    writeSummary(std::cout, options, results);
+    if (!options.out.empty()) {
+        std::ofstream file(options.out);
+        if (!file) {
+            std::cerr << "Cannot write " << options.out << std::endl;
+            return 1;
+        }
+        writeSessions(file, options, results);
+    }
+
+    long long ticks = 0;
+    for (const PveResult &r : results) ticks += r.ticks;
+    std::cerr << total << " sessions on " << pool.size() << " threads in " << elapsed << " s: "
+              << total / elapsed << " sessions/s, " << ticks / elapsed / 1e6 << " M ticks/s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,278 @@
+// Plays replays back headless (see ReplayRecorder) and checks they end on the recorded position
+//   tetris_replay [--repeat N] file...
+//   tetris_replay --record file [--seed N] [--minutes N]
+//   tetris_replay --archive file [--interval N] replay
+//   tetris_replay --seek archive [--seeks N] [--seed N]
+//
+// Playing goes tick after tick with nothing in between, the ticks per second it prints are what a
+// replay costs to verify. --record makes one without the game: the beam search bot (SimBot) plays a
+// piece a second between two ticks, keys are mashed through the input queue meanwhile (held ones
+// too, for DAS), garbage rises the way the game raises it, gravity goes up with the lines and a top
+// out clears the board. A replay of the game is replays/<seed>.replay
+//
+// --archive adds keyframes every N ticks (600 = 10 s by default) to a replay, see ReplayArchive.
+// --seek maps one and jumps to random ticks of it, then checks every position it got against
+// the same tick played straight from the start
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "../engine/replay.h"
+#include "../engine/replay_archive.h"
+#include "../process/bag_generator.h"
+#include "sim_bot.h"
+
+namespace {
+    struct ReplayOptions {
+        std::vector<std::string> files;
+        int repeat = 1;
+        std::string record; // empty = play the files
+        int64_t seed = 1;
+        double minutes = 5;
+        std::string archive; // write one from the replay in files
+        int interval = 600;
+        std::string seek; // the archive to seek in
+        int seeks = 1000;
+    };
+
+    void printUsage(const char *program) {
+        std::cerr << "usage: " << program << " [--repeat N] file...\n"
+                  << "       " << program << " --record file [--seed N] [--minutes N]\n"
+                  << "       " << program << " --archive file [--interval N] replay\n"
+                  << "       " << program << " --seek archive [--seeks N] [--seed N]" << std::endl;
+    }
+
+    // throws std::invalid_argument on anything it doesn't know
+    ReplayOptions parseOptions(const int argc, char **argv) {
+        ReplayOptions options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string name = argv[i];
+            if (name.rfind("--", 0) != 0) {
+                options.files.push_back(name);
+                continue;
+            }
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + name);
+            const std::string value = argv[++i];
+
+            if (name == "--repeat") options.repeat = std::stoi(value);
+            else if (name == "--record") options.record = value;
+            else if (name == "--seed") options.seed = std::stoll(value);
+            else if (name == "--minutes") options.minutes = std::stod(value);
+            else if (name == "--archive") options.archive = value;
+            else if (name == "--interval") options.interval = std::stoi(value);
+            else if (name == "--seek") options.seek = value;
+            else if (name == "--seeks") options.seeks = std::stoi(value);
+            else throw std::invalid_argument("Unknown option: " + name);
+        }
+        if (options.repeat < 1 || options.minutes <= 0 || options.interval < 1 || options.seeks < 1) {
+            throw std::invalid_argument("Counts must be positive!");
+        }
+        if (!options.archive.empty() && options.files.size() != 1) throw std::invalid_argument("--archive takes one replay");
+        if (options.record.empty() && options.seek.empty() && options.files.empty()) throw std::invalid_argument("No replay to play");
+        return options;
+    }
+
+    // xorshift64, the mashing and the garbage come from the seed too
+    uint64_t nextRandom(uint64_t &state) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    int record(const ReplayOptions &options) {
+        TetrisConfig config;
+        config.setLineClearsDelay(0.35); // the game's
+        SevenBagGenerator generator(options.seed);
+        TetrisEngine engine(&config, &generator);
+        ReplayRecorder recorder;
+        recorder.attach(&engine, options.seed);
+        SimBot bot(SimBotSettings(), config);
+        bot.newGame(static_cast<uint32_t>(options.seed));
+
+        uint64_t rng = static_cast<uint64_t>(options.seed) * 0x9E3779B97F4A7C15ULL | 1;
+        std::deque<int> garbageQueue;
+        int lines = 0, topOuts = 0;
+        // the next piece spawns on a clear board
+        engine.runOnGameOver([&] {
+            ++topOuts;
+            engine.resetPlayfield();
+        });
+        engine.onPlayfieldEvent([&](const PlayfieldEvent &event) {
+            lines += static_cast<int>(event.getLinesCleared().size());
+            config.setGravitySubcells(1022 + lines * 400);
+            engine.updateMutableConfig(false);
+        });
+        // the garbage rises like TetrisPlayer::onMinoLocked(), a line every 5 ticks
+        engine.runOnMinoLocked([&](const int cleared) {
+            if (cleared > 0 || garbageQueue.empty()) return;
+            const int amount = garbageQueue.front();
+            const int hole = static_cast<int>(nextRandom(rng) % Bitboard::WIDTH);
+            garbageQueue.pop_front();
+            engine.gameInterrupt(true);
+            for (int i = 0; i < amount; ++i) {
+                engine.scheduleDelayedTask(i * 5, [&engine, i, amount, hole] {
+                    engine.raiseGarbage(1, hole);
+                    if (i >= amount - 1) engine.gameInterrupt(false);
+                });
+            }
+        });
+        engine.start(false);
+
+        const auto ticks = static_cast<int64_t>(options.minutes * 60 * EngineTimer::TARGETTED_TICK_RATE);
+        bool leftHeld = false, rightHeld = false;
+        int64_t nextPiece = 0;
+        while (engine.getTicksPassed() < ticks) {
+            const uint64_t roll = nextRandom(rng);
+            const auto timestamp = static_cast<uint32_t>(engine.getTicksPassed());
+            // a key every 4 ticks or so, the side keys stay down for a while
+            switch (roll % 32) {
+                case 0: engine.queueInput(leftHeld ? INPUT_LEFT_UP : INPUT_LEFT_DOWN, timestamp); leftHeld = !leftHeld; break;
+                case 1: engine.queueInput(rightHeld ? INPUT_RIGHT_UP : INPUT_RIGHT_DOWN, timestamp); rightHeld = !rightHeld; break;
+                case 2: engine.queueInput(INPUT_ROTATE_CW, timestamp); break;
+                case 3: engine.queueInput(INPUT_ROTATE_CCW, timestamp); break;
+                case 4: engine.queueInput(INPUT_SOFT_DROP_DOWN, timestamp); break;
+                case 5: engine.queueInput(INPUT_SOFT_DROP_UP, timestamp); break;
+                default: break;
+            }
+            // an attack now and then
+            if ((roll >> 8) % 600 == 0) garbageQueue.push_back(1 + static_cast<int>((roll >> 20) % 4));
+            // the bot plays wherever the mashing left the piece
+            if (engine.getTicksPassed() >= nextPiece && bot.update(engine)) nextPiece = engine.getTicksPassed() + 60;
+            engine.tick();
+        }
+
+        recorder.finish();
+        try {
+            recorder.save(options.record);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << options.record << ": " << engine.getTicksPassed() << " ticks, " << lines << " lines, "
+                  << topOuts << " top outs, " << recorder.getBytes().size() << " bytes" << std::endl;
+        return 0;
+    }
+
+    int archive(const ReplayOptions &options) {
+        const std::string &file = options.files.front();
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            std::cerr << "Cannot read " << file << std::endl;
+            return 1;
+        }
+        const std::vector<uint8_t> replay((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        const auto begin = std::chrono::steady_clock::now();
+        try {
+            ReplayArchive::write(options.archive, replay, options.interval);
+        } catch (const std::exception &e) {
+            std::cerr << file << ": " << e.what() << std::endl;
+            return 1;
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        const auto written = ReplayArchive::open(options.archive);
+        std::ifstream size(options.archive, std::ios::binary | std::ios::ate);
+        std::cout << options.archive << ": " << written->getKeyframeCount() << " keyframes every " << written->getInterval()
+                  << " ticks, " << size.tellg() << " bytes, written in " << seconds * 1000 << " ms" << std::endl;
+        return 0;
+    }
+
+    int seek(const ReplayOptions &options) {
+        std::shared_ptr<const ReplayArchive> archive;
+        try {
+            archive = ReplayArchive::open(options.seek);
+        } catch (const std::invalid_argument &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        uint64_t rng = static_cast<uint64_t>(options.seed) * 0x9E3779B97F4A7C15ULL | 1;
+        std::vector<int64_t> ticks;
+        for (int i = 0; i < options.seeks; ++i) {
+            ticks.push_back(static_cast<int64_t>(nextRandom(rng) % static_cast<uint64_t>(archive->getEndTick() + 1)));
+        }
+        ticks.push_back(archive->getEndTick());
+
+        // the same ticks played straight from the start, to check the seeks against
+        std::vector<int64_t> sorted = ticks;
+        std::sort(sorted.begin(), sorted.end());
+        std::map<int64_t, uint64_t> expected;
+        {
+            TetrisConfig config = archive->getHeader().config;
+            SevenBagGenerator generator(archive->getHeader().seed);
+            TetrisEngine engine(&config, &generator);
+            ReplayDriver driver(&engine, &config, ReplayEventReader(archive->getReplay(), archive->getReplaySize(), ReplayRecorder::HEADER_SIZE, 0));
+            for (const int64_t tick: sorted) {
+                driver.runTo(tick);
+                expected[tick] = engine.getZobristHash();
+            }
+        }
+
+        ReplaySeeker seeker(archive);
+        double total = 0, slowest = 0;
+        int mismatches = 0;
+        for (const int64_t tick: ticks) {
+            const auto begin = std::chrono::steady_clock::now();
+            seeker.seek(tick);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            total += ms;
+            slowest = std::max(slowest, ms);
+            if (seeker.getEngine().getZobristHash() != expected[tick]) ++mismatches;
+        }
+        if (seeker.getEngine().getZobristHash() != archive->getEndHash()) ++mismatches; // the last seek is the end
+
+        std::cout << options.seek << ": " << archive->getEndTick() << " ticks, " << ticks.size() << " seeks, "
+                  << total / static_cast<double>(ticks.size()) << " ms on average, " << slowest << " ms at most, "
+                  << (mismatches == 0 ? "ok" : std::to_string(mismatches) + " MISMATCHES") << std::endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char **argv) {
+    ReplayOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (!options.record.empty()) return record(options);
+    if (!options.archive.empty()) return archive(options);
+    if (!options.seek.empty()) return seek(options);
+
+    int mismatches = 0;
+    for (const std::string &file: options.files) {
+        ReplayPlayer replay;
+        try {
+            replay = ReplayPlayer::load(file);
+        } catch (const std::invalid_argument &e) {
+            std::cerr << e.what() << std::endl;
+            ++mismatches;
+            continue;
+        }
+
+        ReplayResult result;
+        const auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.repeat; ++i) result = replay.play();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        const double ticksPerSecond = static_cast<double>(result.ticks) * options.repeat / std::max(seconds, 1e-9);
+        std::cout << file << ": " << result.ticks << " ticks, " << replay.getEventCount() << " events, "
+                  << (result.matched ? "ok" : "MISMATCH") << ", " << static_cast<long long>(ticksPerSecond) << " ticks/s ("
+                  << static_cast<long long>(ticksPerSecond / EngineTimer::TARGETTED_TICK_RATE) << "x real time)" << std::endl;
+        if (!result.matched) {
+            std::cout << "  expected " << std::hex << result.expectedHash << " at tick " << std::dec << replay.getEndTick()
+                      << ", got " << std::hex << result.actualHash << std::dec << std::endl;
+            ++mismatches;
+        }
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+// Headless self-play: N games of a bot, in parallel, no SDL involved
+//   tetris_sim [--games N] [--threads N] [--seed N] [--pieces N] [--max-ticks N]
+//              [--bot beam|pc|mcts|random] [--width N] [--depth N] [--playouts N] [--weights file] [--network file] [--book file] [--budget ms] [--pps N]
+//              [--gravity G] [--lock-delay s] [--das s] [--arr s] [--sdf N] [--no-hold] [--no-srs]
+//              [--format csv|binary] [--out file]
+//
+// Per game statistics go to stdout (or --out), the totals (games/s, ticks/s) to stderr.
+// Attack and APM use the game's rules (AttackRules), whose back-to-back bonus is not capped: a bot
+// that never breaks its chain reports far more APM than any versus ruleset would give it.
+// --bot random mashes keys like tetris_bench does: the engine is most of the time spent, that
+// is the one to watch for engine performance work.
+// Games only depend on their seed, so the same command gives the same statistics
+// (unless --budget lets the bots think for a wall clock time)
+//
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include "../bot/thread_pool.h"
+#include "sim_games.h"
+#include "weights_file.h"
+
+namespace {
+    struct SimOptions {
+        int games = 100;
+        unsigned threads = 0; // 0 = every core
+        uint32_t seed = 1; // game i plays seed + i
+        SimGames::GameSettings game;
+        SimBotSettings bot;
+        bool binary = false;
+        std::string out; // empty = stdout
+    };
+
+    void writeCsv(std::ostream &out, const std::vector<SimGameRecord> &records) {
+        out << "game,seed,pieces,lines,attack,t_spins,perfect_clears,max_combo,ticks,top_out_tick,pps,apm\n";
+        for (const SimGameRecord &r : records) {
+            out << r.game << ',' << r.seed << ',' << r.pieces << ',' << r.lines << ',' << r.attack << ','
+                << r.tSpins << ',' << r.perfectClears << ',' << r.maxCombo << ',' << r.ticks << ','
+                << r.topOutTick << ',' << r.pps << ',' << r.apm << '\n';
+        }
+    }
+
+    void writeBinary(std::ostream &out, const std::vector<SimGameRecord> &records) {
+        SimFileHeader header;
+        header.count = static_cast<uint32_t>(records.size());
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(records.data()),
+                  static_cast<std::streamsize>(records.size() * sizeof(SimGameRecord)));
+    }
+
+    void printUsage(const char *program) {
+        std::cerr << "usage: " << program << " [--games N] [--threads N] [--seed N] [--pieces N] [--max-ticks N]\n"
+                  << "    [--bot beam|pc|mcts|random] [--width N] [--depth N] [--playouts N] [--weights file] [--network file] [--book file] [--budget ms] [--pps N]\n"
+                  << "    [--gravity G] [--lock-delay s] [--das s] [--arr s] [--sdf N] [--no-hold] [--no-srs]\n"
+                  << "    [--format csv|binary] [--out file]" << std::endl;
+    }
+
+    // throws std::invalid_argument on anything it doesn't know
+    SimOptions parseOptions(const int argc, char **argv, TetrisConfig &config) {
+        SimOptions options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string name = argv[i];
+            if (name == "--no-hold") {
+                config.setHoldEnabled(false);
+                continue;
+            }
+            if (name == "--no-srs") {
+                config.setSRSEnabled(false);
+                continue;
+            }
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + name);
+            const std::string value = argv[++i];
+
+            if (name == "--games") options.games = std::stoi(value);
+            else if (name == "--threads") options.threads = static_cast<unsigned>(std::stoul(value));
+            else if (name == "--seed") options.seed = static_cast<uint32_t>(std::stoul(value));
+            else if (name == "--pieces") options.game.pieces = std::stoi(value);
+            else if (name == "--max-ticks") options.game.maxTicks = std::stoll(value);
+            else if (name == "--bot") options.bot.bot = value;
+            else if (name == "--width") options.bot.beamWidth = std::stoi(value);
+            else if (name == "--depth") options.bot.depth = std::stoi(value);
+            else if (name == "--playouts") options.bot.playouts = std::stoi(value);
+            else if (name == "--weights") options.bot.weights = WeightsFile::read(value);
+            else if (name == "--network") options.bot.network = NnEval::load(value);
+            else if (name == "--book") options.bot.book = OpeningBook::open(value);
+            else if (name == "--budget") options.bot.budgetMs = std::stod(value);
+            else if (name == "--pps") options.game.pps = std::stod(value);
+            else if (name == "--gravity") config.setGravity(std::stod(value));
+            else if (name == "--lock-delay") config.setSecondsBeforePieceLock(std::stod(value));
+            else if (name == "--das") config.setDelayedAutoShift(std::stod(value));
+            else if (name == "--arr") config.setAutoRepeatRate(std::stod(value));
+            else if (name == "--sdf") config.setSoftDropFactor(std::stoll(value));
+            else if (name == "--format") {
+                if (value != "csv" && value != "binary") throw std::invalid_argument("Unknown format: " + value);
+                options.binary = value == "binary";
+            } else if (name == "--out") options.out = value;
+            else throw std::invalid_argument("Unknown option: " + name);
+        }
+        if (options.bot.bot != "beam" && options.bot.bot != "pc" && options.bot.bot != "mcts" && options.bot.bot != "random") throw std::invalid_argument("Unknown bot: " + options.bot.bot);
+        if (options.games < 1 || options.game.pieces < 1 || options.bot.beamWidth < 1 || options.bot.depth < 1 || options.bot.playouts < 1) {
+            throw std::invalid_argument("Counts must be positive!");
+        }
+        if (options.binary && options.out.empty()) throw std::invalid_argument("Binary output needs --out");
+        return options;
+    }
+}
+
+int main(int argc, char **argv) {
+    TetrisConfig *config = TetrisConfig::builder();
+    SimOptions options;
+    try {
+        options = parseOptions(argc, argv, *config);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        delete config;
+        return 1;
+    }
+
+    // one bot per thread, every game of that thread reuses it
+    ThreadPool pool(options.threads);
+    std::vector<std::unique_ptr<SimBot>> bots(pool.size());
+    std::vector<SimGameRecord> records(options.games);
+    const auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(options.games, [&](const int game, const int worker) {
+        if (bots[worker] == nullptr) bots[worker] = std::make_unique<SimBot>(options.bot, *config);
+        records[game] = SimGames::playGame(*config, *bots[worker], options.seed + static_cast<uint32_t>(game), options.game);
+        records[game].game = static_cast<uint32_t>(game);
+    });
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (options.out.empty()) {
+        writeCsv(std::cout, records);
+    } else {
+        std::ofstream file(options.out, options.binary ? std::ios::binary : std::ios::out);
+        if (!file) {
+            std::cerr << "Cannot write " << options.out << std::endl;
+            delete config;
+            return 1;
+        }
+        if (options.binary) writeBinary(file, records);
+        else writeCsv(file, records);
+    }
+
+    long long ticks = 0, pieces = 0, lines = 0, topOuts = 0;
+    double pps = 0, apm = 0;
+    for (const SimGameRecord &r : records) {
+        ticks += r.ticks;
+        pieces += r.pieces;
+        lines += r.lines;
+        topOuts += r.topOutTick >= 0;
+        pps += r.pps;
+        apm += r.apm;
+    }
+    std::cerr << options.games << " games on " << pool.size() << " threads in " << elapsed << " s: "
+              << options.games / elapsed << " games/s, " << ticks / elapsed / 1e6 << " M ticks/s, "
+              << pieces / elapsed << " pieces/s\n"
+              << "per game: " << static_cast<double>(pieces) / options.games << " pieces, "
+              << static_cast<double>(lines) / options.games << " lines, " << pps / options.games << " PPS, "
+              << apm / options.games << " APM (uncapped back-to-back bonus), " << topOuts << " top outs" << std::endl;
+    delete config;
+    return 0;
+}
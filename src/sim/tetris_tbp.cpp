@@ -0,0 +1,159 @@
+// The beam search bot on the other side of the external bot protocol (bot_protocol.h):
+// reads the game on stdin, answers on stdout. A reference for whoever writes a bot of their own,
+// and what `tetris_bench external` and the game's -bot flag are tried with
+//   tetris_tbp [--width N] [--depth N] [--budget ms] [--threads N] [--weights file] [--network file] [--book file]
+//
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <cstring>
+#include "../bot/beam_search_bot.h"
+#include "../bot/bot_protocol.h"
+#include "../bot/opening_book.h"
+#include "weights_file.h"
+
+namespace {
+    // what the bot believes the game is, kept up to date from the play lines
+    struct TbpGame {
+        bool started = false;
+        uint16_t rows[Bitboard::HEIGHT] = {};
+        int8_t hold = -1;
+        std::string queue; // piece letters, the falling one first
+        int comboCount = -1;
+        bool backToBack = false;
+    };
+
+    void printUsage(const char *program) {
+        std::cerr << "usage: " << program << " [--width N] [--depth N] [--budget ms] [--threads N] [--weights file] [--network file] [--book file]" << std::endl;
+    }
+
+    // throws std::invalid_argument on anything it doesn't know
+    BeamSearchBot::Settings parseOptions(const int argc, char **argv) {
+        BeamSearchBot::Settings settings;
+        settings.beamWidth = 64;
+        settings.maxDepth = 4;
+        settings.timeBudgetMs = 50;
+        for (int i = 1; i < argc; ++i) {
+            const std::string name = argv[i];
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + name);
+            const std::string value = argv[++i];
+
+            if (name == "--width") settings.beamWidth = std::stoi(value);
+            else if (name == "--depth") settings.maxDepth = std::stoi(value);
+            else if (name == "--budget") settings.timeBudgetMs = std::stod(value);
+            else if (name == "--threads") settings.threads = static_cast<unsigned>(std::stoul(value));
+            else if (name == "--weights") settings.weights = WeightsFile::read(value);
+            else if (name == "--network") settings.network = NnEval::load(value);
+            else if (name == "--book") settings.book = OpeningBook::open(value);
+            else throw std::invalid_argument("Unknown option: " + name);
+        }
+        if (settings.beamWidth < 1 || settings.maxDepth < 1) throw std::invalid_argument("Counts must be positive!");
+        return settings;
+    }
+
+    // start <hold> <queue> <combo> <b2b> <rows...>
+    bool readStart(std::istringstream &in, TbpGame &game) {
+        std::string hold;
+        int backToBack;
+        if (!(in >> hold >> game.queue >> game.comboCount >> backToBack)) return false;
+        game.hold = static_cast<int8_t>(hold.size() == 1 ? BotProtocol::pieceFromLetter(hold[0]) : -1);
+        game.backToBack = backToBack != 0;
+        for (uint16_t &row: game.rows) {
+            if (!(in >> row)) return false;
+        }
+        for (const char piece: game.queue) {
+            if (BotProtocol::pieceFromLetter(piece) < 0) return false;
+        }
+        game.started = true;
+        return true;
+    }
+
+    std::string suggest(BeamSearchBot &bot, const TbpGame &game) {
+        if (!game.started || game.queue.empty()) return "suggestion";
+        BotInput input;
+        std::memcpy(input.rows, game.rows, sizeof(input.rows));
+        input.fallingType = static_cast<int8_t>(BotProtocol::pieceFromLetter(game.queue[0]));
+        input.fallingX = static_cast<int8_t>(Bitboard::spawnX(input.fallingType));
+        input.fallingY = Bitboard::SPAWN_Y;
+        input.holdType = game.hold;
+        input.nextQueueSize = static_cast<int8_t>(std::min<size_t>(game.queue.size() - 1, STATE_MAX_NEXT_QUEUE));
+        for (int i = 0; i < input.nextQueueSize; ++i) {
+            input.nextQueue[i] = static_cast<int8_t>(BotProtocol::pieceFromLetter(game.queue[i + 1]));
+        }
+        input.comboCount = game.comboCount;
+        input.backToBack = game.backToBack;
+
+        const BotDecision decision = bot.search(input);
+        if (!decision.found) return "suggestion";
+        BotProtocol::Move move;
+        move.type = !decision.useHold ? input.fallingType : game.hold >= 0 ? game.hold : input.nextQueue[0];
+        move.placement = decision.placement;
+        return "suggestion " + BotProtocol::formatMove(move);
+    }
+
+    // play <P> <rot> <x> <y> <spin>
+    bool play(std::istringstream &in, TbpGame &game) {
+        BotProtocol::Move move;
+        if (!game.started || !BotProtocol::readMove(in, move)) return false;
+        if (!Bitboard::fits(game.rows, move.type, move.placement.rotation, move.placement.x, move.placement.y)) return false;
+        if (!BotProtocol::takePiece(game.queue, game.hold, move.type)) return false;
+        const int cleared = BotProtocol::lockPiece(game.rows, move.type, move.placement);
+        // same bookkeeping as the engine
+        if (cleared > 0) {
+            ++game.comboCount;
+            game.backToBack = SRS::isDifficultClear(cleared, move.placement.spin);
+        } else {
+            game.comboCount = -1;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv) {
+    BeamSearchBot::Settings settings;
+    try {
+        settings = parseOptions(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    BeamSearchBot bot(settings);
+    TbpGame game;
+
+    std::cout << "info tetris_tbp beam " << settings.beamWidth << "x" << settings.maxDepth << std::endl;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+        if (command == "rules") {
+            std::cout << "ready" << std::endl;
+        } else if (command == "start") {
+            game = TbpGame();
+            if (!readStart(in, game)) {
+                std::cerr << "bad start: " << line << std::endl;
+                game.started = false;
+            }
+        } else if (command == "new_piece") {
+            std::string piece;
+            if (in >> piece && piece.size() == 1 && BotProtocol::pieceFromLetter(piece[0]) >= 0) game.queue += piece;
+            else game.started = false; // lost track, the game starts over on the next piece
+        } else if (command == "suggest") {
+            std::cout << suggest(bot, game) << std::endl;
+        } else if (command == "play") {
+            // the game checks the board against its own on the next piece and starts over if it has to
+            if (!play(in, game)) game.started = false;
+        } else if (command == "stop") {
+            game = TbpGame();
+        } else if (command == "quit") {
+            break;
+        } else if (!command.empty()) {
+            std::cerr << "unknown command: " << line << std::endl;
+        }
+    }
+    return 0;
+}
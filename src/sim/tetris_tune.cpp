@@ -0,0 +1,469 @@
+// Evolves the board evaluation weights of the bots on headless games, every core busy
+//   tetris_tune [--generations N] [--population N] [--method cma|ga] [--sigma S]
+//               [--games N] [--pieces N] [--pps N] [--pve N] [--minutes N]
+//               [--score-lines W] [--score-apm W] [--score-wave W]
+//               [--bot beam|mcts] [--width N] [--depth N] [--playouts N] [--weights file]
+//               [--threads N] [--seed N] [--checkpoint file] [--resume] [--out file]
+//
+// A candidate plays --games marathon games and --pve campaign sessions, its fitness is
+//   score-lines * lines + score-apm * APM (per game) + score-wave * the wave reached (per session)
+// Every candidate of a generation plays the same seeds, the next generation moves on to new ones
+// (seed + generation * games), so a comparison is always on the same pieces.
+//
+// cma is a separable CMA-ES (a diagonal covariance, 20 weights don't need more), ga a genetic
+// algorithm (tournaments, uniform crossover, gaussian mutations, the best 2 survive).
+// The search runs on weights scaled by their defaults, --sigma is in those units.
+//
+// One line per generation goes to stdout, --checkpoint is rewritten after each of them
+// (--resume starts from it) and --out gets the best weights so far (read them back with
+// tetris_sim --weights)
+//
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <sstream>
+#include <random>
+#include <numeric>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "../bot/thread_pool.h"
+#include "sim_games.h"
+#include "weights_file.h"
+
+namespace {
+    struct TuneOptions {
+        int generations = 30;
+        int population = 16;
+        bool genetic = false; // --method ga
+        double sigma = 0.3;
+        int games = 4; // per candidate
+        SimGames::GameSettings game;
+        int pveSessions = 1; // per candidate
+        double minutes = 10; // of game time per session
+        double scoreLines = 1, scoreApm = 0.1, scoreWave = 10; // about the same share each with the defaults
+        SimBotSettings bot;
+        unsigned threads = 0; // 0 = every core
+        uint32_t seed = 1;
+        std::string checkpoint = "tetris_tune.checkpoint";
+        bool resume = false;
+        std::string out = "tetris_tune.weights";
+    };
+
+    /**
+     * Where a run is, everything a checkpoint holds
+     */
+    struct TuneState {
+        int generation = 0;
+        double sigma = 0;
+        std::vector<double> mean, variance, pathC, pathSigma; // cma
+        std::vector<std::vector<double>> population; // ga, the last generation best first
+        std::vector<double> fitness; // ga, of population
+        std::vector<double> best;
+        double bestFitness = -1e300;
+    };
+
+    // the search space: weight = default + x * |default| (0.25 at least), so that x is about the same size for every weight
+    std::vector<double> scales() {
+        std::vector<double> result;
+        for (const float value: WeightsFile::toVector(BotWeights())) result.push_back(std::max(0.25, std::fabs(static_cast<double>(value))));
+        return result;
+    }
+
+    BotWeights toWeights(const std::vector<double> &x) {
+        const std::vector<float> defaults = WeightsFile::toVector(BotWeights());
+        const std::vector<double> scale = scales();
+        std::vector<float> values(x.size());
+        for (size_t i = 0; i < x.size(); ++i) values[i] = static_cast<float>(defaults[i] + x[i] * scale[i]);
+        return WeightsFile::fromVector(values);
+    }
+
+    /**
+     * Plays every candidate on the seeds of the generation
+     * @return the fitness of each candidate
+     */
+    std::vector<double> evaluate(const TuneOptions &options, TetrisConfig &config, ThreadPool &pool,
+                                 const std::vector<std::vector<double>> &candidates, const int generation) {
+        const int perCandidate = options.games + options.pveSessions;
+        const uint32_t firstSeed = options.seed + static_cast<uint32_t>(generation * perCandidate);
+        std::vector<double> scores(candidates.size() * perCandidate, 0);
+        const PveRules rules = defaultPveRules();
+
+        pool.parallelFor(static_cast<int>(scores.size()), [&](const int job, int) {
+            const int run = job % perCandidate;
+            SimBotSettings botSettings = options.bot;
+            botSettings.weights = toWeights(candidates[job / perCandidate]);
+            SimBot bot(botSettings, config);
+            if (run < options.games) {
+                const SimGameRecord record = SimGames::playGame(config, bot, firstSeed + run, options.game);
+                scores[job] = (options.scoreLines * record.lines + options.scoreApm * record.apm) / options.games;
+            } else {
+                PveSettings settings;
+                settings.seed = firstSeed + run;
+                settings.maxTicks = static_cast<long long>(options.minutes * 60 * EngineTimer::TARGETTED_TICK_RATE);
+                const PveResult result = SimGames::playPveSession(rules, config, bot, settings, options.game.pps,
+                                                                  SimGames::LANES_FOCUS);
+                scores[job] = options.scoreWave * result.wave / options.pveSessions;
+            }
+        });
+
+        std::vector<double> fitness(candidates.size(), 0);
+        for (size_t job = 0; job < scores.size(); ++job) fitness[job / perCandidate] += scores[job];
+        return fitness;
+    }
+
+    // the candidates from best to worst
+    std::vector<int> ranking(const std::vector<double> &fitness) {
+        std::vector<int> order(fitness.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&fitness](const int a, const int b) { return fitness[a] > fitness[b]; });
+        return order;
+    }
+
+    /**
+     * Separable CMA-ES (Ros & Hansen 2008): the covariance is diagonal, the rest is the usual
+     * (mu/mu_w, lambda) update, maximizing
+     */
+    class SeparableCma {
+    public:
+        SeparableCma(const int dimensions, const int lambda) : n(dimensions), lambda(lambda), mu(lambda / 2) {
+            for (int i = 0; i < mu; ++i) weights.push_back(std::log(mu + 0.5) - std::log(i + 1.0));
+            const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+            double squares = 0;
+            for (double &w: weights) {
+                w /= sum;
+                squares += w * w;
+            }
+            muEff = 1 / squares;
+            cc = (4 + muEff / n) / (n + 4 + 2 * muEff / n);
+            cs = (muEff + 2) / (n + muEff + 5);
+            // the diagonal learns (n + 2) / 3 times faster than a full matrix would
+            c1 = std::min(1.0, 2 / ((n + 1.3) * (n + 1.3) + muEff) * (n + 2) / 3);
+            cmu = std::min(1 - c1, 2 * (muEff - 2 + 1 / muEff) / ((n + 2) * (n + 2) + muEff) * (n + 2) / 3);
+            damps = 1 + 2 * std::max(0.0, std::sqrt((muEff - 1) / (n + 1)) - 1) + cs;
+            chiN = std::sqrt(n) * (1 - 1.0 / (4 * n) + 1.0 / (21.0 * n * n));
+        }
+
+        std::vector<std::vector<double>> sample(const TuneState &state, std::mt19937_64 &random) const {
+            std::normal_distribution<double> normal;
+            std::vector<std::vector<double>> candidates(lambda, std::vector<double>(n));
+            for (auto &x: candidates) {
+                for (int i = 0; i < n; ++i) x[i] = state.mean[i] + state.sigma * std::sqrt(state.variance[i]) * normal(random);
+            }
+            return candidates;
+        }
+
+        void update(TuneState &state, const std::vector<std::vector<double>> &candidates, const std::vector<double> &fitness) const {
+            const std::vector<int> order = ranking(fitness);
+            // the steps of the best mu, in units of sigma
+            std::vector<std::vector<double>> steps(mu, std::vector<double>(n));
+            std::vector<double> meanStep(n, 0);
+            for (int k = 0; k < mu; ++k) {
+                for (int i = 0; i < n; ++i) {
+                    steps[k][i] = (candidates[order[k]][i] - state.mean[i]) / state.sigma;
+                    meanStep[i] += weights[k] * steps[k][i];
+                }
+            }
+
+            double pathNorm = 0;
+            for (int i = 0; i < n; ++i) {
+                state.mean[i] += state.sigma * meanStep[i];
+                state.pathSigma[i] = (1 - cs) * state.pathSigma[i] + std::sqrt(cs * (2 - cs) * muEff) * meanStep[i] / std::sqrt(state.variance[i]);
+                pathNorm += state.pathSigma[i] * state.pathSigma[i];
+            }
+            pathNorm = std::sqrt(pathNorm);
+            const double decay = 1 - std::pow(1 - cs, 2.0 * (state.generation + 1));
+            const bool stalled = pathNorm / std::sqrt(decay) / chiN >= 1.4 + 2.0 / (n + 1);
+
+            for (int i = 0; i < n; ++i) {
+                state.pathC[i] = (1 - cc) * state.pathC[i] + (stalled ? 0 : std::sqrt(cc * (2 - cc) * muEff) * meanStep[i]);
+                double rankMu = 0;
+                for (int k = 0; k < mu; ++k) rankMu += weights[k] * steps[k][i] * steps[k][i];
+                state.variance[i] = (1 - c1 - cmu) * state.variance[i]
+                                    + c1 * (state.pathC[i] * state.pathC[i] + (stalled ? cc * (2 - cc) * state.variance[i] : 0))
+                                    + cmu * rankMu;
+            }
+            state.sigma *= std::exp(cs / damps * (pathNorm / chiN - 1));
+        }
+
+    private:
+        int n, lambda, mu;
+        std::vector<double> weights;
+        double muEff, cc, cs, c1, cmu, damps, chiN;
+    };
+
+    /**
+     * A plain genetic algorithm: tournaments of 3, uniform crossover, gaussian mutations
+     * (sigma on 1 gene in 4), the best 2 go on unchanged
+     */
+    std::vector<std::vector<double>> breed(const TuneState &state, const int size, std::mt19937_64 &random) {
+        const int n = static_cast<int>(state.best.size());
+        std::normal_distribution<double> normal;
+        std::uniform_int_distribution<int> pick(0, static_cast<int>(state.population.size()) - 1);
+        std::uniform_real_distribution<double> coin(0, 1);
+
+        // the population is sorted best first, the lowest index of a tournament wins
+        const auto tournament = [&]() {
+            return std::min({pick(random), pick(random), pick(random)});
+        };
+
+        std::vector<std::vector<double>> children;
+        for (int elite = 0; elite < 2 && elite < static_cast<int>(state.population.size()); ++elite) {
+            children.push_back(state.population[elite]);
+        }
+        while (static_cast<int>(children.size()) < size) {
+            const std::vector<double> &mother = state.population[tournament()];
+            const std::vector<double> &father = state.population[tournament()];
+            std::vector<double> child(n);
+            for (int i = 0; i < n; ++i) {
+                child[i] = coin(random) < 0.5 ? mother[i] : father[i];
+                if (coin(random) < 0.25) child[i] += state.sigma * normal(random);
+            }
+            children.push_back(std::move(child));
+        }
+        return children;
+    }
+
+    void writeVector(std::ostream &out, const char *name, const std::vector<double> &values) {
+        out << name;
+        for (const double value: values) out << ' ' << value;
+        out << '\n';
+    }
+
+    // rewritten whole after every generation (through a temporary file, a crash keeps the last one)
+    void writeCheckpoint(const std::string &path, const TuneOptions &options, const TuneState &state) {
+        const std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary);
+            if (!out) throw std::runtime_error("Cannot write " + temporary);
+            out.precision(17);
+            out << "method " << (options.genetic ? "ga" : "cma") << '\n'
+                << "generation " << state.generation << '\n'
+                << "sigma " << state.sigma << '\n'
+                << "best_fitness " << state.bestFitness << '\n';
+            writeVector(out, "best", state.best);
+            if (options.genetic) {
+                for (size_t i = 0; i < state.population.size(); ++i) {
+                    out << "individual " << state.fitness[i];
+                    for (const double value: state.population[i]) out << ' ' << value;
+                    out << '\n';
+                }
+            } else {
+                writeVector(out, "mean", state.mean);
+                writeVector(out, "variance", state.variance);
+                writeVector(out, "path_c", state.pathC);
+                writeVector(out, "path_sigma", state.pathSigma);
+            }
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) throw std::runtime_error("Cannot replace " + path);
+    }
+
+    // throws std::invalid_argument if the checkpoint is not one of this method
+    TuneState readCheckpoint(const std::string &path, const TuneOptions &options, const int dimensions) {
+        std::ifstream in(path);
+        if (!in) throw std::invalid_argument("Cannot read " + path);
+        TuneState state;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::stringstream stream(line);
+            std::string key;
+            stream >> key;
+            std::vector<double> values;
+            for (double value; stream >> value;) values.push_back(value);
+            if (key == "method" && (line.substr(7) == "ga") != options.genetic) {
+                throw std::invalid_argument(path + " is a checkpoint of the other method");
+            }
+            if (values.empty()) continue;
+            if (key == "generation") state.generation = static_cast<int>(values[0]);
+            else if (key == "sigma") state.sigma = values[0];
+            else if (key == "best_fitness") state.bestFitness = values[0];
+            else if (key == "best") state.best = values;
+            else if (key == "mean") state.mean = values;
+            else if (key == "variance") state.variance = values;
+            else if (key == "path_c") state.pathC = values;
+            else if (key == "path_sigma") state.pathSigma = values;
+            else if (key == "individual") {
+                state.fitness.push_back(values[0]);
+                state.population.emplace_back(values.begin() + 1, values.end());
+            }
+        }
+        const auto fits = [dimensions](const std::vector<double> &v) { return static_cast<int>(v.size()) == dimensions; };
+        const bool complete = options.genetic
+                              ? !state.population.empty() && std::all_of(state.population.begin(), state.population.end(), fits)
+                              : fits(state.mean) && fits(state.variance) && fits(state.pathC) && fits(state.pathSigma);
+        if (!complete || !fits(state.best)) throw std::invalid_argument(path + " doesn't match these weights");
+        return state;
+    }
+
+    void printUsage(const char *program) {
+        std::cerr << "usage: " << program << " [--generations N] [--population N] [--method cma|ga] [--sigma S]\n"
+                  << "    [--games N] [--pieces N] [--pps N] [--pve N] [--minutes N]\n"
+                  << "    [--score-lines W] [--score-apm W] [--score-wave W]\n"
+                  << "    [--bot beam|mcts] [--width N] [--depth N] [--playouts N] [--weights file]\n"
+                  << "    [--threads N] [--seed N] [--checkpoint file] [--resume] [--out file]" << std::endl;
+    }
+
+    // throws std::invalid_argument on anything it doesn't know
+    TuneOptions parseOptions(const int argc, char **argv) {
+        TuneOptions options;
+        // cheap games by default, a run is thousands of them
+        options.game.pieces = 300;
+        options.game.pps = 3;
+        options.bot.beamWidth = 8;
+        options.bot.depth = 2;
+        for (int i = 1; i < argc; ++i) {
+            const std::string name = argv[i];
+            if (name == "--resume") {
+                options.resume = true;
+                continue;
+            }
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + name);
+            const std::string value = argv[++i];
+
+            if (name == "--generations") options.generations = std::stoi(value);
+            else if (name == "--population") options.population = std::stoi(value);
+            else if (name == "--method") {
+                if (value != "cma" && value != "ga") throw std::invalid_argument("Unknown method: " + value);
+                options.genetic = value == "ga";
+            } else if (name == "--sigma") options.sigma = std::stod(value);
+            else if (name == "--games") options.games = std::stoi(value);
+            else if (name == "--pieces") options.game.pieces = std::stoi(value);
+            else if (name == "--pps") options.game.pps = std::stod(value);
+            else if (name == "--pve") options.pveSessions = std::stoi(value);
+            else if (name == "--minutes") options.minutes = std::stod(value);
+            else if (name == "--score-lines") options.scoreLines = std::stod(value);
+            else if (name == "--score-apm") options.scoreApm = std::stod(value);
+            else if (name == "--score-wave") options.scoreWave = std::stod(value);
+            else if (name == "--bot") options.bot.bot = value;
+            else if (name == "--width") options.bot.beamWidth = std::stoi(value);
+            else if (name == "--depth") options.bot.depth = std::stoi(value);
+            else if (name == "--playouts") options.bot.playouts = std::stoi(value);
+            else if (name == "--weights") options.bot.weights = WeightsFile::read(value);
+            else if (name == "--threads") options.threads = static_cast<unsigned>(std::stoul(value));
+            else if (name == "--seed") options.seed = static_cast<uint32_t>(std::stoul(value));
+            else if (name == "--checkpoint") options.checkpoint = value;
+            else if (name == "--out") options.out = value;
+            else throw std::invalid_argument("Unknown option: " + name);
+        }
+        if (options.bot.bot != "beam" && options.bot.bot != "mcts") throw std::invalid_argument("Unknown bot: " + options.bot.bot);
+        if (options.generations < 1 || options.population < 4 || options.games < 0 || options.pveSessions < 0
+            || options.games + options.pveSessions < 1 || options.game.pieces < 1 || options.sigma <= 0) {
+            throw std::invalid_argument("Counts must be positive (and the population at least 4)!");
+        }
+        return options;
+    }
+}
+
+int main(int argc, char **argv) {
+    TuneOptions options;
+    TetrisConfig *config = TetrisConfig::builder();
+    // --weights is where the search starts, the scales stay the ones of the defaults
+    std::vector<double> start;
+    try {
+        options = parseOptions(argc, argv);
+        const std::vector<float> initial = WeightsFile::toVector(options.bot.weights);
+        const std::vector<float> defaults = WeightsFile::toVector(BotWeights());
+        const std::vector<double> scale = scales();
+        for (size_t i = 0; i < initial.size(); ++i) start.push_back((initial[i] - defaults[i]) / scale[i]);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        delete config;
+        return 1;
+    }
+
+    const int dimensions = static_cast<int>(start.size());
+    const SeparableCma cma(dimensions, options.population);
+    TuneState state;
+    try {
+        if (options.resume) {
+            state = readCheckpoint(options.checkpoint, options, dimensions);
+        } else {
+            state.sigma = options.sigma;
+            state.best = start;
+            state.mean = start;
+            state.variance.assign(dimensions, 1.0);
+            state.pathC.assign(dimensions, 0.0);
+            state.pathSigma.assign(dimensions, 0.0);
+            // the first generation of the genetic algorithm: the start, and mutants of it
+            std::mt19937_64 random(options.seed);
+            std::normal_distribution<double> normal;
+            state.population.push_back(start);
+            while (static_cast<int>(state.population.size()) < options.population) {
+                std::vector<double> x = start;
+                for (double &value: x) value += options.sigma * normal(random);
+                state.population.push_back(std::move(x));
+            }
+            state.fitness.assign(state.population.size(), 0);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        delete config;
+        return 1;
+    }
+
+    ThreadPool pool(options.threads);
+    const int perCandidate = options.games + options.pveSessions;
+    long long played = 0;
+    const auto runStart = std::chrono::steady_clock::now();
+    std::cout << "generation,best_fitness,mean_fitness,best_ever,sigma,games,games_per_s" << std::endl;
+
+    // the first generation of the genetic algorithm is scored as it is, breeding starts after it
+    const bool fresh = options.genetic && !options.resume;
+    for (int round = 0; round < options.generations; ++round) {
+        // reseeded every generation, so a resumed run goes on exactly like the one it continues
+        std::mt19937_64 random(options.seed * 0x9E3779B97F4A7C15ULL + state.generation);
+        const std::vector<std::vector<double>> candidates =
+                !options.genetic ? cma.sample(state, random)
+                                 : (fresh && round == 0 ? state.population : breed(state, options.population, random));
+
+        const auto generationStart = std::chrono::steady_clock::now();
+        const std::vector<double> fitness = evaluate(options, *config, pool, candidates, state.generation);
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - generationStart).count();
+        const int games = static_cast<int>(candidates.size()) * perCandidate;
+        played += games;
+
+        const std::vector<int> order = ranking(fitness);
+        if (fitness[order[0]] > state.bestFitness) {
+            state.bestFitness = fitness[order[0]];
+            state.best = candidates[order[0]];
+        }
+        if (options.genetic) {
+            state.population.clear();
+            state.fitness.clear();
+            for (const int index: order) {
+                state.population.push_back(candidates[index]);
+                state.fitness.push_back(fitness[index]);
+            }
+        } else {
+            cma.update(state, candidates, fitness);
+        }
+        ++state.generation;
+
+        const double meanFitness = std::accumulate(fitness.begin(), fitness.end(), 0.0) / fitness.size();
+        std::cout << state.generation << ',' << fitness[order[0]] << ',' << meanFitness << ',' << state.bestFitness << ','
+                  << state.sigma << ',' << games << ',' << games / elapsed << std::endl;
+
+        try {
+            writeCheckpoint(options.checkpoint, options, state);
+            std::ofstream out(options.out);
+            if (!out) throw std::runtime_error("Cannot write " + options.out);
+            out << "# tetris_tune, generation " << state.generation << ", fitness " << state.bestFitness << '\n';
+            WeightsFile::write(out, toWeights(state.best));
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            delete config;
+            return 1;
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    std::cerr << played << " games on " << pool.size() << " threads in " << elapsed << " s: "
+              << played / elapsed << " games/s, best fitness " << state.bestFitness << " (" << options.out << ")" << std::endl;
+    delete config;
+    return 0;
+}
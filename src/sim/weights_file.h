@@ -0,0 +1,92 @@
+#ifndef TETISENGINE_WEIGHTS_FILE_H
+#define TETISENGINE_WEIGHTS_FILE_H
+#pragma once
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../bot/board_eval.h"
+
+/**
+ * BotWeights as a flat list of named numbers: what tetris_tune evolves, and the
+ * "name value" text files it writes (tetris_sim and tetris_pve read them back with --weights)
+ */
+namespace WeightsFile {
+    struct Slot {
+        const char *name;
+        float &(*get)(BotWeights &);
+    };
+
+    inline const std::vector<Slot> &slots() {
+        static const std::vector<Slot> all = {
+                {"aggregate_height", [](BotWeights &w) -> float & { return w.aggregateHeight; }},
+                {"danger_height", [](BotWeights &w) -> float & { return w.dangerHeight; }},
+                {"holes", [](BotWeights &w) -> float & { return w.holes; }},
+                {"covered_holes", [](BotWeights &w) -> float & { return w.coveredHoles; }},
+                {"bumpiness", [](BotWeights &w) -> float & { return w.bumpiness; }},
+                {"row_transitions", [](BotWeights &w) -> float & { return w.rowTransitions; }},
+                {"well_depth", [](BotWeights &w) -> float & { return w.wellDepth; }},
+                {"t_slot", [](BotWeights &w) -> float & { return w.tSlot; }},
+                {"clear_1", [](BotWeights &w) -> float & { return w.clears[1]; }},
+                {"clear_2", [](BotWeights &w) -> float & { return w.clears[2]; }},
+                {"clear_3", [](BotWeights &w) -> float & { return w.clears[3]; }},
+                {"clear_4", [](BotWeights &w) -> float & { return w.clears[4]; }},
+                {"t_spin_0", [](BotWeights &w) -> float & { return w.tSpin[0]; }},
+                {"t_spin_1", [](BotWeights &w) -> float & { return w.tSpin[1]; }},
+                {"t_spin_2", [](BotWeights &w) -> float & { return w.tSpin[2]; }},
+                {"t_spin_3", [](BotWeights &w) -> float & { return w.tSpin[3]; }},
+                {"mini_spin", [](BotWeights &w) -> float & { return w.miniSpin; }},
+                {"perfect_clear", [](BotWeights &w) -> float & { return w.perfectClear; }},
+                {"combo", [](BotWeights &w) -> float & { return w.combo; }},
+                {"back_to_back", [](BotWeights &w) -> float & { return w.backToBack; }},
+        };
+        return all;
+    }
+
+    inline std::vector<float> toVector(BotWeights weights) {
+        std::vector<float> values;
+        for (const Slot &slot: slots()) values.push_back(slot.get(weights));
+        return values;
+    }
+
+    inline BotWeights fromVector(const std::vector<float> &values) {
+        BotWeights weights;
+        for (size_t i = 0; i < slots().size() && i < values.size(); ++i) slots()[i].get(weights) = values[i];
+        return weights;
+    }
+
+    inline void write(std::ostream &out, BotWeights weights) {
+        for (const Slot &slot: slots()) out << slot.name << ' ' << slot.get(weights) << '\n';
+    }
+
+    /**
+     * "name value" per line, # starts a comment, the weights it doesn't mention keep their defaults
+     * @throws std::invalid_argument if the file can't be read or has a name it doesn't know
+     */
+    inline BotWeights read(const std::string &path) {
+        std::ifstream file(path);
+        if (!file) throw std::invalid_argument("Cannot read " + path);
+        BotWeights weights;
+        std::string line;
+        while (std::getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            std::stringstream stream(line);
+            std::string name;
+            float value;
+            if (!(stream >> name)) continue;
+            if (!(stream >> value)) throw std::invalid_argument("Missing value for " + name + " in " + path);
+            bool known = false;
+            for (const Slot &slot: slots()) {
+                if (name != slot.name) continue;
+                slot.get(weights) = value;
+                known = true;
+            }
+            if (!known) throw std::invalid_argument("Unknown weight " + name + " in " + path);
+        }
+        return weights;
+    }
+}
+
+#endif //TETISENGINE_WEIGHTS_FILE_H